@@ -1,5 +1,6 @@
 use std::path::PathBuf;
 
+use anise::structure::compact::CompactEncoding;
 use clap::{Parser, Subcommand};
 use hifitime::Epoch;
 
@@ -10,7 +11,7 @@ pub struct Args {
     pub action: Actions,
 }
 
-#[derive(Debug, PartialEq, Eq, PartialOrd, Subcommand)]
+#[derive(Debug, PartialEq, PartialOrd, Subcommand)]
 pub enum Actions {
     /// Checks the integrity of the file
     Check {
@@ -40,6 +41,20 @@ pub enum Actions {
         /// Output ANISE binary file
         outfile: PathBuf,
     },
+    /// Convert the Chebyshev Type 2 and Hermite Type 13 segments of an SPK into a compact ANISE ephemeris
+    /// Each segment uses the smallest encoding whose position error is within the tolerance, unless an encoding is provided.
+    ConvertCompact {
+        /// Input SPK file
+        input: PathBuf,
+        /// Output compact ephemeris file
+        output: PathBuf,
+        /// Maximum position error of each segment in kilometers, zero keeps all of the coefficients exactly
+        #[clap(long, default_value_t = 0.0)]
+        tolerance_km: f64,
+        /// Encoding of all of the segments: f64, f32, or quantized (Chebyshev only)
+        #[clap(long)]
+        encoding: Option<CompactEncoding>,
+    },
     /// Truncate the segment of the provided ID of the input NAIF DAF file to the provided start and end epochs
     /// Limitation: this may not work correctly if there are several segments with the same ID.
     /// Only works with Chebyshev Type 2 data types (i.e. planetary ephemerides).
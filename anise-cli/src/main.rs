@@ -1,7 +1,9 @@
 extern crate pretty_env_logger;
 use std::collections::HashSet;
 use std::env::{set_var, var};
+use std::fs::copy;
 use std::io;
+use std::path::Path;
 
 use anise::naif::daf::datatypes::Type2ChebyshevSet;
 use anise::naif::daf::{DafDataType, NAIFDataSet};
@@ -13,7 +15,9 @@ use zerocopy::FromBytes;
 use anise::file2heap;
 use anise::naif::daf::{file_record::FileRecordError, DAFError, FileRecord, NAIFRecord};
 use anise::naif::kpl::parser::{convert_fk, convert_tpc};
+use anise::naif::{BPCWriter, SPKWriter};
 use anise::prelude::*;
+use anise::structure::compact::{CompactEphemeris, CompactError, CompactOptions, COMPACT_MAGIC};
 use anise::structure::dataset::{DataSetError, DataSetType};
 use anise::structure::metadata::Metadata;
 use anise::structure::{EulerParameterDataSet, PlanetaryDataSet, SpacecraftDataSet};
@@ -46,6 +50,9 @@ pub enum CliErrors {
     AniseError {
         source: InputOutputError,
     },
+    CliCompact {
+        source: CompactError,
+    },
 }
 
 fn main() -> Result<(), CliErrors> {
@@ -115,6 +122,13 @@ fn main() -> Result<(), CliErrors> {
         Actions::Inspect { file } => {
             let path_str = file.clone();
             let bytes = file2heap!(file).context(AniseSnafu)?;
+            if bytes.starts_with(&COMPACT_MAGIC) {
+                info!("Loading {path_str:?} as a compact ephemeris");
+                let compact = CompactEphemeris::from_bytes(bytes).context(CliCompactSnafu)?;
+                compact.check_integrity().context(CliCompactSnafu)?;
+                println!("{compact}");
+                return Ok(());
+            }
             // Load the header only
             let file_record = FileRecord::read_from(&bytes[..FileRecord::SIZE]).unwrap();
 
@@ -167,6 +181,46 @@ fn main() -> Result<(), CliErrors> {
 
             Ok(())
         }
+        Actions::ConvertCompact {
+            input,
+            output,
+            tolerance_km,
+            encoding,
+        } => {
+            let path_str = input.clone();
+            let bytes = file2heap!(input).context(AniseSnafu)?;
+            // Load the header only
+            let file_record = FileRecord::read_from(&bytes[..FileRecord::SIZE]).unwrap();
+
+            match file_record.identification().context(CliFileRecordSnafu)? {
+                "SPK" => {
+                    info!("Loading {path_str:?} as DAF/SPK");
+                    let input_size = bytes.len();
+                    let spk = SPK::parse(bytes).context(CliDAFSnafu)?;
+
+                    let compact = CompactEphemeris::from_spk(
+                        &spk,
+                        CompactOptions {
+                            tolerance_km,
+                            encoding,
+                        },
+                    )
+                    .context(CliCompactSnafu)?;
+                    compact.save_as(&output, false).context(CliCompactSnafu)?;
+
+                    let output_size = compact.as_bytes().len();
+                    info!(
+                        "{input_size} bytes compacted to {output_size} bytes ({:.1}x smaller)",
+                        input_size as f64 / output_size as f64
+                    );
+
+                    Ok(())
+                }
+                fileid => Err(CliErrors::ArgumentError {
+                    arg: format!("{fileid} cannot be compacted, only SPK files are supported"),
+                }),
+            }
+        }
         Actions::TruncDAFById {
             input,
             output,
@@ -213,18 +267,17 @@ fn main() -> Result<(), CliErrors> {
 
                     let updated_segment = segment.truncate(summary, start, end).unwrap();
 
-                    let mut my_pck_mut = pck.to_mutable();
-                    assert!(my_pck_mut
-                        .set_nth_data(
-                            0,
-                            updated_segment,
+                    info!("Saving file to {output:?}");
+                    copy_daf(&path_str, &output)?;
+                    BPCWriter::open(&output.to_string_lossy())
+                        .context(CliDAFSnafu)?
+                        .replace_segment(
+                            idx,
+                            &updated_segment,
                             start.or_else(|| Some(summary.start_epoch())).unwrap(),
                             end.or_else(|| Some(summary.end_epoch())).unwrap(),
                         )
-                        .is_ok());
-
-                    info!("Saving file to {output:?}");
-                    my_pck_mut.persist(output).unwrap();
+                        .context(CliDAFSnafu)?;
 
                     Ok(())
                 }
@@ -255,18 +308,17 @@ fn main() -> Result<(), CliErrors> {
 
                     let updated_segment = segment.truncate(summary, start, end).unwrap();
 
-                    let mut my_spk_mut = spk.to_mutable();
-                    assert!(my_spk_mut
-                        .set_nth_data(
+                    info!("Saving file to {output:?}");
+                    copy_daf(&path_str, &output)?;
+                    SPKWriter::open(&output.to_string_lossy())
+                        .context(CliDAFSnafu)?
+                        .replace_segment(
                             idx,
-                            updated_segment,
+                            &updated_segment,
                             start.or_else(|| Some(summary.start_epoch())).unwrap(),
                             end.or_else(|| Some(summary.end_epoch())).unwrap(),
                         )
-                        .is_ok());
-
-                    info!("Saving file to {output:?}");
-                    my_spk_mut.persist(output).unwrap();
+                        .context(CliDAFSnafu)?;
 
                     Ok(())
                 }
@@ -295,11 +347,12 @@ fn main() -> Result<(), CliErrors> {
 
                     let (_, idx) = pck.summary_from_id(id).context(CliDAFSnafu)?;
 
-                    let mut my_pck_mut = pck.to_mutable();
-                    my_pck_mut.delete_nth_data(idx).context(CliDAFSnafu)?;
-
                     info!("Saving file to {output:?}");
-                    my_pck_mut.persist(output).unwrap();
+                    copy_daf(&path_str, &output)?;
+                    BPCWriter::open(&output.to_string_lossy())
+                        .context(CliDAFSnafu)?
+                        .remove_segment(idx)
+                        .context(CliDAFSnafu)?;
 
                     Ok(())
                 }
@@ -316,11 +369,12 @@ fn main() -> Result<(), CliErrors> {
 
                     let (_, idx) = spk.summary_from_id(id).context(CliDAFSnafu)?;
 
-                    let mut my_spk_mut = spk.to_mutable();
-                    my_spk_mut.delete_nth_data(idx).context(CliDAFSnafu)?;
-
                     info!("Saving file to {output:?}");
-                    my_spk_mut.persist(output).unwrap();
+                    copy_daf(&path_str, &output)?;
+                    SPKWriter::open(&output.to_string_lossy())
+                        .context(CliDAFSnafu)?
+                        .remove_segment(idx)
+                        .context(CliDAFSnafu)?;
 
                     Ok(())
                 }
@@ -331,3 +385,15 @@ fn main() -> Result<(), CliErrors> {
         }
     }
 }
+
+/// Copies the input DAF to the output path, unless they are the same file, such that only the output file is edited.
+fn copy_daf(input: &Path, output: &Path) -> Result<(), CliErrors> {
+    let same_file = |a: &Path, b: &Path| match (a.canonicalize(), b.canonicalize()) {
+        (Ok(a), Ok(b)) => a == b,
+        _ => false,
+    };
+    if !same_file(input, output) {
+        copy(input, output).context(FileNotFoundSnafu)?;
+    }
+    Ok(())
+}
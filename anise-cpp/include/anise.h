@@ -0,0 +1,237 @@
+/* ANISE Toolkit -- C and C++ bindings. This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. */
+
+#ifndef ANISE_H
+#define ANISE_H
+
+/* Generated with cbindgen from anise-cpp/src/lib.rs: do not edit by hand. */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Aberration correction of a computation, cf. the aberration module of ANISE.
+ */
+typedef enum AniseAberration {
+  ANISE_ABERRATION_NONE = 0,
+  /**
+   * Light time only
+   */
+  ANISE_ABERRATION_LT = 1,
+  /**
+   * Light time and stellar aberration
+   */
+  ANISE_ABERRATION_LT_S = 2,
+  /**
+   * Converged light time only
+   */
+  ANISE_ABERRATION_CN = 3,
+  /**
+   * Converged light time and stellar aberration
+   */
+  ANISE_ABERRATION_CN_S = 4,
+  /**
+   * Light time only, for a transmission
+   */
+  ANISE_ABERRATION_XLT = 5,
+  /**
+   * Light time and stellar aberration, for a transmission
+   */
+  ANISE_ABERRATION_XLT_S = 6,
+  /**
+   * Converged light time only, for a transmission
+   */
+  ANISE_ABERRATION_XCN = 7,
+  /**
+   * Converged light time and stellar aberration, for a transmission
+   */
+  ANISE_ABERRATION_XCN_S = 8,
+} AniseAberration;
+
+/**
+ * Status of a call: anything other than `ANISE_STATUS_OK` is an error.
+ */
+typedef enum AniseStatus {
+  ANISE_STATUS_OK = 0,
+  /**
+   * A required pointer argument was null
+   */
+  ANISE_STATUS_NULL_POINTER = 1,
+  /**
+   * The path is not valid UTF-8
+   */
+  ANISE_STATUS_INVALID_PATH = 2,
+  /**
+   * The file could not be read or is not a supported file
+   */
+  ANISE_STATUS_LOADING = 3,
+  /**
+   * The translation could not be computed, e.g. the frames are not loaded or the epoch is not covered by the data
+   */
+  ANISE_STATUS_EPHEMERIS = 4,
+  /**
+   * The rotation could not be computed, e.g. the frames are not loaded or the epoch is not covered by the data
+   */
+  ANISE_STATUS_ORIENTATION = 5,
+  /**
+   * Any other error
+   */
+  ANISE_STATUS_OTHER = 6,
+  /**
+   * An unexpected internal error, which should be reported as a bug
+   */
+  ANISE_STATUS_PANIC = 7,
+} AniseStatus;
+
+/**
+ * An immutable almanac, shared between all of the holders of its handle.
+ */
+typedef struct AniseAlmanac AniseAlmanac;
+
+/**
+ * A frame, given by the NAIF IDs of its origin and of its orientation, e.g. 399 and 1 for the Earth J2000 frame.
+ */
+typedef struct AniseFrame {
+  int32_t ephemeris_id;
+  int32_t orientation_id;
+} AniseFrame;
+
+/**
+ * Position (km) and velocity (km/s) of a state.
+ */
+typedef struct AniseState {
+  double x_km;
+  double y_km;
+  double z_km;
+  double vx_km_s;
+  double vy_km_s;
+  double vz_km_s;
+} AniseState;
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Creates a handle to an empty almanac.
+ *
+ * # Safety
+ * `out_almanac` must be valid for writes. The handle must be released with `anise_almanac_release`.
+ */
+AniseStatus anise_almanac_new(const AniseAlmanac **out_almanac);
+
+/**
+ * Creates a handle to a new almanac with the file at the provided path, guessing at the file type (SPK, BPC, planetary data, etc.).
+ *
+ * # Safety
+ * `path` must be a null terminated string and `out_almanac` must be valid for writes. The handle must be released with
+ * `anise_almanac_release`.
+ */
+AniseStatus anise_almanac_load(const char *path, const AniseAlmanac **out_almanac);
+
+/**
+ * Creates a handle to a new almanac with all of the data of the provided almanac and the file at the provided path.
+ * The provided almanac is not modified, so any thread using it is unaffected.
+ *
+ * # Safety
+ * `almanac` must be a valid handle, `path` must be a null terminated string and `out_almanac` must be valid for writes.
+ * The new handle must be released with `anise_almanac_release`.
+ */
+AniseStatus anise_almanac_load_file(const AniseAlmanac *almanac,
+                                    const char *path,
+                                    const AniseAlmanac **out_almanac);
+
+/**
+ * Returns a new reference to the provided almanac, e.g. for another thread, which must also be released with
+ * `anise_almanac_release`. Returns null if the handle is null.
+ *
+ * # Safety
+ * `almanac` must be null or a valid handle.
+ */
+const AniseAlmanac *anise_almanac_retain(const AniseAlmanac *almanac);
+
+/**
+ * Releases a reference to an almanac: the almanac is freed when its last reference is released. Does nothing if the handle is null.
+ *
+ * # Safety
+ * `almanac` must be null or a valid handle, which must not be used after this call.
+ */
+void anise_almanac_release(const AniseAlmanac *almanac);
+
+/**
+ * Computes the state of the target frame as seen from the observer frame at the provided epoch, in TDB seconds past J2000,
+ * including the rotation into the orientation of the observer frame.
+ *
+ * # Safety
+ * `almanac` must be a valid handle and `out_state` must be valid for writes.
+ */
+AniseStatus anise_transform(const AniseAlmanac *almanac,
+                            AniseFrame target_frame,
+                            AniseFrame observer_frame,
+                            double epoch_tdb_s,
+                            AniseAberration ab_corr,
+                            AniseState *out_state);
+
+/**
+ * Computes the state of the target frame as seen from the observer frame at each of the provided epochs, in TDB seconds past
+ * J2000, as `anise_transform` does.
+ *
+ * The states are written in order into `out_states`. On error, the number of states computed before the failing epoch is
+ * written into `out_num_computed`, if it is not null.
+ *
+ * # Safety
+ * `almanac` must be a valid handle, `epochs_tdb_s` must be valid for `num_epochs` reads and `out_states` for `num_epochs` writes.
+ * `out_num_computed` must be null or valid for writes.
+ */
+AniseStatus anise_transform_batch(const AniseAlmanac *almanac,
+                                  AniseFrame target_frame,
+                                  AniseFrame observer_frame,
+                                  const double *epochs_tdb_s,
+                                  size_t num_epochs,
+                                  AniseAberration ab_corr,
+                                  AniseState *out_states,
+                                  size_t *out_num_computed);
+
+/**
+ * Computes the position and velocity of the target frame as seen from the observer frame at the provided epoch, in TDB seconds
+ * past J2000, without any rotation: the state is expressed in the orientation of the target frame.
+ *
+ * # Safety
+ * `almanac` must be a valid handle and `out_state` must be valid for writes.
+ */
+AniseStatus anise_translate(const AniseAlmanac *almanac,
+                            AniseFrame target_frame,
+                            AniseFrame observer_frame,
+                            double epoch_tdb_s,
+                            AniseAberration ab_corr,
+                            AniseState *out_state);
+
+/**
+ * Computes the translation of the target frame as seen from the observer frame at each of the provided epochs, in TDB seconds
+ * past J2000, as `anise_translate` does. The buffers are those of `anise_transform_batch`.
+ *
+ * # Safety
+ * `almanac` must be a valid handle, `epochs_tdb_s` must be valid for `num_epochs` reads and `out_states` for `num_epochs` writes.
+ * `out_num_computed` must be null or valid for writes.
+ */
+AniseStatus anise_translate_batch(const AniseAlmanac *almanac,
+                                  AniseFrame target_frame,
+                                  AniseFrame observer_frame,
+                                  const double *epochs_tdb_s,
+                                  size_t num_epochs,
+                                  AniseAberration ab_corr,
+                                  AniseState *out_states,
+                                  size_t *out_num_computed);
+
+/**
+ * Returns a static, null terminated description of the provided status.
+ */
+const char *anise_status_description(AniseStatus status);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  /* ANISE_H */
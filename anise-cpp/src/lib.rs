@@ -0,0 +1,587 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+//! C ABI of ANISE, for use from C and C++.
+//!
+//! An almanac is shared through an opaque, reference counted and immutable handle, which may be used from any number of threads
+//! at once. All computations write into buffers provided by the caller and return an [AniseStatus]: these bindings never allocate
+//! during a computation, and the frame paths are served from the path cache of the almanac after the first queries of a pair of frames.
+//! Errors are reported through their status only and are never formatted.
+
+use core::ffi::{c_char, CStr};
+use core::ptr;
+use std::panic::{catch_unwind, AssertUnwindSafe};
+use std::sync::Arc;
+
+use anise::errors::{AlmanacError, AlmanacResult, EphemerisSnafu};
+use anise::math::cartesian::CartesianState;
+use anise::prelude::{Aberration, Almanac, Frame};
+use hifitime::Epoch;
+use snafu::ResultExt;
+
+/// An immutable almanac, shared between all of the holders of its handle.
+pub struct AniseAlmanac {
+    almanac: Almanac,
+}
+
+/// Status of a call: anything other than `ANISE_STATUS_OK` is an error.
+#[repr(C)]
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum AniseStatus {
+    Ok = 0,
+    /// A required pointer argument was null
+    NullPointer = 1,
+    /// The path is not valid UTF-8
+    InvalidPath = 2,
+    /// The file could not be read or is not a supported file
+    Loading = 3,
+    /// The translation could not be computed, e.g. the frames are not loaded or the epoch is not covered by the data
+    Ephemeris = 4,
+    /// The rotation could not be computed, e.g. the frames are not loaded or the epoch is not covered by the data
+    Orientation = 5,
+    /// Any other error
+    Other = 6,
+    /// An unexpected internal error, which should be reported as a bug
+    Panic = 7,
+}
+
+impl From<&AlmanacError> for AniseStatus {
+    fn from(err: &AlmanacError) -> Self {
+        match err {
+            AlmanacError::Ephemeris { .. } => Self::Ephemeris,
+            AlmanacError::Orientation { .. } => Self::Orientation,
+            AlmanacError::Loading { .. } | AlmanacError::TLDataSet { .. } => Self::Loading,
+            AlmanacError::Meta { .. } => Self::Loading,
+            AlmanacError::GenericError { .. } => Self::Other,
+        }
+    }
+}
+
+/// Aberration correction of a computation, cf. the aberration module of ANISE.
+#[repr(C)]
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum AniseAberration {
+    None = 0,
+    /// Light time only
+    Lt = 1,
+    /// Light time and stellar aberration
+    LtS = 2,
+    /// Converged light time only
+    Cn = 3,
+    /// Converged light time and stellar aberration
+    CnS = 4,
+    /// Light time only, for a transmission
+    Xlt = 5,
+    /// Light time and stellar aberration, for a transmission
+    XltS = 6,
+    /// Converged light time only, for a transmission
+    Xcn = 7,
+    /// Converged light time and stellar aberration, for a transmission
+    XcnS = 8,
+}
+
+impl From<AniseAberration> for Option<Aberration> {
+    fn from(ab_corr: AniseAberration) -> Self {
+        match ab_corr {
+            AniseAberration::None => Aberration::NONE,
+            AniseAberration::Lt => Aberration::LT,
+            AniseAberration::LtS => Aberration::LT_S,
+            AniseAberration::Cn => Aberration::CN,
+            AniseAberration::CnS => Aberration::CN_S,
+            AniseAberration::Xlt => Aberration::XLT,
+            AniseAberration::XltS => Aberration::XLT_S,
+            AniseAberration::Xcn => Aberration::XCN,
+            AniseAberration::XcnS => Aberration::XCN_S,
+        }
+    }
+}
+
+/// A frame, given by the NAIF IDs of its origin and of its orientation, e.g. 399 and 1 for the Earth J2000 frame.
+#[repr(C)]
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub struct AniseFrame {
+    pub ephemeris_id: i32,
+    pub orientation_id: i32,
+}
+
+impl From<AniseFrame> for Frame {
+    fn from(frame: AniseFrame) -> Self {
+        Frame::new(frame.ephemeris_id, frame.orientation_id)
+    }
+}
+
+/// Position (km) and velocity (km/s) of a state.
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Default, PartialEq)]
+pub struct AniseState {
+    pub x_km: f64,
+    pub y_km: f64,
+    pub z_km: f64,
+    pub vx_km_s: f64,
+    pub vy_km_s: f64,
+    pub vz_km_s: f64,
+}
+
+impl From<CartesianState> for AniseState {
+    fn from(state: CartesianState) -> Self {
+        Self {
+            x_km: state.radius_km.x,
+            y_km: state.radius_km.y,
+            z_km: state.radius_km.z,
+            vx_km_s: state.velocity_km_s.x,
+            vy_km_s: state.velocity_km_s.y,
+            vz_km_s: state.velocity_km_s.z,
+        }
+    }
+}
+
+/// Runs the provided call such that a panic is reported as a status instead of unwinding into the caller.
+fn guard<F: FnOnce() -> AniseStatus>(call: F) -> AniseStatus {
+    catch_unwind(AssertUnwindSafe(call)).unwrap_or(AniseStatus::Panic)
+}
+
+/// Loads the provided almanac into a new handle.
+unsafe fn new_handle(
+    almanac: AlmanacResult<Almanac>,
+    out_almanac: *mut *const AniseAlmanac,
+) -> AniseStatus {
+    match almanac {
+        Ok(almanac) => {
+            *out_almanac = Arc::into_raw(Arc::new(AniseAlmanac { almanac }));
+            AniseStatus::Ok
+        }
+        Err(e) => AniseStatus::from(&e),
+    }
+}
+
+/// Returns the path as a string slice, or the status of the error.
+unsafe fn path_str<'a>(path: *const c_char) -> Result<&'a str, AniseStatus> {
+    if path.is_null() {
+        return Err(AniseStatus::NullPointer);
+    }
+    CStr::from_ptr(path)
+        .to_str()
+        .map_err(|_| AniseStatus::InvalidPath)
+}
+
+/// Computes one state per epoch into the output buffer, stopping at the first error.
+unsafe fn compute_states<F>(
+    almanac: *const AniseAlmanac,
+    epochs_tdb_s: *const f64,
+    num_epochs: usize,
+    out_states: *mut AniseState,
+    out_num_computed: *mut usize,
+    state_fn: F,
+) -> AniseStatus
+where
+    F: Fn(&Almanac, Epoch) -> AlmanacResult<CartesianState>,
+{
+    if !out_num_computed.is_null() {
+        *out_num_computed = 0;
+    }
+    if almanac.is_null() || (num_epochs > 0 && (epochs_tdb_s.is_null() || out_states.is_null())) {
+        return AniseStatus::NullPointer;
+    }
+    if num_epochs == 0 {
+        return AniseStatus::Ok;
+    }
+
+    let almanac = &(*almanac).almanac;
+    let epochs_tdb_s = core::slice::from_raw_parts(epochs_tdb_s, num_epochs);
+    let out_states = core::slice::from_raw_parts_mut(out_states, num_epochs);
+
+    for (num_computed, (epoch_tdb_s, out_state)) in
+        epochs_tdb_s.iter().zip(out_states.iter_mut()).enumerate()
+    {
+        match state_fn(almanac, Epoch::from_tdb_seconds(*epoch_tdb_s)) {
+            Ok(state) => *out_state = state.into(),
+            Err(e) => {
+                if !out_num_computed.is_null() {
+                    *out_num_computed = num_computed;
+                }
+                return AniseStatus::from(&e);
+            }
+        }
+    }
+
+    if !out_num_computed.is_null() {
+        *out_num_computed = num_epochs;
+    }
+    AniseStatus::Ok
+}
+
+/// Creates a handle to an empty almanac.
+///
+/// # Safety
+/// `out_almanac` must be valid for writes. The handle must be released with `anise_almanac_release`.
+#[no_mangle]
+pub unsafe extern "C" fn anise_almanac_new(out_almanac: *mut *const AniseAlmanac) -> AniseStatus {
+    guard(|| {
+        if out_almanac.is_null() {
+            return AniseStatus::NullPointer;
+        }
+        new_handle(Ok(Almanac::default()), out_almanac)
+    })
+}
+
+/// Creates a handle to a new almanac with the file at the provided path, guessing at the file type (SPK, BPC, planetary data, etc.).
+///
+/// # Safety
+/// `path` must be a null terminated string and `out_almanac` must be valid for writes. The handle must be released with
+/// `anise_almanac_release`.
+#[no_mangle]
+pub unsafe extern "C" fn anise_almanac_load(
+    path: *const c_char,
+    out_almanac: *mut *const AniseAlmanac,
+) -> AniseStatus {
+    guard(|| {
+        if out_almanac.is_null() {
+            return AniseStatus::NullPointer;
+        }
+        match path_str(path) {
+            Ok(path) => new_handle(Almanac::new(path), out_almanac),
+            Err(status) => status,
+        }
+    })
+}
+
+/// Creates a handle to a new almanac with all of the data of the provided almanac and the file at the provided path.
+/// The provided almanac is not modified, so any thread using it is unaffected.
+///
+/// # Safety
+/// `almanac` must be a valid handle, `path` must be a null terminated string and `out_almanac` must be valid for writes.
+/// The new handle must be released with `anise_almanac_release`.
+#[no_mangle]
+pub unsafe extern "C" fn anise_almanac_load_file(
+    almanac: *const AniseAlmanac,
+    path: *const c_char,
+    out_almanac: *mut *const AniseAlmanac,
+) -> AniseStatus {
+    guard(|| {
+        if almanac.is_null() || out_almanac.is_null() {
+            return AniseStatus::NullPointer;
+        }
+        match path_str(path) {
+            Ok(path) => new_handle((*almanac).almanac.load(path), out_almanac),
+            Err(status) => status,
+        }
+    })
+}
+
+/// Returns a new reference to the provided almanac, e.g. for another thread, which must also be released with
+/// `anise_almanac_release`. Returns null if the handle is null.
+///
+/// # Safety
+/// `almanac` must be null or a valid handle.
+#[no_mangle]
+pub unsafe extern "C" fn anise_almanac_retain(almanac: *const AniseAlmanac) -> *const AniseAlmanac {
+    if almanac.is_null() {
+        return ptr::null();
+    }
+    Arc::increment_strong_count(almanac);
+    almanac
+}
+
+/// Releases a reference to an almanac: the almanac is freed when its last reference is released. Does nothing if the handle is null.
+///
+/// # Safety
+/// `almanac` must be null or a valid handle, which must not be used after this call.
+#[no_mangle]
+pub unsafe extern "C" fn anise_almanac_release(almanac: *const AniseAlmanac) {
+    if !almanac.is_null() {
+        drop(Arc::from_raw(almanac));
+    }
+}
+
+/// Computes the state of the target frame as seen from the observer frame at the provided epoch, in TDB seconds past J2000,
+/// including the rotation into the orientation of the observer frame.
+///
+/// # Safety
+/// `almanac` must be a valid handle and `out_state` must be valid for writes.
+#[no_mangle]
+pub unsafe extern "C" fn anise_transform(
+    almanac: *const AniseAlmanac,
+    target_frame: AniseFrame,
+    observer_frame: AniseFrame,
+    epoch_tdb_s: f64,
+    ab_corr: AniseAberration,
+    out_state: *mut AniseState,
+) -> AniseStatus {
+    anise_transform_batch(
+        almanac,
+        target_frame,
+        observer_frame,
+        &epoch_tdb_s,
+        1,
+        ab_corr,
+        out_state,
+        ptr::null_mut(),
+    )
+}
+
+/// Computes the state of the target frame as seen from the observer frame at each of the provided epochs, in TDB seconds past
+/// J2000, as `anise_transform` does.
+///
+/// The states are written in order into `out_states`. On error, the number of states computed before the failing epoch is
+/// written into `out_num_computed`, if it is not null.
+///
+/// # Safety
+/// `almanac` must be a valid handle, `epochs_tdb_s` must be valid for `num_epochs` reads and `out_states` for `num_epochs` writes.
+/// `out_num_computed` must be null or valid for writes.
+#[no_mangle]
+#[allow(clippy::too_many_arguments)]
+pub unsafe extern "C" fn anise_transform_batch(
+    almanac: *const AniseAlmanac,
+    target_frame: AniseFrame,
+    observer_frame: AniseFrame,
+    epochs_tdb_s: *const f64,
+    num_epochs: usize,
+    ab_corr: AniseAberration,
+    out_states: *mut AniseState,
+    out_num_computed: *mut usize,
+) -> AniseStatus {
+    guard(|| {
+        compute_states(
+            almanac,
+            epochs_tdb_s,
+            num_epochs,
+            out_states,
+            out_num_computed,
+            |almanac, epoch| {
+                almanac.transform(
+                    target_frame.into(),
+                    observer_frame.into(),
+                    epoch,
+                    ab_corr.into(),
+                )
+            },
+        )
+    })
+}
+
+/// Computes the position and velocity of the target frame as seen from the observer frame at the provided epoch, in TDB seconds
+/// past J2000, without any rotation: the state is expressed in the orientation of the target frame.
+///
+/// # Safety
+/// `almanac` must be a valid handle and `out_state` must be valid for writes.
+#[no_mangle]
+pub unsafe extern "C" fn anise_translate(
+    almanac: *const AniseAlmanac,
+    target_frame: AniseFrame,
+    observer_frame: AniseFrame,
+    epoch_tdb_s: f64,
+    ab_corr: AniseAberration,
+    out_state: *mut AniseState,
+) -> AniseStatus {
+    anise_translate_batch(
+        almanac,
+        target_frame,
+        observer_frame,
+        &epoch_tdb_s,
+        1,
+        ab_corr,
+        out_state,
+        ptr::null_mut(),
+    )
+}
+
+/// Computes the translation of the target frame as seen from the observer frame at each of the provided epochs, in TDB seconds
+/// past J2000, as `anise_translate` does. The buffers are those of `anise_transform_batch`.
+///
+/// # Safety
+/// `almanac` must be a valid handle, `epochs_tdb_s` must be valid for `num_epochs` reads and `out_states` for `num_epochs` writes.
+/// `out_num_computed` must be null or valid for writes.
+#[no_mangle]
+#[allow(clippy::too_many_arguments)]
+pub unsafe extern "C" fn anise_translate_batch(
+    almanac: *const AniseAlmanac,
+    target_frame: AniseFrame,
+    observer_frame: AniseFrame,
+    epochs_tdb_s: *const f64,
+    num_epochs: usize,
+    ab_corr: AniseAberration,
+    out_states: *mut AniseState,
+    out_num_computed: *mut usize,
+) -> AniseStatus {
+    guard(|| {
+        compute_states(
+            almanac,
+            epochs_tdb_s,
+            num_epochs,
+            out_states,
+            out_num_computed,
+            |almanac, epoch| {
+                almanac
+                    .translate(
+                        target_frame.into(),
+                        observer_frame.into(),
+                        epoch,
+                        ab_corr.into(),
+                    )
+                    .context(EphemerisSnafu {
+                        action: "translating",
+                    })
+            },
+        )
+    })
+}
+
+/// Returns a static, null terminated description of the provided status.
+#[no_mangle]
+pub extern "C" fn anise_status_description(status: AniseStatus) -> *const c_char {
+    let description: &'static [u8] = match status {
+        AniseStatus::Ok => b"success\0",
+        AniseStatus::NullPointer => b"a required pointer argument was null\0",
+        AniseStatus::InvalidPath => b"the path is not valid UTF-8\0",
+        AniseStatus::Loading => b"the file could not be loaded\0",
+        AniseStatus::Ephemeris => b"the translation could not be computed\0",
+        AniseStatus::Orientation => b"the rotation could not be computed\0",
+        AniseStatus::Other => b"an error occurred\0",
+        AniseStatus::Panic => b"an internal error occurred\0",
+    };
+    description.as_ptr() as *const c_char
+}
+
+#[cfg(test)]
+mod ut_ffi {
+    use super::*;
+    use anise::constants::frames::{EARTH_J2000, MOON_J2000};
+
+    const EARTH: AniseFrame = AniseFrame {
+        ephemeris_id: 399,
+        orientation_id: 1,
+    };
+    const MOON: AniseFrame = AniseFrame {
+        ephemeris_id: 301,
+        orientation_id: 1,
+    };
+
+    #[test]
+    fn batch_translate() {
+        let mut almanac = ptr::null();
+        unsafe {
+            assert_eq!(
+                anise_almanac_load(b"../data/de440s.bsp\0".as_ptr() as _, &mut almanac),
+                AniseStatus::Ok
+            );
+        }
+
+        let epochs_tdb_s: Vec<f64> = (0..10).map(|i| 7.5e8 + 3600.0 * i as f64).collect();
+        let mut states = vec![AniseState::default(); epochs_tdb_s.len()];
+        let mut num_computed = 0;
+
+        // Another reference, as another thread would use
+        let shared = unsafe { anise_almanac_retain(almanac) };
+        unsafe {
+            assert_eq!(
+                anise_translate_batch(
+                    shared,
+                    MOON,
+                    EARTH,
+                    epochs_tdb_s.as_ptr(),
+                    epochs_tdb_s.len(),
+                    AniseAberration::None,
+                    states.as_mut_ptr(),
+                    &mut num_computed,
+                ),
+                AniseStatus::Ok
+            );
+            anise_almanac_release(shared);
+        }
+        assert_eq!(num_computed, epochs_tdb_s.len());
+
+        let reference = Almanac::new("../data/de440s.bsp").unwrap();
+        for (epoch_tdb_s, state) in epochs_tdb_s.iter().zip(&states) {
+            let expected = reference
+                .translate(
+                    MOON_J2000,
+                    EARTH_J2000,
+                    Epoch::from_tdb_seconds(*epoch_tdb_s),
+                    None,
+                )
+                .unwrap();
+            assert_eq!(*state, AniseState::from(expected));
+        }
+
+        // An epoch outside of the data stops the computation at that epoch.
+        let epochs_tdb_s = [7.5e8, 7.5e8 + 60.0, 1e12];
+        unsafe {
+            assert_eq!(
+                anise_translate_batch(
+                    almanac,
+                    MOON,
+                    EARTH,
+                    epochs_tdb_s.as_ptr(),
+                    epochs_tdb_s.len(),
+                    AniseAberration::None,
+                    states.as_mut_ptr(),
+                    &mut num_computed,
+                ),
+                AniseStatus::Ephemeris
+            );
+        }
+        assert_eq!(num_computed, 2);
+
+        let mut state = AniseState::default();
+        unsafe {
+            // There is no orientation data loaded for the Moon body fixed frame.
+            let moon_me = AniseFrame {
+                ephemeris_id: 301,
+                orientation_id: 31001,
+            };
+            assert_eq!(
+                anise_transform(
+                    almanac,
+                    moon_me,
+                    EARTH,
+                    7.5e8,
+                    AniseAberration::None,
+                    &mut state
+                ),
+                AniseStatus::Orientation
+            );
+            anise_almanac_release(almanac);
+        }
+    }
+
+    #[test]
+    fn invalid_arguments() {
+        let mut almanac = ptr::null();
+        let mut state = AniseState::default();
+        unsafe {
+            assert_eq!(
+                anise_almanac_load(ptr::null(), &mut almanac),
+                AniseStatus::NullPointer
+            );
+            assert_eq!(
+                anise_almanac_load(b"../data/not_a_file.bsp\0".as_ptr() as _, &mut almanac),
+                AniseStatus::Loading
+            );
+            assert!(almanac.is_null());
+            assert_eq!(
+                anise_translate(almanac, MOON, EARTH, 0.0, AniseAberration::None, &mut state),
+                AniseStatus::NullPointer
+            );
+
+            assert_eq!(anise_almanac_new(&mut almanac), AniseStatus::Ok);
+            assert_eq!(
+                anise_translate(almanac, MOON, EARTH, 0.0, AniseAberration::None, &mut state),
+                AniseStatus::Ephemeris
+            );
+            anise_almanac_release(almanac);
+
+            let description = CStr::from_ptr(anise_status_description(AniseStatus::Ephemeris));
+            assert_eq!(
+                description.to_str().unwrap(),
+                "the translation could not be computed"
+            );
+        }
+    }
+}
@@ -152,12 +152,12 @@ impl eframe::App for UiApp {
                                 let (label, crc) = if self.almanac.num_loaded_spk() == 1 {
                                     (
                                         "DAF/SPK",
-                                        self.almanac.spk_data[0].as_ref().unwrap().crc32(),
+                                        self.almanac.spk_data[0].crc32(),
                                     )
                                 } else if self.almanac.num_loaded_bpc() == 1 {
                                     (
                                         "DAF/PCK",
-                                        self.almanac.bpc_data[0].as_ref().unwrap().crc32(),
+                                        self.almanac.bpc_data[0].crc32(),
                                     )
                                 } else if !self.almanac.planetary_data.is_empty() {
                                     ("ANISE/PCA", self.almanac.planetary_data.crc32())
@@ -252,8 +252,7 @@ impl eframe::App for UiApp {
                                                 });
                                             })
                                             .body(|mut body| {
-                                                let pck =
-                                                    self.almanac.bpc_data[0].as_ref().unwrap();
+                                                let pck = &self.almanac.bpc_data[0];
 
                                                 for (sno, summary) in
                                                     pck.data_summaries().unwrap().iter().enumerate()
@@ -403,8 +402,7 @@ impl eframe::App for UiApp {
                                                 });
                                             })
                                             .body(|mut body| {
-                                                let spk =
-                                                    self.almanac.spk_data[0].as_ref().unwrap();
+                                                let spk = &self.almanac.spk_data[0];
 
                                                 for (sno, summary) in
                                                     spk.data_summaries().unwrap().iter().enumerate()
@@ -107,6 +107,88 @@ def test_state_transformation():
     # cf. https://github.com/nyx-space/hifitime/issues/270
 
 
+def test_batch_apis():
+    """
+    Checks that the NumPy batch methods match the per-epoch results to within 1e-9.
+    """
+    import numpy as np
+
+    data_path = Path(__file__).parent.joinpath("..", "..", "data")
+    ctx = Almanac(str(data_path.joinpath("de440s.bsp"))).load(
+        str(data_path.joinpath("pck08.pca"))
+    )
+    eme2k = ctx.frame_info(Frames.EME2000)
+
+    start = Epoch("2021-10-29 12:34:56 TDB")
+    epochs_tdb_s = start.to_tdb_seconds() + np.linspace(0.0, 86_400.0, 1_000)
+
+    # Preallocated output
+    states = np.zeros((len(epochs_tdb_s), 6))
+    out = ctx.transform_many(Frames.MOON_J2000, Frames.EARTH_J2000, epochs_tdb_s, None, states)
+    assert out is states
+    for i in [0, 500, 999]:
+        state = ctx.transform(
+            Frames.MOON_J2000,
+            Frames.EARTH_J2000,
+            Epoch.init_from_tdb_seconds(epochs_tdb_s[i]),
+        )
+        assert np.allclose(
+            states[i],
+            [state.x_km, state.y_km, state.z_km, state.vx_km_s, state.vy_km_s, state.vz_km_s],
+            rtol=0.0,
+            atol=1e-9,
+        )
+
+    # Wrong shape
+    try:
+        ctx.transform_many(Frames.MOON_J2000, Frames.EARTH_J2000, epochs_tdb_s, None, np.zeros((3, 6)))
+    except ValueError:
+        pass
+    else:
+        assert False, "expected a ValueError"
+
+    # Output that cannot be written to
+    read_only = np.zeros((len(epochs_tdb_s), 6))
+    read_only.flags.writeable = False
+    try:
+        ctx.transform_many(Frames.MOON_J2000, Frames.EARTH_J2000, epochs_tdb_s, None, read_only)
+    except ValueError:
+        pass
+    else:
+        assert False, "expected a ValueError"
+
+    translated = ctx.translate_many(Frames.MOON_J2000, Frames.EARTH_J2000, epochs_tdb_s)
+    assert translated.shape == (1_000, 6)
+
+    # Orbital elements
+    orbit = Orbit.from_keplerian(8_191.93, 1e-3, 12.85, 306.614, 314.19, 99.887_7, start, eme2k)
+    rows = np.array([[orbit.x_km, orbit.y_km, orbit.z_km, orbit.vx_km_s, orbit.vy_km_s, orbit.vz_km_s]])
+    kep = Orbit.keplerian_many(rows, eme2k)
+    assert kep.shape == (1, 6)
+    assert abs(kep[0, 0] - orbit.sma_km()) < 1e-9
+    assert abs(kep[0, 5] - orbit.ta_deg()) < 1e-9
+    geo = Orbit.latlongalt_many(rows, eme2k)
+    assert abs(geo[0, 2] - orbit.height_km()) < 1e-9
+
+    # AER of the Moon from a ground station
+    iau_earth = ctx.frame_info(Frames.IAU_EARTH_FRAME)
+    station = Orbit.from_latlongalt(40.427_222, 4.250_556, 0.834_939, 0.004178079012116429, start, iau_earth)
+    aer = ctx.azimuth_elevation_range_sez_many(Frames.MOON_J2000, station, epochs_tdb_s)
+    assert aer.shape == (1_000, 4)
+    assert np.all(np.abs(aer[:, 1]) <= 90.0)
+    for i in [0, 500, 999]:
+        epoch = Epoch.init_from_tdb_seconds(epochs_tdb_s[i])
+        rx = ctx.transform(Frames.MOON_J2000, iau_earth, epoch)
+        tx = Orbit.from_latlongalt(40.427_222, 4.250_556, 0.834_939, 0.004178079012116429, epoch, iau_earth)
+        expected = ctx.azimuth_elevation_range_sez(rx, tx)
+        assert np.allclose(
+            aer[i],
+            [expected.azimuth_deg, expected.elevation_deg, expected.range_km, expected.range_rate_km_s],
+            rtol=0.0,
+            atol=1e-9,
+        )
+
+
 def test_meta_load():
     data_path = Path(__file__).parent.joinpath("..", "..", "data", "local.dhall")
     meta = MetaAlmanac(str(data_path))
@@ -22,6 +22,13 @@ fn benchmark_anise_single_hop_type2_cheby(ctx: &Almanac, time_it: TimeSeries) {
     }
 }
 
+fn benchmark_anise_batch_single_hop_type2_cheby(ctx: &Almanac, time_it: TimeSeries) {
+    black_box(
+        ctx.rotations_to_parent(Frame::from_orient_ssb(ITRF93), time_it)
+            .unwrap(),
+    );
+}
+
 pub fn criterion_benchmark(c: &mut Criterion) {
     let start_epoch = Epoch::from_gregorian_at_noon(2012, 1, 1, TimeScale::ET);
     let end_epoch = Epoch::from_gregorian_at_noon(2021, 1, 1, TimeScale::ET);
@@ -37,6 +44,10 @@ pub fn criterion_benchmark(c: &mut Criterion) {
         b.iter(|| benchmark_anise_single_hop_type2_cheby(&almanac, time_it.clone()))
     });
 
+    c.bench_function("ANISE DAF/BPC batch single hop to parent", |b| {
+        b.iter(|| benchmark_anise_batch_single_hop_type2_cheby(&almanac, time_it.clone()))
+    });
+
     c.bench_function("SPICE DAF/BPC single hop to parent", |b| {
         b.iter(|| benchmark_spice_single_hop_type2_cheby(time_it.clone()))
     });
@@ -1,6 +1,10 @@
 use std::path::PathBuf;
 
-use anise::{constants::frames::EARTH_ITRF93, naif::kpl::parser::convert_tpc, prelude::*};
+use anise::{
+    constants::frames::{EARTH_ITRF93, IAU_JUPITER_FRAME},
+    naif::kpl::parser::convert_tpc,
+    prelude::*,
+};
 use criterion::{black_box, criterion_group, criterion_main, Criterion};
 
 fn benchmark_fetch(almanac: &Almanac, frame: Frame) {
@@ -17,6 +21,23 @@ pub fn criterion_benchmark(c: &mut Criterion) {
     c.bench_function("Frame fetch from planetary dataset", |b| {
         b.iter(|| benchmark_fetch(&almanac, EARTH_ITRF93))
     });
+
+    // Jupiter uses the nutation and precession angles of its system.
+    let epoch = Epoch::from_gregorian_utc_at_midnight(2024, 1, 1);
+    c.bench_function("IAU Jupiter rotation to parent", |b| {
+        b.iter(|| {
+            black_box(
+                almanac
+                    .rotation_to_parent(IAU_JUPITER_FRAME, epoch)
+                    .unwrap(),
+            )
+        })
+    });
+
+    let model = almanac.planetary_rotation_model(IAU_JUPITER_FRAME).unwrap();
+    c.bench_function("IAU Jupiter compiled rotation model", |b| {
+        b.iter(|| black_box(model.rotation_to_parent(black_box(epoch))))
+    });
 }
 
 criterion_group!(pca, criterion_benchmark);
@@ -0,0 +1,343 @@
+use anise::{
+    almanac::metaload::MetaFile,
+    constants::{
+        frames::{EARTH_ITRF93, EARTH_J2000, IAU_EARTH_FRAME, MARS_BARYCENTER_J2000, MOON_J2000},
+        usual_planetary_constants::MEAN_EARTH_ANGULAR_VELOCITY_DEG_S,
+    },
+    file2heap,
+    math::interpolation::{hermite_eval, lagrange_eval, NewtonPolynomial},
+    prelude::*,
+};
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+
+const NUM_QUERIES: f64 = 100.0;
+
+const SPACECRAFT_ID: i32 = -10000001;
+
+/// Spacecraft to Mars: a Hermite segment then three DE440s segments.
+fn benchmark_spice_multi_hop(time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(spice::spkezr(
+            "-10000001",
+            epoch.to_et_seconds(),
+            "J2000",
+            "NONE",
+            "MARS BARYCENTER",
+        ));
+    }
+}
+
+fn benchmark_anise_multi_hop(ctx: &Almanac, time_it: TimeSeries) {
+    let my_sc_j2k = Frame::from_ephem_j2000(SPACECRAFT_ID);
+    for epoch in time_it {
+        black_box(
+            ctx.translate_geometric(my_sc_j2k, MARS_BARYCENTER_J2000, epoch)
+                .unwrap(),
+        );
+    }
+}
+
+fn benchmark_spice_aberration(time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(spice::spkezr(
+            "MARS BARYCENTER",
+            epoch.to_et_seconds(),
+            "J2000",
+            "LT+S",
+            "EARTH",
+        ));
+    }
+}
+
+fn benchmark_anise_aberration(ctx: &Almanac, time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(
+            ctx.translate(MARS_BARYCENTER_J2000, EARTH_J2000, epoch, Aberration::LT_S)
+                .unwrap(),
+        );
+    }
+}
+
+fn benchmark_spice_transform(time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(spice::spkezr(
+            "MARS BARYCENTER",
+            epoch.to_et_seconds(),
+            "ITRF93",
+            "NONE",
+            "EARTH",
+        ));
+    }
+}
+
+fn benchmark_anise_transform(ctx: &Almanac, time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(
+            ctx.transform(MARS_BARYCENTER_J2000, EARTH_ITRF93, epoch, None)
+                .unwrap(),
+        );
+    }
+}
+
+/// The Moon is only in the first loaded SPK, so every other loaded SPK is searched first.
+fn benchmark_spice_many_spks(time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(spice::spkezr(
+            "MOON",
+            epoch.to_et_seconds(),
+            "J2000",
+            "NONE",
+            "EARTH",
+        ));
+    }
+}
+
+fn benchmark_anise_many_spks(ctx: &Almanac, time_it: TimeSeries) {
+    for epoch in time_it {
+        black_box(
+            ctx.translate_geometric(MOON_J2000, EARTH_J2000, epoch)
+                .unwrap(),
+        );
+    }
+}
+
+fn benchmark_anise_hermite(ctx: &Almanac, time_it: TimeSeries) {
+    let my_sc_j2k = Frame::from_ephem_j2000(SPACECRAFT_ID);
+    for epoch in time_it {
+        black_box(
+            ctx.translate_geometric(my_sc_j2k, EARTH_J2000, epoch)
+                .unwrap(),
+        );
+    }
+}
+
+fn benchmark_anise_aer(ctx: &Almanac, rx_tx: &[(Orbit, Orbit)]) {
+    for (rx, tx) in rx_tx {
+        black_box(ctx.azimuth_elevation_range_sez(*rx, *tx).unwrap());
+    }
+}
+
+pub fn ephemeris_benchmark(c: &mut Criterion) {
+    let buf = file2heap!("../data/de440s.bsp").unwrap();
+    let spk = SPK::parse(buf).unwrap();
+
+    let buf = file2heap!("../data/gmat-hermite.bsp").unwrap();
+    let spacecraft = SPK::parse(buf).unwrap();
+
+    let bpc = BPC::load("../data/earth_latest_high_prec.bpc").unwrap();
+
+    let ctx = Almanac::from_spk(spk.clone())
+        .unwrap()
+        .with_spk(spacecraft.clone())
+        .unwrap()
+        .with_bpc(bpc)
+        .unwrap();
+
+    spice::furnsh("../data/de440s.bsp");
+    spice::furnsh("../data/gmat-hermite.bsp");
+    spice::furnsh("../data/earth_latest_high_prec.bpc");
+
+    // Spacecraft ephemeris span
+    let start_epoch = Epoch::from_gregorian_at_noon(2000, 1, 1, TimeScale::UTC);
+    let end_epoch = Epoch::from_gregorian_hms(2000, 1, 1, 15, 0, 0, TimeScale::UTC);
+    let time_step = ((end_epoch - start_epoch).to_seconds() / NUM_QUERIES).seconds();
+    let sc_time_it = TimeSeries::exclusive(start_epoch, end_epoch - time_step, time_step);
+
+    // Earth orientation parameters span
+    let start_epoch = Epoch::from_gregorian_at_noon(2012, 1, 1, TimeScale::ET);
+    let end_epoch = Epoch::from_gregorian_at_noon(2021, 1, 1, TimeScale::ET);
+    let time_step = ((end_epoch - start_epoch).to_seconds() / NUM_QUERIES).seconds();
+    let time_it = TimeSeries::exclusive(start_epoch, end_epoch - time_step, time_step);
+
+    c.bench_function("ANISE multi hop spacecraft to Mars", |b| {
+        b.iter(|| benchmark_anise_multi_hop(&ctx, sc_time_it.clone()))
+    });
+
+    c.bench_function("SPICE multi hop spacecraft to Mars", |b| {
+        b.iter(|| benchmark_spice_multi_hop(sc_time_it.clone()))
+    });
+
+    c.bench_function("ANISE Earth to Mars LT+S", |b| {
+        b.iter(|| benchmark_anise_aberration(&ctx, time_it.clone()))
+    });
+
+    c.bench_function("SPICE Earth to Mars LT+S", |b| {
+        b.iter(|| benchmark_spice_aberration(time_it.clone()))
+    });
+
+    c.bench_function("ANISE transform Mars in ITRF93", |b| {
+        b.iter(|| benchmark_anise_transform(&ctx, time_it.clone()))
+    });
+
+    c.bench_function("SPICE transform Mars in ITRF93", |b| {
+        b.iter(|| benchmark_spice_transform(time_it.clone()))
+    });
+
+    // Hermite interpolation with and without the Newton coefficients of each window
+    let mut group = c.benchmark_group("ANISE hermite windows");
+    for capacity in [0, 16] {
+        let ctx = ctx.with_newton_window_capacity(capacity);
+        group.bench_with_input(
+            BenchmarkId::new("newton capacity", capacity),
+            &capacity,
+            |b, _| b.iter(|| benchmark_anise_hermite(&ctx, sc_time_it.clone())),
+        );
+    }
+    group.finish();
+
+    // Summary search cost: DE440s is loaded first, followed by spacecraft SPKs.
+    let variable =
+        SPK::parse(file2heap!("../data/variable-seg-size-hermite.bsp").unwrap()).unwrap();
+    let mut group = c.benchmark_group("ANISE many loaded SPKs");
+    for num_spks in [1, 8, 32] {
+        let mut many = Almanac::from_spk(spk.clone()).unwrap();
+        for n in 1..num_spks {
+            let next = if n % 2 == 0 {
+                variable.clone()
+            } else {
+                spacecraft.clone()
+            };
+            many = many.with_spk(next).unwrap();
+        }
+        group.bench_with_input(
+            BenchmarkId::new("Moon to Earth", num_spks),
+            &many,
+            |b, many| b.iter(|| benchmark_anise_many_spks(many, time_it.clone())),
+        );
+    }
+    group.finish();
+
+    // SPICE ignores a file which is already loaded, so only the distinct files are loaded.
+    spice::furnsh("../data/variable-seg-size-hermite.bsp");
+    c.bench_function("SPICE many loaded SPKs", |b| {
+        b.iter(|| benchmark_spice_many_spks(time_it.clone()))
+    });
+    spice::unload("../data/variable-seg-size-hermite.bsp");
+}
+
+pub fn aer_benchmark(c: &mut Criterion) {
+    let ctx = Almanac::new("../data/de440s.bsp")
+        .unwrap()
+        .load("../data/pck08.pca")
+        .unwrap();
+
+    let iau_earth = ctx.frame_from_uid(IAU_EARTH_FRAME).unwrap();
+    let eme2k = ctx.frame_from_uid(EARTH_J2000).unwrap();
+
+    // Madrid DSN ground station tracking the Moon over a day
+    let start_epoch = Epoch::from_gregorian_utc_at_midnight(2023, 11, 16);
+    let end_epoch = start_epoch + Unit::Day * 1;
+    let time_step = ((end_epoch - start_epoch).to_seconds() / NUM_QUERIES).seconds();
+    let rx_tx: Vec<(Orbit, Orbit)> = TimeSeries::exclusive(start_epoch, end_epoch, time_step)
+        .map(|epoch| {
+            let madrid = Orbit::try_latlongalt(
+                40.427_222,
+                4.250_556,
+                0.834_939,
+                MEAN_EARTH_ANGULAR_VELOCITY_DEG_S,
+                epoch,
+                iau_earth,
+            )
+            .unwrap();
+            let moon = ctx.transform(MOON_J2000, eme2k, epoch, None).unwrap();
+            (madrid, moon)
+        })
+        .collect();
+
+    c.bench_function("ANISE AER from Madrid to the Moon", |b| {
+        b.iter(|| benchmark_anise_aer(&ctx, &rx_tx))
+    });
+}
+
+pub fn load_benchmark(c: &mut Criterion) {
+    for path in [
+        "../data/de440s.bsp",
+        "../data/pck08.pca",
+        "../data/earth_latest_high_prec.bpc",
+    ] {
+        c.bench_function(&format!("ANISE load {path}"), |b| {
+            b.iter(|| black_box(Almanac::default().load(path).unwrap()))
+        });
+
+        c.bench_function(&format!("SPICE load {path}"), |b| {
+            b.iter(|| {
+                spice::furnsh(path);
+                spice::unload(path);
+            })
+        });
+    }
+
+    // Local files are loaded as is, so this is the overhead of the MetaAlmanac over loading each file.
+    let mut meta = MetaAlmanac {
+        files: ["../data/de440s.bsp", "../data/pck08.pca"]
+            .iter()
+            .map(|path| MetaFile {
+                uri: path.to_string(),
+                crc32: None,
+            })
+            .collect(),
+    };
+
+    c.bench_function("ANISE MetaAlmanac process", |b| {
+        b.iter(|| black_box(meta.process().unwrap()))
+    });
+}
+
+/// Samples of a circular orbit every minute, as stored in a Hermite or Lagrange segment.
+fn samples(num_samples: usize) -> (Vec<f64>, Vec<f64>, Vec<f64>) {
+    let rate_rad_s = 1e-3;
+    let xs: Vec<f64> = (0..num_samples).map(|i| 60.0 * i as f64).collect();
+    let ys = xs.iter().map(|t| 7000.0 * (rate_rad_s * t).cos()).collect();
+    let ydots = xs
+        .iter()
+        .map(|t| -7000.0 * rate_rad_s * (rate_rad_s * t).sin())
+        .collect();
+    (xs, ys, ydots)
+}
+
+pub fn interpolation_benchmark(c: &mut Criterion) {
+    let mut group = c.benchmark_group("ANISE interpolation");
+    for num_samples in [4, 8, 16, 32] {
+        let (xs, ys, ydots) = samples(num_samples);
+        // Midpoint of the middle interval, where the interpolations are used
+        let x_eval = 60.0 * (num_samples as f64 - 1.0) / 2.0 + 17.0;
+
+        group.bench_with_input(
+            BenchmarkId::new("hermite_eval", num_samples),
+            &num_samples,
+            |b, _| b.iter(|| black_box(hermite_eval(&xs, &ys, &ydots, black_box(x_eval)))),
+        );
+
+        group.bench_with_input(
+            BenchmarkId::new("lagrange_eval", num_samples),
+            &num_samples,
+            |b, _| b.iter(|| black_box(lagrange_eval(&xs, &ys, black_box(x_eval)))),
+        );
+
+        group.bench_with_input(
+            BenchmarkId::new("newton hermite build", num_samples),
+            &num_samples,
+            |b, _| b.iter(|| black_box(NewtonPolynomial::hermite(&xs, &ys, &ydots))),
+        );
+
+        group.bench_with_input(
+            BenchmarkId::new("newton lagrange build", num_samples),
+            &num_samples,
+            |b, _| b.iter(|| black_box(NewtonPolynomial::lagrange(&xs, &ys))),
+        );
+
+        let poly = NewtonPolynomial::hermite(&xs, &ys, &ydots).unwrap();
+        group.bench_with_input(
+            BenchmarkId::new("newton hermite eval", num_samples),
+            &num_samples,
+            |b, _| b.iter(|| black_box(poly.eval(black_box(x_eval)))),
+        );
+    }
+    group.finish();
+}
+
+criterion_group!(ephemerides, ephemeris_benchmark);
+criterion_group!(interpolation, interpolation_benchmark);
+criterion_group!(aer, aer_benchmark);
+criterion_group!(loading, load_benchmark);
+criterion_main!(ephemerides, interpolation, aer, loading);
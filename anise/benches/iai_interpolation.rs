@@ -0,0 +1,171 @@
+use anise::math::interpolation::{hermite_eval, lagrange_eval, NewtonPolynomial};
+
+use iai::black_box;
+
+// iai runs each benchmark once in its own process and counts all of its instructions, so the samples are constant tables
+// instead of being computed in the benchmarks, and the construction of a Newton polynomial is benchmarked on its own.
+
+const NUM_SAMPLES: usize = 32;
+
+/// Epoch of each sample, every minute, as stored in a Hermite or Lagrange segment.
+const XS: [f64; NUM_SAMPLES] = [
+    0.0, 60.0, 120.0, 180.0, 240.0, 300.0, 360.0, 420.0, 480.0, 540.0, 600.0, 660.0, 720.0, 780.0,
+    840.0, 900.0, 960.0, 1020.0, 1080.0, 1140.0, 1200.0, 1260.0, 1320.0, 1380.0, 1440.0, 1500.0,
+    1560.0, 1620.0, 1680.0, 1740.0, 1800.0, 1860.0,
+];
+
+/// Samples of a circular orbit, 7000 cos(1e-3 t) km, at each epoch.
+const YS: [f64; NUM_SAMPLES] = [
+    7000.0,
+    6987.403779546429,
+    6949.660450977064,
+    6886.90584951685,
+    6799.365823964207,
+    6687.355423879242,
+    6551.277765745544,
+    6391.622582186158,
+    6208.964459454989,
+    6003.960769546769,
+    5777.349304367748,
+    5529.945620481556,
+    5262.640103986266,
+    4976.394766085941,
+    4672.2397808891565,
+    4351.26977789465,
+    4014.639902507197,
+    3663.561658761547,
+    3299.2985492161797,
+    2923.1615277085057,
+    2536.5042813367154,
+    2140.7183586480255,
+    1737.2281615666102,
+    1327.4858190848397,
+    912.9659611670188,
+    495.16041167392035,
+    75.57281940787175,
+    -344.28675339919386,
+    -762.9072656790978,
+    -1178.782135643539,
+    -1590.4146628516098,
+    -1996.323414715146,
+];
+
+/// Derivatives of these samples, in km/s.
+const YDOTS: [f64; NUM_SAMPLES] = [
+    -0.0,
+    -0.41974804535611215,
+    -0.8379854510224355,
+    -1.2532070139807692,
+    -1.663918384989942,
+    -2.068641446629377,
+    -2.4659196329256297,
+    -2.854323171416991,
+    -3.23245422879038,
+    -3.5989519415717925,
+    -3.9524973137652477,
+    -4.291817963814037,
+    -4.6156927038003115,
+    -4.9229559344028715,
+    -5.2125018397960154,
+    -5.483288367392384,
+    -5.734340978106988,
+    -5.964756153645541,
+    -6.173704648194633,
+    -6.360434472811183,
+    -6.5242736017705845,
+    -6.66463239113361,
+    -6.781005700827857,
+    -6.872974712606519,
+    -6.940208437341805,
+    -6.9824649062283815,
+    -6.999592041609764,
+    -6.991528204293668,
+    -6.958302415386532,
+    -6.900034251848874,
+    -6.816933416147366,
+    -6.709298981552399,
+];
+
+/// Epoch of the evaluation, between the fourth and fifth samples.
+const X_EVAL: f64 = 60.0 * 3.0 + 17.0;
+
+fn hermite(num_samples: usize) {
+    black_box(
+        hermite_eval(
+            black_box(&XS[..num_samples]),
+            black_box(&YS[..num_samples]),
+            black_box(&YDOTS[..num_samples]),
+            black_box(X_EVAL),
+        )
+        .unwrap(),
+    );
+}
+
+fn lagrange(num_samples: usize) {
+    black_box(
+        lagrange_eval(
+            black_box(&XS[..num_samples]),
+            black_box(&YS[..num_samples]),
+            black_box(X_EVAL),
+        )
+        .unwrap(),
+    );
+}
+
+fn newton_hermite_build(num_samples: usize) -> NewtonPolynomial {
+    NewtonPolynomial::hermite(
+        black_box(&XS[..num_samples]),
+        black_box(&YS[..num_samples]),
+        black_box(&YDOTS[..num_samples]),
+    )
+    .unwrap()
+}
+
+/// Builds and evaluates the Newton polynomial: the cost of the evaluation is the difference with `newton_hermite_build`.
+fn newton_hermite(num_samples: usize) {
+    let poly = black_box(newton_hermite_build(num_samples));
+    black_box(poly.eval(black_box(X_EVAL)));
+}
+
+fn benchmark_hermite_8_samples() {
+    hermite(8);
+}
+
+fn benchmark_hermite_32_samples() {
+    hermite(32);
+}
+
+fn benchmark_lagrange_8_samples() {
+    lagrange(8);
+}
+
+fn benchmark_lagrange_32_samples() {
+    lagrange(32);
+}
+
+fn benchmark_newton_hermite_build_8_samples() {
+    black_box(newton_hermite_build(8));
+}
+
+fn benchmark_newton_hermite_build_32_samples() {
+    black_box(newton_hermite_build(32));
+}
+
+fn benchmark_newton_hermite_8_samples() {
+    newton_hermite(8);
+}
+
+fn benchmark_newton_hermite_32_samples() {
+    newton_hermite(32);
+}
+
+iai::main!(
+    benchmark_hermite_8_samples,
+    benchmark_hermite_32_samples,
+    benchmark_lagrange_8_samples,
+    benchmark_lagrange_32_samples,
+    benchmark_newton_hermite_build_8_samples,
+    benchmark_newton_hermite_build_32_samples,
+    benchmark_newton_hermite_8_samples,
+    benchmark_newton_hermite_32_samples
+);
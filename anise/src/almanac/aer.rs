@@ -54,59 +54,64 @@ impl Almanac {
             });
         }
 
-        // Compute the SEZ DCM
-        let from = tx.frame.orientation_id * 1_000 + 1;
-        // SEZ DCM is topo to fixed
-        let sez_dcm = tx
-            .dcm_from_topocentric_to_body_fixed(from)
-            .context(EphemerisPhysicsSnafu { action: "" })
-            .context(EphemerisSnafu {
-                action: "computing SEZ DCM for AER",
-            })?;
-
-        let tx_sez = (sez_dcm.transpose() * tx)
-            .context(EphemerisPhysicsSnafu { action: "" })
-            .context(EphemerisSnafu {
-                action: "transforming transmitter to SEZ",
-            })?;
-
         // Convert the receiver into the transmitter frame.
         let rx_in_tx_frame = self.transform_to(rx, tx.frame, None)?;
-        // Convert into SEZ frame
-        let rx_sez = (sez_dcm.transpose() * rx_in_tx_frame)
-            .context(EphemerisPhysicsSnafu { action: "" })
-            .context(EphemerisSnafu {
-                action: "transforming received to SEZ",
-            })?;
-
-        // Compute the range ρ.
-        let rho_sez = rx_sez.radius_km - tx_sez.radius_km;
-
-        // Compute the range-rate \dot ρ
-        let range_rate_km_s =
-            rho_sez.dot(&(rx_sez.velocity_km_s - tx_sez.velocity_km_s)) / rho_sez.norm();
-
-        // Finally, compute the elevation (math is the same as declination)
-        // Source: Vallado, section 4.4.3
-        // Only the sine is needed as per Vallado, and the formula is the same as the declination
-        // because we're in the SEZ frame.
-        let elevation_deg = between_pm_180((rho_sez.z / rho_sez.norm()).asin().to_degrees());
-        if (elevation_deg - 90.0).abs() < 1e-6 {
-            warn!("object nearly overhead (el = {elevation_deg:.6} deg), azimuth may be incorrect");
-        }
-        // For the elevation, we need to perform a quadrant check because it's measured from 0 to 360 degrees.
-        let azimuth_deg = between_0_360((rho_sez.y.atan2(-rho_sez.x)).to_degrees());
-
-        Ok(AzElRange {
-            epoch: tx.epoch,
-            azimuth_deg,
-            elevation_deg,
-            range_km: rho_sez.norm(),
-            range_rate_km_s,
-        })
+        aer_in_tx_frame(rx_in_tx_frame, tx)
     }
 }
 
+/// Computes the AER of `azimuth_elevation_range_sez` from a receiver state already expressed in the frame of the transmitter.
+pub(crate) fn aer_in_tx_frame(rx_in_tx_frame: Orbit, tx: Orbit) -> AlmanacResult<AzElRange> {
+    // Compute the SEZ DCM
+    let from = tx.frame.orientation_id * 1_000 + 1;
+    // SEZ DCM is topo to fixed
+    let sez_dcm = tx
+        .dcm_from_topocentric_to_body_fixed(from)
+        .context(EphemerisPhysicsSnafu { action: "" })
+        .context(EphemerisSnafu {
+            action: "computing SEZ DCM for AER",
+        })?;
+
+    let tx_sez = (sez_dcm.transpose() * tx)
+        .context(EphemerisPhysicsSnafu { action: "" })
+        .context(EphemerisSnafu {
+            action: "transforming transmitter to SEZ",
+        })?;
+
+    // Convert into SEZ frame
+    let rx_sez = (sez_dcm.transpose() * rx_in_tx_frame)
+        .context(EphemerisPhysicsSnafu { action: "" })
+        .context(EphemerisSnafu {
+            action: "transforming received to SEZ",
+        })?;
+
+    // Compute the range ρ.
+    let rho_sez = rx_sez.radius_km - tx_sez.radius_km;
+
+    // Compute the range-rate \dot ρ
+    let range_rate_km_s =
+        rho_sez.dot(&(rx_sez.velocity_km_s - tx_sez.velocity_km_s)) / rho_sez.norm();
+
+    // Finally, compute the elevation (math is the same as declination)
+    // Source: Vallado, section 4.4.3
+    // Only the sine is needed as per Vallado, and the formula is the same as the declination
+    // because we're in the SEZ frame.
+    let elevation_deg = between_pm_180((rho_sez.z / rho_sez.norm()).asin().to_degrees());
+    if (elevation_deg - 90.0).abs() < 1e-6 {
+        warn!("object nearly overhead (el = {elevation_deg:.6} deg), azimuth may be incorrect");
+    }
+    // For the elevation, we need to perform a quadrant check because it's measured from 0 to 360 degrees.
+    let azimuth_deg = between_0_360((rho_sez.y.atan2(-rho_sez.x)).to_degrees());
+
+    Ok(AzElRange {
+        epoch: tx.epoch,
+        azimuth_deg,
+        elevation_deg,
+        range_km: rho_sez.norm(),
+        range_rate_km_s,
+    })
+}
+
 #[cfg(test)]
 mod ut_aer {
     use crate::astro::orbit::Orbit;
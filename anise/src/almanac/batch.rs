@@ -0,0 +1,248 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::ops::Range;
+
+use hifitime::{Duration, Epoch};
+use rayon::prelude::*;
+
+use crate::{
+    errors::AlmanacResult,
+    math::cartesian::CartesianState,
+    prelude::{Aberration, Frame},
+};
+
+use super::Almanac;
+
+/// Maximum number of epochs computed by a single task, such that long jobs are still spread across threads.
+const MAX_CHUNK_LEN: usize = 1024;
+
+/// A set of states to compute: the target frame as seen from the observer frame at evenly spaced epochs.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct BatchJob {
+    pub target_frame: Frame,
+    pub observer_frame: Frame,
+    pub start_epoch: Epoch,
+    /// Last epoch of this job, included if it is a multiple of the step from the start epoch
+    pub end_epoch: Epoch,
+    pub step: Duration,
+    pub ab_corr: Option<Aberration>,
+}
+
+impl BatchJob {
+    pub fn new(
+        target_frame: Frame,
+        observer_frame: Frame,
+        start_epoch: Epoch,
+        end_epoch: Epoch,
+        step: Duration,
+        ab_corr: Option<Aberration>,
+    ) -> Self {
+        Self {
+            target_frame,
+            observer_frame,
+            start_epoch,
+            end_epoch,
+            step,
+            ab_corr,
+        }
+    }
+
+    /// Returns the number of epochs of this job, zero if the step is not positive or the end epoch is before the start epoch.
+    pub fn len(&self) -> usize {
+        let step_ns = self.step.total_nanoseconds();
+        let span_ns = (self.end_epoch - self.start_epoch).total_nanoseconds();
+        if step_ns <= 0 || span_ns < 0 {
+            0
+        } else {
+            (span_ns / step_ns) as usize + 1
+        }
+    }
+
+    /// Returns true if this job has no epochs.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the n-th epoch of this job.
+    pub fn epoch(&self, n: usize) -> Epoch {
+        self.start_epoch
+            + Duration::from_total_nanoseconds(self.step.total_nanoseconds() * n as i128)
+    }
+
+    /// Returns the index of the first epoch of this job at or after the provided epoch.
+    fn index_at_or_after(&self, epoch: Epoch) -> usize {
+        let step_ns = self.step.total_nanoseconds();
+        let span_ns = (epoch - self.start_epoch).total_nanoseconds();
+        if span_ns <= 0 {
+            0
+        } else {
+            ((span_ns + step_ns - 1) / step_ns) as usize
+        }
+    }
+}
+
+/// A contiguous part of a job, computed by a single thread.
+struct BatchTask<'a> {
+    job_no: usize,
+    epochs: Range<usize>,
+    states: &'a mut [CartesianState],
+}
+
+impl Almanac {
+    /// Computes all of the states of all of the provided jobs in parallel, using the current rayon thread pool.
+    ///
+    /// Returns, for each job, either the states of that job in chronological order, or the first error encountered.
+    /// Each state is exactly the one returned by `transform` for that epoch.
+    ///
+    /// # Performance
+    /// Every job is split into tasks which each use a single set of SPK segments, so each thread reuses the same
+    /// geometric path and decoded segments and only touches a small part of the data. These tasks are then distributed over
+    /// the rayon thread pool: use `ThreadPool::install` to select the number of threads.
+    pub fn transform_batch(&self, jobs: &[BatchJob]) -> Vec<AlmanacResult<Vec<CartesianState>>> {
+        let mut outputs = Vec::new();
+        let statuses = self.transform_batch_into(jobs, &mut outputs);
+        statuses
+            .into_iter()
+            .zip(outputs)
+            .map(|(status, states)| status.map(|_| states))
+            .collect()
+    }
+
+    /// Computes all of the states of all of the provided jobs in parallel into the provided output buffers, and returns the status of each job.
+    ///
+    /// The outputs are resized to have one buffer per job, and each buffer is resized to the number of epochs of its job.
+    /// Reusing the same outputs across calls therefore avoids any allocation of the states. If a job fails, the first error is returned
+    /// and the content of its buffer is unspecified. Refer to `transform_batch` for details.
+    pub fn transform_batch_into(
+        &self,
+        jobs: &[BatchJob],
+        outputs: &mut Vec<Vec<CartesianState>>,
+    ) -> Vec<AlmanacResult<()>> {
+        // The time windows of the segments are found in parallel for all jobs.
+        let chunks: Vec<Vec<Range<usize>>> = jobs.par_iter().map(|job| self.chunks(job)).collect();
+
+        outputs.resize_with(jobs.len(), Vec::new);
+
+        let mut tasks = Vec::with_capacity(chunks.iter().map(|job_chunks| job_chunks.len()).sum());
+        for (job_no, ((job, job_chunks), output)) in
+            jobs.iter().zip(chunks).zip(outputs.iter_mut()).enumerate()
+        {
+            output.clear();
+            output.resize(job.len(), CartesianState::zero(job.observer_frame));
+            let mut remaining = output.as_mut_slice();
+            for epochs in job_chunks {
+                let (states, rest) = remaining.split_at_mut(epochs.len());
+                remaining = rest;
+                tasks.push(BatchTask {
+                    job_no,
+                    epochs,
+                    states,
+                });
+            }
+        }
+
+        let results: Vec<(usize, AlmanacResult<()>)> = tasks
+            .into_par_iter()
+            .map(|task| {
+                let result = self.transform_chunk(&jobs[task.job_no], task.epochs, task.states);
+                (task.job_no, result)
+            })
+            .collect();
+
+        let mut statuses: Vec<AlmanacResult<()>> = jobs.iter().map(|_| Ok(())).collect();
+        // Tasks are in chronological order, so this keeps the first error of each job.
+        for (job_no, result) in results {
+            if let Err(e) = result {
+                if statuses[job_no].is_ok() {
+                    statuses[job_no] = Err(e);
+                }
+            }
+        }
+        statuses
+    }
+
+    /// Splits the epochs of this job where the SPK segments used change, and such that no chunk is longer than MAX_CHUNK_LEN.
+    fn chunks(&self, job: &BatchJob) -> Vec<Range<usize>> {
+        let num_epochs = job.len();
+        let mut chunks = Vec::new();
+        let mut first = 0;
+        while first < num_epochs {
+            let max_last = num_epochs.min(first + MAX_CHUNK_LEN);
+            let last = match self
+                .translation_plan(job.target_frame, job.observer_frame, job.epoch(first))
+                .ok()
+                .and_then(|plan| plan.valid_until())
+            {
+                Some(until) => job.index_at_or_after(until).clamp(first + 1, max_last),
+                // Errors are reported when computing the states.
+                None => max_last,
+            };
+            chunks.push(first..last);
+            first = last;
+        }
+        chunks
+    }
+
+    /// Computes the states of these epochs of the job directly into their part of the output buffer.
+    fn transform_chunk(
+        &self,
+        job: &BatchJob,
+        epochs: Range<usize>,
+        states: &mut [CartesianState],
+    ) -> AlmanacResult<()> {
+        self.transform_many_into(
+            job.target_frame,
+            job.observer_frame,
+            epochs.map(|n| job.epoch(n)),
+            job.ab_corr,
+            states,
+        )?;
+
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod ut_batch {
+    use super::*;
+    use crate::constants::frames::{EARTH_J2000, MOON_J2000};
+    use hifitime::Unit;
+
+    #[test]
+    fn job_epochs() {
+        let start = Epoch::from_et_seconds(0.0);
+        let job = BatchJob::new(
+            MOON_J2000,
+            EARTH_J2000,
+            start,
+            start + Unit::Minute * 1,
+            Unit::Second * 7,
+            None,
+        );
+        // 0, 7, ..., 56 seconds
+        assert_eq!(job.len(), 9);
+        assert_eq!(job.epoch(8), start + Unit::Second * 56);
+        assert_eq!(job.index_at_or_after(start - Unit::Second * 1), 0);
+        assert_eq!(job.index_at_or_after(start + Unit::Second * 14), 2);
+        assert_eq!(job.index_at_or_after(start + Unit::Second * 15), 3);
+
+        let backward = BatchJob {
+            end_epoch: start - Unit::Second * 1,
+            ..job
+        };
+        assert!(backward.is_empty());
+        let no_step = BatchJob {
+            step: Duration::ZERO,
+            ..job
+        };
+        assert!(no_step.is_empty());
+    }
+}
@@ -12,17 +12,21 @@ use std::collections::HashMap;
 
 use hifitime::Epoch;
 
+use log::warn;
 #[cfg(feature = "python")]
 use pyo3::prelude::*;
-use snafu::ensure;
+use snafu::{ensure, ResultExt};
 
 use crate::naif::daf::NAIFSummaryRecord;
+use crate::naif::daf::SummaryIndex;
 use crate::naif::pck::BPCSummaryRecord;
 use crate::naif::BPC;
-use crate::orientations::{NoOrientationsLoadedSnafu, OrientationError};
+use crate::orientations::{BPCSnafu, NoOrientationsLoadedSnafu, OrientationError};
 use crate::{naif::daf::DAFError, NaifId};
 
-use super::{Almanac, MAX_LOADED_BPCS};
+use super::cache::PathCache;
+use super::metrics::{DataKind, Stage};
+use super::Almanac;
 
 impl Almanac {
     pub fn from_bpc(bpc: BPC) -> Result<Almanac, OrientationError> {
@@ -31,36 +35,57 @@ impl Almanac {
     }
 
     /// Loads a Binary Planetary Constants kernel.
+    ///
+    /// The loaded BPCs are shared with this original Almanac, and only the summaries of this new BPC are indexed.
     pub fn with_bpc(&self, bpc: BPC) -> Result<Self, OrientationError> {
         // This is just a bunch of pointers so it doesn't use much memory.
         let mut me = self.clone();
-        let mut data_idx = MAX_LOADED_BPCS;
-        for (idx, item) in self.bpc_data.iter().enumerate() {
-            if item.is_none() {
-                data_idx = idx;
-                break;
-            }
-        }
-        if data_idx == MAX_LOADED_BPCS {
-            return Err(OrientationError::StructureIsFull {
-                max_slots: MAX_LOADED_BPCS,
-            });
+        let data_idx = me.bpc_data.push(bpc);
+        me.orientation_paths = PathCache::default();
+        if let Err(e) = me.bpc_index.insert(data_idx, &me.bpc_data[data_idx]) {
+            warn!("BPC #{data_idx} has no usable summary: {e}");
         }
-        me.bpc_data[data_idx] = Some(bpc);
         Ok(me)
     }
 
     pub fn num_loaded_bpc(&self) -> usize {
-        let mut count = 0;
-        for maybe in &self.bpc_data {
-            if maybe.is_none() {
-                break;
-            } else {
-                count += 1;
+        self.bpc_data.len()
+    }
+
+    /// Unloads the BPC at this index from a clone of this Almanac, e.g. to replace an outdated BPC with a newer one.
+    ///
+    /// The other BPCs keep their loading order and are shared with this original context: only their summaries are indexed again.
+    pub fn without_bpc(&self, bpc_no: usize) -> Result<Self, OrientationError> {
+        let mut me = self.clone();
+        me.bpc_data
+            .remove(bpc_no)
+            .ok_or(DAFError::InvalidIndex {
+                kind: "BPC",
+                idx: bpc_no,
+            })
+            .context(BPCSnafu {
+                action: "unloading BPC",
+            })?;
+        me.orientation_paths = PathCache::default();
+        me.bpc_index = SummaryIndex::default();
+        for (data_idx, bpc) in me.bpc_data.iter().enumerate() {
+            if let Err(e) = me.bpc_index.insert(data_idx, bpc) {
+                warn!("BPC #{data_idx} has no usable summary: {e}");
             }
         }
+        Ok(me)
+    }
 
-        count
+    /// Returns the summary at this index of this loaded BPC, as found in the summary index.
+    fn indexed_bpc_summary(
+        &self,
+        bpc_no: usize,
+        idx_in_bpc: usize,
+    ) -> Result<(&BPCSummaryRecord, usize, usize), OrientationError> {
+        let summaries = self.bpc_data[bpc_no].data_summaries().context(BPCSnafu {
+            action: "fetching indexed BPC summary",
+        })?;
+        Ok((&summaries[idx_in_bpc], bpc_no, idx_in_bpc))
     }
 
     /// Returns the summary given the name of the summary record if that summary has data defined at the requested epoch and the BPC where this name was found to be valid at that epoch.
@@ -69,16 +94,17 @@ impl Almanac {
         name: &str,
         epoch: Epoch,
     ) -> Result<(&BPCSummaryRecord, usize, usize), OrientationError> {
-        for (no, maybe_bpc) in self
-            .bpc_data
-            .iter()
-            .take(self.num_loaded_bpc())
-            .rev()
-            .enumerate()
-        {
-            let bpc = maybe_bpc.as_ref().unwrap();
-            if let Ok((summary, idx_in_bpc)) = bpc.summary_from_name_at_epoch(name, epoch) {
-                return Ok((summary, no, idx_in_bpc));
+        if self.bpc_index.num_indexed() == self.num_loaded_bpc() {
+            // The index is up to date, so the names need not be decoded again.
+            if let Some(indexed) = self.bpc_index.lookup_name_at_epoch(name, epoch) {
+                return self.indexed_bpc_summary(indexed.daf_no, indexed.idx);
+            }
+        } else {
+            for (bpc_no, bpc) in self.bpc_data.iter().rev().enumerate() {
+                if let Ok((summary, idx_in_bpc)) = bpc.summary_from_name_at_epoch(name, epoch) {
+                    // NOTE: We're iterating backward, so the correct BPC number is "total loaded" minus "current iteration".
+                    return Ok((summary, self.num_loaded_bpc() - bpc_no - 1, idx_in_bpc));
+                }
             }
         }
 
@@ -99,18 +125,28 @@ impl Almanac {
         id: i32,
         epoch: Epoch,
     ) -> Result<(&BPCSummaryRecord, usize, usize), OrientationError> {
-        for (no, maybe_bpc) in self
-            .bpc_data
-            .iter()
-            .take(self.num_loaded_bpc())
-            .rev()
-            .enumerate()
-        {
-            let bpc = maybe_bpc.as_ref().unwrap();
-            if let Ok((summary, idx_in_bpc)) = bpc.summary_from_id_at_epoch(id, epoch) {
-                // NOTE: We're iterating backward, so the correct BPC number is "total loaded" minus "current iteration".
-                return Ok((summary, self.num_loaded_bpc() - no - 1, idx_in_bpc));
+        if self.bpc_index.num_indexed() == self.num_loaded_bpc() {
+            // The index is up to date, so it is the only place we need to look.
+            let (indexed, scanned) = self.metrics.time(Stage::Lookup, || {
+                self.bpc_index.lookup_summary_scanned(id, epoch)
+            });
+            self.metrics
+                .summary_lookup(DataKind::Orientation, scanned, indexed.is_some());
+            if let Some((bpc_no, idx_in_bpc)) = indexed.map(|item| (item.daf_no, item.idx)) {
+                return self.indexed_bpc_summary(bpc_no, idx_in_bpc);
             }
+        } else {
+            // The BPC data was modified without going through `with_bpc`, so we must scan all of the summaries.
+            for (no, bpc) in self.bpc_data.iter().rev().enumerate() {
+                if let Ok((summary, idx_in_bpc)) = bpc.summary_from_id_at_epoch(id, epoch) {
+                    self.metrics
+                        .summary_lookup(DataKind::Orientation, no + 1, true);
+                    // NOTE: We're iterating backward, so the correct BPC number is "total loaded" minus "current iteration".
+                    return Ok((summary, self.num_loaded_bpc() - no - 1, idx_in_bpc));
+                }
+            }
+            self.metrics
+                .summary_lookup(DataKind::Orientation, self.num_loaded_bpc(), false);
         }
 
         // If we're reached this point, there is no relevant summary at this epoch.
@@ -129,16 +165,17 @@ impl Almanac {
         &self,
         name: &str,
     ) -> Result<(&BPCSummaryRecord, usize, usize), OrientationError> {
-        for (bpc_no, maybe_bpc) in self
-            .bpc_data
-            .iter()
-            .take(self.num_loaded_bpc())
-            .rev()
-            .enumerate()
-        {
-            let bpc = maybe_bpc.as_ref().unwrap();
-            if let Ok((summary, idx_in_bpc)) = bpc.summary_from_name(name) {
-                return Ok((summary, bpc_no, idx_in_bpc));
+        if self.bpc_index.num_indexed() == self.num_loaded_bpc() {
+            // The index is up to date, so the names need not be decoded again.
+            if let Some(indexed) = self.bpc_index.lookup_name(name) {
+                return self.indexed_bpc_summary(indexed.daf_no, indexed.idx);
+            }
+        } else {
+            for (bpc_no, bpc) in self.bpc_data.iter().rev().enumerate() {
+                if let Ok((summary, idx_in_bpc)) = bpc.summary_from_name(name) {
+                    // NOTE: We're iterating backward, so the correct BPC number is "total loaded" minus "current iteration".
+                    return Ok((summary, self.num_loaded_bpc() - bpc_no - 1, idx_in_bpc));
+                }
             }
         }
 
@@ -157,14 +194,7 @@ impl Almanac {
         &self,
         id: i32,
     ) -> Result<(&BPCSummaryRecord, usize, usize), OrientationError> {
-        for (no, maybe_bpc) in self
-            .bpc_data
-            .iter()
-            .take(self.num_loaded_bpc())
-            .rev()
-            .enumerate()
-        {
-            let bpc = maybe_bpc.as_ref().unwrap();
+        for (no, bpc) in self.bpc_data.iter().rev().enumerate() {
             if let Ok((summary, idx_in_bpc)) = bpc.summary_from_id(id) {
                 // NOTE: We're iterating backward, so the correct BPC number is "total loaded" minus "current iteration".
                 return Ok((summary, self.num_loaded_bpc() - no - 1, idx_in_bpc));
@@ -185,8 +215,7 @@ impl Almanac {
     pub fn bpc_summaries(&self, id: NaifId) -> Result<Vec<BPCSummaryRecord>, OrientationError> {
         let mut summaries = vec![];
 
-        for maybe_bpc in self.bpc_data.iter().take(self.num_loaded_bpc()).rev() {
-            let bpc = maybe_bpc.as_ref().unwrap();
+        for bpc in self.bpc_data.iter().rev() {
             if let Ok(these_summaries) = bpc.data_summaries() {
                 for summary in these_summaries {
                     if summary.id() == id {
@@ -235,8 +264,7 @@ impl Almanac {
         ensure!(self.num_loaded_bpc() > 0, NoOrientationsLoadedSnafu);
 
         let mut domains = HashMap::new();
-        for maybe_bpc in self.bpc_data.iter().take(self.num_loaded_bpc()).rev() {
-            let bpc = maybe_bpc.as_ref().unwrap();
+        for bpc in self.bpc_data.iter().rev() {
             if let Ok(these_summaries) = bpc.data_summaries() {
                 for summary in these_summaries {
                     let this_id = summary.id();
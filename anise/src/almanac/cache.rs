@@ -0,0 +1,365 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use std::collections::HashMap;
+use std::sync::{Arc, RwLock};
+
+use hifitime::Epoch;
+
+use crate::ephemerides::paths::MAX_TREE_DEPTH;
+use crate::math::Vector3;
+use crate::NaifId;
+
+/// A path from a frame up to the root of the loaded data, as returned by `ephemeris_path_to_root` and `orientation_path_to_root`.
+pub type FramePath = (usize, [Option<NaifId>; MAX_TREE_DEPTH]);
+
+/// Identifies the data a cache was built from: number of loaded DAF files, and the length and checksum of the planetary data (if used).
+pub type CacheKey = (usize, usize, u32);
+
+#[derive(Copy, Clone, Debug, PartialEq)]
+struct WindowedPath {
+    start_epoch: Epoch,
+    end_epoch: Epoch,
+    path: FramePath,
+}
+
+#[derive(Debug, Default)]
+struct PathCacheData {
+    key: CacheKey,
+    root: Option<NaifId>,
+    /// Paths which do not depend on time, e.g. only defined from planetary constants
+    fixed: HashMap<NaifId, FramePath>,
+    /// Paths valid in the interior of their time window, sorted by epoch and without overlap for a given ID
+    windowed: HashMap<NaifId, Vec<WindowedPath>>,
+}
+
+impl PathCacheData {
+    fn reset_if_stale(&mut self, key: CacheKey) {
+        if self.key != key {
+            *self = Self {
+                key,
+                ..Default::default()
+            };
+        }
+    }
+}
+
+/// Caches the root of the loaded frames and the path of each frame to that root.
+///
+/// A path is cached with the time window where all of the summaries used to build it are the ones in use,
+/// so any query in the interior of that window is a cache hit. Queries right on the boundary of a window are recomputed.
+///
+/// The cache is shared between clones of an Almanac, and reset when data is loaded.
+/// Every access provides a [CacheKey] describing the loaded data: if it does not match the key the cache was built with,
+/// the cache is considered empty, which protects against modifications of the public fields of the Almanac.
+#[derive(Clone, Debug, Default)]
+pub struct PathCache {
+    data: Arc<RwLock<PathCacheData>>,
+}
+
+impl PathCache {
+    /// Returns the cached root, if any.
+    pub fn root(&self, key: CacheKey) -> Option<NaifId> {
+        let data = self.data.read().ok()?;
+        if data.key == key {
+            data.root
+        } else {
+            None
+        }
+    }
+
+    /// Stores the root of the loaded data.
+    pub fn set_root(&self, key: CacheKey, root: NaifId) {
+        if let Ok(mut data) = self.data.write() {
+            data.reset_if_stale(key);
+            data.root = Some(root);
+        }
+    }
+
+    /// Returns the cached path of this ID valid at the provided epoch, if any.
+    pub fn path(&self, key: CacheKey, id: NaifId, epoch: Epoch) -> Option<FramePath> {
+        let data = self.data.read().ok()?;
+        if data.key != key {
+            return None;
+        }
+
+        if let Some(path) = data.fixed.get(&id) {
+            return Some(*path);
+        }
+
+        let windows = data.windowed.get(&id)?;
+        let pos = windows.partition_point(|window| window.start_epoch < epoch);
+        let window = windows.get(pos.checked_sub(1)?)?;
+        if epoch < window.end_epoch {
+            Some(window.path)
+        } else {
+            None
+        }
+    }
+
+    /// Stores the path of this ID, valid in the interior of the provided window, or at all times if there is no window.
+    pub fn insert_path(
+        &self,
+        key: CacheKey,
+        id: NaifId,
+        window: Option<(Epoch, Epoch)>,
+        path: FramePath,
+    ) {
+        let mut data = match self.data.write() {
+            Ok(data) => data,
+            Err(_) => return,
+        };
+        data.reset_if_stale(key);
+
+        match window {
+            None => {
+                data.fixed.insert(id, path);
+            }
+            Some((start_epoch, end_epoch)) => {
+                if start_epoch >= end_epoch {
+                    // Nothing would ever hit this window.
+                    return;
+                }
+                let windows = data.windowed.entry(id).or_default();
+                let pos = windows.partition_point(|window| window.start_epoch < start_epoch);
+                // Another thread may have inserted an overlapping window in the meantime.
+                let overlaps_prev = pos > 0 && windows[pos - 1].end_epoch > start_epoch;
+                let overlaps_next = windows
+                    .get(pos)
+                    .map_or(false, |window| window.start_epoch < end_epoch);
+                if !overlaps_prev && !overlaps_next {
+                    windows.insert(
+                        pos,
+                        WindowedPath {
+                            start_epoch,
+                            end_epoch,
+                            path,
+                        },
+                    );
+                }
+            }
+        }
+    }
+}
+
+/// Number of independently locked shards of a [StateCache], such that threads querying different bodies or epochs seldom contend.
+const STATE_CACHE_SHARDS: usize = 16;
+
+#[derive(Copy, Clone, Debug)]
+struct CachedState {
+    key: CacheKey,
+    id: NaifId,
+    epoch: Epoch,
+    radius_km: Vector3,
+    velocity_km_s: Vector3,
+    center_id: NaifId,
+}
+
+type StateShard = RwLock<Vec<Option<CachedState>>>;
+
+#[derive(Debug)]
+struct StateShards {
+    slots_per_shard: usize,
+    shards: Vec<StateShard>,
+}
+
+/// Caches the position and velocity of frames with respect to their parent in the ephemeris, by ephemeris ID and epoch.
+///
+/// This cache is disabled by default. It is meant for workloads querying the same bodies at the same epochs many times,
+/// e.g. the Sun, the Earth, and the Moon for each spacecraft of a constellation at each step, such that each of these states is only interpolated once.
+/// It has a fixed number of slots, split in shards which each have their own lock: a new state replaces the one stored in its slot,
+/// so the memory used is bounded without any eviction bookkeeping.
+///
+/// Like the [PathCache], it is shared between clones of an Almanac, emptied when SPKs are loaded or unloaded, and considered empty on a [CacheKey] mismatch.
+#[derive(Clone, Debug, Default)]
+pub struct StateCache {
+    data: Option<Arc<StateShards>>,
+}
+
+impl StateCache {
+    /// Initializes a cache of about this many states, rounded up to a multiple of the number of shards. A zero capacity disables the cache.
+    pub fn with_capacity(capacity: usize) -> Self {
+        if capacity == 0 {
+            return Self::default();
+        }
+        let slots_per_shard = (capacity + STATE_CACHE_SHARDS - 1) / STATE_CACHE_SHARDS;
+        Self {
+            data: Some(Arc::new(StateShards {
+                slots_per_shard,
+                shards: (0..STATE_CACHE_SHARDS)
+                    .map(|_| RwLock::new(vec![None; slots_per_shard]))
+                    .collect(),
+            })),
+        }
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.data.is_some()
+    }
+
+    /// Returns the number of states this cache can hold.
+    pub fn capacity(&self) -> usize {
+        self.data
+            .as_ref()
+            .map_or(0, |data| data.shards.len() * data.slots_per_shard)
+    }
+
+    /// Returns a new empty cache with the same capacity, not shared with this one.
+    pub(crate) fn emptied(&self) -> Self {
+        Self::with_capacity(self.capacity())
+    }
+
+    /// Returns the shard and the slot in that shard of this ID at this epoch.
+    fn slot(&self, id: NaifId, epoch: Epoch) -> Option<(&StateShard, usize)> {
+        let data = self.data.as_ref()?;
+        let (centuries, nanoseconds) = epoch.duration.to_parts();
+        let hash = (nanoseconds ^ ((centuries as u64) << 48) ^ ((id as u32 as u64) << 20))
+            .wrapping_mul(0x9E37_79B9_7F4A_7C15);
+        let hash = (hash >> 32) as usize;
+        let shard = &data.shards[hash % STATE_CACHE_SHARDS];
+        Some((shard, (hash / STATE_CACHE_SHARDS) % data.slots_per_shard))
+    }
+
+    /// Returns the cached position, velocity, and ID of the center of this ID at exactly this epoch, if any.
+    pub fn get(
+        &self,
+        key: CacheKey,
+        id: NaifId,
+        epoch: Epoch,
+    ) -> Option<(Vector3, Vector3, NaifId)> {
+        let (shard, pos) = self.slot(id, epoch)?;
+        let slots = shard.read().ok()?;
+        let state = slots.get(pos)?.as_ref()?;
+        if state.key == key && state.id == id && state.epoch == epoch {
+            Some((state.radius_km, state.velocity_km_s, state.center_id))
+        } else {
+            None
+        }
+    }
+
+    /// Stores the position and velocity of this ID with respect to its center at this epoch, replacing the state in this slot if any.
+    pub fn insert(
+        &self,
+        key: CacheKey,
+        id: NaifId,
+        epoch: Epoch,
+        state: (Vector3, Vector3, NaifId),
+    ) {
+        if let Some((shard, pos)) = self.slot(id, epoch) {
+            if let Ok(mut slots) = shard.write() {
+                if let Some(slot) = slots.get_mut(pos) {
+                    *slot = Some(CachedState {
+                        key,
+                        id,
+                        epoch,
+                        radius_km: state.0,
+                        velocity_km_s: state.1,
+                        center_id: state.2,
+                    });
+                }
+            }
+        }
+    }
+}
+
+/// Returns the intersection of the provided time windows, where `None` is valid at all times.
+pub(crate) fn intersect_windows(
+    window: Option<(Epoch, Epoch)>,
+    start_epoch: Epoch,
+    end_epoch: Epoch,
+) -> Option<(Epoch, Epoch)> {
+    Some(match window {
+        None => (start_epoch, end_epoch),
+        Some((cur_start, cur_end)) => (cur_start.max(start_epoch), cur_end.min(end_epoch)),
+    })
+}
+
+#[cfg(test)]
+mod ut_path_cache {
+    use super::*;
+
+    #[test]
+    fn windowed_paths() {
+        let cache = PathCache::default();
+        let key = (1, 0, 0);
+        let start = Epoch::from_et_seconds(0.0);
+        let end = Epoch::from_et_seconds(100.0);
+        let mut path = [None; MAX_TREE_DEPTH];
+        path[0] = Some(3);
+        path[1] = Some(0);
+
+        assert_eq!(cache.root(key), None);
+        cache.set_root(key, 0);
+        assert_eq!(cache.root(key), Some(0));
+
+        cache.insert_path(key, 399, Some((start, end)), (2, path));
+        assert_eq!(
+            cache.path(key, 399, Epoch::from_et_seconds(50.0)),
+            Some((2, path))
+        );
+        // Boundaries are not cached
+        assert_eq!(cache.path(key, 399, start), None);
+        assert_eq!(cache.path(key, 399, end), None);
+        assert_eq!(cache.path(key, 399, Epoch::from_et_seconds(150.0)), None);
+        assert_eq!(cache.path(key, 301, Epoch::from_et_seconds(50.0)), None);
+
+        // Clones share the cache
+        let clone = cache.clone();
+        assert_eq!(
+            clone.path(key, 399, Epoch::from_et_seconds(50.0)),
+            Some((2, path))
+        );
+
+        // A different key invalidates everything
+        let new_key = (2, 0, 0);
+        assert_eq!(cache.path(new_key, 399, Epoch::from_et_seconds(50.0)), None);
+        cache.insert_path(new_key, 10, None, (1, path));
+        assert_eq!(cache.root(new_key), None);
+        assert_eq!(cache.path(key, 399, Epoch::from_et_seconds(50.0)), None);
+        assert_eq!(
+            cache.path(new_key, 10, Epoch::from_et_seconds(1e9)),
+            Some((1, path))
+        );
+    }
+
+    #[test]
+    fn state_cache() {
+        let key = (1, 0, 0);
+        let epoch = Epoch::from_et_seconds(50.0);
+        let state = (Vector3::new(1.0, 2.0, 3.0), Vector3::new(4.0, 5.0, 6.0), 3);
+
+        let disabled = StateCache::default();
+        assert!(!disabled.is_enabled());
+        disabled.insert(key, 399, epoch, state);
+        assert_eq!(disabled.get(key, 399, epoch), None);
+
+        let cache = StateCache::with_capacity(100);
+        assert_eq!(cache.capacity(), 112);
+        assert_eq!(cache.get(key, 399, epoch), None);
+        cache.insert(key, 399, epoch, state);
+        assert_eq!(cache.get(key, 399, epoch), Some(state));
+        // Only exact matches are hits
+        assert_eq!(cache.get(key, 399, Epoch::from_et_seconds(50.000001)), None);
+        assert_eq!(cache.get(key, 301, epoch), None);
+        assert_eq!(cache.get((2, 0, 0), 399, epoch), None);
+
+        // Clones share the cache, but not the emptied ones.
+        assert_eq!(cache.clone().get(key, 399, epoch), Some(state));
+        let emptied = cache.emptied();
+        assert_eq!(emptied.capacity(), cache.capacity());
+        assert_eq!(emptied.get(key, 399, epoch), None);
+
+        // The memory used is bounded.
+        for i in 0..10_000 {
+            cache.insert(key, i, epoch, state);
+        }
+        assert_eq!(cache.capacity(), 112);
+    }
+}
@@ -0,0 +1,436 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::f64::consts::PI;
+
+use hifitime::{Duration, Epoch};
+use snafu::ResultExt;
+
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+
+use crate::{
+    ephemerides::EphemerisPhysicsSnafu,
+    errors::{AlmanacResult, EphemerisSnafu},
+    math::Vector3,
+    prelude::{Aberration, Frame},
+};
+
+use super::windows::{find_windows, SearchSteps};
+use super::Almanac;
+
+/// Settings of an eclipse search.
+#[derive(Copy, Clone, Debug, Default, PartialEq)]
+pub struct EclipseSettings {
+    /// Sampling steps and precision of the entry and exit epochs. The step grows up to the maximum step while no shadow is
+    /// estimated to change, so an eclipse shorter than the maximum step may be missed
+    pub steps: SearchSteps,
+    /// Aberration correction of the states
+    pub ab_corr: Option<Aberration>,
+}
+
+#[derive(Copy, Clone, Debug, PartialEq, Eq, Hash)]
+pub enum ShadowKind {
+    /// At least part of the light source is hidden: this includes the umbra
+    Penumbra,
+    /// The light source is totally hidden
+    Umbra,
+}
+
+/// A time span over which a spacecraft is in the shadow of the occulting body.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct EclipseWindow {
+    /// Index of the spacecraft in the list of spacecraft of the search
+    pub spacecraft: usize,
+    pub kind: ShadowKind,
+    /// Epoch when the spacecraft enters this shadow, or the start of the search if it is already in the shadow then
+    pub entry_epoch: Epoch,
+    /// Epoch when the spacecraft exits this shadow, or the end of the search if it is still in the shadow then
+    pub exit_epoch: Epoch,
+}
+
+impl EclipseWindow {
+    pub fn duration(&self) -> Duration {
+        self.exit_epoch - self.entry_epoch
+    }
+}
+
+/// The apparent disks of the light source and of the occulting body, as seen from the observer, in radians.
+#[derive(Copy, Clone, Debug, PartialEq)]
+struct ApparentDisks {
+    light_radius_rad: f64,
+    body_radius_rad: f64,
+    separation_rad: f64,
+}
+
+impl ApparentDisks {
+    /// Builds the apparent disks from the position of the light source and of the observer relative to the occulting body.
+    fn new(
+        light_km: &Vector3,
+        light_radius_km: f64,
+        obs_km: &Vector3,
+        body_radius_km: f64,
+    ) -> Self {
+        let to_light = light_km - obs_km;
+        let to_body = -obs_km;
+        Self {
+            light_radius_rad: (light_radius_km / to_light.norm()).min(1.0).asin(),
+            body_radius_rad: (body_radius_km / to_body.norm()).min(1.0).asin(),
+            separation_rad: to_light
+                .cross(&to_body)
+                .norm()
+                .atan2(to_light.dot(&to_body)),
+        }
+    }
+
+    /// Positive when at least part of the light source is hidden.
+    fn penumbra_margin_rad(&self) -> f64 {
+        self.light_radius_rad + self.body_radius_rad - self.separation_rad
+    }
+
+    /// Positive when all of the light source is hidden.
+    fn umbra_margin_rad(&self) -> f64 {
+        self.body_radius_rad - self.light_radius_rad - self.separation_rad
+    }
+
+    /// Fraction of the disk of the light source which is hidden by the occulting body, from 0.0 (visible) to 1.0 (umbra).
+    fn shadow_fraction(&self) -> f64 {
+        let (a, b, c) = (
+            self.light_radius_rad,
+            self.body_radius_rad,
+            self.separation_rad,
+        );
+        if c >= a + b {
+            0.0
+        } else if c <= b - a {
+            1.0
+        } else if c <= a - b {
+            // Annular: the body is entirely in front of the light source
+            (b / a).powi(2)
+        } else {
+            // Area of the intersection of both disks, cf. Montenbruck & Gill, Satellite Orbits, section 3.4.2
+            let x = (c.powi(2) + a.powi(2) - b.powi(2)) / (2.0 * c);
+            let y = (a.powi(2) - x.powi(2)).max(0.0).sqrt();
+            let area = a.powi(2) * (x / a).clamp(-1.0, 1.0).acos()
+                + b.powi(2) * ((c - x) / b).clamp(-1.0, 1.0).acos()
+                - c * y;
+            area / (PI * a.powi(2))
+        }
+    }
+}
+
+impl Almanac {
+    /// Returns the fraction of the disk of the light source (usually the Sun) hidden by the occulting body as seen from the
+    /// observer, from 0.0 (fully visible) to 1.0 (umbra).
+    ///
+    /// The light source and occulting frames must define their shape, e.g. as returned by `frame_from_uid`.
+    pub fn shadow_fraction(
+        &self,
+        observer: Frame,
+        light_source: Frame,
+        occulting: Frame,
+        epoch: Epoch,
+        ab_corr: Option<Aberration>,
+    ) -> AlmanacResult<f64> {
+        let (light_radius_km, body_radius_km) = shadow_radii(light_source, occulting)?;
+        let light_km = self
+            .transform(light_source, occulting, epoch, ab_corr)?
+            .radius_km;
+        let obs_km = self
+            .transform(observer, occulting, epoch, ab_corr)?
+            .radius_km;
+        Ok(
+            ApparentDisks::new(&light_km, light_radius_km, &obs_km, body_radius_km)
+                .shadow_fraction(),
+        )
+    }
+
+    /// Finds the penumbra and umbra windows of each spacecraft in the shadow of the occulting body cast by the light source
+    /// (usually the Sun), between the provided epochs. Windows are returned sorted by spacecraft, kind, and entry epoch.
+    ///
+    /// The light source and occulting frames must define their shape, e.g. as returned by `frame_from_uid`, and the spacecraft
+    /// are ephemeris frames of this Almanac.
+    ///
+    /// # Algorithm
+    /// 1. All of the spacecraft are sampled with an adaptive step: the step shrinks to half of the estimated time until any
+    ///    spacecraft reaches a shadow boundary, and is bounded by the minimum and maximum steps of the settings.
+    /// 2. At each sample, the state of the light source relative to the occulting body is computed once for all spacecraft.
+    ///    The shadow boundaries are the epochs when the apparent disks of the light source and of the occulting body start and
+    ///    stop overlapping (penumbra), and when the disk of the light source is fully covered (umbra).
+    /// 3. Each boundary crossing between two samples is refined by bisection to the precision of the settings.
+    ///
+    /// With the `parallel` feature, the spacecraft states of each sample are computed in parallel and the crossings are refined in parallel.
+    pub fn eclipse_windows(
+        &self,
+        spacecraft: &[Frame],
+        light_source: Frame,
+        occulting: Frame,
+        start_epoch: Epoch,
+        end_epoch: Epoch,
+        settings: EclipseSettings,
+    ) -> AlmanacResult<Vec<EclipseWindow>> {
+        let (light_radius_km, body_radius_km) = shadow_radii(light_source, occulting)?;
+
+        // Two channels per spacecraft: the penumbra margin then the umbra margin.
+        let margins = |disks: ApparentDisks, values: &mut [f64]| {
+            values[0] = disks.penumbra_margin_rad();
+            values[1] = disks.umbra_margin_rad();
+        };
+
+        let sample = |epoch: Epoch, values: &mut [f64]| -> AlmanacResult<()> {
+            let light_km = self
+                .transform(light_source, occulting, epoch, settings.ab_corr)?
+                .radius_km;
+
+            let sample_one = |(sc_frame, values): (&Frame, &mut [f64])| -> AlmanacResult<()> {
+                let obs_km = self
+                    .transform(*sc_frame, occulting, epoch, settings.ab_corr)?
+                    .radius_km;
+                margins(
+                    ApparentDisks::new(&light_km, light_radius_km, &obs_km, body_radius_km),
+                    values,
+                );
+                Ok(())
+            };
+
+            #[cfg(feature = "parallel")]
+            let result = spacecraft
+                .par_iter()
+                .zip(values.par_chunks_mut(2))
+                .try_for_each(sample_one);
+            #[cfg(not(feature = "parallel"))]
+            let result = spacecraft
+                .iter()
+                .zip(values.chunks_mut(2))
+                .try_for_each(sample_one);
+            result
+        };
+
+        let value = |channel: usize, epoch: Epoch| -> AlmanacResult<f64> {
+            let light_km = self
+                .transform(light_source, occulting, epoch, settings.ab_corr)?
+                .radius_km;
+            let obs_km = self
+                .transform(spacecraft[channel / 2], occulting, epoch, settings.ab_corr)?
+                .radius_km;
+            let mut values = [0.0; 2];
+            margins(
+                ApparentDisks::new(&light_km, light_radius_km, &obs_km, body_radius_km),
+                &mut values,
+            );
+            Ok(values[channel % 2])
+        };
+
+        Ok(find_windows(
+            2 * spacecraft.len(),
+            start_epoch,
+            end_epoch,
+            0.0,
+            &settings.steps,
+            sample,
+            value,
+        )?
+        .into_iter()
+        .map(|window| EclipseWindow {
+            spacecraft: window.channel / 2,
+            kind: if window.channel % 2 == 0 {
+                ShadowKind::Penumbra
+            } else {
+                ShadowKind::Umbra
+            },
+            entry_epoch: window.start,
+            exit_epoch: window.end,
+        })
+        .collect())
+    }
+}
+
+/// Returns the mean equatorial radii of the light source and of the occulting body.
+fn shadow_radii(light_source: Frame, occulting: Frame) -> AlmanacResult<(f64, f64)> {
+    let radius_km = |frame: Frame| {
+        frame
+            .mean_equatorial_radius_km()
+            .context(EphemerisPhysicsSnafu { action: "" })
+            .context(EphemerisSnafu {
+                action: "fetching shape for eclipse computation",
+            })
+    };
+    Ok((radius_km(light_source)?, radius_km(occulting)?))
+}
+
+#[cfg(test)]
+mod ut_eclipse {
+    use super::*;
+    use crate::constants::frames::{EARTH_J2000, MOON_J2000, SUN_J2000};
+    use crate::prelude::Orbit;
+    use hifitime::TimeUnits;
+
+    #[test]
+    fn apparent_disks() {
+        let sun_km = Vector3::new(1.496e8, 0.0, 0.0);
+        let (sun_radius_km, earth_radius_km) = (696_000.0, 6378.1363);
+
+        // Sunlit side of the Earth
+        let disks = ApparentDisks::new(
+            &sun_km,
+            sun_radius_km,
+            &Vector3::new(7000.0, 0.0, 0.0),
+            earth_radius_km,
+        );
+        assert_eq!(disks.shadow_fraction(), 0.0);
+        assert!(disks.penumbra_margin_rad() < 0.0);
+
+        // Behind the Earth
+        let disks = ApparentDisks::new(
+            &sun_km,
+            sun_radius_km,
+            &Vector3::new(-7000.0, 0.0, 0.0),
+            earth_radius_km,
+        );
+        assert_eq!(disks.shadow_fraction(), 1.0);
+        assert!(disks.umbra_margin_rad() > 0.0);
+
+        // The fraction increases monotonically across the penumbra
+        let mut prev_fraction = 0.0;
+        for y_km in (6000..6800).rev().step_by(5) {
+            let disks = ApparentDisks::new(
+                &sun_km,
+                sun_radius_km,
+                &Vector3::new(-7000.0, y_km as f64, 0.0),
+                earth_radius_km,
+            );
+            let fraction = disks.shadow_fraction();
+            assert!((0.0..=1.0).contains(&fraction));
+            assert!(fraction >= prev_fraction);
+            assert_eq!(
+                fraction > 0.0,
+                disks.penumbra_margin_rad() > 0.0,
+                "{disks:?}"
+            );
+            assert_eq!(
+                fraction == 1.0,
+                disks.umbra_margin_rad() >= 0.0,
+                "{disks:?}"
+            );
+            prev_fraction = fraction;
+        }
+        assert_eq!(prev_fraction, 1.0);
+    }
+
+    #[test]
+    fn leo_eclipses() {
+        let almanac = Almanac::default()
+            .load("../data/de440s.bsp")
+            .and_then(|almanac| almanac.load("../data/pck08.pca"))
+            .unwrap();
+
+        let sun = almanac.frame_from_uid(SUN_J2000).unwrap();
+        let eme2k = almanac.frame_from_uid(EARTH_J2000).unwrap();
+
+        let epoch = Epoch::from_gregorian_utc_at_midnight(2024, 3, 20);
+        let end = epoch + 6.hours();
+        let leo = Orbit::keplerian(6778.0, 0.001, 10.0, 0.0, 0.0, 0.0, epoch, eme2k);
+
+        // Two body propagation of the LEO, which is not in an SPK.
+        let disks = |epoch: Epoch| {
+            let obs = leo.at_epoch(epoch).unwrap();
+            let sun_km = almanac
+                .transform(sun, eme2k, epoch, None)
+                .unwrap()
+                .radius_km;
+            ApparentDisks::new(
+                &sun_km,
+                sun.mean_equatorial_radius_km().unwrap(),
+                &obs.radius_km,
+                eme2k.mean_equatorial_radius_km().unwrap(),
+            )
+        };
+
+        let windows = find_windows(
+            2,
+            epoch,
+            end,
+            0.0,
+            &SearchSteps::default(),
+            |epoch, values| {
+                let disks = disks(epoch);
+                values[0] = disks.penumbra_margin_rad();
+                values[1] = disks.umbra_margin_rad();
+                Ok(())
+            },
+            |channel, epoch| {
+                let disks = disks(epoch);
+                Ok([disks.penumbra_margin_rad(), disks.umbra_margin_rad()][channel])
+            },
+        )
+        .unwrap();
+
+        // About four orbits of 92 minutes: each umbra is within a penumbra which lasts a few seconds longer
+        let penumbras: Vec<_> = windows.iter().filter(|w| w.channel == 0).collect();
+        let umbras: Vec<_> = windows.iter().filter(|w| w.channel == 1).collect();
+        assert!(penumbras.len() >= 3 && penumbras.len() == umbras.len());
+        for (penumbra, umbra) in penumbras.iter().zip(&umbras) {
+            assert!(penumbra.start < umbra.start);
+            assert!(umbra.end < penumbra.end || umbra.end == end);
+            assert!((umbra.start - penumbra.start) < 15.seconds());
+            if umbra.end != end {
+                assert!((umbra.end - umbra.start) > 25.minutes());
+            }
+        }
+    }
+
+    #[test]
+    fn penumbral_lunar_eclipse() {
+        let almanac = Almanac::default()
+            .load("../data/de440s.bsp")
+            .and_then(|almanac| almanac.load("../data/pck08.pca"))
+            .unwrap();
+
+        let sun = almanac.frame_from_uid(SUN_J2000).unwrap();
+        let eme2k = almanac.frame_from_uid(EARTH_J2000).unwrap();
+
+        // Penumbral lunar eclipse of 2024 March 25, with its greatest eclipse at 07:12 UTC
+        let start = Epoch::from_gregorian_utc_at_midnight(2024, 3, 24);
+        let greatest = Epoch::from_gregorian_utc_hms(2024, 3, 25, 7, 12, 0);
+        let windows = almanac
+            .eclipse_windows(
+                &[MOON_J2000],
+                sun,
+                eme2k,
+                start,
+                start + 2.days(),
+                EclipseSettings::default(),
+            )
+            .unwrap();
+
+        // The center of the Moon enters the penumbra of the Earth, but not its umbra
+        assert_eq!(windows.len(), 1, "{windows:?}");
+        assert_eq!(windows[0].kind, ShadowKind::Penumbra);
+        assert!(windows[0].entry_epoch < greatest && greatest < windows[0].exit_epoch);
+        assert!(windows[0].duration() < 5.hours());
+
+        let fraction = almanac
+            .shadow_fraction(MOON_J2000, sun, eme2k, greatest, None)
+            .unwrap();
+        assert!(fraction > 0.0 && fraction < 1.0, "{fraction}");
+
+        // No shape on the light source
+        assert!(almanac
+            .eclipse_windows(
+                &[MOON_J2000],
+                SUN_J2000,
+                eme2k,
+                start,
+                start + 1.hours(),
+                EclipseSettings::default()
+            )
+            .is_err());
+    }
+}
@@ -12,6 +12,7 @@ use serde_derive::{Deserialize, Serialize};
 use serde_dhall::SimpleType;
 use snafu::prelude::*;
 use std::str::FromStr;
+use std::thread;
 use url::Url;
 
 #[cfg(feature = "python")]
@@ -32,7 +33,9 @@ use super::{Almanac, MetaAlmanacError, MetaFile};
 /// # Behavior
 /// If the URI is a local path, relative or absolute, nothing will be fetched from a remote. Relative paths are relative to the execution folder (i.e. the current working directory).
 /// If the URI is a remote path, the MetaAlmanac will first check if the file exists locally. If it exists, it will check that the CRC32 checksum of this file matches that of the specs.
-/// If it does not match, the file will be downloaded again. If no CRC32 is provided but the file exists, then the MetaAlmanac will fetch the remote file and overwrite the existing file.
+/// If it does not match, the file will be downloaded again. If no CRC32 is provided but the file exists, then the MetaAlmanac will revalidate the file with the remote
+/// (using the `ETag` and `Last-Modified` headers of the previous download) and only overwrite the existing file if it changed on the remote.
+/// The remote files are fetched concurrently, and then loaded in the order of the `files` list.
 /// The downloaded path will be stored in the "AppData" folder.
 #[derive(Clone, Debug, Serialize, Deserialize, PartialEq)]
 #[cfg_attr(feature = "python", pyclass)]
@@ -56,10 +59,24 @@ impl MetaAlmanac {
 
     /// Fetch all of the URIs and return a loaded Almanac
     pub(crate) fn _process(&mut self) -> AlmanacResult<Almanac> {
-        for (fno, file) in self.files.iter_mut().enumerate() {
-            file._process().context(MetaSnafu {
+        // Fetch all of the files concurrently, but report the first error in the order of the files.
+        let statuses = thread::scope(|scope| {
+            let handles = self
+                .files
+                .iter_mut()
+                .map(|file| scope.spawn(move || file._process()))
+                .collect::<Vec<_>>();
+
+            handles
+                .into_iter()
+                .map(|handle| handle.join().expect("fetching a meta file panicked"))
+                .collect::<Vec<_>>()
+        });
+
+        for (fno, status) in statuses.into_iter().enumerate() {
+            status.context(MetaSnafu {
                 fno,
-                file: file.clone(),
+                file: self.files[fno].clone(),
             })?;
         }
         // At this stage, all of the files are local files, so we can load them as is.
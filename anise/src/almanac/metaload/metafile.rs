@@ -11,12 +11,14 @@
 use log::{debug, info};
 use platform_dirs::AppDirs;
 use regex::Regex;
+use reqwest::header::{HeaderName, ETAG, IF_MODIFIED_SINCE, IF_NONE_MATCH, LAST_MODIFIED};
+use reqwest::StatusCode;
 use serde_derive::{Deserialize, Serialize};
 use serde_dhall::StaticType;
 use std::env;
-use std::fs::{create_dir_all, remove_file, File};
-use std::io::Write;
-use std::path::Path;
+use std::fs::{create_dir_all, remove_file, rename, File, OpenOptions};
+use std::io::{BufWriter, ErrorKind, Write};
+use std::path::{Path, PathBuf};
 use std::thread;
 use std::time::Duration;
 use url::Url;
@@ -31,13 +33,21 @@ use pyo3::pyclass::CompareOp;
 use crate::file2heap;
 use crate::prelude::InputOutputError;
 
+use super::sidecar::Sidecar;
 use super::MetaAlmanacError;
 
+/// Number of times the lock file of a download is checked before giving up.
+const LOCK_CHECKS: usize = 90;
+/// Wait between two checks of the lock file of a download.
+const LOCK_POLL: Duration = Duration::from_millis(100);
+
 /// MetaFile allows downloading a remote file from a URL (http, https only), and interpolation of paths in environment variable using the Dhall syntax `env:MY_ENV_VAR`.
 ///
 /// The data is stored in the user's local temp directory (i.e. `~/.local/share/nyx-space/anise/` on Linux and `AppData/Local/nyx-space/anise/` on Windows).
 /// Prior to loading a remote resource, if the local resource exists, its CRC32 will be computed: if it matches the CRC32 of this instance of MetaFile,
-/// then the file will not be downloaded a second time.
+/// then the file will not be downloaded a second time. If no CRC32 is provided, the cached file is revalidated with the server using the `ETag` and
+/// `Last-Modified` headers of its previous download, and only downloaded again if it changed on the remote.
+/// The validated CRC32 of a cached file is stored next to it (in `<file>.meta`), such that large cached files are only hashed again if they are modified.
 #[cfg_attr(feature = "python", pyclass)]
 #[cfg_attr(feature = "python", pyo3(module = "anise"))]
 #[cfg_attr(feature = "python", pyo3(get_all, set_all))]
@@ -77,173 +87,232 @@ impl MetaFile {
                 }
                 // Build the path for this file.
                 match url.path_segments().and_then(|segments| segments.last()) {
-                    Some(remote_file_path) => {
-                        match Path::new(remote_file_path).file_name() {
-                            Some(file_name) => {
-                                match AppDirs::new(Some("nyx-space/anise"), true) {
-                                    Some(app_dir) => {
-                                        // Check whether the path currently exists.
-
-                                        if !app_dir.data_dir.exists() {
-                                            // Create the folders
-                                            create_dir_all(&app_dir.data_dir).map_err(|e| {
-                                                MetaAlmanacError::MetaIO {
-                                                    path: app_dir.data_dir.to_str().unwrap().into(),
-                                                    what: "creating directories for storage",
-                                                    source: InputOutputError::IOError {
-                                                        kind: e.kind(),
-                                                    },
-                                                }
-                                            })?;
+                    Some(remote_file_path) => match Path::new(remote_file_path).file_name() {
+                        Some(file_name) => match AppDirs::new(Some("nyx-space/anise"), true) {
+                            Some(app_dir) => {
+                                // Check whether the path currently exists.
+                                if !app_dir.data_dir.exists() {
+                                    // Create the folders
+                                    create_dir_all(&app_dir.data_dir).map_err(|e| {
+                                        MetaAlmanacError::MetaIO {
+                                            path: app_dir.data_dir.to_str().unwrap().into(),
+                                            what: "creating directories for storage",
+                                            source: InputOutputError::IOError { kind: e.kind() },
                                         }
+                                    })?;
+                                }
 
-                                        let dest_path = app_dir.data_dir.join(file_name);
-                                        let lock_path = dest_path.with_file_name(
-                                            file_name.to_str().unwrap().to_string() + ".lock",
-                                        );
-
-                                        // Check the existence of the lock file.
-                                        let mut checks = 0;
-                                        loop {
-                                            if lock_path.exists() {
-                                                if checks == 9 {
-                                                    return Err(MetaAlmanacError::PersistentLock {
-                                                        desired: dest_path
-                                                            .to_str()
-                                                            .unwrap()
-                                                            .to_owned(),
-                                                    });
-                                                }
-
-                                                checks += 1;
-                                                thread::sleep(std::time::Duration::from_secs(1));
-                                            } else {
-                                                break;
-                                            }
-                                        }
+                                let dest_path = app_dir.data_dir.join(file_name);
+                                self.fetch(url, &dest_path)
+                            }
+                            None => Err(MetaAlmanacError::AppDirError),
+                        },
+                        None => Err(MetaAlmanacError::MissingFilePath {
+                            path: self.uri.clone(),
+                        }),
+                    },
+                    None => Err(MetaAlmanacError::MissingFilePath {
+                        path: self.uri.clone(),
+                    }),
+                }
+            }
+        }
+    }
 
-                                        if dest_path.exists() {
-                                            if let Some(crc32) = self.crc32 {
-                                                // Open the file and check the CRC32
-                                                let dest_path_c = dest_path.clone(); // macro token issue
-                                                if let Ok(bytes) = file2heap!(dest_path_c) {
-                                                    let computed_crc32 = crc32fast::hash(&bytes);
-                                                    let dest_path_s =
-                                                        dest_path.to_str().unwrap().to_string();
-                                                    if computed_crc32 == crc32 {
-                                                        // No need to redownload this, let's just update the uri path
-                                                        info!("Using cached {dest_path_s}",);
-                                                        self.uri = dest_path_s;
-                                                        return Ok(());
-                                                    } else {
-                                                        info!("Discarding cached {dest_path_s} - CRC32 differ (got {computed_crc32}, config expected {crc32})");
-                                                    }
-                                                }
-                                            }
-                                        }
+    /// Fetches the remote file at the provided URL into the destination path, unless the cached file is still valid.
+    ///
+    /// If a CRC32 is configured, the cached file is used if its checksum matches. Otherwise, the cached file is revalidated
+    /// with the server using the `ETag` and `Last-Modified` headers of its previous download. The validated CRC32 of the cached
+    /// file is stored in a sidecar such that it is only computed again if the cached file changes.
+    ///
+    /// The lock file of the destination is created atomically, so concurrent fetches of the same file name wait for each other.
+    fn fetch(&mut self, url: Url, dest_path: &Path) -> Result<(), MetaAlmanacError> {
+        let dest_path_s = dest_path.to_str().unwrap().to_string();
+        let lock_path = PathBuf::from(dest_path_s.clone() + ".lock");
+
+        // Take the lock of this download, which another thread or process may hold while downloading this file.
+        let mut checks = 0;
+        loop {
+            match OpenOptions::new()
+                .write(true)
+                .create_new(true)
+                .open(&lock_path)
+            {
+                Ok(_) => break,
+                Err(e) if e.kind() == ErrorKind::AlreadyExists => {
+                    if checks == LOCK_CHECKS {
+                        return Err(MetaAlmanacError::PersistentLock {
+                            desired: dest_path_s,
+                        });
+                    }
 
-                                        // At this stage, either the dest path does not exist, or the CRC32 check failed.
-
-                                        // Create the lock file
-                                        if let Err(e) = File::create(&lock_path) {
-                                            return Err(MetaAlmanacError::MetaIO {
-                                                path: dest_path
-                                                    .join(".lock")
-                                                    .to_str()
-                                                    .unwrap()
-                                                    .into(),
-                                                what: "creating lock file",
-                                                source: InputOutputError::IOError {
-                                                    kind: e.kind(),
-                                                },
-                                            });
-                                        }
+                    checks += 1;
+                    thread::sleep(LOCK_POLL);
+                }
+                Err(e) => {
+                    return Err(MetaAlmanacError::MetaIO {
+                        path: lock_path.to_str().unwrap().into(),
+                        what: "creating lock file",
+                        source: InputOutputError::IOError { kind: e.kind() },
+                    })
+                }
+            }
+        }
 
-                                        let del_lock_file = || {
-                                            // Ignore if the deletion of the lock file fails
-                                            let _ = remove_file(lock_path);
-                                        };
-
-                                        let client = reqwest::blocking::Client::builder()
-                                            .connect_timeout(Duration::from_secs(30))
-                                            .timeout(Duration::from_secs(30))
-                                            .build()
-                                            .unwrap();
-
-                                        match client.get(url.clone()).send() {
-                                            Ok(resp) => {
-                                                if resp.status().is_success() {
-                                                    // Downloaded the file, let's store it locally.
-                                                    match File::create(&dest_path) {
-                                                        Err(e) => {
-                                                            del_lock_file();
-                                                            Err(MetaAlmanacError::MetaIO {
-                                                                path: dest_path
-                                                                    .to_str()
-                                                                    .unwrap()
-                                                                    .into(),
-                                                                what: "creating file for storage",
-                                                                source: InputOutputError::IOError {
-                                                                    kind: e.kind(),
-                                                                },
-                                                            })
-                                                        }
-                                                        Ok(mut file) => {
-                                                            // Created the file, let's write the bytes.
-                                                            let bytes = resp.bytes().unwrap();
-                                                            let crc32 = crc32fast::hash(&bytes);
-                                                            file.write_all(&bytes).unwrap();
-
-                                                            info!(
-                                                                 "Saved {url} to {} (CRC32 = {crc32:x})",
-                                                                 dest_path.to_str().unwrap()
-                                                             );
-
-                                                            // Set the URI for loading
-                                                            self.uri = dest_path
-                                                                .to_str()
-                                                                .unwrap()
-                                                                .to_string();
-
-                                                            // Set the CRC32
-                                                            self.crc32 = Some(crc32);
-
-                                                            del_lock_file();
-
-                                                            Ok(())
-                                                        }
-                                                    }
-                                                } else {
-                                                    del_lock_file();
-                                                    Err(MetaAlmanacError::FetchError {
-                                                        status: resp.status(),
-                                                        uri: self.uri.clone(),
-                                                    })
-                                                }
-                                            }
-                                            Err(e) => {
-                                                del_lock_file();
-                                                Err(MetaAlmanacError::CnxError {
-                                                    uri: self.uri.clone(),
-                                                    error: format!("{e}"),
-                                                })
-                                            }
-                                        }
-                                    }
-                                    None => Err(MetaAlmanacError::AppDirError),
-                                }
+        let rslt = self.fetch_locked(url, dest_path);
+        // Ignore if the deletion of the lock file fails
+        let _ = remove_file(&lock_path);
+        rslt
+    }
+
+    /// Fetches the remote file while holding its lock, such that no other fetch validates or writes the same destination concurrently.
+    fn fetch_locked(&mut self, url: Url, dest_path: &Path) -> Result<(), MetaAlmanacError> {
+        let dest_path_s = dest_path.to_str().unwrap().to_string();
+
+        let mut sidecar = None;
+        if dest_path.exists() {
+            sidecar = Sidecar::load(dest_path);
+            if let Some(crc32) = self.crc32 {
+                let computed_crc32 = match &sidecar {
+                    Some(sidecar) => Some(sidecar.crc32),
+                    None => {
+                        // Open the file and compute the CRC32, storing it for the next time.
+                        let dest_path_c = dest_path; // macro token issue
+                        file2heap!(dest_path_c).ok().map(|bytes| {
+                            let computed_crc32 = crc32fast::hash(&bytes);
+                            if let Some(sidecar) =
+                                Sidecar::new(dest_path, computed_crc32, None, None)
+                            {
+                                sidecar.save(dest_path);
                             }
-                            None => Err(MetaAlmanacError::MissingFilePath {
-                                path: self.uri.clone(),
-                            }),
-                        }
+                            computed_crc32
+                        })
+                    }
+                };
+
+                if let Some(computed_crc32) = computed_crc32 {
+                    if computed_crc32 == crc32 {
+                        // No need to redownload this, let's just update the uri path
+                        info!("Using cached {dest_path_s}",);
+                        self.uri = dest_path_s;
+                        return Ok(());
+                    } else {
+                        info!("Discarding cached {dest_path_s} - CRC32 differ (got {computed_crc32}, config expected {crc32})");
+                        // The server validators are meaningless when the configured checksum differs.
+                        sidecar = None;
                     }
-                    None => Err(MetaAlmanacError::MissingFilePath {
-                        path: self.uri.clone(),
-                    }),
                 }
             }
         }
+
+        // At this stage, either the dest path does not exist, the CRC32 check failed, or the cached file must be revalidated.
+        self.download(url, dest_path, sidecar)
+    }
+
+    /// Downloads the remote file, using a conditional request if the sidecar of the cached file is provided.
+    fn download(
+        &mut self,
+        url: Url,
+        dest_path: &Path,
+        sidecar: Option<Sidecar>,
+    ) -> Result<(), MetaAlmanacError> {
+        let dest_path_s = dest_path.to_str().unwrap().to_string();
+
+        let client = reqwest::blocking::Client::builder()
+            .connect_timeout(Duration::from_secs(30))
+            .timeout(Duration::from_secs(30))
+            .build()
+            .unwrap();
+
+        let mut request = client.get(url.clone());
+        if let Some(sidecar) = &sidecar {
+            if let Some(etag) = &sidecar.etag {
+                request = request.header(IF_NONE_MATCH, etag);
+            }
+            if let Some(last_modified) = &sidecar.last_modified {
+                request = request.header(IF_MODIFIED_SINCE, last_modified);
+            }
+        }
+
+        let mut resp = request.send().map_err(|e| MetaAlmanacError::CnxError {
+            uri: self.uri.clone(),
+            error: format!("{e}"),
+        })?;
+
+        if resp.status() == StatusCode::NOT_MODIFIED {
+            if let Some(sidecar) = sidecar {
+                info!("Using cached {dest_path_s} - not modified on remote");
+                self.uri = dest_path_s;
+                self.crc32 = Some(sidecar.crc32);
+                return Ok(());
+            }
+        }
+
+        if !resp.status().is_success() {
+            return Err(MetaAlmanacError::FetchError {
+                status: resp.status(),
+                uri: self.uri.clone(),
+            });
+        }
+
+        let header = |name: HeaderName| {
+            resp.headers()
+                .get(name)
+                .and_then(|value| value.to_str().ok())
+                .map(|value| value.to_string())
+        };
+        let etag = header(ETAG);
+        let last_modified = header(LAST_MODIFIED);
+
+        // Stream the download into a partial file, hashing it on the fly, and only replace the cached file once complete.
+        let part_path = PathBuf::from(dest_path_s.clone() + ".part");
+        let io_err =
+            |path: &Path, what: &'static str, e: std::io::Error| MetaAlmanacError::MetaIO {
+                path: path.to_str().unwrap().into(),
+                what,
+                source: InputOutputError::IOError { kind: e.kind() },
+            };
+
+        let file = File::create(&part_path)
+            .map_err(|e| io_err(&part_path, "creating file for storage", e))?;
+        let mut writer = HashingWriter {
+            inner: BufWriter::new(file),
+            hasher: crc32fast::Hasher::new(),
+        };
+
+        if let Err(e) = resp
+            .copy_to(&mut writer)
+            .map_err(|e| MetaAlmanacError::CnxError {
+                uri: self.uri.clone(),
+                error: format!("{e}"),
+            })
+        {
+            let _ = remove_file(&part_path);
+            return Err(e);
+        }
+
+        let crc32 = writer.hasher.finalize();
+        if let Err(e) = writer.inner.flush() {
+            let _ = remove_file(&part_path);
+            return Err(io_err(&part_path, "writing file for storage", e));
+        }
+        drop(writer);
+
+        Sidecar::remove(dest_path);
+        rename(&part_path, dest_path).map_err(|e| io_err(dest_path, "replacing cached file", e))?;
+
+        if let Some(sidecar) = Sidecar::new(dest_path, crc32, etag, last_modified) {
+            sidecar.save(dest_path);
+        }
+
+        info!("Saved {url} to {dest_path_s} (CRC32 = {crc32:x})");
+
+        // Set the URI for loading
+        self.uri = dest_path_s;
+        // Set the CRC32
+        self.crc32 = Some(crc32);
+
+        Ok(())
     }
 }
 
@@ -282,6 +351,24 @@ impl MetaFile {
     }
 }
 
+/// Computes the CRC32 of the bytes written through it.
+struct HashingWriter<W: Write> {
+    inner: W,
+    hasher: crc32fast::Hasher,
+}
+
+impl<W: Write> Write for HashingWriter<W> {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        let written = self.inner.write(buf)?;
+        self.hasher.update(&buf[..written]);
+        Ok(written)
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        self.inner.flush()
+    }
+}
+
 fn replace_env_vars(input: &str) -> String {
     let re = Regex::new(r"env:([A-Z_][A-Z0-9_]*)").unwrap();
     re.replace_all(input, |caps: &regex::Captures| {
@@ -293,7 +380,10 @@ fn replace_env_vars(input: &str) -> String {
 
 #[cfg(test)]
 mod ut_metafile {
-    use super::MetaFile;
+    use super::{MetaAlmanacError, MetaFile};
+    use std::fs::{create_dir_all, remove_dir_all, write};
+    use std::thread;
+    use url::Url;
 
     #[test]
     fn abs_paths() {
@@ -346,4 +436,66 @@ mod ut_metafile {
             "env:BLAH_BLAH_NO_EXIST/.cargo/env".to_string()
         );
     }
+
+    #[test]
+    fn concurrent_fetch() {
+        let dir = std::env::temp_dir().join(format!("anise-fetch-{}", std::process::id()));
+        create_dir_all(&dir).unwrap();
+        let dest_path = dir.join("kernel.bsp");
+        let lock_path = dir.join("kernel.bsp.lock");
+        let part_path = dir.join("kernel.bsp.part");
+
+        // Nothing listens on this port, so any download fails immediately.
+        let url = Url::parse("http://127.0.0.1:1/kernel.bsp").unwrap();
+
+        // Both fetches of a cached file with a matching CRC32 take the lock in turn and use the cached file.
+        let bytes = b"cached kernel".to_vec();
+        write(&dest_path, &bytes).unwrap();
+        let crc32 = crc32fast::hash(&bytes);
+        thread::scope(|s| {
+            let handles = (0..2)
+                .map(|_| {
+                    s.spawn(|| {
+                        let mut file = MetaFile {
+                            uri: url.to_string(),
+                            crc32: Some(crc32),
+                        };
+                        file.fetch(url.clone(), &dest_path).map(|_| file.uri)
+                    })
+                })
+                .collect::<Vec<_>>();
+            for handle in handles {
+                assert_eq!(handle.join().unwrap().unwrap(), dest_path.to_str().unwrap());
+            }
+        });
+        assert!(!lock_path.exists());
+
+        // Both downloads fail on the connection, and neither of them finds the lock held forever nor leaves a partial file.
+        remove_dir_all(&dir).unwrap();
+        create_dir_all(&dir).unwrap();
+        thread::scope(|s| {
+            let handles = (0..2)
+                .map(|_| {
+                    s.spawn(|| {
+                        let mut file = MetaFile {
+                            uri: url.to_string(),
+                            crc32: None,
+                        };
+                        file.fetch(url.clone(), &dest_path)
+                    })
+                })
+                .collect::<Vec<_>>();
+            for handle in handles {
+                assert!(matches!(
+                    handle.join().unwrap(),
+                    Err(MetaAlmanacError::CnxError { .. })
+                ));
+            }
+        });
+        assert!(!lock_path.exists());
+        assert!(!part_path.exists());
+        assert!(!dest_path.exists());
+
+        remove_dir_all(&dir).unwrap();
+    }
 }
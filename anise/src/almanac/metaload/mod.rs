@@ -10,6 +10,7 @@
 
 mod metaalmanac;
 mod metafile;
+mod sidecar;
 
 pub use metaalmanac::MetaAlmanac;
 pub use metafile::MetaFile;
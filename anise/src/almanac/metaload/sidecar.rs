@@ -0,0 +1,141 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use log::debug;
+use serde_derive::{Deserialize, Serialize};
+use serde_dhall::StaticType;
+use std::fs::{self, Metadata};
+use std::path::{Path, PathBuf};
+use std::time::UNIX_EPOCH;
+
+/// The sidecar of a cached remote file, stored next to it as `<file>.meta`.
+///
+/// It records the CRC32 of the cached file once it has been validated, along with the length and modification time of the file
+/// at that moment, such that large cached kernels are only hashed again if they were modified. It also stores the HTTP validators
+/// returned by the server (`ETag` and `Last-Modified`) to revalidate the cached file with a conditional request.
+#[derive(Clone, Debug, Default, Serialize, Deserialize, PartialEq, StaticType)]
+pub(crate) struct Sidecar {
+    /// CRC32 of the cached file
+    pub crc32: u32,
+    /// Length of the cached file in bytes when its CRC32 was computed
+    pub len: u64,
+    /// Modification time of the cached file in nanoseconds since the UNIX epoch when its CRC32 was computed
+    pub modified_ns: u64,
+    /// ETag header returned by the server when the file was downloaded
+    pub etag: Option<String>,
+    /// Last-Modified header returned by the server when the file was downloaded
+    pub last_modified: Option<String>,
+}
+
+impl Sidecar {
+    /// Builds the sidecar of the file at the provided path, using the metadata of that file.
+    pub fn new(
+        path: &Path,
+        crc32: u32,
+        etag: Option<String>,
+        last_modified: Option<String>,
+    ) -> Option<Self> {
+        let (len, modified_ns) = file_stamp(&fs::metadata(path).ok()?)?;
+        Some(Self {
+            crc32,
+            len,
+            modified_ns,
+            etag,
+            last_modified,
+        })
+    }
+
+    /// Returns the path of the sidecar of the provided file.
+    pub fn path_of(path: &Path) -> PathBuf {
+        let mut sidecar = path.as_os_str().to_owned();
+        sidecar.push(".meta");
+        PathBuf::from(sidecar)
+    }
+
+    /// Loads the sidecar of the provided file, only if it is still valid, i.e. the file has not changed since the sidecar was written.
+    pub fn load(path: &Path) -> Option<Self> {
+        let contents = fs::read_to_string(Self::path_of(path)).ok()?;
+        let me = match serde_dhall::from_str(&contents)
+            .static_type_annotation()
+            .parse::<Self>()
+        {
+            Ok(me) => me,
+            Err(e) => {
+                debug!("ignoring sidecar of {}: {e}", path.display());
+                return None;
+            }
+        };
+
+        let (len, modified_ns) = file_stamp(&fs::metadata(path).ok()?)?;
+        if me.len == len && me.modified_ns == modified_ns {
+            Some(me)
+        } else {
+            debug!("ignoring outdated sidecar of {}", path.display());
+            None
+        }
+    }
+
+    /// Stores this sidecar next to the provided file. Failures are only logged since the sidecar is only an optimization.
+    pub fn save(&self, path: &Path) {
+        let sidecar_path = Self::path_of(path);
+        match serde_dhall::serialize(self)
+            .static_type_annotation()
+            .to_string()
+        {
+            Ok(contents) => {
+                if let Err(e) = fs::write(&sidecar_path, contents) {
+                    debug!("could not write {}: {e}", sidecar_path.display());
+                }
+            }
+            Err(e) => debug!("could not serialize {}: {e}", sidecar_path.display()),
+        }
+    }
+
+    /// Removes the sidecar of the provided file, if any.
+    pub fn remove(path: &Path) {
+        let _ = fs::remove_file(Self::path_of(path));
+    }
+}
+
+/// Returns the length and modification time in nanoseconds since the UNIX epoch from the provided metadata.
+fn file_stamp(metadata: &Metadata) -> Option<(u64, u64)> {
+    let modified = metadata.modified().ok()?.duration_since(UNIX_EPOCH).ok()?;
+    Some((metadata.len(), modified.as_nanos() as u64))
+}
+
+#[cfg(test)]
+mod ut_sidecar {
+    use super::Sidecar;
+    use std::fs;
+
+    #[test]
+    fn round_trip_and_staleness() {
+        let path = std::env::temp_dir().join(format!("anise-sidecar-{}.bin", std::process::id()));
+        fs::write(&path, b"ANISE kernel").unwrap();
+        let crc32 = crc32fast::hash(b"ANISE kernel");
+
+        // No sidecar yet
+        assert!(Sidecar::load(&path).is_none());
+
+        let sidecar = Sidecar::new(&path, crc32, Some("\"abc123\"".to_string()), None).unwrap();
+        assert_eq!(sidecar.len, 12);
+        sidecar.save(&path);
+
+        assert_eq!(Sidecar::load(&path), Some(sidecar));
+
+        // Modifying the file invalidates its sidecar
+        fs::write(&path, b"Modified ANISE kernel").unwrap();
+        assert!(Sidecar::load(&path).is_none());
+
+        Sidecar::remove(&path);
+        assert!(!Sidecar::path_of(&path).exists());
+        let _ = fs::remove_file(&path);
+    }
+}
@@ -0,0 +1,477 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+#[cfg(feature = "metrics")]
+use std::sync::atomic::{AtomicU64, Ordering};
+#[cfg(feature = "metrics")]
+use std::sync::Arc;
+#[cfg(feature = "metrics")]
+use std::time::Instant;
+
+#[cfg(feature = "metrics")]
+use super::Almanac;
+#[cfg(feature = "metrics")]
+use crate::ephemerides::paths::MAX_TREE_DEPTH;
+
+/// Number of buckets of the latency histograms: bucket `i` counts the durations between 2^i and 2^(i+1) nanoseconds, and the last
+/// bucket also counts all of the longer durations.
+pub const LATENCY_BUCKETS: usize = 32;
+
+/// Stage of a query whose latency is measured.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub(crate) enum Stage {
+    /// Search for the summary valid at an epoch
+    Lookup,
+    /// Access to the data of a segment
+    Decode,
+    /// Interpolation of a segment, or evaluation of a rotation model
+    Eval,
+}
+
+/// Kind of interpolation used to evaluate a segment or a rotation.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub(crate) enum Interpolation {
+    Chebyshev,
+    Lagrange,
+    Hermite,
+    /// Rotation computed from the planetary constants
+    PlanetaryConstants,
+}
+
+/// Kind of DAF summaries, or of frame paths.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub(crate) enum DataKind {
+    Ephemeris,
+    Orientation,
+}
+
+#[cfg(feature = "metrics")]
+#[derive(Debug, Default)]
+struct Histogram {
+    count: AtomicU64,
+    total_ns: AtomicU64,
+    buckets: [AtomicU64; LATENCY_BUCKETS],
+}
+
+#[cfg(feature = "metrics")]
+impl Histogram {
+    fn record(&self, elapsed_ns: u64) {
+        let bucket = (u64::BITS - elapsed_ns.max(1).leading_zeros() - 1) as usize;
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.total_ns.fetch_add(elapsed_ns, Ordering::Relaxed);
+        self.buckets[bucket.min(LATENCY_BUCKETS - 1)].fetch_add(1, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> LatencyStats {
+        LatencyStats {
+            count: self.count.load(Ordering::Relaxed),
+            total_ns: self.total_ns.load(Ordering::Relaxed),
+            buckets: core::array::from_fn(|i| self.buckets[i].load(Ordering::Relaxed)),
+        }
+    }
+}
+
+#[cfg(feature = "metrics")]
+#[derive(Debug, Default)]
+struct Lookups {
+    lookups: AtomicU64,
+    scanned: AtomicU64,
+    misses: AtomicU64,
+}
+
+#[cfg(feature = "metrics")]
+#[derive(Debug, Default)]
+struct Paths {
+    hits: AtomicU64,
+    misses: AtomicU64,
+    depth: [AtomicU64; MAX_TREE_DEPTH + 1],
+}
+
+#[cfg(feature = "metrics")]
+#[derive(Debug, Default)]
+struct Hits {
+    hits: AtomicU64,
+    misses: AtomicU64,
+}
+
+#[cfg(feature = "metrics")]
+#[derive(Debug, Default)]
+struct Counters {
+    spk: Lookups,
+    bpc: Lookups,
+    ephemeris_paths: Paths,
+    orientation_paths: Paths,
+    state_cache: Hits,
+    interpolations: [AtomicU64; 4],
+    latencies: [Histogram; 3],
+}
+
+/// Records the statistics of the queries of an Almanac, and is shared between its clones.
+///
+/// All of the recording functions compile to nothing without the `metrics` feature. With it, each record is a relaxed atomic
+/// increment, and each timed stage reads the monotonic clock twice.
+#[derive(Clone, Debug, Default)]
+pub struct QueryMetrics {
+    #[cfg(feature = "metrics")]
+    counters: Arc<Counters>,
+}
+
+impl QueryMetrics {
+    /// Runs the provided stage of a query, and records its duration.
+    #[inline(always)]
+    pub(crate) fn time<T, F: FnOnce() -> T>(&self, stage: Stage, stage_fn: F) -> T {
+        #[cfg(feature = "metrics")]
+        {
+            let start = Instant::now();
+            let result = stage_fn();
+            let elapsed_ns = start.elapsed().as_nanos().min(u64::MAX as u128) as u64;
+            self.counters.latencies[stage as usize].record(elapsed_ns);
+            result
+        }
+        #[cfg(not(feature = "metrics"))]
+        {
+            let _ = stage;
+            stage_fn()
+        }
+    }
+
+    /// Records a summary lookup which examined `scanned` summaries (or files, if the index is stale), and whether it found one.
+    #[inline(always)]
+    pub(crate) fn summary_lookup(&self, kind: DataKind, scanned: usize, found: bool) {
+        #[cfg(feature = "metrics")]
+        {
+            let lookups = match kind {
+                DataKind::Ephemeris => &self.counters.spk,
+                DataKind::Orientation => &self.counters.bpc,
+            };
+            lookups.lookups.fetch_add(1, Ordering::Relaxed);
+            lookups.scanned.fetch_add(scanned as u64, Ordering::Relaxed);
+            if !found {
+                lookups.misses.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+        #[cfg(not(feature = "metrics"))]
+        let _ = (kind, scanned, found);
+    }
+
+    /// Records whether the path of a frame to the root was served from the path cache.
+    #[inline(always)]
+    pub(crate) fn path_cache(&self, kind: DataKind, hit: bool) {
+        #[cfg(feature = "metrics")]
+        {
+            let paths = self.paths(kind);
+            if hit {
+                paths.hits.fetch_add(1, Ordering::Relaxed);
+            } else {
+                paths.misses.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+        #[cfg(not(feature = "metrics"))]
+        let _ = (kind, hit);
+    }
+
+    /// Records whether the state of a frame with respect to its parent was served from the state cache, if it is enabled.
+    #[inline(always)]
+    pub(crate) fn state_cache(&self, hit: bool) {
+        #[cfg(feature = "metrics")]
+        {
+            let state_cache = &self.counters.state_cache;
+            if hit {
+                state_cache.hits.fetch_add(1, Ordering::Relaxed);
+            } else {
+                state_cache.misses.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+        #[cfg(not(feature = "metrics"))]
+        let _ = hit;
+    }
+
+    /// Records the number of nodes of the path between two frames.
+    #[inline(always)]
+    pub(crate) fn path_depth(&self, kind: DataKind, node_count: usize) {
+        #[cfg(feature = "metrics")]
+        self.paths(kind).depth[node_count.min(MAX_TREE_DEPTH)].fetch_add(1, Ordering::Relaxed);
+        #[cfg(not(feature = "metrics"))]
+        let _ = (kind, node_count);
+    }
+
+    /// Records an evaluation with the provided kind of interpolation.
+    #[inline(always)]
+    pub(crate) fn interpolation(&self, interpolation: Interpolation) {
+        #[cfg(feature = "metrics")]
+        self.counters.interpolations[interpolation as usize].fetch_add(1, Ordering::Relaxed);
+        #[cfg(not(feature = "metrics"))]
+        let _ = interpolation;
+    }
+
+    #[cfg(feature = "metrics")]
+    fn paths(&self, kind: DataKind) -> &Paths {
+        match kind {
+            DataKind::Ephemeris => &self.counters.ephemeris_paths,
+            DataKind::Orientation => &self.counters.orientation_paths,
+        }
+    }
+
+    /// Returns a snapshot of the statistics recorded so far.
+    #[cfg(feature = "metrics")]
+    pub fn snapshot(&self) -> AlmanacStats {
+        let lookups = |lookups: &Lookups| LookupStats {
+            lookups: lookups.lookups.load(Ordering::Relaxed),
+            scanned: lookups.scanned.load(Ordering::Relaxed),
+            misses: lookups.misses.load(Ordering::Relaxed),
+        };
+        let paths = |paths: &Paths| PathStats {
+            hits: paths.hits.load(Ordering::Relaxed),
+            misses: paths.misses.load(Ordering::Relaxed),
+            depth: core::array::from_fn(|i| paths.depth[i].load(Ordering::Relaxed)),
+        };
+        let interpolations = &self.counters.interpolations;
+        let latencies = &self.counters.latencies;
+
+        AlmanacStats {
+            spk_lookups: lookups(&self.counters.spk),
+            bpc_lookups: lookups(&self.counters.bpc),
+            ephemeris_paths: paths(&self.counters.ephemeris_paths),
+            orientation_paths: paths(&self.counters.orientation_paths),
+            state_cache: CacheStats {
+                hits: self.counters.state_cache.hits.load(Ordering::Relaxed),
+                misses: self.counters.state_cache.misses.load(Ordering::Relaxed),
+            },
+            interpolations: InterpolationStats {
+                chebyshev: interpolations[Interpolation::Chebyshev as usize]
+                    .load(Ordering::Relaxed),
+                lagrange: interpolations[Interpolation::Lagrange as usize].load(Ordering::Relaxed),
+                hermite: interpolations[Interpolation::Hermite as usize].load(Ordering::Relaxed),
+                planetary_constants: interpolations[Interpolation::PlanetaryConstants as usize]
+                    .load(Ordering::Relaxed),
+            },
+            lookup_latency: latencies[Stage::Lookup as usize].snapshot(),
+            decode_latency: latencies[Stage::Decode as usize].snapshot(),
+            eval_latency: latencies[Stage::Eval as usize].snapshot(),
+        }
+    }
+
+    /// Resets all of the statistics, for this Almanac and all of its clones.
+    #[cfg(feature = "metrics")]
+    pub fn reset(&self) {
+        let reset = |counters: &[AtomicU64]| {
+            for counter in counters {
+                counter.store(0, Ordering::Relaxed);
+            }
+        };
+        let counters = &self.counters;
+        for lookups in [&counters.spk, &counters.bpc] {
+            lookups.lookups.store(0, Ordering::Relaxed);
+            lookups.scanned.store(0, Ordering::Relaxed);
+            lookups.misses.store(0, Ordering::Relaxed);
+        }
+        for paths in [&counters.ephemeris_paths, &counters.orientation_paths] {
+            paths.hits.store(0, Ordering::Relaxed);
+            paths.misses.store(0, Ordering::Relaxed);
+            reset(&paths.depth);
+        }
+        counters.state_cache.hits.store(0, Ordering::Relaxed);
+        counters.state_cache.misses.store(0, Ordering::Relaxed);
+        reset(&counters.interpolations);
+        for histogram in &counters.latencies {
+            histogram.count.store(0, Ordering::Relaxed);
+            histogram.total_ns.store(0, Ordering::Relaxed);
+            reset(&histogram.buckets);
+        }
+    }
+}
+
+/// Statistics of the summary lookups of one kind of DAF.
+#[cfg(feature = "metrics")]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct LookupStats {
+    /// Number of lookups of a summary by ID at an epoch
+    pub lookups: u64,
+    /// Number of summaries examined by these lookups, or of files if the index was not up to date
+    pub scanned: u64,
+    /// Number of lookups which found no summary
+    pub misses: u64,
+}
+
+#[cfg(feature = "metrics")]
+impl LookupStats {
+    /// Mean number of summaries examined per lookup.
+    pub fn mean_scanned(&self) -> f64 {
+        self.scanned as f64 / self.lookups.max(1) as f64
+    }
+}
+
+/// Statistics of the paths from frames to the root of one kind of data.
+#[cfg(feature = "metrics")]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct PathStats {
+    /// Number of paths served from the path cache
+    pub hits: u64,
+    /// Number of paths computed from the summaries
+    pub misses: u64,
+    /// Number of paths between two frames with each number of nodes, from zero to the maximum tree depth
+    pub depth: [u64; MAX_TREE_DEPTH + 1],
+}
+
+#[cfg(feature = "metrics")]
+impl PathStats {
+    /// Fraction of the paths served from the path cache.
+    pub fn hit_rate(&self) -> f64 {
+        self.hits as f64 / (self.hits + self.misses).max(1) as f64
+    }
+}
+
+/// Statistics of the state cache, cf. [Almanac::with_state_cache].
+#[cfg(feature = "metrics")]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct CacheStats {
+    /// Number of states served from the cache
+    pub hits: u64,
+    /// Number of states interpolated and then inserted in the cache
+    pub misses: u64,
+}
+
+#[cfg(feature = "metrics")]
+impl CacheStats {
+    /// Fraction of the states served from the cache.
+    pub fn hit_rate(&self) -> f64 {
+        self.hits as f64 / (self.hits + self.misses).max(1) as f64
+    }
+}
+
+/// Number of evaluations with each kind of interpolation.
+#[cfg(feature = "metrics")]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct InterpolationStats {
+    /// SPK and BPC segments of Chebyshev type 2
+    pub chebyshev: u64,
+    /// SPK segments of Lagrange type 9
+    pub lagrange: u64,
+    /// SPK segments of Hermite type 13
+    pub hermite: u64,
+    /// Rotations computed from the planetary constants
+    pub planetary_constants: u64,
+}
+
+/// Histogram of the durations of a stage of the queries.
+#[cfg(feature = "metrics")]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct LatencyStats {
+    pub count: u64,
+    pub total_ns: u64,
+    /// Bucket `i` counts the durations between 2^i and 2^(i+1) nanoseconds
+    pub buckets: [u64; LATENCY_BUCKETS],
+}
+
+#[cfg(feature = "metrics")]
+impl LatencyStats {
+    /// Mean duration in nanoseconds.
+    pub fn mean_ns(&self) -> f64 {
+        self.total_ns as f64 / self.count.max(1) as f64
+    }
+
+    /// Upper bound, in nanoseconds, of the duration of the provided quantile (between 0 and 1), to within a factor of two.
+    pub fn quantile_ns(&self, quantile: f64) -> u64 {
+        let rank = (quantile.clamp(0.0, 1.0) * self.count as f64).ceil() as u64;
+        let mut seen = 0;
+        for (i, count) in self.buckets.iter().enumerate() {
+            seen += count;
+            if seen >= rank.max(1) {
+                return 1 << (i + 1);
+            }
+        }
+        1 << LATENCY_BUCKETS
+    }
+}
+
+/// Snapshot of the statistics of the queries of an Almanac, cf. [Almanac::stats].
+#[cfg(feature = "metrics")]
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct AlmanacStats {
+    pub spk_lookups: LookupStats,
+    pub bpc_lookups: LookupStats,
+    pub ephemeris_paths: PathStats,
+    pub orientation_paths: PathStats,
+    /// Hits and misses of the state cache, only recorded while it is enabled
+    pub state_cache: CacheStats,
+    pub interpolations: InterpolationStats,
+    /// Durations of the summary lookups in the summary index
+    pub lookup_latency: LatencyStats,
+    /// Durations of the accesses to the segment data
+    pub decode_latency: LatencyStats,
+    /// Durations of the interpolations and of the rotation model evaluations
+    pub eval_latency: LatencyStats,
+}
+
+#[cfg(feature = "metrics")]
+impl Almanac {
+    /// Returns a snapshot of the statistics of the queries of this Almanac and of all of its clones since they were last reset.
+    pub fn stats(&self) -> AlmanacStats {
+        self.metrics.snapshot()
+    }
+
+    /// Resets the statistics of the queries of this Almanac and of all of its clones.
+    pub fn reset_stats(&self) {
+        self.metrics.reset()
+    }
+}
+
+#[cfg(all(test, feature = "metrics"))]
+mod ut_metrics {
+    use super::*;
+    use crate::constants::frames::{EARTH_ITRF93, EARTH_J2000, MOON_J2000};
+    use hifitime::Epoch;
+
+    #[test]
+    fn query_stats() {
+        let almanac = Almanac::new("../data/de440s.bsp")
+            .unwrap()
+            .load("../data/earth_latest_high_prec.bpc")
+            .unwrap();
+        almanac.reset_stats();
+
+        let epoch = Epoch::from_gregorian_utc_at_midnight(2024, 1, 1);
+        for i in 0..10 {
+            almanac
+                .translate(
+                    MOON_J2000,
+                    EARTH_J2000,
+                    epoch + i as f64 * hifitime::Unit::Minute,
+                    None,
+                )
+                .unwrap();
+        }
+        almanac
+            .rotate_from_to(EARTH_ITRF93, EARTH_J2000, epoch)
+            .unwrap();
+
+        let stats = almanac.stats();
+        assert!(stats.spk_lookups.lookups >= 10);
+        assert_eq!(stats.spk_lookups.misses, 0);
+        assert!(stats.spk_lookups.mean_scanned() >= 1.0);
+        // The Moon path is computed once, and then served from the cache.
+        assert!(stats.ephemeris_paths.misses >= 1);
+        assert!(stats.ephemeris_paths.hits >= 9);
+        assert!(stats.ephemeris_paths.hit_rate() > 0.5);
+        // The state cache is disabled by default.
+        assert_eq!(stats.state_cache, CacheStats::default());
+        assert_eq!(stats.ephemeris_paths.depth.iter().sum::<u64>(), 10);
+        assert!(stats.interpolations.chebyshev >= 11);
+        assert_eq!(stats.interpolations.lagrange, 0);
+        assert!(stats.bpc_lookups.lookups >= 1);
+        assert!(stats.eval_latency.count >= 11);
+        assert!(stats.eval_latency.quantile_ns(0.5) <= stats.eval_latency.quantile_ns(1.0));
+        assert!(stats.lookup_latency.mean_ns() > 0.0);
+
+        // Clones share their statistics.
+        almanac.clone().reset_stats();
+        assert_eq!(almanac.stats(), AlmanacStats::default());
+    }
+}
@@ -20,27 +20,37 @@ use crate::errors::{
     AlmanacError, AlmanacResult, EphemerisSnafu, InputOutputError, LoadingSnafu, OrientationSnafu,
     TLDataSetSnafu,
 };
-use crate::file2heap;
-use crate::naif::daf::{FileRecord, NAIFRecord};
+use crate::naif::daf::{FileRecord, NAIFRecord, SummaryIndex};
 use crate::naif::{BPC, SPK};
 use crate::orientations::BPCSnafu;
 use crate::structure::dataset::DataSetType;
 use crate::structure::metadata::Metadata;
 use crate::structure::{EulerParameterDataSet, PlanetaryDataSet, SpacecraftDataSet};
+use crate::{file2heap, file2mmap};
+use cache::{PathCache, StateCache};
 use core::fmt;
+use metrics::QueryMetrics;
+use registry::KernelRegistry;
 
 // TODO: Switch these to build constants so that it's configurable when building the library.
-pub const MAX_LOADED_SPKS: usize = 32;
-pub const MAX_LOADED_BPCS: usize = 8;
 pub const MAX_SPACECRAFT_DATA: usize = 16;
 pub const MAX_PLANETARY_DATA: usize = 64;
 
 pub mod aer;
+#[cfg(feature = "parallel")]
+pub mod batch;
 pub mod bpc;
+pub mod cache;
+pub mod eclipse;
+pub mod metrics;
 pub mod planetary;
+pub mod registry;
+pub mod shared;
 pub mod solar;
 pub mod spk;
 pub mod transform;
+pub mod visibility;
+pub mod windows;
 
 #[cfg(feature = "metaload")]
 pub mod metaload;
@@ -57,21 +67,36 @@ use pyo3::prelude::*;
 /// An Almanac contains all of the loaded SPICE and ANISE data.
 ///
 /// # Limitations
-/// The stack space required depends on the maximum number of each type that can be loaded.
+/// Any number of SPK and BPC files can be loaded, and they are shared between clones of an Almanac.
+/// The stack space required depends on the maximum number of spacecraft and planetary data that can be loaded.
 #[derive(Clone, Default)]
 #[cfg_attr(feature = "python", pyclass)]
 #[cfg_attr(feature = "python", pyo3(module = "anise"))]
 pub struct Almanac {
     /// NAIF SPK is kept unchanged
-    pub spk_data: [Option<SPK>; MAX_LOADED_SPKS],
+    pub spk_data: KernelRegistry<SPK>,
     /// NAIF BPC is kept unchanged
-    pub bpc_data: [Option<BPC>; MAX_LOADED_BPCS],
+    pub bpc_data: KernelRegistry<BPC>,
+    /// Index of the SPK summaries by ID and epoch, maintained by `with_spk`
+    pub spk_index: SummaryIndex,
+    /// Index of the BPC summaries by ID and epoch, maintained by `with_bpc`
+    pub bpc_index: SummaryIndex,
+    /// Cache of the ephemeris root and paths, reset by `with_spk`
+    pub ephemeris_paths: PathCache,
+    /// Cache of the orientation root and paths, reset by `with_bpc` and `with_planetary_data`
+    pub orientation_paths: PathCache,
+    /// Cache of the states of frames with respect to their parent, disabled unless set up by `with_state_cache`, and emptied by `with_spk`
+    pub state_cache: StateCache,
+    /// Number of Type 9 and Type 13 interpolation windows whose Newton coefficients each thread keeps for this Almanac, zero (the default) unless set up by `with_newton_window_capacity`
+    pub newton_window_capacity: usize,
     /// Dataset of planetary data
     pub planetary_data: PlanetaryDataSet,
     /// Dataset of spacecraft data
     pub spacecraft_data: SpacecraftDataSet,
     /// Dataset of euler parameters
     pub euler_param_data: EulerParameterDataSet,
+    /// Statistics of the queries, shared between clones and only recorded with the `metrics` feature
+    pub metrics: QueryMetrics,
 }
 
 impl fmt::Display for Almanac {
@@ -125,7 +150,7 @@ impl Almanac {
                 return match fileid {
                     "PCK" => {
                         info!("Loading as DAF/PCK");
-                        let bpc = BPC::parse(bytes)
+                        let bpc = BPC::from_bytes(bytes)
                             .context(BPCSnafu {
                                 action: "parsing bytes",
                             })
@@ -138,7 +163,7 @@ impl Almanac {
                     }
                     "SPK" => {
                         info!("Loading as DAF/SPK");
-                        let spk = SPK::parse(bytes)
+                        let spk = SPK::from_bytes(bytes)
                             .context(SPKSnafu {
                                 action: "parsing bytes",
                             })
@@ -195,6 +220,28 @@ impl Almanac {
             })
         }
     }
+
+    /// Generic function that tries to load the provided path guessing to the file type, memory mapping the file instead of copying it onto the heap.
+    ///
+    /// SPK and BPC files are then served directly from the mapped pages, so several processes loading the same kernels share one copy in the page cache.
+    /// ANISE data sets are decoded on load, so memory mapping them only avoids the initial copy.
+    ///
+    /// # Safety
+    /// The file must not be modified or truncated while it is loaded in this Almanac or any of its clones: the data would
+    /// change under them, and accessing truncated pages is undefined behavior.
+    pub unsafe fn load_mmap(&self, path: &str) -> AlmanacResult<Self> {
+        // SAFETY: the caller guarantees that the file is not modified while mapped.
+        let bytes = unsafe { file2mmap!(path) }.context(LoadingSnafu {
+            path: path.to_string(),
+        })?;
+        info!("Memory mapping almanac from {path}");
+        self.load_from_bytes(bytes).map_err(|e| match e {
+            AlmanacError::GenericError { err } => AlmanacError::GenericError {
+                err: format!("with {path}: {err}"),
+            },
+            _ => e,
+        })
+    }
 }
 
 #[cfg_attr(feature = "python", pymethods)]
@@ -247,14 +294,7 @@ impl Almanac {
         let print_any = spk.unwrap_or(false) || bpc.unwrap_or(false) || planetary.unwrap_or(false);
 
         if spk.unwrap_or(!print_any) {
-            for (spk_no, maybe_spk) in self
-                .spk_data
-                .iter()
-                .take(self.num_loaded_spk())
-                .rev()
-                .enumerate()
-            {
-                let spk = maybe_spk.as_ref().unwrap();
+            for (spk_no, spk) in self.spk_data.iter().rev().enumerate() {
                 println!(
                     "=== SPK #{spk_no} ===\n{}",
                     spk.describe_in(time_scale.unwrap_or(TimeScale::TDB), round_time)
@@ -263,14 +303,7 @@ impl Almanac {
         }
 
         if bpc.unwrap_or(!print_any) {
-            for (bpc_no, maybe_bpc) in self
-                .bpc_data
-                .iter()
-                .take(self.num_loaded_bpc())
-                .rev()
-                .enumerate()
-            {
-                let bpc = maybe_bpc.as_ref().unwrap();
+            for (bpc_no, bpc) in self.bpc_data.iter().rev().enumerate() {
                 println!(
                     "=== BPC #{bpc_no} ===\n{}",
                     bpc.describe_in(time_scale.unwrap_or(TimeScale::TDB), round_time)
@@ -7,11 +7,13 @@
  *
  * Documentation: https://nyxspace.com/
  */
+use super::cache::PathCache;
 use super::Almanac;
 use snafu::prelude::*;
 use tabled::{settings::Style, Table, Tabled};
 
 use crate::{
+    errors::AlmanacResult,
     prelude::{Frame, FrameUid},
     structure::{dataset::DataSetError, PlanetaryDataSet},
 };
@@ -32,17 +34,35 @@ impl Almanac {
         let uid = uid.into();
         Ok(self
             .planetary_data
-            .get_by_id(uid.ephemeris_id)
+            .get_ref_by_id(uid.ephemeris_id)
             .context(PlanetaryDataSetSnafu {
                 action: "fetching frame by its UID via ephemeris_id",
             })?
             .to_frame(uid))
     }
 
+    /// Returns this frame with its gravity parameter and shape from the planetary data if it is loaded, or the frame itself otherwise.
+    ///
+    /// Frames which already define both, e.g. those returned by `frame_from_uid`, are returned as is without a lookup.
+    pub(crate) fn loaded_frame_info(&self, frame: Frame) -> Frame {
+        if frame.mu_km3_s2.is_some() && frame.shape.is_some() {
+            frame
+        } else {
+            self.frame_from_uid(frame).unwrap_or(frame)
+        }
+    }
+
+    /// Returns the frame with this center and reference frame name, cf. [Frame::from_name], with its gravity parameter and
+    /// shape if its planetary data is loaded.
+    pub fn frame_from_name(&self, center: &str, ref_frame: &str) -> AlmanacResult<Frame> {
+        Ok(self.loaded_frame_info(Frame::from_name(center, ref_frame)?))
+    }
+
     /// Loads the provided planetary data into a clone of this original Almanac.
     pub fn with_planetary_data(&self, planetary_data: PlanetaryDataSet) -> Self {
         let mut me = self.clone();
         me.planetary_data = planetary_data;
+        me.orientation_paths = PathCache::default();
         me
     }
 }
@@ -134,3 +154,29 @@ impl PlanetaryDataSet {
         format!("{tbl}")
     }
 }
+
+#[cfg(test)]
+mod ut_planetary {
+    use crate::constants::frames::EARTH_J2000;
+    use crate::prelude::{Almanac, Frame};
+
+    #[test]
+    fn frame_by_name() {
+        let almanac = Almanac::new("../data/pck08.pca").unwrap();
+
+        let eme2k = almanac.frame_from_name("Earth", "J2000").unwrap();
+        assert_eq!(eme2k, almanac.frame_from_uid(EARTH_J2000).unwrap());
+        assert!(eme2k.mu_km3_s2.is_some() && eme2k.shape.is_some());
+        // Frames which already carry their info are returned as is.
+        assert_eq!(almanac.loaded_frame_info(eme2k), eme2k);
+        assert_eq!(almanac.loaded_frame_info(EARTH_J2000), eme2k);
+
+        // Frames without planetary data are still valid.
+        let unloaded = Almanac::default();
+        assert_eq!(
+            unloaded.frame_from_name("Earth", "J2000").unwrap(),
+            Frame::new(399, 1)
+        );
+        assert!(almanac.frame_from_name("Vulcan", "J2000").is_err());
+    }
+}
@@ -9,22 +9,172 @@
  */
 
 use super::{
+    aer::aer_in_tx_frame,
     planetary::{PlanetaryDataError, PlanetaryDataSetSnafu},
     Almanac,
 };
-use crate::prelude::Frame;
+use crate::errors::AlmanacResult;
+use crate::prelude::{Aberration, Frame, Orbit};
+use hifitime::Epoch;
+use numpy::{PyArray2, PyArrayMethods, PyReadonlyArray1, PyUntypedArrayMethods};
+use pyo3::exceptions::PyValueError;
 use pyo3::prelude::*;
 use snafu::prelude::*;
 
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+
 #[pymethods]
 impl Almanac {
     pub fn frame_info(&self, uid: Frame) -> Result<Frame, PlanetaryDataError> {
         Ok(self
             .planetary_data
-            .get_by_id(uid.ephemeris_id)
+            .get_ref_by_id(uid.ephemeris_id)
             .context(PlanetaryDataSetSnafu {
                 action: "fetching frame by its UID via ephemeris_id",
             })?
             .to_frame(uid.into()))
     }
+
+    /// Computes the state of the target frame as seen from the observer frame at each of the provided epochs, as `transform` does.
+    ///
+    /// The epochs are a NumPy array of TDB seconds past J2000, e.g. from `Epoch.to_tdb_seconds()`. The states are written as
+    /// X, Y, Z (km), VX, VY, VZ (km/s) into the rows of `out` if provided, an (N, 6) float64 array, or into a new array otherwise.
+    /// The GIL is released during the computation, and the epochs are computed in parallel.
+    #[pyo3(name = "transform_many", signature = (target_frame, observer_frame, epochs_tdb_s, ab_corr=None, out=None))]
+    fn py_transform_many<'py>(
+        &self,
+        py: Python<'py>,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epochs_tdb_s: PyReadonlyArray1<'py, f64>,
+        ab_corr: Option<Aberration>,
+        out: Option<Bound<'py, PyArray2<f64>>>,
+    ) -> PyResult<Bound<'py, PyArray2<f64>>> {
+        let epochs_tdb_s = epochs_tdb_s.as_slice()?;
+        compute_rows(py, epochs_tdb_s, out, 6, |epoch, row| {
+            let state = self.transform(target_frame, observer_frame, epoch, ab_corr)?;
+            row.copy_from_slice(state.to_cartesian_pos_vel().as_slice());
+            Ok(())
+        })
+    }
+
+    /// Computes the translation of the target frame as seen from the observer frame at each of the provided epochs, as
+    /// `translate` does. The epochs and output array are those of `transform_many`.
+    #[pyo3(name = "translate_many", signature = (target_frame, observer_frame, epochs_tdb_s, ab_corr=None, out=None))]
+    fn py_translate_many<'py>(
+        &self,
+        py: Python<'py>,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epochs_tdb_s: PyReadonlyArray1<'py, f64>,
+        ab_corr: Option<Aberration>,
+        out: Option<Bound<'py, PyArray2<f64>>>,
+    ) -> PyResult<Bound<'py, PyArray2<f64>>> {
+        let epochs_tdb_s = epochs_tdb_s.as_slice()?;
+        compute_rows(py, epochs_tdb_s, out, 6, |epoch, row| {
+            let state = self
+                .translate(target_frame, observer_frame, epoch, ab_corr)
+                .context(crate::errors::EphemerisSnafu {
+                    action: "translating many",
+                })?;
+            row.copy_from_slice(state.to_cartesian_pos_vel().as_slice());
+            Ok(())
+        })
+    }
+
+    /// Computes the azimuth (deg), elevation (deg), range (km), and range rate (km/s) of the receiver frame seen from the
+    /// transmitter at each of the provided epochs, as `azimuth_elevation_range_sez` does. The transmitter is typically a ground
+    /// station: it is fixed in its frame and only its epoch is changed.
+    ///
+    /// The epochs are those of `transform_many`, and the results are written into the rows of `out` if provided, an (N, 4)
+    /// float64 array, or into a new array otherwise.
+    #[pyo3(signature = (rx_frame, tx, epochs_tdb_s, ab_corr=None, out=None))]
+    fn azimuth_elevation_range_sez_many<'py>(
+        &self,
+        py: Python<'py>,
+        rx_frame: Frame,
+        tx: Orbit,
+        epochs_tdb_s: PyReadonlyArray1<'py, f64>,
+        ab_corr: Option<Aberration>,
+        out: Option<Bound<'py, PyArray2<f64>>>,
+    ) -> PyResult<Bound<'py, PyArray2<f64>>> {
+        let epochs_tdb_s = epochs_tdb_s.as_slice()?;
+        compute_rows(py, epochs_tdb_s, out, 4, |epoch, row| {
+            let mut tx = tx;
+            tx.epoch = epoch;
+            // The receiver is computed directly in the transmitter frame, so it is transformed only once per epoch.
+            let rx = self.transform(rx_frame, tx.frame, epoch, ab_corr)?;
+            let aer = aer_in_tx_frame(rx, tx)?;
+            row.copy_from_slice(&[
+                aer.azimuth_deg,
+                aer.elevation_deg,
+                aer.range_km,
+                aer.range_rate_km_s,
+            ]);
+            Ok(())
+        })
+    }
+}
+
+/// Computes one row of the output per epoch without the GIL, in parallel with the `parallel` feature.
+/// The output array is allocated if it is not provided.
+pub(crate) fn compute_rows<'py, F>(
+    py: Python<'py>,
+    epochs_tdb_s: &[f64],
+    out: Option<Bound<'py, PyArray2<f64>>>,
+    width: usize,
+    row_fn: F,
+) -> PyResult<Bound<'py, PyArray2<f64>>>
+where
+    F: Fn(Epoch, &mut [f64]) -> AlmanacResult<()> + Send + Sync,
+{
+    let out = output_array(py, out, epochs_tdb_s.len(), width)?;
+    {
+        // The output array may be borrowed elsewhere, e.g. if it is also the array of epochs.
+        let mut rows = out.try_readwrite().map_err(|e| {
+            PyValueError::new_err(format!("output array cannot be written to: {e}"))
+        })?;
+        let rows = rows.as_slice_mut()?;
+        py.allow_threads(|| {
+            #[cfg(feature = "parallel")]
+            let result = rows
+                .par_chunks_mut(width)
+                .zip(epochs_tdb_s.par_iter())
+                .try_for_each(|(row, epoch_tdb_s)| {
+                    row_fn(Epoch::from_tdb_seconds(*epoch_tdb_s), row)
+                });
+            #[cfg(not(feature = "parallel"))]
+            let result = rows
+                .chunks_mut(width)
+                .zip(epochs_tdb_s.iter())
+                .try_for_each(|(row, epoch_tdb_s)| {
+                    row_fn(Epoch::from_tdb_seconds(*epoch_tdb_s), row)
+                });
+            result
+        })?;
+    }
+    Ok(out)
+}
+
+/// Returns the provided output array after checking its shape, or a new zeroed array of that shape.
+pub(crate) fn output_array<'py>(
+    py: Python<'py>,
+    out: Option<Bound<'py, PyArray2<f64>>>,
+    num_rows: usize,
+    width: usize,
+) -> PyResult<Bound<'py, PyArray2<f64>>> {
+    match out {
+        Some(out) => {
+            if out.shape() != [num_rows, width] {
+                Err(PyValueError::new_err(format!(
+                    "output array must have shape ({num_rows}, {width}) but has shape {:?}",
+                    out.shape()
+                )))
+            } else {
+                Ok(out)
+            }
+        }
+        None => Ok(PyArray2::zeros_bound(py, [num_rows, width], false)),
+    }
 }
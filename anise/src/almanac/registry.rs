@@ -0,0 +1,101 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::fmt;
+use core::ops::Deref;
+use std::sync::Arc;
+
+/// The kernels loaded in an Almanac, in their loading order, shared between clones of that Almanac.
+///
+/// There is no limit on the number of kernels. Cloning a registry is a reference count increment.
+/// Adding a kernel to a registry shared with other Almanacs first copies the list of handles to the loaded kernels,
+/// which only increments the reference count of each kernel's bytes: the kernels themselves are neither copied nor parsed again.
+pub struct KernelRegistry<T> {
+    kernels: Arc<Vec<T>>,
+}
+
+impl<T: Clone> KernelRegistry<T> {
+    /// Appends this kernel, which then has the highest priority, and returns its index.
+    pub fn push(&mut self, kernel: T) -> usize {
+        let kernels = Arc::make_mut(&mut self.kernels);
+        kernels.push(kernel);
+        kernels.len() - 1
+    }
+
+    /// Removes the kernel at this index and returns it, if any: the kernels loaded after it move down by one index.
+    pub fn remove(&mut self, idx: usize) -> Option<T> {
+        if idx < self.kernels.len() {
+            Some(Arc::make_mut(&mut self.kernels).remove(idx))
+        } else {
+            None
+        }
+    }
+}
+
+impl<T> Deref for KernelRegistry<T> {
+    type Target = [T];
+
+    fn deref(&self) -> &Self::Target {
+        self.kernels.as_slice()
+    }
+}
+
+impl<T> Clone for KernelRegistry<T> {
+    fn clone(&self) -> Self {
+        Self {
+            kernels: Arc::clone(&self.kernels),
+        }
+    }
+}
+
+impl<T> Default for KernelRegistry<T> {
+    fn default() -> Self {
+        Self {
+            kernels: Arc::new(Vec::new()),
+        }
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for KernelRegistry<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_list().entries(self.iter()).finish()
+    }
+}
+
+#[cfg(test)]
+mod ut_registry {
+    use super::*;
+
+    #[test]
+    fn shared_growth() {
+        let mut registry = KernelRegistry::default();
+        assert!(registry.is_empty());
+        assert_eq!(registry.push(10), 0);
+
+        let shared = registry.clone();
+        assert!(Arc::ptr_eq(&registry.kernels, &shared.kernels));
+
+        // Growing this registry does not change its clones.
+        for n in 1..500 {
+            assert_eq!(registry.push(10 + n), n);
+        }
+        assert_eq!(registry.len(), 500);
+        assert_eq!(registry[499], 509);
+        assert_eq!(&shared[..], &[10]);
+
+        // Removing a kernel does not change its clones either.
+        let grown = registry.clone();
+        assert_eq!(registry.remove(0), Some(10));
+        assert_eq!(registry.remove(499), None);
+        assert_eq!(registry.len(), 499);
+        assert_eq!(registry[0], 11);
+        assert_eq!(grown.len(), 500);
+    }
+}
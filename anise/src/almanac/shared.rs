@@ -0,0 +1,224 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use log::info;
+use snafu::ResultExt;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, PoisonError, RwLock};
+use std::thread::{self, JoinHandle};
+
+use super::Almanac;
+use crate::errors::{AlmanacError, AlmanacResult, EphemerisSnafu};
+
+/// A handle to an Almanac queried by a long-running service, whose kernels can be replaced without pausing these queries.
+///
+/// Each query uses the snapshot returned by `current`, which does not change for as long as it is held, even if a newer Almanac is swapped in meanwhile.
+/// Queries never wait for an update: the Almanac is only locked to clone or replace a pointer to it, while the newer Almanac is
+/// loaded, parsed, and indexed beforehand, optionally on a background thread. Updates are serialized by `update_lock`, so an
+/// update waits for any update still being built, e.g. behind a slow load.
+/// Kernels are shared between the snapshots that load them, so replacing an SPK only holds the bytes of that SPK twice, until the last query on the previous snapshot completes.
+///
+/// Clones of this handle refer to the same Almanac.
+#[derive(Clone, Default)]
+pub struct SharedAlmanac {
+    current: Arc<RwLock<Arc<Almanac>>>,
+    /// Serializes the updates, so that none of them is lost if several are built at the same time
+    update_lock: Arc<Mutex<()>>,
+    generation: Arc<AtomicU64>,
+}
+
+impl SharedAlmanac {
+    pub fn new(almanac: Almanac) -> Self {
+        Self {
+            current: Arc::new(RwLock::new(Arc::new(almanac))),
+            ..Default::default()
+        }
+    }
+
+    /// Returns the current snapshot of the Almanac.
+    pub fn current(&self) -> Arc<Almanac> {
+        // The lock only protects a pointer swap, so a panic while holding it cannot leave the Almanac in an inconsistent state.
+        Arc::clone(&self.current.read().unwrap_or_else(PoisonError::into_inner))
+    }
+
+    /// Returns the number of times the Almanac was replaced since this handle was created.
+    pub fn generation(&self) -> u64 {
+        self.generation.load(Ordering::Acquire)
+    }
+
+    /// Replaces the Almanac by the provided one, and returns the previous snapshot.
+    pub fn swap(&self, almanac: Almanac) -> Arc<Almanac> {
+        let _update = self
+            .update_lock
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        self.replace(almanac)
+    }
+
+    /// Builds a new Almanac from the current one, e.g. by loading a new kernel in it, and swaps it in. Returns the new generation.
+    ///
+    /// Queries keep using the current Almanac while it is built. Other updates wait until this one is swapped in or fails, such
+    /// that each update builds on the previous one. If building fails, the current Almanac is kept.
+    pub fn update<F>(&self, build: F) -> AlmanacResult<u64>
+    where
+        F: FnOnce(&Almanac) -> AlmanacResult<Almanac>,
+    {
+        let _update = self
+            .update_lock
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        let almanac = build(&self.current())?;
+        self.replace(almanac);
+        Ok(self.generation())
+    }
+
+    /// Builds a new Almanac from the current one on a background thread, and swaps it in once built.
+    pub fn update_in_background<F>(&self, build: F) -> PendingUpdate
+    where
+        F: FnOnce(&Almanac) -> AlmanacResult<Almanac> + Send + 'static,
+    {
+        let me = self.clone();
+        PendingUpdate {
+            handle: thread::spawn(move || me.update(build)),
+        }
+    }
+
+    /// Loads the provided files in this order on a background thread, and swaps in the resulting Almanac once all are loaded.
+    pub fn load_in_background(&self, paths: Vec<String>) -> PendingUpdate {
+        self.update_in_background(move |almanac| {
+            paths
+                .iter()
+                .try_fold(almanac.clone(), |almanac, path| almanac.load(path))
+        })
+    }
+
+    /// Replaces the loaded SPK whose CRC32 checksum is `spk_crc32` by the provided SPK file, loaded on a background thread, e.g. to reload a predicted ephemeris.
+    ///
+    /// The SPK to replace is looked up once the updates queued before this one are swapped in, since these may change the index of each SPK.
+    /// If several loaded SPKs have this checksum, the one with the lowest priority is replaced. The new SPK has the highest priority, like any newly loaded SPK.
+    pub fn replace_spk_in_background(&self, spk_crc32: u32, path: String) -> PendingUpdate {
+        self.update_in_background(move |almanac| {
+            let spk_no = almanac
+                .spk_data
+                .iter()
+                .position(|spk| spk.crc32_checksum == spk_crc32)
+                .ok_or_else(|| AlmanacError::GenericError {
+                    err: format!("no loaded SPK has the checksum 0x{spk_crc32:X}"),
+                })?;
+            almanac
+                .without_spk(spk_no)
+                .context(EphemerisSnafu {
+                    action: "replacing SPK",
+                })?
+                .load(&path)
+        })
+    }
+
+    fn replace(&self, almanac: Almanac) -> Arc<Almanac> {
+        let almanac = Arc::new(almanac);
+        let prev = {
+            let mut current = self.current.write().unwrap_or_else(PoisonError::into_inner);
+            std::mem::replace(&mut *current, almanac)
+        };
+        let generation = self.generation.fetch_add(1, Ordering::AcqRel) + 1;
+        info!("Almanac replaced (generation {generation})");
+        // The previous snapshot is dropped by the caller, outside of the lock, once no query uses it anymore.
+        prev
+    }
+}
+
+/// An update of a [SharedAlmanac] running on a background thread.
+#[must_use = "the outcome of the update is only known by waiting for it"]
+pub struct PendingUpdate {
+    handle: JoinHandle<AlmanacResult<u64>>,
+}
+
+impl PendingUpdate {
+    /// Returns true once the new Almanac is swapped in or failed to build.
+    pub fn is_finished(&self) -> bool {
+        self.handle.is_finished()
+    }
+
+    /// Blocks until this update completes, and returns the generation of the new Almanac.
+    pub fn wait(self) -> AlmanacResult<u64> {
+        self.handle.join().unwrap_or_else(|_| {
+            Err(AlmanacError::GenericError {
+                err: "background update of the Almanac panicked".to_string(),
+            })
+        })
+    }
+}
+
+#[cfg(test)]
+mod ut_shared {
+    use super::*;
+    use crate::constants::frames::{EARTH_J2000, MOON_J2000};
+    use crate::prelude::Epoch;
+
+    #[test]
+    fn hot_swap() {
+        let shared = SharedAlmanac::new(Almanac::new("../data/de440s.bsp").unwrap());
+        let epoch = Epoch::from_gregorian_utc_at_midnight(2025, 1, 1);
+
+        let before = shared.current();
+        let state = before
+            .translate_geometric(MOON_J2000, EARTH_J2000, epoch)
+            .unwrap();
+
+        let pending = shared.load_in_background(vec!["../data/de421.bsp".to_string()]);
+        // Queries can use the current Almanac while the new one is loaded.
+        assert_eq!(
+            before
+                .translate_geometric(MOON_J2000, EARTH_J2000, epoch)
+                .unwrap(),
+            state
+        );
+        assert_eq!(pending.wait().unwrap(), 1);
+
+        // The previous snapshot is unchanged, and the new one shares its SPK.
+        assert_eq!(before.num_loaded_spk(), 1);
+        let after = shared.current();
+        assert_eq!(after.num_loaded_spk(), 2);
+        assert_eq!(after.spk_index.num_indexed(), 2);
+
+        // Replacing DE421 by DE440s puts the latter at the highest priority.
+        let de421_crc32 = after.spk_data[1].crc32_checksum;
+        assert_ne!(de421_crc32, after.spk_data[0].crc32_checksum);
+        let pending =
+            shared.replace_spk_in_background(de421_crc32, "../data/de440s.bsp".to_string());
+        assert_eq!(pending.wait().unwrap(), 2);
+        let replaced = shared.current();
+        assert_eq!(replaced.num_loaded_spk(), 2);
+        assert_eq!(replaced.spk_index.num_indexed(), 2);
+        assert_eq!(
+            replaced
+                .translate_geometric(MOON_J2000, EARTH_J2000, epoch)
+                .unwrap(),
+            state
+        );
+
+        // A failed update keeps the current Almanac.
+        assert!(shared
+            .load_in_background(vec!["../data/not-a-kernel.bsp".to_string()])
+            .wait()
+            .is_err());
+        assert!(shared
+            .replace_spk_in_background(de421_crc32, "../data/de421.bsp".to_string())
+            .wait()
+            .is_err());
+        assert_eq!(shared.generation(), 2);
+        assert!(Arc::ptr_eq(&shared.current(), &replaced));
+
+        let prev = shared.swap(Almanac::default());
+        assert!(Arc::ptr_eq(&prev, &replaced));
+        assert_eq!(shared.current().num_loaded_spk(), 0);
+        assert_eq!(shared.generation(), 3);
+    }
+}
@@ -14,17 +14,21 @@ use hifitime::Epoch;
 
 #[cfg(feature = "python")]
 use pyo3::prelude::*;
-use snafu::ensure;
+use snafu::{ensure, ResultExt};
 
-use crate::ephemerides::NoEphemerisLoadedSnafu;
+use crate::ephemerides::paths::ephemeris_root_of;
+use crate::ephemerides::{NoEphemerisLoadedSnafu, SPKSnafu};
 use crate::naif::daf::DAFError;
 use crate::naif::daf::NAIFSummaryRecord;
+use crate::naif::daf::SummaryIndex;
 use crate::naif::spk::summary::SPKSummaryRecord;
 use crate::naif::SPK;
 use crate::{ephemerides::EphemerisError, NaifId};
-use log::error;
+use log::{error, warn};
 
-use super::{Almanac, MAX_LOADED_SPKS};
+use super::cache::{PathCache, StateCache};
+use super::metrics::{DataKind, Stage};
+use super::Almanac;
 
 impl Almanac {
     pub fn from_spk(spk: SPK) -> Result<Almanac, EphemerisError> {
@@ -34,39 +38,97 @@ impl Almanac {
 
     /// Loads a new SPK file into a new context.
     /// This new context is needed to satisfy the unloading of files. In fact, to unload a file, simply let the newly loaded context drop out of scope and Rust will clean it up.
+    ///
+    /// The loaded SPKs are shared with this original context, and only the summaries of this new SPK are indexed and searched for the ephemeris root.
     pub fn with_spk(&self, spk: SPK) -> Result<Self, EphemerisError> {
+        // The root of the already loaded data, if known, so that only this new SPK needs to be searched.
+        let prev_root = if self.spk_data.is_empty() {
+            Some(i32::MAX)
+        } else {
+            self.ephemeris_cache_key()
+                .and_then(|key| self.ephemeris_paths.root(key))
+        };
+
         // This is just a bunch of pointers so it doesn't use much memory.
         let mut me = self.clone();
-        // Parse as SPK and place into the SPK list if there is room
-        let mut data_idx = MAX_LOADED_SPKS;
-        for (idx, item) in self.spk_data.iter().enumerate() {
-            if item.is_none() {
-                data_idx = idx;
-                break;
-            }
+        let data_idx = me.spk_data.push(spk);
+        me.ephemeris_paths = PathCache::default();
+        me.state_cache = me.state_cache.emptied();
+        if let Err(e) = me.spk_index.insert(data_idx, &me.spk_data[data_idx]) {
+            warn!("SPK #{data_idx} has no usable summary: {e}");
         }
-        if data_idx == MAX_LOADED_SPKS {
-            return Err(EphemerisError::StructureIsFull {
-                max_slots: MAX_LOADED_SPKS,
-            });
+
+        if let (Some(prev_root), Some(key)) = (prev_root, me.ephemeris_cache_key()) {
+            if let Ok(root) = ephemeris_root_of(&me.spk_data[data_idx], prev_root) {
+                me.ephemeris_paths.set_root(key, root);
+            }
         }
-        me.spk_data[data_idx] = Some(spk);
         Ok(me)
     }
 }
 
 impl Almanac {
+    /// Returns a clone of this Almanac which caches up to about `capacity` states of frames with respect to their parent, by epoch.
+    ///
+    /// This avoids interpolating the same SPK segment repeatedly when the same bodies are queried at the same epochs, e.g. from several threads
+    /// propagating different spacecraft with the same steps. The cache is shared with the clones of the returned Almanac. A zero capacity disables it.
+    pub fn with_state_cache(&self, capacity: usize) -> Self {
+        let mut me = self.clone();
+        me.state_cache = StateCache::with_capacity(capacity);
+        me
+    }
+
+    /// Returns a clone of this Almanac which keeps the Newton coefficients of up to `capacity` interpolation windows of the Hermite Type 13 and Lagrange Type 9 data sets.
+    ///
+    /// When non-zero, the divided differences of each interpolation window are computed once, and every query in that window is a Horner evaluation.
+    /// Each thread querying the returned Almanac keeps its own windows, of about 3 kB for Hermite data and 6 kB for Lagrange data each, and drops the least recently used ones once the capacity is reached.
+    /// The results match the default interpolation up to rounding errors, but are not bit-for-bit identical, so the state cache is emptied. Zero (the default) disables this.
+    pub fn with_newton_window_capacity(&self, capacity: usize) -> Self {
+        let mut me = self.clone();
+        me.newton_window_capacity = capacity;
+        me.state_cache = me.state_cache.emptied();
+        me
+    }
+
     pub fn num_loaded_spk(&self) -> usize {
-        let mut count = 0;
-        for maybe in &self.spk_data {
-            if maybe.is_none() {
-                break;
-            } else {
-                count += 1;
+        self.spk_data.len()
+    }
+
+    /// Unloads the SPK at this index from a clone of this Almanac, e.g. to replace an outdated SPK with a newer one.
+    ///
+    /// The other SPKs keep their loading order and are shared with this original context: only their summaries are indexed again.
+    pub fn without_spk(&self, spk_no: usize) -> Result<Self, EphemerisError> {
+        let mut me = self.clone();
+        me.spk_data
+            .remove(spk_no)
+            .ok_or(DAFError::InvalidIndex {
+                kind: "SPK",
+                idx: spk_no,
+            })
+            .context(SPKSnafu {
+                action: "unloading SPK",
+            })?;
+        me.ephemeris_paths = PathCache::default();
+        me.state_cache = me.state_cache.emptied();
+        me.spk_index = SummaryIndex::default();
+        for (data_idx, spk) in me.spk_data.iter().enumerate() {
+            if let Err(e) = me.spk_index.insert(data_idx, spk) {
+                warn!("SPK #{data_idx} has no usable summary: {e}");
             }
         }
+        Ok(me)
+    }
 
-        count
+    /// Returns the summary at this index of this loaded SPK, as found in the summary index.
+    fn indexed_spk_summary(
+        &self,
+        spk_no: usize,
+        idx_in_spk: usize,
+    ) -> Result<(&SPKSummaryRecord, usize, usize), EphemerisError> {
+        let summaries = self.spk_data[spk_no].data_summaries().context(SPKSnafu {
+            action: "fetching indexed SPK summary",
+        })?;
+        Ok((&summaries[idx_in_spk], spk_no, idx_in_spk))
     }
 
     /// Returns the summary given the name of the summary record if that summary has data defined at the requested epoch and the SPK where this name was found to be valid at that epoch.
@@ -75,16 +137,17 @@ impl Almanac {
         name: &str,
         epoch: Epoch,
     ) -> Result<(&SPKSummaryRecord, usize, usize), EphemerisError> {
-        for (spk_no, maybe_spk) in self
-            .spk_data
-            .iter()
-            .take(self.num_loaded_spk())
-            .rev()
-            .enumerate()
-        {
-            let spk = maybe_spk.as_ref().unwrap();
-            if let Ok((summary, idx_in_spk)) = spk.summary_from_name_at_epoch(name, epoch) {
-                return Ok((summary, spk_no, idx_in_spk));
+        if self.spk_index.num_indexed() == self.num_loaded_spk() {
+            // The index is up to date, so the names need not be decoded again.
+            if let Some(indexed) = self.spk_index.lookup_name_at_epoch(name, epoch) {
+                return self.indexed_spk_summary(indexed.daf_no, indexed.idx);
+            }
+        } else {
+            for (spk_no, spk) in self.spk_data.iter().rev().enumerate() {
+                if let Ok((summary, idx_in_spk)) = spk.summary_from_name_at_epoch(name, epoch) {
+                    // NOTE: We're iterating backward, so the correct SPK number is "total loaded" minus "current iteration".
+                    return Ok((summary, self.num_loaded_spk() - spk_no - 1, idx_in_spk));
+                }
             }
         }
 
@@ -106,18 +169,28 @@ impl Almanac {
         id: i32,
         epoch: Epoch,
     ) -> Result<(&SPKSummaryRecord, usize, usize), EphemerisError> {
-        for (spk_no, maybe_spk) in self
-            .spk_data
-            .iter()
-            .take(self.num_loaded_spk())
-            .rev()
-            .enumerate()
-        {
-            let spk = maybe_spk.as_ref().unwrap();
-            if let Ok((summary, idx_in_spk)) = spk.summary_from_id_at_epoch(id, epoch) {
-                // NOTE: We're iterating backward, so the correct SPK number is "total loaded" minus "current iteration".
-                return Ok((summary, self.num_loaded_spk() - spk_no - 1, idx_in_spk));
+        if self.spk_index.num_indexed() == self.num_loaded_spk() {
+            // The index is up to date, so it is the only place we need to look.
+            let (indexed, scanned) = self.metrics.time(Stage::Lookup, || {
+                self.spk_index.lookup_summary_scanned(id, epoch)
+            });
+            self.metrics
+                .summary_lookup(DataKind::Ephemeris, scanned, indexed.is_some());
+            if let Some((spk_no, idx_in_spk)) = indexed.map(|item| (item.daf_no, item.idx)) {
+                return self.indexed_spk_summary(spk_no, idx_in_spk);
             }
+        } else {
+            // The SPK data was modified without going through `with_spk`, so we must scan all of the summaries.
+            for (spk_no, spk) in self.spk_data.iter().rev().enumerate() {
+                if let Ok((summary, idx_in_spk)) = spk.summary_from_id_at_epoch(id, epoch) {
+                    self.metrics
+                        .summary_lookup(DataKind::Ephemeris, spk_no + 1, true);
+                    // NOTE: We're iterating backward, so the correct SPK number is "total loaded" minus "current iteration".
+                    return Ok((summary, self.num_loaded_spk() - spk_no - 1, idx_in_spk));
+                }
+            }
+            self.metrics
+                .summary_lookup(DataKind::Ephemeris, self.num_loaded_spk(), false);
         }
 
         error!("Almanac: No summary {id} valid at epoch {epoch}");
@@ -137,16 +210,17 @@ impl Almanac {
         &self,
         name: &str,
     ) -> Result<(&SPKSummaryRecord, usize, usize), EphemerisError> {
-        for (spk_no, maybe_spk) in self
-            .spk_data
-            .iter()
-            .take(self.num_loaded_spk())
-            .rev()
-            .enumerate()
-        {
-            let spk = maybe_spk.as_ref().unwrap();
-            if let Ok((summary, idx_in_spk)) = spk.summary_from_name(name) {
-                return Ok((summary, spk_no, idx_in_spk));
+        if self.spk_index.num_indexed() == self.num_loaded_spk() {
+            // The index is up to date, so the names need not be decoded again.
+            if let Some(indexed) = self.spk_index.lookup_name(name) {
+                return self.indexed_spk_summary(indexed.daf_no, indexed.idx);
+            }
+        } else {
+            for (spk_no, spk) in self.spk_data.iter().rev().enumerate() {
+                if let Ok((summary, idx_in_spk)) = spk.summary_from_name(name) {
+                    // NOTE: We're iterating backward, so the correct SPK number is "total loaded" minus "current iteration".
+                    return Ok((summary, self.num_loaded_spk() - spk_no - 1, idx_in_spk));
+                }
             }
         }
 
@@ -167,14 +241,7 @@ impl Almanac {
         &self,
         id: i32,
     ) -> Result<(&SPKSummaryRecord, usize, usize), EphemerisError> {
-        for (spk_no, maybe_spk) in self
-            .spk_data
-            .iter()
-            .take(self.num_loaded_spk())
-            .rev()
-            .enumerate()
-        {
-            let spk = maybe_spk.as_ref().unwrap();
+        for (spk_no, spk) in self.spk_data.iter().rev().enumerate() {
             if let Ok((summary, idx_in_spk)) = spk.summary_from_id(id) {
                 // NOTE: We're iterating backward, so the correct SPK number is "total loaded" minus "current iteration".
                 return Ok((summary, self.num_loaded_spk() - spk_no - 1, idx_in_spk));
@@ -198,8 +265,7 @@ impl Almanac {
     /// This function performs a memory allocation.
     pub fn spk_summaries(&self, id: NaifId) -> Result<Vec<SPKSummaryRecord>, EphemerisError> {
         let mut summaries = vec![];
-        for maybe_spk in self.spk_data.iter().take(self.num_loaded_spk()).rev() {
-            let spk = maybe_spk.as_ref().unwrap();
+        for spk in self.spk_data.iter().rev() {
             if let Ok(these_summaries) = spk.data_summaries() {
                 for summary in these_summaries {
                     if summary.id() == id {
@@ -249,8 +315,7 @@ impl Almanac {
         ensure!(self.num_loaded_spk() > 0, NoEphemerisLoadedSnafu);
 
         let mut domains = HashMap::new();
-        for maybe_spk in self.spk_data.iter().take(self.num_loaded_spk()).rev() {
-            let spk = maybe_spk.as_ref().unwrap();
+        for spk in self.spk_data.iter().rev() {
             if let Ok(these_summaries) = spk.data_summaries() {
                 for summary in these_summaries {
                     let this_id = summary.id();
@@ -281,6 +346,7 @@ mod ut_almanac_spk {
         constants::frames::{EARTH_J2000, MOON_J2000},
         prelude::{Almanac, Epoch},
     };
+    use hifitime::{TimeSeries, Unit};
 
     #[test]
     fn summaries_nothing_loaded() {
@@ -307,6 +373,136 @@ mod ut_almanac_spk {
         );
     }
 
+    #[test]
+    fn summary_index_matches_scan() {
+        let almanac = Almanac::default()
+            .load("../data/de421.bsp")
+            .unwrap()
+            .load("../data/de440s.bsp")
+            .unwrap();
+        assert_eq!(almanac.spk_index.num_indexed(), 2);
+
+        // Clearing the index forces the linear scan through all of the summaries.
+        let mut scanning = almanac.clone();
+        scanning.spk_index = Default::default();
+
+        for epoch in TimeSeries::inclusive(
+            Epoch::from_gregorian_utc_at_midnight(1900, 1, 1),
+            Epoch::from_gregorian_utc_at_midnight(2100, 1, 1),
+            Unit::Day * 1000,
+        ) {
+            for id in [1, 3, 301, 399, 5, 10] {
+                let indexed = almanac
+                    .spk_summary_at_epoch(id, epoch)
+                    .map(|(_, spk_no, idx)| (spk_no, idx));
+                let scanned = scanning
+                    .spk_summary_at_epoch(id, epoch)
+                    .map(|(_, spk_no, idx)| (spk_no, idx));
+                assert_eq!(indexed.ok(), scanned.ok(), "{id} @ {epoch}");
+            }
+        }
+    }
+
+    #[test]
+    fn state_cache_matches_interpolation() {
+        let almanac = Almanac::new("../data/de440s.bsp").unwrap();
+        let cached = almanac.with_state_cache(64);
+        assert!(!almanac.state_cache.is_enabled());
+
+        let start = Epoch::from_gregorian_utc_at_midnight(2025, 1, 1);
+        let epochs = TimeSeries::inclusive(start, start + Unit::Day * 3, Unit::Hour * 1);
+        #[cfg(feature = "metrics")]
+        cached.reset_stats();
+        #[cfg(feature = "metrics")]
+        let mut first_pass = None;
+        // The second pass is served from the cache.
+        for _ in 0..2 {
+            for epoch in epochs.clone() {
+                assert_eq!(
+                    cached
+                        .translate_geometric(MOON_J2000, EARTH_J2000, epoch)
+                        .unwrap(),
+                    almanac
+                        .translate_geometric(MOON_J2000, EARTH_J2000, epoch)
+                        .unwrap()
+                );
+            }
+            #[cfg(feature = "metrics")]
+            {
+                let stats = cached.stats().state_cache;
+                match first_pass {
+                    None => {
+                        assert_eq!(stats.hits, 0);
+                        assert!(stats.misses > 0);
+                        first_pass = Some(stats);
+                    }
+                    Some(first) => {
+                        // The second pass queries the same states, of which those not evicted are hits.
+                        assert!(stats.hits > 0, "{stats:?}");
+                        assert_eq!(stats.hits + stats.misses, 2 * first.misses, "{stats:?}");
+                        assert!(stats.hit_rate() > 0.0 && stats.hit_rate() <= 0.5);
+                    }
+                }
+            }
+        }
+
+        // Loading a new SPK empties the cache, but keeps it enabled.
+        let reloaded = cached.load("../data/de440s.bsp").unwrap();
+        assert_eq!(
+            reloaded.state_cache.capacity(),
+            cached.state_cache.capacity()
+        );
+        assert_eq!(
+            reloaded
+                .translate_geometric(MOON_J2000, EARTH_J2000, start)
+                .unwrap(),
+            almanac
+                .translate_geometric(MOON_J2000, EARTH_J2000, start)
+                .unwrap()
+        );
+    }
+
+    #[test]
+    fn name_index_matches_scan() {
+        let almanac = Almanac::default()
+            .load("../data/de421.bsp")
+            .unwrap()
+            .load("../data/de440s.bsp")
+            .unwrap();
+
+        let mut scanning = almanac.clone();
+        scanning.spk_index = Default::default();
+
+        let mut names = Vec::new();
+        for spk in almanac.spk_data.iter() {
+            let summary_size = spk.file_record().unwrap().summary_size();
+            let name_rcrd = spk.name_record().unwrap();
+            for idx in 0..spk.data_summaries().unwrap().len() {
+                names.push(name_rcrd.nth_name(idx, summary_size).to_string());
+            }
+        }
+        names.push("invalid name".to_string());
+
+        let epoch = Epoch::from_gregorian_utc_at_midnight(2000, 1, 1);
+        for name in &names {
+            let indexed = almanac
+                .spk_summary_from_name(name)
+                .map(|(_, spk_no, idx)| (spk_no, idx));
+            let scanned = scanning
+                .spk_summary_from_name(name)
+                .map(|(_, spk_no, idx)| (spk_no, idx));
+            assert_eq!(indexed.ok(), scanned.ok(), "{name}");
+
+            let indexed = almanac
+                .spk_summary_from_name_at_epoch(name, epoch)
+                .map(|(_, spk_no, idx)| (spk_no, idx));
+            let scanned = scanning
+                .spk_summary_from_name_at_epoch(name, epoch)
+                .map(|(_, spk_no, idx)| (spk_no, idx));
+            assert_eq!(indexed.ok(), scanned.ok(), "{name} @ {epoch}");
+        }
+    }
+
     #[test]
     fn queries_nothing_loaded() {
         let almanac = Almanac::default();
@@ -14,7 +14,7 @@ use snafu::ResultExt;
 use crate::{
     errors::{AlmanacResult, EphemerisSnafu, OrientationSnafu},
     math::{cartesian::CartesianState, units::LengthUnit, Vector3},
-    orientations::OrientationPhysicsSnafu,
+    orientations::{plan::RotationPlan, OrientationPhysicsSnafu},
     prelude::{Aberration, Frame},
     NaifId,
 };
@@ -111,6 +111,88 @@ impl Almanac {
 }
 
 impl Almanac {
+    /// Returns the Cartesian states of the target frame as seen from the observer frame at each of the provided epochs, and optionally given the aberration correction.
+    ///
+    /// This returns the same states as calling `transform` at each epoch, but both the translation and the rotation are planned once:
+    /// the ephemeris and orientation paths, the SPK and BPC segments, and the rotation models from the planetary data are only
+    /// resolved again when an epoch is outside of the segments used for the previous epoch.
+    /// Providing the epochs in chronological order, e.g. from a `TimeSeries`, maximizes this reuse.
+    pub fn transform_many<I: IntoIterator<Item = Epoch>>(
+        &self,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epochs: I,
+        ab_corr: Option<Aberration>,
+    ) -> AlmanacResult<Vec<CartesianState>> {
+        let mut states = self
+            .translate_many(target_frame, observer_frame, epochs, ab_corr)
+            .context(EphemerisSnafu {
+                action: "transform many",
+            })?;
+        self.rotate_states(target_frame, observer_frame, &mut states)?;
+        Ok(states)
+    }
+
+    /// Writes the Cartesian states of the target frame as seen from the observer frame at each of the provided epochs into the states, as `transform_many` does, without any allocation.
+    ///
+    /// The n-th state is that at the n-th epoch: epochs beyond the number of states are ignored, and states beyond the number of epochs are left untouched.
+    /// Returns the number of states written.
+    pub fn transform_many_into<I: IntoIterator<Item = Epoch>>(
+        &self,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epochs: I,
+        ab_corr: Option<Aberration>,
+        states: &mut [CartesianState],
+    ) -> AlmanacResult<usize> {
+        let num_states = self
+            .translate_many_into(target_frame, observer_frame, epochs, ab_corr, states)
+            .context(EphemerisSnafu {
+                action: "transform many",
+            })?;
+        self.rotate_states(target_frame, observer_frame, &mut states[..num_states])?;
+        Ok(num_states)
+    }
+
+    /// Rotates these translated states from the orientation of the target frame into that of the observer frame, in place.
+    fn rotate_states(
+        &self,
+        target_frame: Frame,
+        observer_frame: Frame,
+        states: &mut [CartesianState],
+    ) -> AlmanacResult<()> {
+        let mut plan: Option<RotationPlan> = None;
+        for state in states.iter_mut() {
+            if !plan
+                .as_ref()
+                .map_or(false, |plan| plan.is_valid_at(state.epoch))
+            {
+                plan = Some(
+                    self.rotation_plan(target_frame, observer_frame, state.epoch)
+                        .context(OrientationSnafu {
+                            action: "transform many",
+                        })?,
+                );
+            }
+            let dcm = plan
+                .as_ref()
+                .unwrap()
+                .evaluate(state.epoch)
+                .context(OrientationSnafu {
+                    action: "transform many",
+                })?;
+
+            *state =
+                (dcm * *state)
+                    .context(OrientationPhysicsSnafu {})
+                    .context(OrientationSnafu {
+                        action: "transform many",
+                    })?;
+        }
+
+        Ok(())
+    }
+
     /// Translates a state with its origin (`to_frame`) and given its units (distance_unit, time_unit), returns that state with respect to the requested frame
     ///
     /// **WARNING:** This function only performs the translation and no rotation _whatsoever_. Use the `transform_state_to` function instead to include rotations.
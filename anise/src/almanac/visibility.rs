@@ -0,0 +1,199 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use hifitime::{Duration, Epoch};
+use snafu::ResultExt;
+
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+
+use crate::{
+    ephemerides::EphemerisPhysicsSnafu,
+    errors::{AlmanacResult, EphemerisSnafu},
+    math::{Matrix3, Vector3},
+    prelude::{Aberration, Frame, Orbit},
+};
+
+use super::windows::{find_windows, SearchSteps};
+use super::Almanac;
+
+/// Settings of a visibility search.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct VisibilitySettings {
+    /// Elevation above which a spacecraft is visible from a ground station, in degrees
+    pub min_elevation_deg: f64,
+    /// Sampling steps and precision of the rise and set epochs. The step grows up to the maximum step while no elevation is
+    /// estimated to reach the threshold, so a pass shorter than the maximum step may be missed.
+    pub steps: SearchSteps,
+    /// Aberration correction of the spacecraft states
+    pub ab_corr: Option<Aberration>,
+}
+
+impl Default for VisibilitySettings {
+    fn default() -> Self {
+        Self {
+            min_elevation_deg: 0.0,
+            steps: SearchSteps::default(),
+            ab_corr: None,
+        }
+    }
+}
+
+/// A time span over which a spacecraft is above the minimum elevation of a ground station.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct VisibilityPass {
+    /// Index of the ground station in the list of stations of the search
+    pub station: usize,
+    /// Index of the spacecraft in the list of spacecraft of the search
+    pub spacecraft: usize,
+    /// Epoch when the spacecraft rises above the minimum elevation, or the start of the search if it is already visible then
+    pub rise_epoch: Epoch,
+    /// Epoch when the spacecraft sets below the minimum elevation, or the end of the search if it is still visible then
+    pub set_epoch: Epoch,
+    /// Highest elevation sampled during this pass, in degrees
+    pub max_elevation_deg: f64,
+}
+
+impl VisibilityPass {
+    pub fn duration(&self) -> Duration {
+        self.set_epoch - self.rise_epoch
+    }
+}
+
+/// A ground station, fixed in the body fixed frame of its state.
+struct Station {
+    /// Index of the frame of this station in the list of distinct station frames
+    frame_no: usize,
+    radius_km: Vector3,
+    /// Rotation from the body fixed frame to the SEZ frame of this station
+    fixed_to_sez: Matrix3,
+}
+
+impl Station {
+    /// Elevation in degrees of the provided position, expressed in the body fixed frame of this station, as computed by
+    /// [Almanac::azimuth_elevation_range_sez].
+    fn elevation_deg(&self, radius_km: &Vector3) -> f64 {
+        let rho_sez = self.fixed_to_sez * (radius_km - self.radius_km);
+        (rho_sez.z / rho_sez.norm()).asin().to_degrees()
+    }
+}
+
+impl Almanac {
+    /// Finds the time spans over which each spacecraft is above the minimum elevation of each ground station, between the
+    /// provided epochs.
+    ///
+    /// The ground stations are fixed in their body fixed frame (e.g. ITRF93), as built with [Orbit::try_latlongalt], and the
+    /// spacecraft are ephemeris frames of this Almanac. Passes are returned sorted by spacecraft, station, and rise epoch.
+    ///
+    /// # Algorithm
+    /// 1. Each spacecraft is sampled with an adaptive step: the step shrinks to half of the estimated time until the elevation
+    ///    of any station reaches the threshold, and is bounded by the minimum and maximum steps of the settings.
+    /// 2. At each sample, the spacecraft state is transformed once into each distinct station frame, and the elevation of all
+    ///    of the stations in that frame is computed from that single state with the precomputed SEZ rotation of each station.
+    /// 3. Each threshold crossing between two samples is refined by bisection to the precision of the settings.
+    ///
+    /// With the `parallel` feature, the spacecraft are sampled in parallel and the crossings of all stations are refined in parallel.
+    pub fn visibility_passes(
+        &self,
+        stations: &[Orbit],
+        spacecraft: &[Frame],
+        start_epoch: Epoch,
+        end_epoch: Epoch,
+        settings: VisibilitySettings,
+    ) -> AlmanacResult<Vec<VisibilityPass>> {
+        let mut frames: Vec<Frame> = Vec::new();
+        let mut compiled = Vec::with_capacity(stations.len());
+        for station in stations {
+            let frame_no = match frames.iter().position(|frame| {
+                frame.ephem_origin_match(station.frame) && frame.orient_origin_match(station.frame)
+            }) {
+                Some(frame_no) => frame_no,
+                None => {
+                    frames.push(station.frame);
+                    frames.len() - 1
+                }
+            };
+
+            // SEZ DCM is topo to fixed
+            let sez_dcm = station
+                .dcm_from_topocentric_to_body_fixed(station.frame.orientation_id * 1_000 + 1)
+                .context(EphemerisPhysicsSnafu { action: "" })
+                .context(EphemerisSnafu {
+                    action: "computing SEZ DCM for visibility",
+                })?;
+
+            compiled.push(Station {
+                frame_no,
+                radius_km: station.radius_km,
+                fixed_to_sez: sez_dcm.rot_mat.transpose(),
+            });
+        }
+
+        let search = |(sc_no, sc_frame): (usize, &Frame)| -> AlmanacResult<Vec<VisibilityPass>> {
+            let radii_km = |epoch: Epoch, radii_km: &mut Vec<Vector3>| -> AlmanacResult<()> {
+                radii_km.clear();
+                for frame in &frames {
+                    radii_km.push(
+                        self.transform(*sc_frame, *frame, epoch, settings.ab_corr)?
+                            .radius_km,
+                    );
+                }
+                Ok(())
+            };
+
+            let mut radii_buf = Vec::with_capacity(frames.len());
+            let sample = |epoch: Epoch, elevations_deg: &mut [f64]| -> AlmanacResult<()> {
+                radii_km(epoch, &mut radii_buf)?;
+                for (station, elevation_deg) in compiled.iter().zip(elevations_deg.iter_mut()) {
+                    *elevation_deg = station.elevation_deg(&radii_buf[station.frame_no]);
+                }
+                Ok(())
+            };
+
+            let elevation_deg = |station_no: usize, epoch: Epoch| -> AlmanacResult<f64> {
+                let station = &compiled[station_no];
+                let sc_km = self
+                    .transform(*sc_frame, frames[station.frame_no], epoch, settings.ab_corr)?
+                    .radius_km;
+                Ok(station.elevation_deg(&sc_km))
+            };
+
+            Ok(find_windows(
+                compiled.len(),
+                start_epoch,
+                end_epoch,
+                settings.min_elevation_deg,
+                &settings.steps,
+                sample,
+                elevation_deg,
+            )?
+            .into_iter()
+            .map(|window| VisibilityPass {
+                station: window.channel,
+                spacecraft: sc_no,
+                rise_epoch: window.start,
+                set_epoch: window.end,
+                max_elevation_deg: window.max_value,
+            })
+            .collect())
+        };
+
+        #[cfg(feature = "parallel")]
+        let spacecraft = spacecraft.par_iter().enumerate();
+        #[cfg(not(feature = "parallel"))]
+        let spacecraft = spacecraft.iter().enumerate();
+
+        let passes = spacecraft
+            .map(search)
+            .collect::<AlmanacResult<Vec<Vec<VisibilityPass>>>>()?;
+
+        Ok(passes.into_iter().flatten().collect())
+    }
+}
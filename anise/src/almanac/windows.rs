@@ -0,0 +1,272 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use hifitime::{Duration, Epoch, TimeUnits};
+
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+
+use crate::errors::AlmanacResult;
+
+/// Sampling and root finding settings of an event search.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct SearchSteps {
+    /// Smallest step between two samples, used when a value is about to cross its threshold
+    pub min_step: Duration,
+    /// Largest step between two samples, used when none of the values is estimated to reach its threshold soon: an event
+    /// shorter than this step may be missed
+    pub max_step: Duration,
+    /// Precision of the epochs of the events
+    pub precision: Duration,
+}
+
+impl Default for SearchSteps {
+    fn default() -> Self {
+        Self {
+            min_step: 1.seconds(),
+            max_step: 5.minutes(),
+            precision: 1.milliseconds(),
+        }
+    }
+}
+
+/// A time span over which the value of a channel is at or above the threshold.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub(crate) struct Window {
+    pub channel: usize,
+    /// Epoch when the value rises above the threshold, or the start of the search if it is already above then
+    pub start: Epoch,
+    /// Epoch when the value falls below the threshold, or the end of the search if it is still above then
+    pub end: Epoch,
+    /// Highest value sampled during this window
+    pub max_value: f64,
+}
+
+/// A threshold crossing found while sampling, bracketed by the epochs of two samples.
+#[derive(Copy, Clone, Debug)]
+enum Crossing {
+    Bound(Epoch),
+    Bracket(Epoch, Epoch),
+}
+
+/// A window found while sampling, before its start and end epochs are refined.
+#[derive(Copy, Clone, Debug)]
+struct SampledWindow {
+    channel: usize,
+    start: Crossing,
+    end: Crossing,
+    max_value: f64,
+}
+
+/// Finds the windows over which the value of each channel is at or above the threshold.
+///
+/// The `sample` function computes the values of all channels at once at an epoch, such that the computations they share
+/// are done only once per sample, and the `value` function computes the value of a single channel.
+/// Windows are returned sorted by channel and start epoch.
+///
+/// # Algorithm
+/// 1. All channels are sampled with an adaptive step: the step shrinks to half of the estimated time until the value of
+///    any channel reaches the threshold at its current rate, and is bounded by the minimum and maximum steps.
+/// 2. Each threshold crossing between two samples is refined by bisection to the precision of the settings, in parallel
+///    with the `parallel` feature.
+pub(crate) fn find_windows<S, V>(
+    num_channels: usize,
+    start_epoch: Epoch,
+    end_epoch: Epoch,
+    threshold: f64,
+    steps: &SearchSteps,
+    mut sample: S,
+    value: V,
+) -> AlmanacResult<Vec<Window>>
+where
+    S: FnMut(Epoch, &mut [f64]) -> AlmanacResult<()>,
+    V: Fn(usize, Epoch) -> AlmanacResult<f64> + Sync,
+{
+    if end_epoch <= start_epoch || num_channels == 0 {
+        return Ok(Vec::new());
+    }
+
+    let min_step_s = steps.min_step.to_seconds();
+    let max_step_s = steps.max_step.to_seconds().max(min_step_s);
+
+    let mut sampled = Vec::new();
+    let mut prev = vec![0.0; num_channels];
+    let mut cur = vec![0.0; num_channels];
+    sample(start_epoch, &mut prev)?;
+
+    // Windows currently open for each channel: how they started and their highest value so far.
+    let mut open: Vec<Option<(Crossing, f64)>> = prev
+        .iter()
+        .map(|value| (*value >= threshold).then_some((Crossing::Bound(start_epoch), *value)))
+        .collect();
+
+    let mut epoch = start_epoch;
+    let mut step_s = min_step_s;
+    while epoch < end_epoch {
+        let next_epoch = (epoch + step_s.seconds()).min(end_epoch);
+        sample(next_epoch, &mut cur)?;
+        let dt_s = (next_epoch - epoch).to_seconds();
+
+        let mut next_step_s = max_step_s;
+        for channel in 0..num_channels {
+            let prev_above = prev[channel] >= threshold;
+            let cur_above = cur[channel] >= threshold;
+
+            match (prev_above, cur_above, open[channel]) {
+                (false, true, _) => {
+                    open[channel] = Some((Crossing::Bracket(epoch, next_epoch), cur[channel]));
+                }
+                (true, false, Some((start, max_value))) => {
+                    sampled.push(SampledWindow {
+                        channel,
+                        start,
+                        end: Crossing::Bracket(epoch, next_epoch),
+                        max_value,
+                    });
+                    open[channel] = None;
+                }
+                (true, true, Some((start, max_value))) => {
+                    open[channel] = Some((start, max_value.max(cur[channel])));
+                }
+                _ => {}
+            }
+
+            // Estimate when the value reaches the threshold at its current rate.
+            let rate = (cur[channel] - prev[channel]) / dt_s;
+            let margin = cur[channel] - threshold;
+            if rate * margin < 0.0 {
+                next_step_s = next_step_s.min(0.5 * (margin / rate).abs());
+            }
+        }
+
+        step_s = next_step_s.max(min_step_s);
+        core::mem::swap(&mut prev, &mut cur);
+        epoch = next_epoch;
+    }
+
+    for (channel, open) in open.into_iter().enumerate() {
+        if let Some((start, max_value)) = open {
+            sampled.push(SampledWindow {
+                channel,
+                start,
+                end: Crossing::Bound(end_epoch),
+                max_value,
+            });
+        }
+    }
+
+    // Stable sort, so the windows of each channel remain in chronological order.
+    sampled.sort_by_key(|window| window.channel);
+
+    let refine = |window: &SampledWindow| -> AlmanacResult<Window> {
+        let crossing_epoch = |crossing: Crossing, rising: bool| -> AlmanacResult<Epoch> {
+            match crossing {
+                Crossing::Bound(epoch) => Ok(epoch),
+                Crossing::Bracket(mut below, mut above) => {
+                    if !rising {
+                        core::mem::swap(&mut below, &mut above);
+                    }
+                    while (above - below).abs() > steps.precision {
+                        let mid = below + 0.5 * (above - below);
+                        if value(window.channel, mid)? >= threshold {
+                            above = mid;
+                        } else {
+                            below = mid;
+                        }
+                    }
+                    Ok(below + 0.5 * (above - below))
+                }
+            }
+        };
+
+        Ok(Window {
+            channel: window.channel,
+            start: crossing_epoch(window.start, true)?,
+            end: crossing_epoch(window.end, false)?,
+            max_value: window.max_value,
+        })
+    };
+
+    #[cfg(feature = "parallel")]
+    let sampled = sampled.par_iter();
+    #[cfg(not(feature = "parallel"))]
+    let sampled = sampled.iter();
+
+    sampled.map(refine).collect()
+}
+
+#[cfg(test)]
+mod ut_windows {
+    use super::*;
+    use core::f64::consts::TAU;
+
+    /// Values which oscillate with a period of 100 minutes, with a different phase and amplitude per channel.
+    fn analytic(channel: usize, epoch: Epoch) -> f64 {
+        let t_s = epoch.to_tdb_seconds();
+        let amplitude = 20.0 + 15.0 * channel as f64;
+        amplitude * (TAU * t_s / 6000.0 + channel as f64).sin() - 10.0
+    }
+
+    #[test]
+    fn analytic_windows() {
+        let start = Epoch::from_tdb_seconds(0.0);
+        let end = Epoch::from_tdb_seconds(36_000.0);
+        let steps = SearchSteps::default();
+
+        let mut num_samples = 0;
+        let windows = find_windows(
+            3,
+            start,
+            end,
+            5.0,
+            &steps,
+            |epoch, values| {
+                num_samples += 1;
+                for (channel, value) in values.iter_mut().enumerate() {
+                    *value = analytic(channel, epoch);
+                }
+                Ok(())
+            },
+            |channel, epoch| Ok(analytic(channel, epoch)),
+        )
+        .unwrap();
+
+        // Far fewer samples than with the minimum step
+        assert!(num_samples < 36_000 / 10, "{num_samples} samples");
+
+        // Six periods, and the last two channels are above the threshold at the start and at the end of the search
+        assert_eq!(windows.iter().filter(|w| w.channel == 0).count(), 6);
+        assert_eq!(windows.iter().filter(|w| w.channel == 1).count(), 7);
+        assert_eq!(windows.iter().filter(|w| w.channel == 2).count(), 7);
+
+        for window in &windows {
+            assert!(window.start < window.end);
+            assert!(window.max_value >= 5.0);
+            for epoch in [window.start, window.end] {
+                if epoch != start && epoch != end {
+                    // Within one millisecond of the crossing
+                    let rate = (analytic(window.channel, epoch + 1.seconds())
+                        - analytic(window.channel, epoch))
+                    .abs();
+                    assert!(
+                        (analytic(window.channel, epoch) - 5.0).abs() < rate * 1e-3,
+                        "{window:?}"
+                    );
+                }
+            }
+        }
+
+        assert!(
+            find_windows(0, start, end, 0.0, &steps, |_, _| Ok(()), |_, _| Ok(0.0))
+                .unwrap()
+                .is_empty()
+        );
+    }
+}
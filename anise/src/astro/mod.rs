@@ -28,6 +28,8 @@ pub use aberration::Aberration;
 
 pub mod orbit;
 pub mod orbit_geodetic;
+pub mod state_batch;
+pub use state_batch::{GeodeticBatch, KeplerianBatch, StateBatch};
 
 pub type PhysicsResult<T> = Result<T, PhysicsError>;
 
@@ -199,32 +199,7 @@ impl CartesianState {
     pub fn latlongalt(&self) -> PhysicsResult<(f64, f64, f64)> {
         let a_km = self.frame.mean_equatorial_radius_km()?;
         let b_km = self.frame.shape.unwrap().polar_radius_km;
-        let e2 = (a_km.powi(2) - b_km.powi(2)) / a_km.powi(2);
-        let e_prime2 = (a_km.powi(2) - b_km.powi(2)) / b_km.powi(2);
-        let p = (self.radius_km.x.powi(2) + self.radius_km.y.powi(2)).sqrt();
-        let big_f = 54.0 * b_km.powi(2) * self.radius_km.z.powi(2);
-        let big_g =
-            p.powi(2) + (1.0 - e2) * self.radius_km.z.powi(2) - e2 * (a_km.powi(2) - b_km.powi(2));
-        let c = (e2.powi(2) * big_f * p.powi(2)) / big_g.powi(3);
-        let s = (1.0 + c + (c.powi(2) + 2.0 * c).sqrt()).powf(1.0 / 3.0);
-        let k = s + 1.0 + 1.0 / s;
-        let big_p = big_f / (3.0 * k.powi(2) * big_g.powi(2));
-        let big_q = (1.0 + 2.0 * e2.powi(2) * big_p).sqrt();
-        let r0 = (-big_p * e2 * p) / (1.0 + big_q)
-            + (0.5 * a_km.powi(2) * (1.0 + 1.0 / big_q)
-                - (big_p * (1.0 - e2) * self.radius_km.z.powi(2)) / (big_q * (1.0 + big_q))
-                - 0.5 * big_p * p.powi(2))
-            .sqrt();
-        let big_u = ((p - e2 * r0).powi(2) + self.radius_km.z.powi(2)).sqrt();
-        let big_v = ((p - e2 * r0).powi(2) + (1.0 - e2) * self.radius_km.z.powi(2)).sqrt();
-        let z0 = b_km.powi(2) * self.radius_km.z / (a_km * big_v);
-
-        let alt_km = big_u * (1.0 - b_km.powi(2) / (a_km * big_v));
-        let lat_deg =
-            between_pm_180((((self.radius_km.z + e_prime2 * z0) / p).atan()).to_degrees());
-        let long_deg = between_0_360(self.radius_km.y.atan2(self.radius_km.x).to_degrees());
-
-        Ok((lat_deg, long_deg, alt_km))
+        Ok(heikkinen_latlongalt(&self.radius_km, a_km, b_km))
     }
 
     /// Returns the geodetic longitude (λ) in degrees. Value is between 0 and 360 degrees.
@@ -250,3 +225,32 @@ impl CartesianState {
         Ok(self.latlongalt()?.2)
     }
 }
+
+/// Computes the geodetic latitude, longitude (both in degrees), and height (in km) of the provided position with the Heikkinen procedure,
+/// given the equatorial and polar radii of the ellipsoid.
+pub(crate) fn heikkinen_latlongalt(radius_km: &Vector3, a_km: f64, b_km: f64) -> (f64, f64, f64) {
+    let e2 = (a_km.powi(2) - b_km.powi(2)) / a_km.powi(2);
+    let e_prime2 = (a_km.powi(2) - b_km.powi(2)) / b_km.powi(2);
+    let p = (radius_km.x.powi(2) + radius_km.y.powi(2)).sqrt();
+    let big_f = 54.0 * b_km.powi(2) * radius_km.z.powi(2);
+    let big_g = p.powi(2) + (1.0 - e2) * radius_km.z.powi(2) - e2 * (a_km.powi(2) - b_km.powi(2));
+    let c = (e2.powi(2) * big_f * p.powi(2)) / big_g.powi(3);
+    let s = (1.0 + c + (c.powi(2) + 2.0 * c).sqrt()).powf(1.0 / 3.0);
+    let k = s + 1.0 + 1.0 / s;
+    let big_p = big_f / (3.0 * k.powi(2) * big_g.powi(2));
+    let big_q = (1.0 + 2.0 * e2.powi(2) * big_p).sqrt();
+    let r0 = (-big_p * e2 * p) / (1.0 + big_q)
+        + (0.5 * a_km.powi(2) * (1.0 + 1.0 / big_q)
+            - (big_p * (1.0 - e2) * radius_km.z.powi(2)) / (big_q * (1.0 + big_q))
+            - 0.5 * big_p * p.powi(2))
+        .sqrt();
+    let big_u = ((p - e2 * r0).powi(2) + radius_km.z.powi(2)).sqrt();
+    let big_v = ((p - e2 * r0).powi(2) + (1.0 - e2) * radius_km.z.powi(2)).sqrt();
+    let z0 = b_km.powi(2) * radius_km.z / (a_km * big_v);
+
+    let alt_km = big_u * (1.0 - b_km.powi(2) / (a_km * big_v));
+    let lat_deg = between_pm_180((((radius_km.z + e_prime2 * z0) / p).atan()).to_degrees());
+    let long_deg = between_0_360(radius_km.y.atan2(radius_km.x).to_degrees());
+
+    (lat_deg, long_deg, alt_km)
+}
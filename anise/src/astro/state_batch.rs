@@ -0,0 +1,507 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::f64::consts::PI;
+
+use hifitime::Epoch;
+use snafu::ensure;
+
+use super::orbit_geodetic::heikkinen_latlongalt;
+use super::PhysicsResult;
+use crate::{
+    errors::FrameMismatchSnafu,
+    math::{cartesian::CartesianState, Matrix3, Vector3},
+    prelude::Frame,
+};
+
+/// A batch of Cartesian states in the same frame, stored as a structure of arrays.
+///
+/// Each component (epoch, x, y, z, vx, vy, vz) is stored in its own contiguous column, such that conversions of many states
+/// run as tight loops over the columns. The columns can be borrowed as slices, or taken with [StateBatch::into_columns]
+/// to be handed over to NumPy or Arrow arrays (e.g. `PyArray1::from_vec` or `Float64Array::from`) without copying.
+///
+/// Radius data is expressed in kilometers. Velocity data is expressed in kilometers per second.
+#[derive(Clone, Debug, PartialEq)]
+pub struct StateBatch {
+    /// Frame in which all of these states live
+    pub frame: Frame,
+    epochs: Vec<Epoch>,
+    x_km: Vec<f64>,
+    y_km: Vec<f64>,
+    z_km: Vec<f64>,
+    vx_km_s: Vec<f64>,
+    vy_km_s: Vec<f64>,
+    vz_km_s: Vec<f64>,
+}
+
+/// The Keplerian orbital elements of a batch of states, one column per element.
+///
+/// The elements of degenerate states (zero radius or velocity) are NaN instead of an error.
+#[derive(Clone, Debug, Default, PartialEq)]
+pub struct KeplerianBatch {
+    pub sma_km: Vec<f64>,
+    pub ecc: Vec<f64>,
+    pub inc_deg: Vec<f64>,
+    pub raan_deg: Vec<f64>,
+    pub aop_deg: Vec<f64>,
+    pub ta_deg: Vec<f64>,
+}
+
+/// The geodetic coordinates of a batch of states, one column per coordinate.
+#[derive(Clone, Debug, Default, PartialEq)]
+pub struct GeodeticBatch {
+    pub latitude_deg: Vec<f64>,
+    pub longitude_deg: Vec<f64>,
+    pub height_km: Vec<f64>,
+}
+
+impl StateBatch {
+    /// Builds an empty batch in the provided frame, with room for the provided number of states.
+    pub fn with_capacity(frame: Frame, capacity: usize) -> Self {
+        Self {
+            frame,
+            epochs: Vec::with_capacity(capacity),
+            x_km: Vec::with_capacity(capacity),
+            y_km: Vec::with_capacity(capacity),
+            z_km: Vec::with_capacity(capacity),
+            vx_km_s: Vec::with_capacity(capacity),
+            vy_km_s: Vec::with_capacity(capacity),
+            vz_km_s: Vec::with_capacity(capacity),
+        }
+    }
+
+    /// Builds a batch from its columns, returns None if the columns do not all have the same length.
+    ///
+    /// **Units:** km, km, km, km/s, km/s, km/s
+    #[allow(clippy::too_many_arguments)]
+    pub fn from_columns(
+        frame: Frame,
+        epochs: Vec<Epoch>,
+        x_km: Vec<f64>,
+        y_km: Vec<f64>,
+        z_km: Vec<f64>,
+        vx_km_s: Vec<f64>,
+        vy_km_s: Vec<f64>,
+        vz_km_s: Vec<f64>,
+    ) -> Option<Self> {
+        let len = epochs.len();
+        if [&x_km, &y_km, &z_km, &vx_km_s, &vy_km_s, &vz_km_s]
+            .iter()
+            .any(|column| column.len() != len)
+        {
+            None
+        } else {
+            Some(Self {
+                frame,
+                epochs,
+                x_km,
+                y_km,
+                z_km,
+                vx_km_s,
+                vy_km_s,
+                vz_km_s,
+            })
+        }
+    }
+
+    /// Builds a batch from the provided states, which must all be in the same frame.
+    pub fn from_states(frame: Frame, states: &[CartesianState]) -> PhysicsResult<Self> {
+        let mut me = Self::with_capacity(frame, states.len());
+        for state in states {
+            me.push(state)?;
+        }
+        Ok(me)
+    }
+
+    /// Appends a state to this batch, returns an error if it is not in the frame of this batch.
+    pub fn push(&mut self, state: &CartesianState) -> PhysicsResult<()> {
+        ensure!(
+            self.frame.ephem_origin_match(state.frame)
+                && self.frame.orient_origin_match(state.frame),
+            FrameMismatchSnafu {
+                action: "adding a state to a batch",
+                frame1: self.frame,
+                frame2: state.frame
+            }
+        );
+        self.epochs.push(state.epoch);
+        self.x_km.push(state.radius_km.x);
+        self.y_km.push(state.radius_km.y);
+        self.z_km.push(state.radius_km.z);
+        self.vx_km_s.push(state.velocity_km_s.x);
+        self.vy_km_s.push(state.velocity_km_s.y);
+        self.vz_km_s.push(state.velocity_km_s.z);
+        Ok(())
+    }
+
+    /// Number of states in this batch.
+    pub fn len(&self) -> usize {
+        self.epochs.len()
+    }
+
+    /// Returns true if this batch has no states.
+    pub fn is_empty(&self) -> bool {
+        self.epochs.is_empty()
+    }
+
+    /// Returns the n-th state of this batch.
+    pub fn get(&self, n: usize) -> Option<CartesianState> {
+        Some(CartesianState {
+            radius_km: self.radius_km(n)?,
+            velocity_km_s: self.velocity_km_s(n)?,
+            epoch: *self.epochs.get(n)?,
+            frame: self.frame,
+        })
+    }
+
+    /// Iterates over the states of this batch.
+    pub fn iter(&self) -> impl Iterator<Item = CartesianState> + '_ {
+        (0..self.len()).filter_map(|n| self.get(n))
+    }
+
+    pub fn epochs(&self) -> &[Epoch] {
+        &self.epochs
+    }
+
+    pub fn x_km(&self) -> &[f64] {
+        &self.x_km
+    }
+
+    pub fn y_km(&self) -> &[f64] {
+        &self.y_km
+    }
+
+    pub fn z_km(&self) -> &[f64] {
+        &self.z_km
+    }
+
+    pub fn vx_km_s(&self) -> &[f64] {
+        &self.vx_km_s
+    }
+
+    pub fn vy_km_s(&self) -> &[f64] {
+        &self.vy_km_s
+    }
+
+    pub fn vz_km_s(&self) -> &[f64] {
+        &self.vz_km_s
+    }
+
+    /// Consumes this batch and returns its columns: epochs, x, y, z, vx, vy, vz.
+    #[allow(clippy::type_complexity)]
+    pub fn into_columns(self) -> (Vec<Epoch>, [Vec<f64>; 6]) {
+        (
+            self.epochs,
+            [
+                self.x_km,
+                self.y_km,
+                self.z_km,
+                self.vx_km_s,
+                self.vy_km_s,
+                self.vz_km_s,
+            ],
+        )
+    }
+
+    /// Returns the magnitude of the radius of each state in km.
+    pub fn rmag_km(&self) -> Vec<f64> {
+        magnitudes(&self.x_km, &self.y_km, &self.z_km)
+    }
+
+    /// Returns the magnitude of the velocity of each state in km/s.
+    pub fn vmag_km_s(&self) -> Vec<f64> {
+        magnitudes(&self.vx_km_s, &self.vy_km_s, &self.vz_km_s)
+    }
+
+    /// Computes the Keplerian orbital elements of all of the states, as the getters of [crate::astro::orbit::Orbit] would.
+    ///
+    /// The orbital momentum and eccentricity vectors are computed only once per state. Unlike [crate::astro::orbit::Orbit::ta_deg],
+    /// no warning is emitted for circular orbits.
+    ///
+    /// # Frame warning
+    /// This returns an error if the frame of this batch does not define its gravitational parameter.
+    pub fn keplerian(&self) -> PhysicsResult<KeplerianBatch> {
+        let mu_km3_s2 = self.frame.mu_km3_s2()?;
+
+        let mut kep = KeplerianBatch::with_capacity(self.len());
+        for n in 0..self.len() {
+            let r = self.radius_km(n).unwrap();
+            let v = self.velocity_km_s(n).unwrap();
+            let (rmag, vmag) = (r.norm(), v.norm());
+            if rmag <= f64::EPSILON || vmag <= f64::EPSILON {
+                kep.push_nan();
+                continue;
+            }
+
+            let hvec = r.cross(&v);
+            let hmag = hvec.norm();
+            let evec = ((vmag.powi(2) - mu_km3_s2 / rmag) * r - (r.dot(&v)) * v) / mu_km3_s2;
+            let ecc = evec.norm();
+
+            kep.sma_km
+                .push(-mu_km3_s2 / (2.0 * (vmag.powi(2) / 2.0 - mu_km3_s2 / rmag)));
+            kep.ecc.push(ecc);
+            kep.inc_deg.push((hvec[2] / hmag).acos().to_degrees());
+
+            let node = Vector3::new(0.0, 0.0, 1.0).cross(&hvec);
+            let raan = (node[0] / node.norm()).acos();
+            kep.raan_deg
+                .push(angle_deg(raan, node[0] / node.norm(), node[1] < 0.0));
+
+            let cos_aop = node.dot(&evec) / (node.norm() * ecc);
+            kep.aop_deg
+                .push(angle_deg(cos_aop.acos(), cos_aop, evec[2] < 0.0));
+
+            let cos_nu = evec.dot(&r) / (ecc * rmag);
+            kep.ta_deg
+                .push(angle_deg(cos_nu.acos(), cos_nu, r.dot(&v) < 0.0));
+        }
+
+        Ok(kep)
+    }
+
+    /// Computes the geodetic latitude, longitude, and height of all of the states, as [CartesianState::latlongalt] would.
+    ///
+    /// # Frame warning
+    /// This batch MUST be in a body fixed frame (e.g. ITRF93) with a shape, or the computation is **invalid**.
+    pub fn latlongalt(&self) -> PhysicsResult<GeodeticBatch> {
+        let a_km = self.frame.mean_equatorial_radius_km()?;
+        let b_km = self.frame.polar_radius_km()?;
+
+        let mut geo = GeodeticBatch {
+            latitude_deg: Vec::with_capacity(self.len()),
+            longitude_deg: Vec::with_capacity(self.len()),
+            height_km: Vec::with_capacity(self.len()),
+        };
+        for n in 0..self.len() {
+            let (lat_deg, long_deg, alt_km) =
+                heikkinen_latlongalt(&self.radius_km(n).unwrap(), a_km, b_km);
+            geo.latitude_deg.push(lat_deg);
+            geo.longitude_deg.push(long_deg);
+            geo.height_km.push(alt_km);
+        }
+
+        Ok(geo)
+    }
+
+    /// Builds the rotation matrices from the RIC frame of each state to the inertial frame of this batch,
+    /// as [CartesianState::dcm3x3_from_ric_to_inertial], i.e. **without** accounting for the transport theorem.
+    ///
+    /// # Frame warning
+    /// If this batch is NOT in an inertial frame, then this computation is INVALID.
+    pub fn dcm3x3_from_ric_to_inertial(&self) -> Vec<Matrix3> {
+        (0..self.len())
+            .map(|n| {
+                let r = self.radius_km(n).unwrap();
+                let hvec = r.cross(&self.velocity_km_s(n).unwrap());
+                let r_hat = r / r.norm();
+                let c_hat = hvec / hvec.norm();
+                Matrix3::from_columns(&[r_hat, r_hat.cross(&c_hat), c_hat])
+            })
+            .collect()
+    }
+
+    /// Builds the rotation matrices from the VNC frame of each state to the inertial frame of this batch,
+    /// as [CartesianState::dcm_from_vnc_to_inertial].
+    ///
+    /// # Frame warning
+    /// If this batch is NOT in an inertial frame, then this computation is INVALID.
+    pub fn dcm_from_vnc_to_inertial(&self) -> Vec<Matrix3> {
+        (0..self.len())
+            .map(|n| {
+                let r = self.radius_km(n).unwrap();
+                let v = self.velocity_km_s(n).unwrap();
+                let hvec = r.cross(&v);
+                let v_hat = v / v.norm();
+                let n_hat = hvec / hvec.norm();
+                Matrix3::from_columns(&[v_hat, n_hat, v_hat.cross(&n_hat)])
+            })
+            .collect()
+    }
+
+    fn radius_km(&self, n: usize) -> Option<Vector3> {
+        Some(Vector3::new(
+            *self.x_km.get(n)?,
+            *self.y_km.get(n)?,
+            *self.z_km.get(n)?,
+        ))
+    }
+
+    fn velocity_km_s(&self, n: usize) -> Option<Vector3> {
+        Some(Vector3::new(
+            *self.vx_km_s.get(n)?,
+            *self.vy_km_s.get(n)?,
+            *self.vz_km_s.get(n)?,
+        ))
+    }
+}
+
+impl KeplerianBatch {
+    fn with_capacity(capacity: usize) -> Self {
+        Self {
+            sma_km: Vec::with_capacity(capacity),
+            ecc: Vec::with_capacity(capacity),
+            inc_deg: Vec::with_capacity(capacity),
+            raan_deg: Vec::with_capacity(capacity),
+            aop_deg: Vec::with_capacity(capacity),
+            ta_deg: Vec::with_capacity(capacity),
+        }
+    }
+
+    fn push_nan(&mut self) {
+        for column in [
+            &mut self.sma_km,
+            &mut self.ecc,
+            &mut self.inc_deg,
+            &mut self.raan_deg,
+            &mut self.aop_deg,
+            &mut self.ta_deg,
+        ] {
+            column.push(f64::NAN);
+        }
+    }
+}
+
+/// Returns the angle in degrees between 0 and 360 from its arccosine, handling its rounding as the Orbit getters do.
+fn angle_deg(angle_rad: f64, cos_angle: f64, flip: bool) -> f64 {
+    if angle_rad.is_nan() {
+        if cos_angle > 1.0 {
+            180.0
+        } else {
+            0.0
+        }
+    } else if flip {
+        (2.0 * PI - angle_rad).to_degrees()
+    } else {
+        angle_rad.to_degrees()
+    }
+}
+
+fn magnitudes(x: &[f64], y: &[f64], z: &[f64]) -> Vec<f64> {
+    x.iter()
+        .zip(y)
+        .zip(z)
+        .map(|((x, y), z)| (x * x + y * y + z * z).sqrt())
+        .collect()
+}
+
+#[cfg(test)]
+mod ut_state_batch {
+    use super::*;
+    use crate::constants::frames::{EARTH_J2000, IAU_EARTH_FRAME};
+    use crate::math::rotation::DCM;
+    use crate::structure::planetocentric::ellipsoid::Ellipsoid;
+    use hifitime::TimeUnits;
+
+    #[test]
+    fn matches_orbit_getters() {
+        let eme2k = EARTH_J2000.with_mu_km3_s2(398_600.4418);
+        let epoch = Epoch::from_gregorian_utc_at_midnight(2024, 1, 1);
+
+        let states: Vec<CartesianState> = (0..50)
+            .map(|n| {
+                CartesianState::try_keplerian(
+                    7000.0 + 100.0 * n as f64,
+                    0.001 + 0.01 * n as f64,
+                    1.0 + 3.5 * n as f64,
+                    7.0 * n as f64,
+                    11.0 * n as f64,
+                    13.0 * n as f64,
+                    epoch + (n as f64).minutes(),
+                    eme2k,
+                )
+                .unwrap()
+            })
+            .collect();
+
+        let batch = StateBatch::from_states(eme2k, &states).unwrap();
+        assert_eq!(batch.len(), 50);
+        assert_eq!(batch.get(7), Some(states[7]));
+        assert_eq!(batch.iter().count(), 50);
+
+        let kep = batch.keplerian().unwrap();
+        let ric = batch.dcm3x3_from_ric_to_inertial();
+        let vnc = batch.dcm_from_vnc_to_inertial();
+        for (n, state) in states.iter().enumerate() {
+            assert_eq!(kep.sma_km[n], state.sma_km().unwrap());
+            assert_eq!(kep.ecc[n], state.ecc().unwrap());
+            assert_eq!(kep.inc_deg[n], state.inc_deg().unwrap());
+            assert_eq!(kep.raan_deg[n], state.raan_deg().unwrap());
+            assert_eq!(kep.aop_deg[n], state.aop_deg().unwrap());
+            assert_eq!(kep.ta_deg[n], state.ta_deg().unwrap());
+
+            let exp_ric: DCM = state.dcm3x3_from_ric_to_inertial().unwrap();
+            assert!((ric[n] - exp_ric.rot_mat).norm() < 1e-15);
+            let exp_vnc = state.dcm_from_vnc_to_inertial().unwrap();
+            assert!((vnc[n] - exp_vnc.rot_mat).norm() < 1e-15);
+            assert!((batch.rmag_km()[n] - state.rmag_km()).abs() < 1e-9);
+        }
+
+        // Degenerate states are NaN
+        let mut degenerate = batch.clone();
+        degenerate
+            .push(&CartesianState::zero_at_epoch(epoch, eme2k))
+            .unwrap();
+        assert!(degenerate.keplerian().unwrap().sma_km[50].is_nan());
+
+        // States must all be in the same frame, and the frame must have a gravitational parameter
+        assert!(StateBatch::with_capacity(IAU_EARTH_FRAME, 1)
+            .push(&states[0])
+            .is_err());
+        assert!(StateBatch::from_states(EARTH_J2000, &[])
+            .unwrap()
+            .keplerian()
+            .is_err());
+
+        let (epochs, [x_km, ..]) = batch.into_columns();
+        assert_eq!(epochs.len(), 50);
+        assert_eq!(x_km[3], states[3].radius_km.x);
+    }
+
+    #[test]
+    fn geodetic() {
+        let iau_earth = Frame {
+            shape: Some(Ellipsoid::from_spheroid(6378.1366, 6356.7519)),
+            ..IAU_EARTH_FRAME
+        };
+        let states: Vec<CartesianState> = (0..20)
+            .map(|n| {
+                CartesianState::from_position(
+                    7000.0 - 300.0 * n as f64,
+                    -500.0 * n as f64,
+                    200.0 * n as f64 - 1000.0,
+                    Epoch::from_tdb_seconds(0.0),
+                    iau_earth,
+                )
+            })
+            .collect();
+
+        let batch = StateBatch::from_states(iau_earth, &states).unwrap();
+        let geo = batch.latlongalt().unwrap();
+        for (n, state) in states.iter().enumerate() {
+            let (lat_deg, long_deg, alt_km) = state.latlongalt().unwrap();
+            assert_eq!(geo.latitude_deg[n], lat_deg);
+            assert_eq!(geo.longitude_deg[n], long_deg);
+            assert_eq!(geo.height_km[n], alt_km);
+        }
+
+        assert!(StateBatch::from_columns(
+            iau_earth,
+            vec![Epoch::from_tdb_seconds(0.0)],
+            vec![1.0],
+            vec![],
+            vec![],
+            vec![],
+            vec![],
+            vec![]
+        )
+        .is_none());
+    }
+}
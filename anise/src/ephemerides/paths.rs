@@ -12,47 +12,86 @@ use hifitime::Epoch;
 use snafu::{ensure, ResultExt};
 
 use super::{EphemerisError, NoEphemerisLoadedSnafu, SPKSnafu};
+use crate::almanac::cache::{intersect_windows, CacheKey};
+use crate::almanac::metrics::DataKind;
 use crate::almanac::Almanac;
 use crate::frames::Frame;
 use crate::naif::daf::{DAFError, NAIFSummaryRecord};
+use crate::naif::SPK;
 use crate::NaifId;
 
 /// **Limitation:** no translation or rotation may have more than 8 nodes.
 pub const MAX_TREE_DEPTH: usize = 8;
 
+/// Returns the root of the summaries of this SPK and of the provided root of other SPKs.
+///
+/// The common center is the absolute minimum of all centers due to the NAIF numbering.
+pub(crate) fn ephemeris_root_of(
+    spk: &SPK,
+    mut common_center: NaifId,
+) -> Result<NaifId, EphemerisError> {
+    for summary in spk.data_summaries().context(SPKSnafu {
+        action: "finding ephemeris root",
+    })? {
+        // This summary exists, so we need to follow the branch of centers up the tree.
+        if !summary.is_empty() && summary.center_id.abs() < common_center.abs() {
+            common_center = summary.center_id;
+            if common_center == 0 {
+                // We're at the SSB, there is nothing higher up
+                break;
+            }
+        }
+    }
+    Ok(common_center)
+}
+
 impl Almanac {
+    /// Returns the key describing the loaded SPK data for the path cache, if the summary index is up to date.
+    pub(crate) fn ephemeris_cache_key(&self) -> Option<CacheKey> {
+        let num_loaded = self.num_loaded_spk();
+        if self.spk_index.num_indexed() == num_loaded {
+            Some((num_loaded, 0, 0))
+        } else {
+            None
+        }
+    }
+
     /// Returns the root of all of the loaded ephemerides, typically this should be the Solar System Barycenter.
     ///
     /// # Algorithm
     ///
     /// 1. For each loaded SPK, iterated in reverse order (to mimic SPICE behavior)
     /// 2. For each summary record in each SPK, follow the ephemeris branch all the way up until the end of this SPK or until the SSB.
+    ///
+    /// The root is cached until new SPK data is loaded.
     pub fn try_find_ephemeris_root(&self) -> Result<NaifId, EphemerisError> {
         ensure!(self.num_loaded_spk() > 0, NoEphemerisLoadedSnafu);
 
-        // The common center is the absolute minimum of all centers due to the NAIF numbering.
+        let cache_key = self.ephemeris_cache_key();
+        if let Some(root) = cache_key.and_then(|key| self.ephemeris_paths.root(key)) {
+            return Ok(root);
+        }
+
         let mut common_center = i32::MAX;
 
-        for maybe_spk in self.spk_data.iter().take(self.num_loaded_spk()).rev() {
-            let spk = maybe_spk.as_ref().unwrap();
-
-            for summary in spk.data_summaries().context(SPKSnafu {
-                action: "finding ephemeris root",
-            })? {
-                // This summary exists, so we need to follow the branch of centers up the tree.
-                if !summary.is_empty() && summary.center_id.abs() < common_center.abs() {
-                    common_center = summary.center_id;
-                    if common_center == 0 {
-                        // We're at the SSB, there is nothing higher up
-                        return Ok(common_center);
-                    }
-                }
+        for spk in self.spk_data.iter().rev() {
+            common_center = ephemeris_root_of(spk, common_center)?;
+            if common_center == 0 {
+                // We're at the SSB, there is nothing higher up
+                break;
             }
         }
+
+        if let Some(key) = cache_key {
+            self.ephemeris_paths.set_root(key, common_center);
+        }
+
         Ok(common_center)
     }
 
     /// Try to construct the path from the source frame all the way to the root ephemeris of this context.
+    ///
+    /// Paths are cached with the time window where the summaries of each hop are valid, until new SPK data is loaded.
     pub fn ephemeris_path_to_root(
         &self,
         source: Frame,
@@ -68,26 +107,46 @@ impl Almanac {
             return Ok((of_path_len, of_path));
         }
 
-        // Grab the summary data, which we use to find the paths
-        let summary = self.spk_summary_at_epoch(source.ephemeris_id, epoch)?.0;
-
-        let mut center_id = summary.center_id;
-
-        of_path[of_path_len] = Some(summary.center_id);
-        of_path_len += 1;
-
-        if summary.center_id == common_center {
-            // Well that was quick!
-            return Ok((of_path_len, of_path));
+        let cache_key = self.ephemeris_cache_key();
+        if let Some(path) =
+            cache_key.and_then(|key| self.ephemeris_paths.path(key, source.ephemeris_id, epoch))
+        {
+            self.metrics.path_cache(DataKind::Ephemeris, true);
+            return Ok(path);
         }
+        self.metrics.path_cache(DataKind::Ephemeris, false);
+
+        // The path is valid for as long as the summary of each hop is the one in use.
+        let mut window = None;
+        let mut cacheable = cache_key.is_some();
+        let mut center_id = source.ephemeris_id;
 
         for _ in 0..MAX_TREE_DEPTH {
+            // Grab the summary data, which we use to find the paths
             let summary = self.spk_summary_at_epoch(center_id, epoch)?.0;
+            if cacheable {
+                match self.spk_index.lookup_summary(center_id, epoch) {
+                    Some(indexed) => {
+                        window = intersect_windows(window, indexed.start_epoch, indexed.end_epoch)
+                    }
+                    None => cacheable = false,
+                }
+            }
+
             center_id = summary.center_id;
             of_path[of_path_len] = Some(center_id);
             of_path_len += 1;
+
             if center_id == common_center {
                 // We're found the path!
+                if let (true, Some(key), Some(window)) = (cacheable, cache_key, window) {
+                    self.ephemeris_paths.insert_path(
+                        key,
+                        source.ephemeris_id,
+                        Some(window),
+                        (of_path_len, of_path),
+                    );
+                }
                 return Ok((of_path_len, of_path));
             }
         }
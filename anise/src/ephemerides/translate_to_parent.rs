@@ -12,88 +12,201 @@ use log::trace;
 use snafu::ResultExt;
 
 use super::{EphemerisError, SPKSnafu};
+use crate::almanac::metrics::{Interpolation, Stage};
 use crate::almanac::Almanac;
 use crate::ephemerides::EphemInterpolationSnafu;
 use crate::hifitime::Epoch;
 use crate::math::cartesian::CartesianState;
 use crate::math::Vector3;
-use crate::naif::daf::datatypes::{HermiteSetType13, LagrangeSetType9, Type2ChebyshevSet};
+use crate::naif::daf::datatypes::{
+    with_newton_window_capacity, HermiteSetType13, LagrangeSetType9, Type2ChebyshevSet,
+};
 use crate::naif::daf::{DAFError, DafDataType, NAIFDataSet};
+use crate::naif::spk::summary::SPKSummaryRecord;
 use crate::prelude::Frame;
 
 #[cfg(feature = "python")]
 use pyo3::prelude::*;
 
+/// The decoded data of an SPK segment, which borrows from the SPK itself.
+pub(crate) enum SpkSegmentData<'a> {
+    Chebyshev(Type2ChebyshevSet<'a>),
+    Lagrange(LagrangeSetType9<'a>),
+    Hermite(HermiteSetType13<'a>),
+}
+
+/// An SPK segment translating a frame to its parent, decoded once such that it can be evaluated at many epochs.
+pub(crate) struct SpkSegment<'a> {
+    /// Frame translated to its parent by this segment
+    pub source: Frame,
+    /// Parent frame, i.e. the center of this segment
+    pub parent: Frame,
+    pub summary: &'a SPKSummaryRecord,
+    /// Time window where this segment is the one that the Almanac would use, if known
+    pub window: Option<(Epoch, Epoch)>,
+    pub data: SpkSegmentData<'a>,
+    /// Newton window capacity of the Almanac, used by the Type 9 and Type 13 data
+    pub newton_window_capacity: usize,
+}
+
+impl<'a> SpkSegment<'a> {
+    /// Returns true if the Almanac would use this same segment at the provided epoch, i.e. if the epoch is in the interior of its window.
+    pub fn is_valid_at(&self, epoch: Epoch) -> bool {
+        match self.window {
+            Some((start, end)) => epoch > start && epoch < end,
+            None => false,
+        }
+    }
+
+    /// Returns the kind of interpolation of this segment.
+    pub fn interpolation(&self) -> Interpolation {
+        match &self.data {
+            SpkSegmentData::Chebyshev(_) => Interpolation::Chebyshev,
+            SpkSegmentData::Lagrange(_) => Interpolation::Lagrange,
+            SpkSegmentData::Hermite(_) => Interpolation::Hermite,
+        }
+    }
+
+    /// Evaluates the position and velocity of the source with respect to its parent at the provided epoch.
+    pub fn evaluate(&self, epoch: Epoch) -> Result<(Vector3, Vector3), EphemerisError> {
+        trace!(
+            "translate {} wrt to {} @ {epoch:E}",
+            self.source,
+            self.parent
+        );
+        let state = match &self.data {
+            SpkSegmentData::Chebyshev(data) => data.evaluate(epoch, self.summary),
+            SpkSegmentData::Lagrange(data) => {
+                with_newton_window_capacity(self.newton_window_capacity, || {
+                    data.evaluate(epoch, self.summary)
+                })
+            }
+            SpkSegmentData::Hermite(data) => {
+                with_newton_window_capacity(self.newton_window_capacity, || {
+                    data.evaluate(epoch, self.summary)
+                })
+            }
+        };
+        state.context(EphemInterpolationSnafu)
+    }
+}
+
 impl Almanac {
-    /// Returns the position vector and velocity vector of the `source` with respect to its parent in the ephemeris at the provided epoch,
-    /// Units are those used in the SPK, typically distances are in kilometers and velocities in kilometers per second.
+    /// Returns the decoded SPK segment of the `source` with respect to its parent in the ephemeris at the provided epoch.
     ///
     /// # Errors
     /// + As of now, some interpolation types are not supported, and if that were to happen, this would return an error.
-    ///
-    /// # Warning
-    /// This function only performs the translation and no rotation whatsoever. Use the `transform_to_parent_from` function instead to include rotations.
-    pub(crate) fn translation_parts_to_parent(
+    pub(crate) fn spk_segment(
         &self,
         source: Frame,
         epoch: Epoch,
-    ) -> Result<(Vector3, Vector3, Frame), EphemerisError> {
+    ) -> Result<SpkSegment<'_>, EphemerisError> {
         // First, let's find the SPK summary for this frame.
         let (summary, spk_no, idx_in_spk) =
             self.spk_summary_at_epoch(source.ephemeris_id, epoch)?;
 
-        let new_frame = source.with_ephem(summary.center_id);
-
-        trace!("translate {source} wrt to {new_frame} @ {epoch:E}");
+        // The time window is only known if the index is up to date.
+        let window = if self.spk_index.num_indexed() == self.num_loaded_spk() {
+            self.spk_index
+                .lookup_summary(source.ephemeris_id, epoch)
+                .map(|indexed| (indexed.start_epoch, indexed.end_epoch))
+        } else {
+            None
+        };
 
         // This should not fail because we've fetched the spk_no from above with the spk_summary_at_epoch call.
-        let spk_data = self.spk_data[spk_no]
-            .as_ref()
+        let spk_data = self
+            .spk_data
+            .get(spk_no)
             .ok_or(EphemerisError::Unreachable)?;
 
-        // Now let's simply evaluate the data
-
-        let (pos_km, vel_km_s) = match summary.data_type()? {
-            DafDataType::Type2ChebyshevTriplet => {
-                let data =
+        let data = self.metrics.time(Stage::Decode, || {
+            Ok(match summary.data_type()? {
+                DafDataType::Type2ChebyshevTriplet => SpkSegmentData::Chebyshev(
                     spk_data
                         .nth_data::<Type2ChebyshevSet>(idx_in_spk)
                         .context(SPKSnafu {
                             action: "fetching data for interpolation",
-                        })?;
-                data.evaluate(epoch, summary)
-                    .context(EphemInterpolationSnafu)?
-            }
-            DafDataType::Type9LagrangeUnequalStep => {
-                let data = spk_data
-                    .nth_data::<LagrangeSetType9>(idx_in_spk)
-                    .context(SPKSnafu {
-                        action: "fetching data for interpolation",
-                    })?;
-                data.evaluate(epoch, summary)
-                    .context(EphemInterpolationSnafu)?
-            }
-            DafDataType::Type13HermiteUnequalStep => {
-                let data = spk_data
-                    .nth_data::<HermiteSetType13>(idx_in_spk)
-                    .context(SPKSnafu {
-                        action: "fetching data for interpolation",
-                    })?;
-                data.evaluate(epoch, summary)
-                    .context(EphemInterpolationSnafu)?
-            }
-            dtype => {
-                return Err(EphemerisError::SPK {
-                    action: "translation to parent",
-                    source: DAFError::UnsupportedDatatype {
-                        dtype,
-                        kind: "SPK computations",
-                    },
-                })
-            }
+                        })?,
+                ),
+                DafDataType::Type9LagrangeUnequalStep => SpkSegmentData::Lagrange(
+                    spk_data
+                        .nth_data::<LagrangeSetType9>(idx_in_spk)
+                        .context(SPKSnafu {
+                            action: "fetching data for interpolation",
+                        })?,
+                ),
+                DafDataType::Type13HermiteUnequalStep => SpkSegmentData::Hermite(
+                    spk_data
+                        .nth_data::<HermiteSetType13>(idx_in_spk)
+                        .context(SPKSnafu {
+                            action: "fetching data for interpolation",
+                        })?,
+                ),
+                dtype => {
+                    return Err(EphemerisError::SPK {
+                        action: "translation to parent",
+                        source: DAFError::UnsupportedDatatype {
+                            dtype,
+                            kind: "SPK computations",
+                        },
+                    })
+                }
+            })
+        })?;
+
+        Ok(SpkSegment {
+            source,
+            parent: source.with_ephem(summary.center_id),
+            summary,
+            window,
+            data,
+            newton_window_capacity: self.newton_window_capacity,
+        })
+    }
+
+    /// Returns the position vector and velocity vector of the `source` with respect to its parent in the ephemeris at the provided epoch,
+    /// Units are those used in the SPK, typically distances are in kilometers and velocities in kilometers per second.
+    ///
+    /// # Errors
+    /// + As of now, some interpolation types are not supported, and if that were to happen, this would return an error.
+    ///
+    /// # Warning
+    /// This function only performs the translation and no rotation whatsoever. Use the `transform_to_parent_from` function instead to include rotations.
+    pub(crate) fn translation_parts_to_parent(
+        &self,
+        source: Frame,
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3, Frame), EphemerisError> {
+        let cache_key = if self.state_cache.is_enabled() {
+            self.ephemeris_cache_key()
+        } else {
+            None
         };
+        if let Some(key) = cache_key {
+            if let Some((pos_km, vel_km_s, center_id)) =
+                self.state_cache.get(key, source.ephemeris_id, epoch)
+            {
+                self.metrics.state_cache(true);
+                return Ok((pos_km, vel_km_s, source.with_ephem(center_id)));
+            }
+            self.metrics.state_cache(false);
+        }
+
+        let segment = self.spk_segment(source, epoch)?;
+        self.metrics.interpolation(segment.interpolation());
+        let (pos_km, vel_km_s) = self.metrics.time(Stage::Eval, || segment.evaluate(epoch))?;
+
+        if let Some(key) = cache_key {
+            self.state_cache.insert(
+                key,
+                source.ephemeris_id,
+                epoch,
+                (pos_km, vel_km_s, segment.summary.center_id),
+            );
+        }
 
-        Ok((pos_km, vel_km_s, new_frame))
+        Ok((pos_km, vel_km_s, segment.parent))
     }
 }
 
@@ -10,8 +10,10 @@
 
 use snafu::ResultExt;
 
+use super::translate_to_parent::SpkSegment;
 use super::EphemerisError;
 use super::EphemerisPhysicsSnafu;
+use crate::almanac::metrics::DataKind;
 use crate::almanac::Almanac;
 use crate::astro::aberration::stellar_aberration;
 use crate::astro::Aberration;
@@ -21,7 +23,9 @@ use crate::hifitime::Epoch;
 use crate::math::cartesian::CartesianState;
 use crate::math::units::*;
 use crate::math::Vector3;
+use crate::naif::daf::DAFError;
 use crate::prelude::Frame;
+use crate::NaifId;
 
 /// **Limitation:** no translation or rotation may have more than 8 nodes.
 pub const MAX_TREE_DEPTH: usize = 8;
@@ -59,15 +63,13 @@ impl Almanac {
         }
 
         // If there is no frame info, the user hasn't loaded this frame, but might still want to compute a translation.
-        if let Ok(obs_frame_info) = self.frame_from_uid(observer_frame) {
-            // User has loaded the planetary data for this frame, so let's use that as the to_frame.
-            observer_frame = obs_frame_info;
-        }
+        observer_frame = self.loaded_frame_info(observer_frame);
 
         match ab_corr {
             None => {
                 let (node_count, path, common_node) =
                     self.common_ephemeris_path(observer_frame, target_frame, epoch)?;
+                self.metrics.path_depth(DataKind::Ephemeris, node_count);
 
                 // The fwrd variables are the states from the `from frame` to the common node
                 let (mut pos_fwrd, mut vel_fwrd, mut frame_fwrd) =
@@ -121,48 +123,11 @@ impl Almanac {
                 // This is a rewrite of NAIF SPICE's `spkapo`
 
                 // Find the geometric position of the observer body with respect to the solar system barycenter.
-                let obs_ssb = self.translate(observer_frame, SSB_J2000, epoch, None)?;
-                let obs_ssb_pos_km = obs_ssb.radius_km;
-                let obs_ssb_vel_km_s = obs_ssb.velocity_km_s;
-
-                // Find the geometric position of the target body with respect to the solar system barycenter.
-                let tgt_ssb = self.translate(target_frame, SSB_J2000, epoch, None)?;
-                let tgt_ssb_pos_km = tgt_ssb.radius_km;
-                let tgt_ssb_vel_km_s = tgt_ssb.velocity_km_s;
-
-                // Subtract the position of the observer to get the relative position.
-                let mut rel_pos_km = tgt_ssb_pos_km - obs_ssb_pos_km;
-                // NOTE: We never correct the velocity, so the geometric velocity is what we're seeking.
-                let mut rel_vel_km_s = tgt_ssb_vel_km_s - obs_ssb_vel_km_s;
-
-                // Use this to compute the one-way light time in seconds.
-                let mut one_way_lt_s = rel_pos_km.norm() / SPEED_OF_LIGHT_KM_S;
-
-                // To correct for light time, find the position of the target body at the current epoch
-                // minus the one-way light time. Note that the observer remains where he is.
-
-                let num_it = if ab_corr.converged { 3 } else { 1 };
-                let lt_sign = if ab_corr.transmit_mode { 1.0 } else { -1.0 };
-
-                for _ in 0..num_it {
-                    let epoch_lt = epoch + lt_sign * one_way_lt_s * TimeUnit::Second;
-                    let tgt_ssb = self.translate(target_frame, SSB_J2000, epoch_lt, None)?;
-                    let tgt_ssb_pos_km = tgt_ssb.radius_km;
-                    let tgt_ssb_vel_km_s = tgt_ssb.velocity_km_s;
-
-                    rel_pos_km = tgt_ssb_pos_km - obs_ssb_pos_km;
-                    rel_vel_km_s = tgt_ssb_vel_km_s - obs_ssb_vel_km_s;
-                    one_way_lt_s = rel_pos_km.norm() / SPEED_OF_LIGHT_KM_S;
-                }
+                let obs_ssb = SsbTranslation::new(self, observer_frame).evaluate(epoch)?;
 
-                // If stellar aberration correction is requested, perform it now.
-                if ab_corr.stellar {
-                    // Modifications based on transmission versus reception case is done in the function directly.
-                    rel_pos_km = stellar_aberration(rel_pos_km, obs_ssb_vel_km_s, ab_corr)
-                        .context(EphemerisPhysicsSnafu {
-                            action: "computing stellar aberration",
-                        })?;
-                }
+                // And correct the position of the target for the light time.
+                let (rel_pos_km, rel_vel_km_s) = SsbTranslation::new(self, target_frame)
+                    .light_time_corrected(obs_ssb, epoch, ab_corr)?;
 
                 Ok(CartesianState {
                     radius_km: rel_pos_km,
@@ -198,16 +163,361 @@ impl Almanac {
         let mut new_state = state.add_unchecked(&frame_state);
 
         // If there is no frame info, the user hasn't loaded this frame, but might still want to compute a translation.
-        if let Ok(obs_frame_info) = self.frame_from_uid(observer_frame) {
-            // User has loaded the planetary data for this frame, so let's use that as the to_frame.
-            observer_frame = obs_frame_info;
-        }
+        observer_frame = self.loaded_frame_info(observer_frame);
         new_state.frame = observer_frame.with_orient(state.frame.orientation_id);
         Ok(new_state)
     }
 }
 
+/// The SPK segments translating a frame up to a node of the ephemeris tree.
+pub(crate) struct SpkChain<'a> {
+    segments: Vec<SpkSegment<'a>>,
+}
+
+impl<'a> SpkChain<'a> {
+    /// Returns true if all of the segments of this chain are the ones the Almanac would use at this epoch.
+    pub fn is_valid_at(&self, epoch: Epoch) -> bool {
+        self.segments
+            .iter()
+            .all(|segment| segment.is_valid_at(epoch))
+    }
+
+    /// Returns the position and velocity of the start of this chain with respect to its end node.
+    pub fn evaluate(&self, epoch: Epoch) -> Result<(Vector3, Vector3), EphemerisError> {
+        let mut pos_km = Vector3::zeros();
+        let mut vel_km_s = Vector3::zeros();
+        for segment in &self.segments {
+            let (seg_pos_km, seg_vel_km_s) = segment.evaluate(epoch)?;
+            pos_km += seg_pos_km;
+            vel_km_s += seg_vel_km_s;
+        }
+        Ok((pos_km, vel_km_s))
+    }
+}
+
+/// A geometric translation between two frames, whose path and segments are resolved once and reused for as long as they remain valid.
+pub(crate) struct TranslationPlan<'a> {
+    observer: SpkChain<'a>,
+    target: SpkChain<'a>,
+}
+
+impl<'a> TranslationPlan<'a> {
+    /// Returns true if this plan can be evaluated at the provided epoch and give the same result as `translate`.
+    pub fn is_valid_at(&self, epoch: Epoch) -> bool {
+        self.observer.is_valid_at(epoch) && self.target.is_valid_at(epoch)
+    }
+
+    /// Returns the end of the time window where this plan remains valid, if it is known and bounded.
+    pub fn valid_until(&self) -> Option<Epoch> {
+        let mut until: Option<Epoch> = None;
+        for segment in self
+            .observer
+            .segments
+            .iter()
+            .chain(self.target.segments.iter())
+        {
+            let (_, end) = segment.window?;
+            until = Some(until.map_or(end, |until| until.min(end)));
+        }
+        until
+    }
+
+    /// Returns the geometric position and velocity of the target with respect to the observer.
+    pub fn evaluate(&self, epoch: Epoch) -> Result<(Vector3, Vector3), EphemerisError> {
+        let (pos_fwrd, vel_fwrd) = self.observer.evaluate(epoch)?;
+        let (pos_bwrd, vel_bwrd) = self.target.evaluate(epoch)?;
+        Ok((pos_bwrd - pos_fwrd, vel_bwrd - vel_fwrd))
+    }
+}
+
+/// The geometric translation of a frame with respect to the solar system barycenter, whose plan is kept for as long as it remains valid.
+///
+/// The light time iterations evaluate the target at epochs only a few seconds apart, which almost always use the same SPK segments.
+pub(crate) struct SsbTranslation<'a> {
+    almanac: &'a Almanac,
+    frame: Frame,
+    plan: Option<TranslationPlan<'a>>,
+}
+
+impl<'a> SsbTranslation<'a> {
+    pub fn new(almanac: &'a Almanac, frame: Frame) -> Self {
+        Self {
+            almanac,
+            frame,
+            plan: None,
+        }
+    }
+
+    /// Returns the same position and velocity as `translate(frame, SSB_J2000, epoch, None)`.
+    pub fn evaluate(&mut self, epoch: Epoch) -> Result<(Vector3, Vector3), EphemerisError> {
+        if self.frame == SSB_J2000 {
+            return Ok((Vector3::zeros(), Vector3::zeros()));
+        }
+
+        if !self
+            .plan
+            .as_ref()
+            .map_or(false, |plan| plan.is_valid_at(epoch))
+        {
+            self.plan = Some(
+                self.almanac
+                    .translation_plan(self.frame, SSB_J2000, epoch)?,
+            );
+        }
+
+        self.plan.as_ref().unwrap().evaluate(epoch)
+    }
+
+    /// Returns the position and velocity of this frame as seen from the observer, whose state with respect to the solar system barycenter
+    /// is provided, corrected for the light time and optionally the stellar aberration.
+    pub fn light_time_corrected(
+        &mut self,
+        obs_ssb: (Vector3, Vector3),
+        epoch: Epoch,
+        ab_corr: Aberration,
+    ) -> Result<(Vector3, Vector3), EphemerisError> {
+        let (obs_ssb_pos_km, obs_ssb_vel_km_s) = obs_ssb;
+
+        // Find the geometric position of the target body with respect to the solar system barycenter.
+        let (tgt_ssb_pos_km, tgt_ssb_vel_km_s) = self.evaluate(epoch)?;
+
+        // Subtract the position of the observer to get the relative position.
+        let mut rel_pos_km = tgt_ssb_pos_km - obs_ssb_pos_km;
+        // NOTE: We never correct the velocity, so the geometric velocity is what we're seeking.
+        let mut rel_vel_km_s = tgt_ssb_vel_km_s - obs_ssb_vel_km_s;
+
+        // Use this to compute the one-way light time in seconds.
+        let mut one_way_lt_s = rel_pos_km.norm() / SPEED_OF_LIGHT_KM_S;
+
+        // To correct for light time, find the position of the target body at the current epoch
+        // minus the one-way light time. Note that the observer remains where he is.
+
+        let num_it = if ab_corr.converged { 3 } else { 1 };
+        let lt_sign = if ab_corr.transmit_mode { 1.0 } else { -1.0 };
+
+        for _ in 0..num_it {
+            let epoch_lt = epoch + lt_sign * one_way_lt_s * TimeUnit::Second;
+            let (tgt_ssb_pos_km, tgt_ssb_vel_km_s) = self.evaluate(epoch_lt)?;
+
+            rel_pos_km = tgt_ssb_pos_km - obs_ssb_pos_km;
+            rel_vel_km_s = tgt_ssb_vel_km_s - obs_ssb_vel_km_s;
+            one_way_lt_s = rel_pos_km.norm() / SPEED_OF_LIGHT_KM_S;
+        }
+
+        // If stellar aberration correction is requested, perform it now.
+        if ab_corr.stellar {
+            // Modifications based on transmission versus reception case is done in the function directly.
+            rel_pos_km = stellar_aberration(rel_pos_km, obs_ssb_vel_km_s, ab_corr).context(
+                EphemerisPhysicsSnafu {
+                    action: "computing stellar aberration",
+                },
+            )?;
+        }
+
+        Ok((rel_pos_km, rel_vel_km_s))
+    }
+}
+
 impl Almanac {
+    /// Builds the chain of SPK segments from the provided frame up to the node of the ephemeris tree.
+    pub(crate) fn spk_chain(
+        &self,
+        from_frame: Frame,
+        node: NaifId,
+        epoch: Epoch,
+    ) -> Result<SpkChain<'_>, EphemerisError> {
+        let mut segments = Vec::new();
+        let mut frame = from_frame;
+        while !frame.ephem_origin_id_match(node) {
+            if segments.len() == MAX_TREE_DEPTH {
+                return Err(EphemerisError::SPK {
+                    action: "computing path to common node",
+                    source: DAFError::MaxRecursionDepth,
+                });
+            }
+            let segment = self.spk_segment(frame, epoch)?;
+            frame = segment.parent;
+            segments.push(segment);
+        }
+        Ok(SpkChain { segments })
+    }
+
+    /// Resolves the geometric translation between these frames at the provided epoch.
+    pub(crate) fn translation_plan(
+        &self,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epoch: Epoch,
+    ) -> Result<TranslationPlan<'_>, EphemerisError> {
+        let (_, _, common_node) =
+            self.common_ephemeris_path(observer_frame, target_frame, epoch)?;
+
+        Ok(TranslationPlan {
+            observer: self.spk_chain(observer_frame, common_node, epoch)?,
+            target: self.spk_chain(target_frame, common_node, epoch)?,
+        })
+    }
+
+    /// Returns the Cartesian states of the target frame as seen from the observer frame at each of the provided epochs, and optionally given the aberration correction.
+    ///
+    /// This returns the same states as calling `translate` at each epoch, but the geometric path and the SPK segments are only
+    /// searched for again when an epoch is outside of the segments used for the previous epoch.
+    /// Providing the epochs in chronological order, e.g. from a `TimeSeries`, maximizes this reuse.
+    ///
+    /// # Warning
+    /// This function only performs the translation and no rotation whatsoever. Use the `transform` function instead to include rotations.
+    pub fn translate_many<I: IntoIterator<Item = Epoch>>(
+        &self,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epochs: I,
+        ab_corr: Option<Aberration>,
+    ) -> Result<Vec<CartesianState>, EphemerisError> {
+        let epochs = epochs.into_iter();
+        let mut states = Vec::with_capacity(epochs.size_hint().0);
+        self.translate_each(target_frame, observer_frame, epochs, ab_corr, |state| {
+            states.push(state)
+        })?;
+        Ok(states)
+    }
+
+    /// Writes the Cartesian states of the target frame as seen from the observer frame at each of the provided epochs into the states, as `translate_many` does, without any allocation.
+    ///
+    /// The n-th state is that at the n-th epoch: epochs beyond the number of states are ignored, and states beyond the number of epochs are left untouched.
+    /// Returns the number of states written.
+    pub fn translate_many_into<I: IntoIterator<Item = Epoch>>(
+        &self,
+        target_frame: Frame,
+        observer_frame: Frame,
+        epochs: I,
+        ab_corr: Option<Aberration>,
+        states: &mut [CartesianState],
+    ) -> Result<usize, EphemerisError> {
+        let epochs = epochs.into_iter().take(states.len());
+        let mut num_states = 0;
+        self.translate_each(target_frame, observer_frame, epochs, ab_corr, |state| {
+            // There are no more epochs than states.
+            states[num_states] = state;
+            num_states += 1;
+        })?;
+        Ok(num_states)
+    }
+
+    /// Computes the states of `translate_many` in chronological order of the epochs, and provides each of them to `emit`.
+    fn translate_each<I, F>(
+        &self,
+        target_frame: Frame,
+        mut observer_frame: Frame,
+        epochs: I,
+        ab_corr: Option<Aberration>,
+        mut emit: F,
+    ) -> Result<(), EphemerisError>
+    where
+        I: Iterator<Item = Epoch>,
+        F: FnMut(CartesianState),
+    {
+        if observer_frame == target_frame {
+            epochs.for_each(|epoch| emit(CartesianState::zero_at_epoch(epoch, observer_frame)));
+            return Ok(());
+        }
+
+        // If there is no frame info, the user hasn't loaded this frame, but might still want to compute a translation.
+        observer_frame = self.loaded_frame_info(observer_frame);
+        let frame = observer_frame.with_orient(target_frame.orientation_id);
+
+        if let Some(ab_corr) = ab_corr {
+            // Both the observer and the target keep their segments across epochs and light time iterations.
+            let mut observer = SsbTranslation::new(self, observer_frame);
+            let mut target = SsbTranslation::new(self, target_frame);
+            for epoch in epochs {
+                let obs_ssb = observer.evaluate(epoch)?;
+                let (radius_km, velocity_km_s) =
+                    target.light_time_corrected(obs_ssb, epoch, ab_corr)?;
+
+                emit(CartesianState {
+                    radius_km,
+                    velocity_km_s,
+                    epoch,
+                    frame,
+                });
+            }
+            return Ok(());
+        }
+
+        let mut plan: Option<TranslationPlan> = None;
+        for epoch in epochs {
+            if !plan.as_ref().map_or(false, |plan| plan.is_valid_at(epoch)) {
+                plan = Some(self.translation_plan(target_frame, observer_frame, epoch)?);
+            }
+
+            let (radius_km, velocity_km_s) = plan.as_ref().unwrap().evaluate(epoch)?;
+
+            emit(CartesianState {
+                radius_km,
+                velocity_km_s,
+                epoch,
+                frame,
+            });
+        }
+
+        Ok(())
+    }
+
+    /// Returns the Cartesian states of each of the target frames as seen from the observer frame at the provided epoch, and optionally given the aberration correction.
+    ///
+    /// This returns the same states as calling `translate` for each target, but the state of the observer with respect to the
+    /// solar system barycenter, needed for the aberration corrections, is only computed once for all of the targets.
+    ///
+    /// # Warning
+    /// This function only performs the translation and no rotation whatsoever. Use the `transform` function instead to include rotations.
+    pub fn translate_targets(
+        &self,
+        target_frames: &[Frame],
+        observer_frame: Frame,
+        epoch: Epoch,
+        ab_corr: Option<Aberration>,
+    ) -> Result<Vec<CartesianState>, EphemerisError> {
+        let ab_corr = match ab_corr {
+            Some(ab_corr) => ab_corr,
+            None => {
+                return target_frames
+                    .iter()
+                    .map(|target_frame| self.translate(*target_frame, observer_frame, epoch, None))
+                    .collect()
+            }
+        };
+
+        // If there is no frame info, the user hasn't loaded this frame, but might still want to compute a translation.
+        let resolved_observer_frame = self.loaded_frame_info(observer_frame);
+
+        let mut observer_ssb = None;
+        let mut states = Vec::with_capacity(target_frames.len());
+        for target_frame in target_frames {
+            if *target_frame == observer_frame {
+                states.push(CartesianState::zero(observer_frame));
+                continue;
+            }
+
+            let obs_ssb = match observer_ssb {
+                Some(obs_ssb) => obs_ssb,
+                None => *observer_ssb
+                    .insert(SsbTranslation::new(self, resolved_observer_frame).evaluate(epoch)?),
+            };
+
+            let (radius_km, velocity_km_s) = SsbTranslation::new(self, *target_frame)
+                .light_time_corrected(obs_ssb, epoch, ab_corr)?;
+
+            states.push(CartesianState {
+                radius_km,
+                velocity_km_s,
+                epoch,
+                frame: resolved_observer_frame.with_orient(target_frame.orientation_id),
+            });
+        }
+
+        Ok(states)
+    }
+
     /// Translates a state with its origin (`to_frame`) and given its units (distance_unit, time_unit), returns that state with respect to the requested frame
     ///
     /// **WARNING:** This function only performs the translation and no rotation _whatsoever_. Use the `transform_state_to` function instead to include rotations.
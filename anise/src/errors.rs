@@ -110,6 +110,8 @@ pub enum DecodingError {
 pub enum IntegrityError {
     /// Data checksum differs from expected checksum
     ChecksumInvalid { expected: u32, computed: u32 },
+    /// Data length differs from the length of the data whose checksums were recorded
+    LengthMismatch { expected: usize, computed: usize },
     /// Data between two ephemerides expected to be identical mismatch (may happen on merger of files)
     DataMismatchOnMerge,
     /// Could not fetch spline data that was expected to be there
@@ -45,6 +45,7 @@ pub mod prelude {
     #[cfg(feature = "metaload")]
     pub use crate::almanac::metaload::MetaAlmanac;
 
+    pub use crate::almanac::shared::SharedAlmanac;
     pub use crate::almanac::Almanac;
     pub use crate::astro::{orbit::Orbit, Aberration};
     pub use crate::errors::InputOutputError;
@@ -86,6 +87,30 @@ macro_rules! file2heap {
     };
 }
 
+/// Memory maps a file and returns a zero-copy `Bytes` view of the mapped pages.
+///
+/// The memory map is owned by the returned `Bytes` and is only unmapped once the last clone of these bytes is dropped.
+/// Several processes mapping the same file therefore share a single copy in the page cache.
+///
+/// # Safety
+/// This macro must be expanded in an `unsafe` block: the file must not be modified or truncated while it is mapped, cf. `memmap2::Mmap`.
+#[macro_export]
+macro_rules! file2mmap {
+    ($filename:tt) => {
+        match File::open($filename) {
+            Err(e) => Err(InputOutputError::IOError { kind: e.kind() }),
+            Ok(file) => {
+                use bytes::Bytes;
+                use memmap2::MmapOptions;
+                match MmapOptions::new().map(&file) {
+                    Err(_) => Err(InputOutputError::IOUnknownError),
+                    Ok(mmap) => Ok(Bytes::from_owner(mmap)),
+                }
+            }
+        }
+    };
+}
+
 /// Memory maps a file and **copies** the data on the heap prior to returning a pointer to this heap data.
 #[macro_export]
 macro_rules! file_mmap {
@@ -11,9 +11,11 @@
 // This file contains Python specific helper functions that don't fit anywhere else.
 
 use super::cartesian::CartesianState;
+use crate::astro::StateBatch;
 use crate::prelude::Frame;
 use hifitime::Epoch;
-use pyo3::exceptions::PyTypeError;
+use numpy::{PyArray2, PyArrayMethods, PyReadonlyArray2, PyUntypedArrayMethods};
+use pyo3::exceptions::{PyTypeError, PyValueError};
 use pyo3::prelude::*;
 use pyo3::pyclass::CompareOp;
 use pyo3::types::PyType;
@@ -162,4 +164,90 @@ impl CartesianState {
             self.frame,
         ))
     }
+
+    /// Computes the Keplerian orbital elements of many states in the provided frame, provided as the rows of an (N, 6) float64
+    /// array of X, Y, Z (km), VX, VY, VZ (km/s).
+    ///
+    /// Returns an (N, 6) array of SMA (km), ECC, INC (deg), RAAN (deg), AOP (deg), and TA (deg), where the elements of
+    /// degenerate states are NaN. The GIL is released during the computation.
+    #[staticmethod]
+    fn keplerian_many<'py>(
+        py: Python<'py>,
+        states: PyReadonlyArray2<'py, f64>,
+        frame: Frame,
+    ) -> PyResult<Bound<'py, PyArray2<f64>>> {
+        let batch = batch_from_rows(&states, frame)?;
+        let kep = py.allow_threads(|| batch.keplerian())?;
+        rows_from_columns(
+            py,
+            &[
+                &kep.sma_km,
+                &kep.ecc,
+                &kep.inc_deg,
+                &kep.raan_deg,
+                &kep.aop_deg,
+                &kep.ta_deg,
+            ],
+        )
+    }
+
+    /// Computes the geodetic latitude (deg), longitude (deg), and height (km) of many states in the provided body fixed frame,
+    /// provided as the rows of an (N, 6) float64 array as for `keplerian_many`. Returns an (N, 3) array.
+    #[staticmethod]
+    fn latlongalt_many<'py>(
+        py: Python<'py>,
+        states: PyReadonlyArray2<'py, f64>,
+        frame: Frame,
+    ) -> PyResult<Bound<'py, PyArray2<f64>>> {
+        let batch = batch_from_rows(&states, frame)?;
+        let geo = py.allow_threads(|| batch.latlongalt())?;
+        rows_from_columns(py, &[&geo.latitude_deg, &geo.longitude_deg, &geo.height_km])
+    }
+}
+
+/// Builds a batch of states from the rows of an (N, 6) array. Epochs are not used by the conversions and are set to J2000.
+fn batch_from_rows(states: &PyReadonlyArray2<'_, f64>, frame: Frame) -> PyResult<StateBatch> {
+    if states.shape()[1] != 6 {
+        return Err(PyValueError::new_err(format!(
+            "states must have shape (N, 6) but have shape {:?}",
+            states.shape()
+        )));
+    }
+    let rows = states.as_slice()?;
+    let column = |k: usize| {
+        rows.iter()
+            .skip(k)
+            .step_by(6)
+            .copied()
+            .collect::<Vec<f64>>()
+    };
+    Ok(StateBatch::from_columns(
+        frame,
+        vec![Epoch::from_tdb_seconds(0.0); rows.len() / 6],
+        column(0),
+        column(1),
+        column(2),
+        column(3),
+        column(4),
+        column(5),
+    )
+    .unwrap())
+}
+
+/// Builds an (N, K) array from K columns of N values.
+fn rows_from_columns<'py>(
+    py: Python<'py>,
+    columns: &[&Vec<f64>],
+) -> PyResult<Bound<'py, PyArray2<f64>>> {
+    let num_rows = columns.first().map_or(0, |column| column.len());
+    let out = PyArray2::zeros_bound(py, [num_rows, columns.len()], false);
+    {
+        let mut rows = out.readwrite();
+        for (n, row) in rows.as_slice_mut()?.chunks_mut(columns.len()).enumerate() {
+            for (value, column) in row.iter_mut().zip(columns) {
+                *value = column[n];
+            }
+        }
+    }
+    Ok(out)
 }
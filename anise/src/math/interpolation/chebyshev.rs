@@ -9,6 +9,7 @@
  */
 
 use crate::errors::MathError;
+use crate::math::Vector3;
 
 use hifitime::Epoch;
 
@@ -57,3 +58,164 @@ pub fn chebyshev_eval(
     let deriv = (w[0] + normalized_time * dw[0] - dw[1]) / spline_radius_s;
     Ok((val, deriv))
 }
+
+/// Evaluates the three Chebyshev polynomials of a position (e.g. X, Y, Z coefficients) at once, returning the values and their derivatives.
+///
+/// This is equivalent to calling [chebyshev_eval] on each component, but the three Clenshaw recurrences are run together
+/// over fixed size arrays, and the lengths of the coefficients are checked once before the recurrence. This removes all of the
+/// branches from the inner loop and lets the compiler vectorize it. The results are identical to [chebyshev_eval].
+///
+/// # Notes
+/// 1. At this point, the splines are expected to be in Chebyshev format and no verification is done.
+#[allow(clippy::needless_range_loop)]
+pub fn chebyshev_eval_xyz(
+    normalized_time: f64,
+    spline_coeffs: [&[f64]; 3],
+    spline_radius_s: f64,
+    eval_epoch: Epoch,
+    degree: usize,
+) -> Result<(Vector3, Vector3), InterpolationError> {
+    if spline_radius_s.abs() < f64::EPSILON {
+        return Err(InterpolationError::InterpMath {
+            source: MathError::DivisionByZero {
+                action: "spline radius in Chebyshev eval is zero",
+            },
+        });
+    }
+
+    let num_coeffs = degree + 1;
+    let [x_coeffs, y_coeffs, z_coeffs] = spline_coeffs;
+    if x_coeffs.len() < num_coeffs || y_coeffs.len() < num_coeffs || z_coeffs.len() < num_coeffs {
+        return Err(InterpolationError::MissingInterpolationData { epoch: eval_epoch });
+    }
+    // Reslicing to the exact length allows the compiler to elide the bounds checks.
+    let x_coeffs = &x_coeffs[..num_coeffs];
+    let y_coeffs = &y_coeffs[..num_coeffs];
+    let z_coeffs = &z_coeffs[..num_coeffs];
+
+    // Workspace arrays, one lane per component
+    let mut w0 = [0.0_f64; 3];
+    let mut w1 = [0.0_f64; 3];
+    let mut w2 = [0.0_f64; 3];
+    let mut dw0 = [0.0_f64; 3];
+    let mut dw1 = [0.0_f64; 3];
+    let mut dw2 = [0.0_f64; 3];
+
+    let two_t = 2.0 * normalized_time;
+
+    for ((x, y), z) in x_coeffs[1..]
+        .iter()
+        .rev()
+        .zip(y_coeffs[1..].iter().rev())
+        .zip(z_coeffs[1..].iter().rev())
+    {
+        let coeff = [*x, *y, *z];
+        for k in 0..3 {
+            w2[k] = w1[k];
+            w1[k] = w0[k];
+            w0[k] = coeff[k] + (two_t * w1[k] - w2[k]);
+
+            dw2[k] = dw1[k];
+            dw1[k] = dw0[k];
+            dw0[k] = w1[k] * 2. + dw1[k] * two_t - dw2[k];
+        }
+    }
+
+    let first = [x_coeffs[0], y_coeffs[0], z_coeffs[0]];
+    let mut val = Vector3::zeros();
+    let mut deriv = Vector3::zeros();
+    for k in 0..3 {
+        val[k] = first[k] + (normalized_time * w0[k] - w1[k]);
+        deriv[k] = (w0[k] + normalized_time * dw0[k] - dw1[k]) / spline_radius_s;
+    }
+
+    Ok((val, deriv))
+}
+
+/// Returns the Chebyshev nodes of the first kind in the normalized time `[-1, 1]` used to fit a polynomial of the provided degree.
+///
+/// The nodes are in decreasing order, i.e. from 1 to -1.
+pub fn chebyshev_nodes(degree: usize) -> Vec<f64> {
+    let num = (degree + 1) as f64;
+    (0..=degree)
+        .map(|k| (core::f64::consts::PI * (k as f64 + 0.5) / num).cos())
+        .collect()
+}
+
+/// Computes the coefficients of the Chebyshev polynomial interpolating the provided values at the nodes from [chebyshev_nodes].
+///
+/// The coefficients are in the format expected by [chebyshev_eval], where the degree is the number of values minus one.
+pub fn chebyshev_fit(values_at_nodes: &[f64]) -> Vec<f64> {
+    let num = values_at_nodes.len();
+    (0..num)
+        .map(|j| {
+            let sum: f64 = values_at_nodes
+                .iter()
+                .enumerate()
+                .map(|(k, value)| {
+                    value * (core::f64::consts::PI * j as f64 * (k as f64 + 0.5) / num as f64).cos()
+                })
+                .sum();
+            if j == 0 {
+                sum / num as f64
+            } else {
+                2.0 * sum / num as f64
+            }
+        })
+        .collect()
+}
+
+#[cfg(test)]
+mod ut_chebyshev {
+    use super::*;
+
+    #[test]
+    fn fused_matches_scalar() {
+        let epoch = Epoch::from_et_seconds(0.0);
+        let x = [1.5, -0.25, 3e-3, 4.1e-5, -7.7e-7, 2e-9];
+        let y = [-2.5, 0.75, -1e-2, 6.3e-5, 1.1e-6, -3e-9];
+        let z = [0.5, 0.1, 5e-3, -2.2e-5, 9.9e-7, 1e-10];
+        let radius_s = 43_200.0;
+
+        for degree in 0..x.len() {
+            for normalized_time in [-1.0, -0.33, 0.0, 0.5, 1.0] {
+                let (val, deriv) =
+                    chebyshev_eval_xyz(normalized_time, [&x, &y, &z], radius_s, epoch, degree)
+                        .unwrap();
+                for (k, coeffs) in [&x, &y, &z].iter().enumerate() {
+                    let (exp_val, exp_deriv) =
+                        chebyshev_eval(normalized_time, *coeffs, radius_s, epoch, degree).unwrap();
+                    assert_eq!(val[k], exp_val);
+                    assert_eq!(deriv[k], exp_deriv);
+                }
+            }
+        }
+
+        assert_eq!(
+            chebyshev_eval_xyz(0.0, [&x, &y, &z[..2]], radius_s, epoch, 4),
+            Err(InterpolationError::MissingInterpolationData { epoch })
+        );
+        assert!(chebyshev_eval_xyz(0.0, [&x, &y, &z], 0.0, epoch, 4).is_err());
+    }
+
+    #[test]
+    fn fit_polynomial() {
+        let epoch = Epoch::from_et_seconds(0.0);
+        // A cubic is fitted exactly by a polynomial of degree three or more.
+        let cubic = |t: f64| 2.0 - 3.0 * t + 0.5 * t.powi(2) + 1.25 * t.powi(3);
+        let cubic_dt = |t: f64| -3.0 + t + 3.75 * t.powi(2);
+        let radius_s = 600.0;
+
+        for degree in [3, 4, 9] {
+            let nodes = chebyshev_nodes(degree);
+            assert_eq!(nodes.len(), degree + 1);
+            let coeffs = chebyshev_fit(&nodes.iter().map(|t| cubic(*t)).collect::<Vec<_>>());
+
+            for t in [-1.0, -0.5, 0.0, 0.3, 1.0] {
+                let (val, deriv) = chebyshev_eval(t, &coeffs, radius_s, epoch, degree).unwrap();
+                assert!((val - cubic(t)).abs() < 1e-12);
+                assert!((deriv - cubic_dt(t) / radius_s).abs() < 1e-12);
+            }
+        }
+    }
+}
@@ -11,11 +11,13 @@
 mod chebyshev;
 mod hermite;
 mod lagrange;
+mod newton;
 
-pub use chebyshev::chebyshev_eval;
+pub use chebyshev::{chebyshev_eval, chebyshev_eval_xyz, chebyshev_fit, chebyshev_nodes};
 pub use hermite::hermite_eval;
 use hifitime::Epoch;
 pub use lagrange::lagrange_eval;
+pub use newton::NewtonPolynomial;
 use snafu::Snafu;
 
 use crate::errors::{DecodingError, MathError};
@@ -56,4 +58,12 @@ pub enum InterpolationError {
         "{dataset} is not yet supported -- https://github.com/nyx-space/anise/issues/{issue}"
     ))]
     UnimplementedType { issue: u32, dataset: &'static str },
+    #[snafu(display(
+        "Chebyshev fit of degree {degree} over {num_records} records reached {error_ratio} times the tolerance"
+    ))]
+    FitTolerance {
+        degree: usize,
+        num_records: usize,
+        error_ratio: f64,
+    },
 }
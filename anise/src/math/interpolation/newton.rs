@@ -0,0 +1,183 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use crate::errors::MathError;
+
+use super::{InterpolationError, MAX_SAMPLES};
+
+/// An interpolating polynomial stored in its Newton form, i.e. its nodes and divided differences.
+///
+/// Building it costs O(n²), like a single call to `lagrange_eval` or `hermite_eval`, but then every evaluation is a Horner pass in O(n).
+/// This is worth it when the same interpolation window is evaluated many times.
+/// The result matches `lagrange_eval` and `hermite_eval` up to rounding errors, but is not bit-for-bit identical.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct NewtonPolynomial {
+    len: usize,
+    nodes: [f64; 2 * MAX_SAMPLES],
+    coeffs: [f64; 2 * MAX_SAMPLES],
+}
+
+impl NewtonPolynomial {
+    /// Builds the Lagrange interpolation of the ordinates (ys) at the abscissas (xs), as `lagrange_eval` does.
+    pub fn lagrange(xs: &[f64], ys: &[f64]) -> Result<Self, InterpolationError> {
+        if xs.len() != ys.len() {
+            return Err(InterpolationError::CorruptedData {
+                what: "lengths of abscissas (xs) and ordinates (ys) differ",
+            });
+        }
+        Self::check_len(xs)?;
+
+        let n = xs.len();
+        let mut me = Self {
+            len: n,
+            nodes: [0.0; 2 * MAX_SAMPLES],
+            coeffs: [0.0; 2 * MAX_SAMPLES],
+        };
+        me.nodes[..n].copy_from_slice(xs);
+        me.coeffs[..n].copy_from_slice(ys);
+
+        for j in 1..n {
+            for i in (j..n).rev() {
+                let denom = me.nodes[i] - me.nodes[i - j];
+                if denom.abs() < f64::EPSILON {
+                    return Err(InterpolationError::InterpMath {
+                        source: MathError::DivisionByZero {
+                            action: "lagrange data contains duplicate states",
+                        },
+                    });
+                }
+                me.coeffs[i] = (me.coeffs[i] - me.coeffs[i - 1]) / denom;
+            }
+        }
+
+        Ok(me)
+    }
+
+    /// Builds the Hermite interpolation of the ordinates (ys) and first derivatives (ydots) at the abscissas (xs), as `hermite_eval` does.
+    pub fn hermite(xs: &[f64], ys: &[f64], ydots: &[f64]) -> Result<Self, InterpolationError> {
+        if xs.len() != ys.len() || xs.len() != ydots.len() {
+            return Err(InterpolationError::CorruptedData {
+                what: "lengths of abscissas (xs), ordinates (ys), and first derivatives (ydots) differ",
+            });
+        }
+        Self::check_len(xs)?;
+
+        // Each abscissa is a node of multiplicity two.
+        let n = 2 * xs.len();
+        let mut me = Self {
+            len: n,
+            nodes: [0.0; 2 * MAX_SAMPLES],
+            coeffs: [0.0; 2 * MAX_SAMPLES],
+        };
+        for (i, (x, y)) in xs.iter().zip(ys.iter()).enumerate() {
+            me.nodes[2 * i] = *x;
+            me.nodes[2 * i + 1] = *x;
+            me.coeffs[2 * i] = *y;
+            me.coeffs[2 * i + 1] = *y;
+        }
+
+        for j in 1..n {
+            for i in (j..n).rev() {
+                if j == 1 && i % 2 == 1 {
+                    // Divided difference of a repeated node is the derivative at that node.
+                    me.coeffs[i] = ydots[i / 2];
+                    continue;
+                }
+                let denom = me.nodes[i] - me.nodes[i - j];
+                if denom.abs() < f64::EPSILON {
+                    return Err(InterpolationError::InterpMath {
+                        source: MathError::DivisionByZero {
+                            action: "hermite data contains duplicate states",
+                        },
+                    });
+                }
+                me.coeffs[i] = (me.coeffs[i] - me.coeffs[i - 1]) / denom;
+            }
+        }
+
+        Ok(me)
+    }
+
+    fn check_len(xs: &[f64]) -> Result<(), InterpolationError> {
+        if xs.is_empty() {
+            Err(InterpolationError::CorruptedData {
+                what: "list of abscissas (xs) is empty",
+            })
+        } else if xs.len() > MAX_SAMPLES {
+            Err(InterpolationError::CorruptedData {
+                what: "list of abscissas (xs) contains more items than MAX_SAMPLES (32)",
+            })
+        } else {
+            Ok(())
+        }
+    }
+
+    /// Evaluates this polynomial and its first derivative at the requested abscissa.
+    pub fn eval(&self, x_eval: f64) -> (f64, f64) {
+        let mut f = self.coeffs[self.len - 1];
+        let mut df = 0.0;
+        for k in (0..self.len - 1).rev() {
+            let dx = x_eval - self.nodes[k];
+            df = df * dx + f;
+            f = f * dx + self.coeffs[k];
+        }
+        (f, df)
+    }
+}
+
+#[cfg(test)]
+mod ut_newton {
+    use super::super::{hermite_eval, lagrange_eval};
+    use super::*;
+
+    fn assert_close(got: f64, want: f64) {
+        assert!(
+            (got - want).abs() <= 1e-12 * want.abs().max(1.0),
+            "got {got} but want {want}"
+        );
+    }
+
+    #[test]
+    fn lagrange_matches_neville() {
+        let ts = [-1.0, 0.0, 3.0, 5.0];
+        let yvals = [-2.0, -7.0, -8.0, 26.0];
+        let poly = NewtonPolynomial::lagrange(&ts, &yvals).unwrap();
+
+        for t in [-1.0, -0.5, 0.0, 2.0, 3.0, 4.99, 5.0] {
+            let (f, df) = poly.eval(t);
+            let (want_f, want_df) = lagrange_eval(&ts, &yvals, t).unwrap();
+            assert_close(f, want_f);
+            assert_close(df, want_df);
+        }
+
+        assert!(NewtonPolynomial::lagrange(&[0.0, 0.0], &[1.0, 2.0]).is_err());
+        assert!(NewtonPolynomial::lagrange(&[], &[]).is_err());
+    }
+
+    #[test]
+    fn hermite_matches_neville() {
+        let ts = [-1.0, 0.0, 3.0, 5.0];
+        let yvals = [6.0, 5.0, 2210.0, 78180.0];
+        let ydotvals = [3.0, 0.0, 5115.0, 109395.0];
+        let poly = NewtonPolynomial::hermite(&ts, &yvals, &ydotvals).unwrap();
+
+        for t in [-1.0, -0.5, 0.0, 2.0, 3.0, 4.99, 5.0] {
+            let (f, df) = poly.eval(t);
+            let (want_f, want_df) = hermite_eval(&ts, &yvals, &ydotvals, t).unwrap();
+            assert_close(f, want_f);
+            assert_close(df, want_df);
+        }
+
+        // SPICE documentation example
+        let (x, vx) = poly.eval(2.0);
+        assert_close(x, 141.0);
+        assert_close(vx, 456.0);
+    }
+}
@@ -257,11 +257,13 @@ impl Mul<&CartesianState> for DCM {
                 state_frame: rhs.frame
             }
         );
-        let new_state = self.state_dcm() * rhs.to_cartesian_pos_vel();
-
+        // Apply the blocks of the 6x6 state DCM directly, where the velocity includes the transport theorem.
         let mut rslt = *rhs;
-        rslt.radius_km = new_state.fixed_rows::<3>(0).to_owned().into();
-        rslt.velocity_km_s = new_state.fixed_rows::<3>(3).to_owned().into();
+        rslt.radius_km = self.rot_mat * rhs.radius_km;
+        rslt.velocity_km_s = match self.rot_mat_dt {
+            Some(rot_mat_dt) => rot_mat_dt * rhs.radius_km + self.rot_mat * rhs.velocity_km_s,
+            None => self.rot_mat * rhs.velocity_km_s,
+        };
         rslt.frame.orientation_id = self.to;
 
         Ok(rslt)
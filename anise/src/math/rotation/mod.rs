@@ -58,6 +58,63 @@ pub fn r3_dot(angle_rad: f64) -> Matrix3 {
     Matrix3::new(-s, c, 0.0, -c, -s, 0.0, 0.0, 0.0, 0.0)
 }
 
+/// Build the 3x3 rotation matrix of the 3-1-3 Euler sequence, i.e. `r3(third_rad) * r1(second_rad) * r3(first_rad)`, computing each sine and cosine once.
+pub fn r3r1r3(first_rad: f64, second_rad: f64, third_rad: f64) -> Matrix3 {
+    let (s1, c1) = first_rad.sin_cos();
+    let (s2, c2) = second_rad.sin_cos();
+    let (s3, c3) = third_rad.sin_cos();
+    Matrix3::new(
+        c3 * c1 - s3 * c2 * s1,
+        c3 * s1 + s3 * c2 * c1,
+        s3 * s2,
+        -s3 * c1 - c3 * c2 * s1,
+        -s3 * s1 + c3 * c2 * c1,
+        c3 * s2,
+        s2 * s1,
+        -s2 * c1,
+        c2,
+    )
+}
+
+/// Build the 3x3 rotation matrix of the 3-1-3 Euler sequence, as [r3r1r3], and its time derivative given the rate of each angle.
+///
+/// This is equivalent to, but much cheaper than, summing the three products of `r3_dot` and `r1_dot` with the other two rotations.
+pub fn r3r1r3_with_dot(angles_rad: [f64; 3], rates_rad_s: [f64; 3]) -> (Matrix3, Matrix3) {
+    let [first_rad, second_rad, third_rad] = angles_rad;
+    let [first_dot, second_dot, third_dot] = rates_rad_s;
+    let (s1, c1) = first_rad.sin_cos();
+    let (s2, c2) = second_rad.sin_cos();
+    let (s3, c3) = third_rad.sin_cos();
+
+    // Rows of the rotation matrix
+    let row0 = [c3 * c1 - s3 * c2 * s1, c3 * s1 + s3 * c2 * c1, s3 * s2];
+    let row1 = [-s3 * c1 - c3 * c2 * s1, -s3 * s1 + c3 * c2 * c1, c3 * s2];
+    let row2 = [s2 * s1, -s2 * c1, c2];
+    // Partial derivative of the last row with respect to the second angle, while those of the first two rows are proportional to the last row.
+    let d_row2 = [c2 * s1, -c2 * c1, -s2];
+
+    let mut rot_mat = Matrix3::zeros();
+    let mut rot_mat_dt = Matrix3::zeros();
+    for j in 0..3 {
+        rot_mat[(0, j)] = row0[j];
+        rot_mat[(1, j)] = row1[j];
+        rot_mat[(2, j)] = row2[j];
+
+        // The partial derivative with respect to the first angle moves column 1 into column 0 and minus column 0 into column 1.
+        let (d1_0, d1_1, d1_2) = match j {
+            0 => (-row0[1], -row1[1], -row2[1]),
+            1 => (row0[0], row1[0], row2[0]),
+            _ => (0.0, 0.0, 0.0),
+        };
+        // The partial derivative with respect to the third angle moves row 1 into row 0 and minus row 0 into row 1.
+        rot_mat_dt[(0, j)] = first_dot * d1_0 + second_dot * s3 * row2[j] + third_dot * row1[j];
+        rot_mat_dt[(1, j)] = first_dot * d1_1 + second_dot * c3 * row2[j] - third_dot * row0[j];
+        rot_mat_dt[(2, j)] = first_dot * d1_2 + second_dot * d_row2[j];
+    }
+
+    (rot_mat, rot_mat_dt)
+}
+
 /// Generates the angles for the test
 #[cfg(test)]
 pub(crate) fn generate_angles() -> Vec<f64> {
@@ -83,3 +140,28 @@ pub(crate) fn vec3_eq(a: Vector3, b: Vector3, msg: String) {
     let rslt = (a - b).norm();
     assert!(rslt < 1e-3, "{msg}:{rslt:.e}\ta = {a}\tb = {b}")
 }
+
+#[cfg(test)]
+mod ut_rotation {
+    use super::*;
+
+    #[test]
+    fn fused_euler_313() {
+        let angles = generate_angles();
+        for (n, first) in angles.iter().enumerate().step_by(7) {
+            let second = angles[(3 * n + 11) % angles.len()];
+            let third = angles[(5 * n + 29) % angles.len()];
+            let rates = [1.1e-3, -7.3e-4, 7.292e-5];
+
+            let expected = r3(third) * r1(second) * r3(*first);
+            let expected_dt = rates[2] * r3_dot(third) * r1(second) * r3(*first)
+                + rates[1] * r3(third) * r1_dot(second) * r3(*first)
+                + rates[0] * r3(third) * r1(second) * r3_dot(*first);
+
+            let (rot_mat, rot_mat_dt) = r3r1r3_with_dot([*first, second, third], rates);
+            assert!((rot_mat - expected).norm() < EPSILON);
+            assert!((rot_mat_dt - expected_dt).norm() < EPSILON);
+            assert!((r3r1r3(*first, second, third) - expected).norm() < EPSILON);
+        }
+    }
+}
@@ -0,0 +1,293 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::ops::Range;
+use core::sync::atomic::{AtomicBool, Ordering};
+use crc32fast::Hasher;
+use log::error;
+
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+
+use crate::errors::IntegrityError;
+
+/// Computes the CRC32 of the provided bytes, hashing blocks of [BlockChecksums::DEFAULT_BLOCK_SIZE] in parallel with the `parallel` feature.
+///
+/// This is the same value as `crc32fast::hash(bytes)`.
+pub fn crc32(bytes: &[u8]) -> u32 {
+    if bytes.len() <= BlockChecksums::DEFAULT_BLOCK_SIZE {
+        crc32fast::hash(bytes)
+    } else {
+        BlockChecksums::compute(bytes).crc32()
+    }
+}
+
+/// The CRC32 of each block of a file, such that parts of a large file can be verified independently.
+///
+/// The table is built in parallel when the `parallel` feature is enabled, and the CRC32 of the whole file is derived
+/// from the table without hashing the data again. A table computed once (e.g. when a kernel is first downloaded) can be
+/// stored by the caller and provided back to verify a file lazily, cf. [crate::naif::daf::DAF::from_bytes_lazy].
+#[derive(Clone, Debug, PartialEq, Eq, Hash)]
+pub struct BlockChecksums {
+    block_size: usize,
+    len: usize,
+    checksums: Vec<u32>,
+}
+
+impl BlockChecksums {
+    /// Default size of each block, a multiple of the DAF record length.
+    pub const DEFAULT_BLOCK_SIZE: usize = 1 << 20;
+
+    /// Computes the checksum table of the provided bytes with the default block size.
+    pub fn compute(bytes: &[u8]) -> Self {
+        Self::with_block_size(bytes, Self::DEFAULT_BLOCK_SIZE)
+    }
+
+    /// Computes the checksum table of the provided bytes with the provided block size.
+    ///
+    /// # Panics
+    /// If the block size is zero.
+    pub fn with_block_size(bytes: &[u8], block_size: usize) -> Self {
+        assert!(block_size > 0, "block size must be strictly positive");
+
+        #[cfg(feature = "parallel")]
+        let checksums = bytes.par_chunks(block_size).map(crc32fast::hash).collect();
+        #[cfg(not(feature = "parallel"))]
+        let checksums = bytes.chunks(block_size).map(crc32fast::hash).collect();
+
+        Self {
+            block_size,
+            len: bytes.len(),
+            checksums,
+        }
+    }
+
+    /// Rebuilds a checksum table previously recorded, returns None if the number of checksums does not match the length of the data.
+    pub fn from_parts(block_size: usize, len: usize, checksums: Vec<u32>) -> Option<Self> {
+        if block_size == 0 || checksums.len() != len.div_ceil(block_size) {
+            None
+        } else {
+            Some(Self {
+                block_size,
+                len,
+                checksums,
+            })
+        }
+    }
+
+    /// Size of each block in bytes, only the last block may be shorter.
+    pub fn block_size(&self) -> usize {
+        self.block_size
+    }
+
+    /// Length in bytes of the data of this table.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns true if this table is for empty data.
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// The CRC32 of each block.
+    pub fn checksums(&self) -> &[u32] {
+        &self.checksums
+    }
+
+    /// Returns the CRC32 of the whole data, combined from the checksum of each block.
+    pub fn crc32(&self) -> u32 {
+        let mut hasher = Hasher::new();
+        for (block, checksum) in self.checksums.iter().enumerate() {
+            let block_len = self.block_range(block).len() as u64;
+            hasher.combine(&Hasher::new_with_initial_len(*checksum, block_len));
+        }
+        hasher.finalize()
+    }
+
+    /// Verifies the provided bytes against this table, hashing the blocks in parallel with the `parallel` feature.
+    pub fn verify(&self, bytes: &[u8]) -> Result<(), IntegrityError> {
+        self.check_len(bytes)?;
+
+        let computed = Self::with_block_size(bytes, self.block_size);
+        match self
+            .checksums
+            .iter()
+            .zip(&computed.checksums)
+            .find(|(expected, computed)| expected != computed)
+        {
+            Some((expected, computed)) => Err(IntegrityError::ChecksumInvalid {
+                expected: *expected,
+                computed: *computed,
+            }),
+            None => Ok(()),
+        }
+    }
+
+    /// Verifies a single block of the provided bytes against this table.
+    pub fn verify_block(&self, bytes: &[u8], block: usize) -> Result<(), IntegrityError> {
+        let expected = *self
+            .checksums
+            .get(block)
+            .ok_or(IntegrityError::DataMissing)?;
+        let computed = crc32fast::hash(
+            bytes
+                .get(self.block_range(block))
+                .ok_or(IntegrityError::DataMissing)?,
+        );
+        if computed == expected {
+            Ok(())
+        } else {
+            error!("[integrity] block {block}: expected hash {expected} but computed {computed}");
+            Err(IntegrityError::ChecksumInvalid { expected, computed })
+        }
+    }
+
+    /// Returns an error if the provided bytes do not have the length of the data of this table.
+    pub(crate) fn check_len(&self, bytes: &[u8]) -> Result<(), IntegrityError> {
+        if bytes.len() == self.len {
+            Ok(())
+        } else {
+            Err(IntegrityError::LengthMismatch {
+                expected: self.len,
+                computed: bytes.len(),
+            })
+        }
+    }
+
+    /// Byte range of the provided block.
+    fn block_range(&self, block: usize) -> Range<usize> {
+        let start = block * self.block_size;
+        start..(start + self.block_size).min(self.len)
+    }
+
+    /// Blocks which contain the provided byte range.
+    fn blocks_of(&self, bytes: Range<usize>) -> Range<usize> {
+        if bytes.is_empty() {
+            0..0
+        } else {
+            bytes.start / self.block_size..(bytes.end - 1) / self.block_size + 1
+        }
+    }
+}
+
+/// Verifies each block of a file against its recorded checksum the first time that block is accessed.
+///
+/// Once a block was verified successfully, it is not verified again. All clones of a lazily verified DAF share this state.
+#[derive(Debug)]
+pub struct LazyIntegrity {
+    expected: BlockChecksums,
+    verified: Vec<AtomicBool>,
+}
+
+impl LazyIntegrity {
+    pub fn new(expected: BlockChecksums) -> Self {
+        let verified = (0..expected.checksums.len())
+            .map(|_| AtomicBool::new(false))
+            .collect();
+        Self { expected, verified }
+    }
+
+    /// The recorded checksum table.
+    pub fn expected(&self) -> &BlockChecksums {
+        &self.expected
+    }
+
+    /// Number of blocks which have been verified so far.
+    pub fn num_verified(&self) -> usize {
+        self.verified
+            .iter()
+            .filter(|verified| verified.load(Ordering::Relaxed))
+            .count()
+    }
+
+    /// Verifies the blocks containing the provided range of the bytes, unless they were already verified.
+    pub fn verify_range(&self, bytes: &[u8], range: Range<usize>) -> Result<(), IntegrityError> {
+        for block in self.expected.blocks_of(range) {
+            if let Some(verified) = self.verified.get(block) {
+                if !verified.load(Ordering::Acquire) {
+                    self.expected.verify_block(bytes, block)?;
+                    verified.store(true, Ordering::Release);
+                }
+            }
+        }
+        Ok(())
+    }
+}
+
+impl PartialEq for LazyIntegrity {
+    /// Only the recorded checksums are compared, regardless of which blocks were already verified.
+    fn eq(&self, other: &Self) -> bool {
+        self.expected == other.expected
+    }
+}
+
+#[cfg(test)]
+mod ut_checksum {
+    use super::*;
+
+    #[test]
+    fn combined_crc32() {
+        let bytes: Vec<u8> = (0..10_000_u32).map(|i| (i * 7 % 251) as u8).collect();
+        let expected = crc32fast::hash(&bytes);
+
+        for block_size in [1, 1024, 3000, 10_000, 20_000] {
+            let table = BlockChecksums::with_block_size(&bytes, block_size);
+            assert_eq!(table.checksums().len(), bytes.len().div_ceil(block_size));
+            assert_eq!(table.crc32(), expected, "block size {block_size}");
+            assert!(table.verify(&bytes).is_ok());
+        }
+
+        assert_eq!(crc32(&bytes), expected);
+        assert_eq!(BlockChecksums::compute(&[]).crc32(), crc32fast::hash(&[]));
+
+        let table = BlockChecksums::with_block_size(&bytes, 1024);
+        assert_eq!(
+            BlockChecksums::from_parts(1024, bytes.len(), table.checksums().to_vec()),
+            Some(table.clone())
+        );
+        assert_eq!(BlockChecksums::from_parts(1024, bytes.len(), vec![]), None);
+
+        // Corrupt a single byte
+        let mut corrupted = bytes.clone();
+        corrupted[5000] ^= 0xFF;
+        assert!(table.verify(&corrupted).is_err());
+        assert!(table.verify_block(&corrupted, 4).is_ok());
+        assert!(table.verify_block(&corrupted, 5).is_err());
+        assert_eq!(
+            table.verify(&bytes[1..]),
+            Err(IntegrityError::LengthMismatch {
+                expected: 10_000,
+                computed: 9_999
+            })
+        );
+    }
+
+    #[test]
+    fn lazy_verification() {
+        let bytes: Vec<u8> = (0..10_000_u32).map(|i| (i % 256) as u8).collect();
+        let lazy = LazyIntegrity::new(BlockChecksums::with_block_size(&bytes, 1024));
+        assert_eq!(lazy.num_verified(), 0);
+
+        // Bytes 1000 to 2100 span the first three blocks
+        lazy.verify_range(&bytes, 1000..2100).unwrap();
+        assert_eq!(lazy.num_verified(), 3);
+        lazy.verify_range(&bytes, 0..10).unwrap();
+        assert_eq!(lazy.num_verified(), 3);
+
+        // A corrupted block which was not verified yet is detected
+        let mut corrupted = bytes.clone();
+        corrupted[9_999] ^= 0xFF;
+        assert!(lazy.verify_range(&corrupted, 9_300..10_000).is_err());
+        assert_eq!(lazy.num_verified(), 3);
+        lazy.verify_range(&bytes, 0..10_000).unwrap();
+        assert_eq!(lazy.num_verified(), 10);
+    }
+}
@@ -8,6 +8,8 @@
  * Documentation: https://nyxspace.com/
  */
 
+use super::checksum::{self, BlockChecksums, LazyIntegrity};
+use super::datatypes::invalidate_windows;
 use super::file_record::FileRecordError;
 use super::{
     DAFError, DecodingNameSnafu, DecodingSummarySnafu, FileRecordSnafu, IOSnafu, NAIFDataSet,
@@ -15,9 +17,9 @@ use super::{
 };
 pub use super::{FileRecord, NameRecord, SummaryRecord};
 use crate::errors::{DecodingError, InputOutputError};
-use crate::file2heap;
 use crate::naif::daf::DecodingDataSnafu;
 use crate::{errors::IntegrityError, DBL_SIZE};
+use crate::{file2heap, file2mmap};
 use bytes::{Bytes, BytesMut};
 use core::fmt::Debug;
 use core::hash::Hash;
@@ -26,6 +28,7 @@ use core::ops::Deref;
 use hifitime::Epoch;
 use log::{debug, error, trace};
 use snafu::ResultExt;
+use std::sync::Arc;
 
 use zerocopy::AsBytes;
 use zerocopy::{FromBytes, Ref};
@@ -46,6 +49,8 @@ pub(crate) const RCRD_LEN: usize = 1024;
 pub struct GenericDAF<R: NAIFSummaryRecord, W: MutKind> {
     pub bytes: W,
     pub crc32_checksum: u32,
+    /// Set when the data is verified lazily: each block of the data is verified the first time a segment within it is accessed.
+    pub lazy_integrity: Option<Arc<LazyIntegrity>>,
     pub _daf_type: PhantomData<R>,
 }
 
@@ -59,7 +64,12 @@ impl MutKind for BytesMut {}
 impl<R: NAIFSummaryRecord, W: MutKind> GenericDAF<R, W> {
     /// Compute the CRC32 of the underlying bytes
     pub fn crc32(&self) -> u32 {
-        crc32fast::hash(&self.bytes)
+        checksum::crc32(&self.bytes)
+    }
+
+    /// Computes the CRC32 of each block of the underlying bytes, which can be recorded to later load this DAF with lazy verification.
+    pub fn block_checksums(&self) -> BlockChecksums {
+        BlockChecksums::compute(&self.bytes)
     }
 
     /// Scrubs the data by computing the CRC32 of the bytes and making sure that it still matches the previously known hash
@@ -271,6 +281,11 @@ impl<R: NAIFSummaryRecord, W: MutKind> GenericDAF<R, W> {
 
         let start = (this_summary.start_index() - 1) * DBL_SIZE;
         let end = this_summary.end_index() * DBL_SIZE;
+        if let Some(lazy_integrity) = &self.lazy_integrity {
+            lazy_integrity
+                .verify_range(&self.bytes, start..end.min(self.bytes.len()))
+                .map_err(|source| DAFError::DAFIntegrity { source })?;
+        }
         let data: &[f64] = Ref::new_slice(
             match self
                 .bytes
@@ -378,11 +393,58 @@ impl<R: NAIFSummaryRecord, W: MutKind> Hash for GenericDAF<R, W> {
 
 impl<R: NAIFSummaryRecord> DAF<R> {
     /// Parse the provided bytes as a SPICE Double Array File
+    ///
+    /// This copies the provided bytes, use [Self::from_bytes] to take ownership of existing `Bytes` instead.
     pub fn parse<B: Deref<Target = [u8]>>(bytes: B) -> Result<Self, DAFError> {
-        let crc32_checksum = crc32fast::hash(&bytes);
+        Self::from_bytes(Bytes::copy_from_slice(&bytes))
+    }
+
+    /// Parse the provided bytes as a SPICE Double Array File without copying them.
+    pub fn from_bytes(bytes: Bytes) -> Result<Self, DAFError> {
+        let crc32_checksum = checksum::crc32(&bytes);
+        Self::from_checked_bytes(bytes, crc32_checksum, None)
+    }
+
+    /// Parse the provided bytes as a SPICE Double Array File without copying them nor hashing them all on load.
+    ///
+    /// The provided checksum table must have been recorded from the same file, cf. [Self::block_checksums]. Only the blocks
+    /// holding the file, summary and name records are verified on load: each other block is verified the first time that a segment
+    /// within it is accessed, and an access to corrupted data returns an integrity error. The CRC32 of this DAF is that of the table.
+    pub fn from_bytes_lazy(bytes: Bytes, expected: BlockChecksums) -> Result<Self, DAFError> {
+        expected
+            .check_len(&bytes)
+            .map_err(|source| DAFError::DAFIntegrity { source })?;
+
+        let crc32_checksum = expected.crc32();
+        let lazy_integrity = LazyIntegrity::new(expected);
+        // The file record is required to locate the summary and name records.
+        lazy_integrity
+            .verify_range(&bytes, 0..FileRecord::SIZE.min(bytes.len()))
+            .map_err(|source| DAFError::DAFIntegrity { source })?;
+
+        let me = Self::from_checked_bytes(bytes, crc32_checksum, Some(Arc::new(lazy_integrity)))?;
+
+        let header_end = ((me.file_record()?.fwrd_idx() + 1) * RCRD_LEN).min(me.bytes.len());
+        if let Some(lazy_integrity) = &me.lazy_integrity {
+            lazy_integrity
+                .verify_range(&me.bytes, 0..header_end)
+                .map_err(|source| DAFError::DAFIntegrity { source })?;
+        }
+
+        Ok(me)
+    }
+
+    fn from_checked_bytes(
+        bytes: Bytes,
+        crc32_checksum: u32,
+        lazy_integrity: Option<Arc<LazyIntegrity>>,
+    ) -> Result<Self, DAFError> {
+        // These bytes may be at the address of previously dropped data.
+        invalidate_windows();
         let me = Self {
-            bytes: Bytes::copy_from_slice(&bytes),
+            bytes,
             crc32_checksum,
+            lazy_integrity,
             _daf_type: PhantomData,
         };
         // Check that these calls will succeed.
@@ -396,22 +458,55 @@ impl<R: NAIFSummaryRecord> DAF<R> {
         bytes: B,
         expected: u32,
     ) -> Result<Self, DAFError> {
-        let computed = crc32fast::hash(&bytes);
+        let computed = checksum::crc32(&bytes);
         if computed != expected {
             return Err(DAFError::DAFIntegrity {
                 source: IntegrityError::ChecksumInvalid { expected, computed },
             });
         }
 
-        Self::parse(bytes)
+        // The checksum was just computed, so there is no need to hash the copied bytes again.
+        Self::from_checked_bytes(Bytes::copy_from_slice(&bytes), computed, None)
     }
 
+    /// Loads the provided file onto the heap and parses it as a SPICE Double Array File.
     pub fn load(path: &str) -> Result<Self, DAFError> {
         let bytes = file2heap!(path).context(IOSnafu {
             action: format!("loading {path:?}"),
         })?;
 
-        Self::parse(bytes)
+        Self::from_bytes(bytes)
+    }
+
+    /// Memory maps the provided file and parses it as a SPICE Double Array File, without copying it onto the heap.
+    ///
+    /// The summaries and data are read directly from the mapped pages, which the OS page cache shares across processes.
+    /// The mapping remains valid until this DAF and all of its clones are dropped.
+    ///
+    /// # Safety
+    /// The file must not be modified or truncated while this DAF or any of its clones is alive: the data would change under
+    /// them, and accessing truncated pages is undefined behavior.
+    pub unsafe fn load_mmap(path: &str) -> Result<Self, DAFError> {
+        // SAFETY: the caller guarantees that the file is not modified while mapped.
+        let bytes = unsafe { file2mmap!(path) }.context(IOSnafu {
+            action: format!("memory mapping {path:?}"),
+        })?;
+
+        Self::from_bytes(bytes)
+    }
+
+    /// Memory maps the provided file and parses it as a SPICE Double Array File, verifying its data lazily against the recorded checksum table.
+    ///
+    /// # Safety
+    /// Same as `load_mmap`: the file must not be modified or truncated while this DAF or any of its clones is alive. Lazy
+    /// verification only checks each block once, so it does not detect modifications made after that check.
+    pub unsafe fn load_mmap_lazy(path: &str, expected: BlockChecksums) -> Result<Self, DAFError> {
+        // SAFETY: the caller guarantees that the file is not modified while mapped.
+        let bytes = unsafe { file2mmap!(path) }.context(IOSnafu {
+            action: format!("memory mapping {path:?}"),
+        })?;
+
+        Self::from_bytes_lazy(bytes, expected)
     }
 
     /// Parse the provided static byte array as a SPICE Double Array File
@@ -421,9 +516,11 @@ impl<R: NAIFSummaryRecord> DAF<R> {
 
     /// Copies the underlying bytes of this DAF into a MutDAF, enabling modification of the DAF.
     pub fn to_mutable(&self) -> MutDAF<R> {
+        invalidate_windows();
         MutDAF {
             bytes: BytesMut::from_iter(&self.bytes),
             crc32_checksum: self.crc32_checksum,
+            lazy_integrity: None,
             _daf_type: PhantomData,
         }
     }
@@ -433,13 +530,18 @@ impl<R: NAIFSummaryRecord> DAF<R> {
 mod daf_ut {
     use hifitime::Epoch;
 
+    use bytes::BytesMut;
+
     use crate::{
         errors::{InputOutputError, IntegrityError},
         file2heap,
-        naif::daf::{datatypes::HermiteSetType13, DAFError},
+        naif::daf::{datatypes::HermiteSetType13, BlockChecksums, DAFError, NAIFSummaryRecord},
         prelude::SPK,
+        DBL_SIZE,
     };
 
+    use super::RCRD_LEN;
+
     use std::fs::File;
 
     #[test]
@@ -471,6 +573,47 @@ mod daf_ut {
         );
     }
 
+    #[test]
+    fn lazy_integrity() {
+        let traj = SPK::load("../data/gmat-hermite.bsp").unwrap();
+        let table = BlockChecksums::with_block_size(&traj.bytes, 4 * RCRD_LEN);
+        assert_eq!(table.crc32(), traj.crc32_checksum);
+
+        let lazy = SPK::from_bytes_lazy(traj.bytes.clone(), table.clone()).unwrap();
+        assert_eq!(lazy.crc32_checksum, traj.crc32_checksum);
+        let num_verified = lazy.lazy_integrity.as_ref().unwrap().num_verified();
+        assert!(num_verified < table.checksums().len());
+
+        if lazy.nth_data::<HermiteSetType13>(0).unwrap()
+            != traj.nth_data::<HermiteSetType13>(0).unwrap()
+        {
+            panic!("lazily verified data differs from heap data");
+        }
+        assert!(lazy.lazy_integrity.as_ref().unwrap().num_verified() > num_verified);
+
+        // Corrupt the data of the segment: loading succeeds, but accessing the segment fails.
+        let summary = traj.data_summaries().unwrap()[0];
+        let mut corrupted = BytesMut::from_iter(traj.bytes.iter());
+        corrupted[summary.end_index() * DBL_SIZE - 1] ^= 0xFF;
+        let corrupted = SPK::from_bytes_lazy(corrupted.freeze(), table.clone()).unwrap();
+        assert!(matches!(
+            corrupted.nth_data::<HermiteSetType13>(0),
+            Err(DAFError::DAFIntegrity {
+                source: IntegrityError::ChecksumInvalid { .. }
+            })
+        ));
+
+        assert_eq!(
+            SPK::from_bytes_lazy(traj.bytes.slice(1..), table),
+            Err(DAFError::DAFIntegrity {
+                source: IntegrityError::LengthMismatch {
+                    expected: traj.bytes.len(),
+                    computed: traj.bytes.len() - 1
+                }
+            })
+        );
+    }
+
     #[test]
     fn summary_from_name() {
         let epoch = Epoch::now().unwrap();
@@ -503,4 +646,34 @@ mod daf_ut {
             panic!("nth data test failed");
         }
     }
+
+    #[test]
+    fn load_mmap() {
+        let heap = SPK::load("../data/gmat-hermite.bsp").unwrap();
+        // SAFETY: the test data is not modified while the tests run.
+        let mapped = unsafe { SPK::load_mmap("../data/gmat-hermite.bsp") }.unwrap();
+
+        assert_eq!(heap.crc32_checksum, mapped.crc32_checksum);
+        assert_eq!(heap.bytes, mapped.bytes);
+        assert_eq!(
+            heap.data_summaries().unwrap(),
+            mapped.data_summaries().unwrap()
+        );
+
+        if heap.nth_data::<HermiteSetType13>(0).unwrap()
+            != mapped.nth_data::<HermiteSetType13>(0).unwrap()
+        {
+            panic!("memory mapped data differs from heap data");
+        }
+
+        assert_eq!(
+            unsafe { SPK::load_mmap("../data/this-file-does-not-exist.bsp") },
+            Err(DAFError::IO {
+                action: "memory mapping \"../data/this-file-does-not-exist.bsp\"".to_string(),
+                source: InputOutputError::IOError {
+                    kind: std::io::ErrorKind::NotFound
+                }
+            })
+        );
+    }
 }
@@ -15,7 +15,7 @@ use snafu::{ensure, ResultExt};
 use crate::{
     errors::{DecodingError, IntegrityError, TooFewDoublesSnafu},
     math::{
-        interpolation::{chebyshev_eval, InterpDecodingSnafu, InterpolationError},
+        interpolation::{chebyshev_eval_xyz, InterpDecodingSnafu, InterpolationError},
         Vector3,
     },
     naif::daf::{NAIFDataRecord, NAIFDataSet, NAIFSummaryRecord},
@@ -161,20 +161,13 @@ impl<'a> NAIFDataSet<'a> for Type2ChebyshevSet<'a> {
 
         let normalized_time = (epoch.to_et_seconds() - record.midpoint_et_s) / radius_s;
 
-        let mut state = Vector3::zeros();
-        let mut rate = Vector3::zeros();
-
-        for (cno, coeffs) in [record.x_coeffs, record.y_coeffs, record.z_coeffs]
-            .iter()
-            .enumerate()
-        {
-            let (val, deriv) =
-                chebyshev_eval(normalized_time, coeffs, radius_s, epoch, self.degree())?;
-            state[cno] = val;
-            rate[cno] = deriv;
-        }
-
-        Ok((state, rate))
+        chebyshev_eval_xyz(
+            normalized_time,
+            [record.x_coeffs, record.y_coeffs, record.z_coeffs],
+            radius_s,
+            epoch,
+            self.degree(),
+        )
     }
 
     fn check_integrity(&self) -> Result<(), IntegrityError> {
@@ -0,0 +1,372 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use hifitime::{Duration, Epoch, TimeUnits};
+use log::debug;
+
+#[cfg(feature = "parallel")]
+use rayon::prelude::*;
+
+use crate::math::interpolation::{
+    chebyshev_eval_xyz, chebyshev_fit, chebyshev_nodes, InterpolationError,
+};
+use crate::math::Vector3;
+use crate::naif::daf::{NAIFDataSet, NAIFSummaryRecord};
+
+use super::Type2ChebyshevSet;
+
+/// Fits Chebyshev Type 2 segments (position only) to the states provided by a callback, e.g. an integrator or another segment.
+///
+/// All of the records of a Type 2 segment have the same length: the fitter starts from a single record over the whole time span
+/// and increases the number of records until the fit of each record is within tolerance. The records are fitted in parallel with
+/// the `parallel` feature. Each record interpolates the positions at the Chebyshev nodes of its interval, and its error is checked
+/// against the states at evenly spaced epochs over the interval, including its bounds.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct ChebyshevFitter {
+    /// Degree of the Chebyshev polynomials of each record
+    pub degree: usize,
+    /// Maximum position error in kilometers
+    pub position_tolerance_km: f64,
+    /// Maximum velocity error in kilometers per second, velocity is not checked if unset
+    pub velocity_tolerance_km_s: Option<f64>,
+    /// Maximum number of records of a segment
+    pub max_records: usize,
+}
+
+impl ChebyshevFitter {
+    /// Builds a new fitter of the provided degree and position tolerance in kilometers, without velocity tolerance.
+    pub fn new(degree: usize, position_tolerance_km: f64) -> Self {
+        Self {
+            degree,
+            position_tolerance_km,
+            velocity_tolerance_km_s: None,
+            max_records: 100_000,
+        }
+    }
+
+    /// Sets the velocity tolerance in kilometers per second.
+    pub fn with_velocity_tolerance(mut self, velocity_tolerance_km_s: f64) -> Self {
+        self.velocity_tolerance_km_s = Some(velocity_tolerance_km_s);
+        self
+    }
+
+    /// Sets the maximum number of records of a segment.
+    pub fn with_max_records(mut self, max_records: usize) -> Self {
+        self.max_records = max_records;
+        self
+    }
+
+    /// Fits a segment from the start to the end epoch, where the callback returns the position (km) and velocity (km/s) at an epoch.
+    pub fn fit<F>(
+        &self,
+        start: Epoch,
+        end: Epoch,
+        states: F,
+    ) -> Result<Type2ChebyshevFit, InterpolationError>
+    where
+        F: Fn(Epoch) -> Result<(Vector3, Vector3), InterpolationError> + Sync,
+    {
+        let span_ns = (end - start).total_nanoseconds();
+        if span_ns <= 0 {
+            return Err(InterpolationError::UnsupportedOperation {
+                kind: Type2ChebyshevSet::DATASET_NAME,
+                op: "fitting a time span which is not strictly positive",
+            });
+        }
+
+        let mut num_records = 1_usize;
+        loop {
+            // Round the interval length up to the nanosecond such that the records cover the whole time span.
+            let interval_ns = (span_ns + num_records as i128 - 1) / num_records as i128;
+            let interval_length = Duration::from_total_nanoseconds(interval_ns);
+
+            let records = self.fit_records(start, end, interval_length, num_records, &states)?;
+
+            let error_ratio = records
+                .iter()
+                .map(|record| record.error_ratio)
+                .fold(0.0, f64::max);
+
+            debug!(
+                "Chebyshev fit of degree {} with {num_records} records of {interval_length}: {error_ratio:.3} times the tolerance",
+                self.degree
+            );
+
+            if error_ratio <= 1.0 {
+                let mut fit = Type2ChebyshevFit {
+                    init_epoch: start,
+                    interval_length,
+                    degree: self.degree,
+                    record_data: Vec::with_capacity(num_records * (3 * self.degree + 5)),
+                    max_position_error_km: 0.0,
+                    max_velocity_error_km_s: 0.0,
+                };
+                for record in records {
+                    fit.max_position_error_km = fit.max_position_error_km.max(record.pos_err_km);
+                    fit.max_velocity_error_km_s =
+                        fit.max_velocity_error_km_s.max(record.vel_err_km_s);
+                    fit.record_data.extend(record.data);
+                }
+                return Ok(fit);
+            } else if num_records >= self.max_records || !error_ratio.is_finite() {
+                return Err(InterpolationError::FitTolerance {
+                    degree: self.degree,
+                    num_records,
+                    error_ratio,
+                });
+            }
+
+            // The error of the fit decreases with the interval length to the power of the number of coefficients,
+            // so estimate the number of records needed, with some margin and at least some growth.
+            let growth = (error_ratio.powf(1.0 / self.degree.max(1) as f64) * 1.1).max(1.25);
+            num_records = ((num_records as f64 * growth).ceil() as usize)
+                .max(num_records + 1)
+                .min(self.max_records);
+        }
+    }
+
+    /// Fits a segment to the provided data set over the time span of its summary, e.g. to compress a Hermite or Lagrange segment.
+    pub fn fit_dataset<'a, S, R>(
+        &self,
+        dataset: &S,
+        summary: &R,
+    ) -> Result<Type2ChebyshevFit, InterpolationError>
+    where
+        S: NAIFDataSet<'a, StateKind = (Vector3, Vector3)> + Sync,
+        R: NAIFSummaryRecord + Sync,
+    {
+        self.fit(summary.start_epoch(), summary.end_epoch(), |epoch| {
+            dataset.evaluate(epoch, summary)
+        })
+    }
+
+    fn fit_records<F>(
+        &self,
+        start: Epoch,
+        end: Epoch,
+        interval_length: Duration,
+        num_records: usize,
+        states: &F,
+    ) -> Result<Vec<RecordFit>, InterpolationError>
+    where
+        F: Fn(Epoch) -> Result<(Vector3, Vector3), InterpolationError> + Sync,
+    {
+        let nodes = chebyshev_nodes(self.degree);
+        #[cfg(feature = "parallel")]
+        let records = (0..num_records).into_par_iter();
+        #[cfg(not(feature = "parallel"))]
+        let records = 0..num_records;
+
+        records
+            .map(|rno| {
+                let rcrd_start = start
+                    + Duration::from_total_nanoseconds(
+                        interval_length.total_nanoseconds() * rno as i128,
+                    );
+                self.fit_record(rcrd_start, interval_length, (start, end), &nodes, states)
+            })
+            .collect()
+    }
+
+    fn fit_record<F>(
+        &self,
+        rcrd_start: Epoch,
+        interval_length: Duration,
+        bounds: (Epoch, Epoch),
+        nodes: &[f64],
+        states: &F,
+    ) -> Result<RecordFit, InterpolationError>
+    where
+        F: Fn(Epoch) -> Result<(Vector3, Vector3), InterpolationError> + Sync,
+    {
+        let radius_s = interval_length.to_seconds() / 2.0;
+        let midpoint = rcrd_start + 0.5 * interval_length;
+        let midpoint_et_s = midpoint.to_et_seconds();
+
+        let mut values: [Vec<f64>; 3] = Default::default();
+        for node in nodes {
+            let (pos_km, _) = states(midpoint + (node * radius_s).seconds())?;
+            for (k, component) in values.iter_mut().enumerate() {
+                component.push(pos_km[k]);
+            }
+        }
+
+        let mut data = Vec::with_capacity(3 * nodes.len() + 2);
+        data.push(midpoint_et_s);
+        data.push(radius_s);
+        for component in &values {
+            data.extend(chebyshev_fit(component));
+        }
+
+        // Check the fit at evenly spaced epochs over the interval, including its bounds but not past the fitted time span,
+        // which the last record may exceed by a few nanoseconds.
+        let num_coeffs = nodes.len();
+        let coeffs = [
+            &data[2..2 + num_coeffs],
+            &data[2 + num_coeffs..2 + 2 * num_coeffs],
+            &data[2 + 2 * num_coeffs..],
+        ];
+        let num_checks = 2 * num_coeffs + 1;
+        let mut pos_err_km = 0.0_f64;
+        let mut vel_err_km_s = 0.0_f64;
+        for check in 0..num_checks {
+            let normalized_time = 2.0 * check as f64 / (num_checks - 1) as f64 - 1.0;
+            let epoch = (midpoint + (normalized_time * radius_s).seconds())
+                .max(bounds.0)
+                .min(bounds.1);
+            let normalized_time = (epoch - midpoint).to_seconds() / radius_s;
+            let (pos_km, vel_km_s) = states(epoch)?;
+            let (fit_pos_km, fit_vel_km_s) =
+                chebyshev_eval_xyz(normalized_time, coeffs, radius_s, epoch, self.degree)?;
+            pos_err_km = pos_err_km.max((fit_pos_km - pos_km).norm());
+            vel_err_km_s = vel_err_km_s.max((fit_vel_km_s - vel_km_s).norm());
+        }
+
+        let mut error_ratio = pos_err_km / self.position_tolerance_km;
+        if let Some(velocity_tolerance_km_s) = self.velocity_tolerance_km_s {
+            error_ratio = error_ratio.max(vel_err_km_s / velocity_tolerance_km_s);
+        }
+
+        Ok(RecordFit {
+            data,
+            pos_err_km,
+            vel_err_km_s,
+            error_ratio,
+        })
+    }
+}
+
+struct RecordFit {
+    data: Vec<f64>,
+    pos_err_km: f64,
+    vel_err_km_s: f64,
+    error_ratio: f64,
+}
+
+/// The result of a Chebyshev Type 2 fit, which owns its record data.
+#[derive(Clone, Debug, PartialEq)]
+pub struct Type2ChebyshevFit {
+    pub init_epoch: Epoch,
+    pub interval_length: Duration,
+    pub degree: usize,
+    /// Midpoint, radius, and X, Y, Z coefficients of each record
+    pub record_data: Vec<f64>,
+    /// Maximum position error found while checking the fit
+    pub max_position_error_km: f64,
+    /// Maximum velocity error found while checking the fit
+    pub max_velocity_error_km_s: f64,
+}
+
+impl Type2ChebyshevFit {
+    /// Number of doubles in each record.
+    pub fn rsize(&self) -> usize {
+        3 * (self.degree + 1) + 2
+    }
+
+    pub fn num_records(&self) -> usize {
+        self.record_data.len() / self.rsize()
+    }
+
+    /// End epoch of the last record of this fit.
+    pub fn end_epoch(&self) -> Epoch {
+        self.init_epoch
+            + Duration::from_total_nanoseconds(
+                self.interval_length.total_nanoseconds() * self.num_records() as i128,
+            )
+    }
+
+    /// Returns the Chebyshev Type 2 set of this fit, e.g. to evaluate it or to write it to an SPK with a [crate::naif::daf::DAFWriter].
+    pub fn as_set(&self) -> Type2ChebyshevSet<'_> {
+        Type2ChebyshevSet {
+            init_epoch: self.init_epoch,
+            interval_length: self.interval_length,
+            rsize: self.rsize(),
+            num_records: self.num_records(),
+            record_data: &self.record_data,
+        }
+    }
+}
+
+#[cfg(test)]
+mod ut_chebyshev_fit {
+    use super::*;
+    use crate::naif::daf::datatypes::HermiteSetType13;
+    use crate::naif::daf::{DafDataType, NAIFDataSet};
+    use crate::naif::SPK;
+
+    /// A circular orbit of 7000 km with a period of about 97 minutes, and its velocity.
+    fn circular(epoch: Epoch) -> Result<(Vector3, Vector3), InterpolationError> {
+        let radius_km = 7000.0;
+        let rate_rad_s = (398_600.4418_f64 / radius_km.powi(3)).sqrt();
+        let (sin, cos) = (rate_rad_s * epoch.to_et_seconds()).sin_cos();
+        Ok((
+            Vector3::new(radius_km * cos, radius_km * sin, 0.0),
+            Vector3::new(
+                -radius_km * rate_rad_s * sin,
+                radius_km * rate_rad_s * cos,
+                0.0,
+            ),
+        ))
+    }
+
+    #[test]
+    fn fit_circular_orbit() {
+        let start = Epoch::from_et_seconds(0.0);
+        let end = start + 1.days();
+        let fitter = ChebyshevFitter::new(13, 1e-6).with_velocity_tolerance(1e-9);
+        let fit = fitter.fit(start, end, circular).unwrap();
+
+        assert!(fit.num_records() > 1);
+        assert!(fit.end_epoch() >= end);
+        assert!(fit.max_position_error_km <= 1e-6);
+        assert_eq!(fit.record_data.len(), fit.num_records() * fit.rsize());
+
+        // Evaluate the fit through the Type 2 set, as when it is read from an SPK.
+        let set = fit.as_set();
+        let summary = crate::naif::spk::summary::SPKSummaryRecord {
+            start_epoch_et_s: start.to_et_seconds(),
+            end_epoch_et_s: end.to_et_seconds(),
+            data_type_i: DafDataType::Type2ChebyshevTriplet as i32,
+            ..Default::default()
+        };
+        let data = set.to_f64_daf_vec().unwrap();
+        let reloaded = Type2ChebyshevSet::from_f64_slice(&data).unwrap();
+        assert_eq!(reloaded.num_records, fit.num_records());
+        assert_eq!(reloaded.degree(), 13);
+
+        for minutes in (0..24 * 60).step_by(7) {
+            let epoch = start + (minutes as f64 + 0.5).minutes();
+            let (pos_km, vel_km_s) = reloaded.evaluate(epoch, &summary).unwrap();
+            let (exp_pos_km, exp_vel_km_s) = circular(epoch).unwrap();
+            assert!((pos_km - exp_pos_km).norm() < 1e-5, "{epoch}");
+            assert!((vel_km_s - exp_vel_km_s).norm() < 1e-8, "{epoch}");
+        }
+
+        // Cannot be fitted with so few records
+        assert!(matches!(
+            fitter.with_max_records(2).fit(start, end, circular),
+            Err(InterpolationError::FitTolerance { num_records: 2, .. })
+        ));
+        assert!(fitter.fit(end, start, circular).is_err());
+    }
+
+    #[test]
+    fn compress_hermite() {
+        let spk = SPK::load("../data/gmat-hermite.bsp").unwrap();
+        let summary = spk.data_summaries().unwrap()[0];
+        let hermite = spk.nth_data::<HermiteSetType13>(0).unwrap();
+
+        let fit = ChebyshevFitter::new(11, 1e-3)
+            .fit_dataset(&hermite, &summary)
+            .unwrap();
+        assert!(fit.max_position_error_km <= 1e-3);
+        assert!(fit.record_data.len() < hermite.to_f64_daf_vec().unwrap().len());
+    }
+}
@@ -13,9 +13,7 @@ use hifitime::{Duration, Epoch, TimeUnits};
 use snafu::{ensure, ResultExt};
 
 use crate::errors::{DecodingError, IntegrityError, TooFewDoublesSnafu};
-use crate::math::interpolation::{
-    hermite_eval, InterpDecodingSnafu, InterpolationError, MAX_SAMPLES,
-};
+use crate::math::interpolation::{hermite_eval, InterpDecodingSnafu, InterpolationError};
 use crate::naif::daf::NAIFSummaryRecord;
 use crate::{
     math::{cartesian::CartesianState, Vector3},
@@ -24,6 +22,9 @@ use crate::{
 };
 
 use super::posvel::PositionVelocityRecord;
+use super::window::{
+    cached_window, interpolant, search_epochs, window_key, Interpolant, NewtonWindow, SampleWindow,
+};
 
 #[derive(PartialEq)]
 pub struct HermiteSetType12<'a> {
@@ -153,6 +154,88 @@ impl<'a> HermiteSetType13<'a> {
     pub fn degree(&self) -> usize {
         2 * self.samples - 1
     }
+
+    /// Evaluates the interpolation of this window at the requested epoch.
+    fn interpolate(
+        &self,
+        interpolant: &Interpolant,
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3), InterpolationError> {
+        match interpolant {
+            Interpolant::Samples(window) => self.interpolate_samples(window, epoch),
+            Interpolant::Newton(newton) => {
+                // The derivative of the position polynomial is the velocity.
+                let (x_km, vx_km_s) = newton.polynomials[0].eval(epoch.to_et_seconds());
+                let (y_km, vy_km_s) = newton.polynomials[1].eval(epoch.to_et_seconds());
+                let (z_km, vz_km_s) = newton.polynomials[2].eval(epoch.to_et_seconds());
+
+                Ok((
+                    Vector3::new(x_km, y_km, z_km),
+                    Vector3::new(vx_km_s, vy_km_s, vz_km_s),
+                ))
+            }
+        }
+    }
+
+    /// Builds the Newton form of the Hermite interpolation of the position and velocity of these samples.
+    fn newton_window(&self, window: &SampleWindow) -> Result<NewtonWindow, InterpolationError> {
+        let epochs = &window.epochs[..self.samples];
+        Ok(NewtonWindow {
+            polynomials: vec![
+                NewtonPolynomial::hermite(
+                    epochs,
+                    &window.xs[..self.samples],
+                    &window.vxs[..self.samples],
+                )?,
+                NewtonPolynomial::hermite(
+                    epochs,
+                    &window.ys[..self.samples],
+                    &window.vys[..self.samples],
+                )?,
+                NewtonPolynomial::hermite(
+                    epochs,
+                    &window.zs[..self.samples],
+                    &window.vzs[..self.samples],
+                )?,
+            ],
+        })
+    }
+
+    /// Evaluates the Hermite interpolation of the provided samples at the requested epoch.
+    fn interpolate_samples(
+        &self,
+        window: &SampleWindow,
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3), InterpolationError> {
+        // Build the interpolation polynomials making sure to limit the slices to exactly the number of items we actually used
+        // The other ones are zeros, which would cause the interpolation function to fail.
+        let (x_km, vx_km_s) = hermite_eval(
+            &window.epochs[..self.samples],
+            &window.xs[..self.samples],
+            &window.vxs[..self.samples],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (y_km, vy_km_s) = hermite_eval(
+            &window.epochs[..self.samples],
+            &window.ys[..self.samples],
+            &window.vys[..self.samples],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (z_km, vz_km_s) = hermite_eval(
+            &window.epochs[..self.samples],
+            &window.zs[..self.samples],
+            &window.vzs[..self.samples],
+            epoch.to_et_seconds(),
+        )?;
+
+        // And build the result
+        let pos_km = Vector3::new(x_km, y_km, z_km);
+        let vel_km_s = Vector3::new(vx_km_s, vy_km_s, vz_km_s);
+
+        Ok((pos_km, vel_km_s))
+    }
 }
 
 impl<'a> fmt::Display for HermiteSetType13<'a> {
@@ -266,8 +349,6 @@ impl<'a> NAIFDataSet<'a> for HermiteSetType13<'a> {
         epoch: Epoch,
         _: &S,
     ) -> Result<Self::StateKind, InterpolationError> {
-        // Start by doing a binary search on the epoch registry to limit the search space in the total number of epochs.
-        // TODO: use the epoch registry to reduce the search space
         // Check that we even have interpolation data for that time
         if epoch.to_et_seconds() + 1e-9 < self.epoch_data[0]
             || epoch.to_et_seconds() - 1e-9 > *self.epoch_data.last().unwrap()
@@ -278,12 +359,13 @@ impl<'a> NAIFDataSet<'a> for HermiteSetType13<'a> {
                 end: Epoch::from_et_seconds(*self.epoch_data.last().unwrap()),
             });
         }
-        // Now, perform a binary search on the epochs themselves.
-        match self.epoch_data.binary_search_by(|epoch_et| {
-            epoch_et
-                .partial_cmp(&epoch.to_et_seconds())
-                .expect("epochs in Hermite data is now NaN or infinite but was not before")
-        }) {
+        // Sequential queries usually land in the same window as the previous one.
+        let key = window_key(self.state_data, self.epoch_data);
+        if let Some(window) = cached_window(key, self.epoch_data, epoch.to_et_seconds()) {
+            return self.interpolate(&window, epoch);
+        }
+        // Now, perform a binary search on the epoch directory and then on the epochs themselves.
+        match search_epochs(self.epoch_data, self.epoch_registry, epoch.to_et_seconds()) {
             Ok(idx) => {
                 // Oh wow, this state actually exists, no interpolation needed!
                 Ok(self
@@ -304,59 +386,38 @@ impl<'a> NAIFDataSet<'a> for HermiteSetType13<'a> {
                     first_idx = last_idx - 2 * num_left;
                 }
 
-                // Statically allocated arrays of the maximum number of samples
-                let mut epochs = [0.0; MAX_SAMPLES];
-                let mut xs = [0.0; MAX_SAMPLES];
-                let mut ys = [0.0; MAX_SAMPLES];
-                let mut zs = [0.0; MAX_SAMPLES];
-                let mut vxs = [0.0; MAX_SAMPLES];
-                let mut vys = [0.0; MAX_SAMPLES];
-                let mut vzs = [0.0; MAX_SAMPLES];
-                for (cno, idx) in (first_idx..last_idx).enumerate() {
-                    let record = self.nth_record(idx).context(InterpDecodingSnafu)?;
-                    xs[cno] = record.x_km;
-                    ys[cno] = record.y_km;
-                    zs[cno] = record.z_km;
-                    vxs[cno] = record.vx_km_s;
-                    vys[cno] = record.vy_km_s;
-                    vzs[cno] = record.vz_km_s;
-                    epochs[cno] = self.epoch_data[idx];
-                }
-
-                // TODO: Build a container that uses the underlying data and provides an index into it.
-
-                // Build the interpolation polynomials making sure to limit the slices to exactly the number of items we actually used
-                // The other ones are zeros, which would cause the interpolation function to fail.
-                let (x_km, vx_km_s) = hermite_eval(
-                    &epochs[..self.samples],
-                    &xs[..self.samples],
-                    &vxs[..self.samples],
-                    epoch.to_et_seconds(),
-                )?;
-
-                let (y_km, vy_km_s) = hermite_eval(
-                    &epochs[..self.samples],
-                    &ys[..self.samples],
-                    &vys[..self.samples],
-                    epoch.to_et_seconds(),
-                )?;
-
-                let (z_km, vz_km_s) = hermite_eval(
-                    &epochs[..self.samples],
-                    &zs[..self.samples],
-                    &vzs[..self.samples],
-                    epoch.to_et_seconds(),
+                let interpolant = interpolant(
+                    key,
+                    self.epoch_data,
+                    idx,
+                    || {
+                        SampleWindow::gather(self.epoch_data, first_idx, last_idx, |n| {
+                            self.nth_record(n)
+                        })
+                        .context(InterpDecodingSnafu)
+                    },
+                    |window| self.newton_window(window),
                 )?;
 
-                // And build the result
-                let pos_km = Vector3::new(x_km, y_km, z_km);
-                let vel_km_s = Vector3::new(vx_km_s, vy_km_s, vz_km_s);
-
-                Ok((pos_km, vel_km_s))
+                self.interpolate(&interpolant, epoch)
             }
         }
     }
 
+    /// Builds the DAF array representing a Hermite Type 13 set. Note that the window size minus one is stored.
+    fn to_f64_daf_vec(&self) -> Result<Vec<f64>, InterpolationError> {
+        let mut data = Vec::with_capacity(
+            self.state_data.len() + self.epoch_data.len() + self.epoch_registry.len() + 2,
+        );
+        data.extend_from_slice(self.state_data);
+        data.extend_from_slice(self.epoch_data);
+        data.extend_from_slice(self.epoch_registry);
+        data.push((self.samples - 1) as f64);
+        data.push(self.num_records as f64);
+
+        Ok(data)
+    }
+
     fn check_integrity(&self) -> Result<(), IntegrityError> {
         // Verify that none of the data is invalid once when we load it.
         for val in self.epoch_data {
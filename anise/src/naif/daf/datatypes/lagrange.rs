@@ -16,7 +16,7 @@ use crate::{
     errors::{DecodingError, IntegrityError, TooFewDoublesSnafu},
     math::{
         cartesian::CartesianState,
-        interpolation::{lagrange_eval, InterpDecodingSnafu, InterpolationError, MAX_SAMPLES},
+        interpolation::{lagrange_eval, InterpDecodingSnafu, InterpolationError, NewtonPolynomial},
         Vector3,
     },
     naif::daf::{NAIFDataRecord, NAIFDataSet, NAIFRecord, NAIFSummaryRecord},
@@ -24,6 +24,9 @@ use crate::{
 };
 
 use super::posvel::PositionVelocityRecord;
+use super::window::{
+    cached_window, interpolant, search_epochs, window_key, Interpolant, NewtonWindow, SampleWindow,
+};
 
 #[derive(PartialEq)]
 pub struct LagrangeSetType8<'a> {
@@ -145,6 +148,105 @@ pub struct LagrangeSetType9<'a> {
     pub epoch_registry: &'a [f64],
 }
 
+impl<'a> LagrangeSetType9<'a> {
+    /// Evaluates the interpolation of this window at the requested epoch.
+    fn interpolate(
+        &self,
+        interpolant: &Interpolant,
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3), InterpolationError> {
+        match interpolant {
+            Interpolant::Samples(window) => self.interpolate_samples(window, epoch),
+            Interpolant::Newton(newton) => {
+                let mut state = [0.0; 6];
+                for (value, polynomial) in state.iter_mut().zip(newton.polynomials.iter()) {
+                    *value = polynomial.eval(epoch.to_et_seconds()).0;
+                }
+
+                Ok((
+                    Vector3::new(state[0], state[1], state[2]),
+                    Vector3::new(state[3], state[4], state[5]),
+                ))
+            }
+        }
+    }
+
+    /// Builds the Newton form of the Lagrange interpolation of each component of these samples.
+    fn newton_window(&self, window: &SampleWindow) -> Result<NewtonWindow, InterpolationError> {
+        let group_size = self.degree + 1;
+        let epochs = &window.epochs[..group_size];
+        let mut polynomials = Vec::with_capacity(6);
+        for component in [
+            &window.xs,
+            &window.ys,
+            &window.zs,
+            &window.vxs,
+            &window.vys,
+            &window.vzs,
+        ] {
+            polynomials.push(NewtonPolynomial::lagrange(
+                epochs,
+                &component[..group_size],
+            )?);
+        }
+
+        Ok(NewtonWindow { polynomials })
+    }
+
+    /// Evaluates the Lagrange interpolation of the provided samples at the requested epoch.
+    fn interpolate_samples(
+        &self,
+        window: &SampleWindow,
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3), InterpolationError> {
+        let group_size = self.degree + 1;
+
+        // Build the interpolation polynomials making sure to limit the slices to exactly the number of items we actually used
+        // The other ones are zeros, which would cause the interpolation function to fail.
+        let (x_km, _) = lagrange_eval(
+            &window.epochs[..group_size],
+            &window.xs[..group_size],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (y_km, _) = lagrange_eval(
+            &window.epochs[..group_size],
+            &window.ys[..group_size],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (z_km, _) = lagrange_eval(
+            &window.epochs[..group_size],
+            &window.zs[..group_size],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (vx_km_s, _) = lagrange_eval(
+            &window.epochs[..group_size],
+            &window.vxs[..group_size],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (vy_km_s, _) = lagrange_eval(
+            &window.epochs[..group_size],
+            &window.vys[..group_size],
+            epoch.to_et_seconds(),
+        )?;
+
+        let (vz_km_s, _) = lagrange_eval(
+            &window.epochs[..group_size],
+            &window.vzs[..group_size],
+            epoch.to_et_seconds(),
+        )?;
+
+        // And build the result
+        let pos_km = Vector3::new(x_km, y_km, z_km);
+        let vel_km_s = Vector3::new(vx_km_s, vy_km_s, vz_km_s);
+
+        Ok((pos_km, vel_km_s))
+    }
+}
+
 impl<'a> fmt::Display for LagrangeSetType9<'a> {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         write!(
@@ -212,8 +314,6 @@ impl<'a> NAIFDataSet<'a> for LagrangeSetType9<'a> {
         epoch: Epoch,
         _: &S,
     ) -> Result<Self::StateKind, InterpolationError> {
-        // Start by doing a binary search on the epoch registry to limit the search space in the total number of epochs.
-        // TODO: use the epoch registry to reduce the search space
         // Check that we even have interpolation data for that time
         if epoch.to_et_seconds() + 1e-9 < self.epoch_data[0]
             || epoch.to_et_seconds() - 1e-9 > *self.epoch_data.last().unwrap()
@@ -224,12 +324,13 @@ impl<'a> NAIFDataSet<'a> for LagrangeSetType9<'a> {
                 end: Epoch::from_et_seconds(*self.epoch_data.last().unwrap()),
             });
         }
-        // Now, perform a binary search on the epochs themselves.
-        match self.epoch_data.binary_search_by(|epoch_et| {
-            epoch_et
-                .partial_cmp(&epoch.to_et_seconds())
-                .expect("epochs in Hermite data is now NaN or infinite but was not before")
-        }) {
+        // Sequential queries usually land in the same window as the previous one.
+        let key = window_key(self.state_data, self.epoch_data);
+        if let Some(window) = cached_window(key, self.epoch_data, epoch.to_et_seconds()) {
+            return self.interpolate(&window, epoch);
+        }
+        // Now, perform a binary search on the epoch directory and then on the epochs themselves.
+        match search_epochs(self.epoch_data, self.epoch_registry, epoch.to_et_seconds()) {
             Ok(idx) => {
                 // Oh wow, this state actually exists, no interpolation needed!
                 Ok(self
@@ -251,75 +352,38 @@ impl<'a> NAIFDataSet<'a> for LagrangeSetType9<'a> {
                     first_idx = last_idx - 2 * num_left;
                 }
 
-                // Statically allocated arrays of the maximum number of samples
-                let mut epochs = [0.0; MAX_SAMPLES];
-                let mut xs = [0.0; MAX_SAMPLES];
-                let mut ys = [0.0; MAX_SAMPLES];
-                let mut zs = [0.0; MAX_SAMPLES];
-                let mut vxs = [0.0; MAX_SAMPLES];
-                let mut vys = [0.0; MAX_SAMPLES];
-                let mut vzs = [0.0; MAX_SAMPLES];
-
-                for (cno, idx) in (first_idx..last_idx).enumerate() {
-                    let record = self.nth_record(idx).context(InterpDecodingSnafu)?;
-                    xs[cno] = record.x_km;
-                    ys[cno] = record.y_km;
-                    zs[cno] = record.z_km;
-                    vxs[cno] = record.vx_km_s;
-                    vys[cno] = record.vy_km_s;
-                    vzs[cno] = record.vz_km_s;
-                    epochs[cno] = self.epoch_data[idx];
-                }
-
-                // TODO: Build a container that uses the underlying data and provides an index into it.
-
-                // Build the interpolation polynomials making sure to limit the slices to exactly the number of items we actually used
-                // The other ones are zeros, which would cause the interpolation function to fail.
-                let (x_km, _) = lagrange_eval(
-                    &epochs[..group_size],
-                    &xs[..group_size],
-                    epoch.to_et_seconds(),
-                )?;
-
-                let (y_km, _) = lagrange_eval(
-                    &epochs[..group_size],
-                    &ys[..group_size],
-                    epoch.to_et_seconds(),
-                )?;
-
-                let (z_km, _) = lagrange_eval(
-                    &epochs[..group_size],
-                    &zs[..group_size],
-                    epoch.to_et_seconds(),
-                )?;
-
-                let (vx_km_s, _) = lagrange_eval(
-                    &epochs[..group_size],
-                    &vxs[..group_size],
-                    epoch.to_et_seconds(),
+                let interpolant = interpolant(
+                    key,
+                    self.epoch_data,
+                    idx,
+                    || {
+                        SampleWindow::gather(self.epoch_data, first_idx, last_idx, |n| {
+                            self.nth_record(n)
+                        })
+                        .context(InterpDecodingSnafu)
+                    },
+                    |window| self.newton_window(window),
                 )?;
 
-                let (vy_km_s, _) = lagrange_eval(
-                    &epochs[..group_size],
-                    &vys[..group_size],
-                    epoch.to_et_seconds(),
-                )?;
-
-                let (vz_km_s, _) = lagrange_eval(
-                    &epochs[..group_size],
-                    &vzs[..group_size],
-                    epoch.to_et_seconds(),
-                )?;
-
-                // And build the result
-                let pos_km = Vector3::new(x_km, y_km, z_km);
-                let vel_km_s = Vector3::new(vx_km_s, vy_km_s, vz_km_s);
-
-                Ok((pos_km, vel_km_s))
+                self.interpolate(&interpolant, epoch)
             }
         }
     }
 
+    /// Builds the DAF array representing a Lagrange Type 9 set.
+    fn to_f64_daf_vec(&self) -> Result<Vec<f64>, InterpolationError> {
+        let mut data = Vec::with_capacity(
+            self.state_data.len() + self.epoch_data.len() + self.epoch_registry.len() + 2,
+        );
+        data.extend_from_slice(self.state_data);
+        data.extend_from_slice(self.epoch_data);
+        data.extend_from_slice(self.epoch_registry);
+        data.push(self.degree as f64);
+        data.push(self.num_records as f64);
+
+        Ok(data)
+    }
+
     fn check_integrity(&self) -> Result<(), IntegrityError> {
         // Verify that none of the data is invalid once when we load it.
         for val in self.epoch_data {
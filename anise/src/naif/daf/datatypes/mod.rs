@@ -9,10 +9,16 @@
  */
 
 pub mod chebyshev;
+pub mod chebyshev_fit;
 pub mod hermite;
 pub mod lagrange;
 pub mod posvel;
+mod window;
+
+pub(crate) use window::{invalidate_windows, with_newton_window_capacity};
 
 pub use chebyshev::*;
+pub use chebyshev_fit::{ChebyshevFitter, Type2ChebyshevFit};
 pub use hermite::*;
 pub use lagrange::*;
+pub use window::set_interpolation_window_cache;
@@ -0,0 +1,454 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::cell::{Cell, RefCell};
+use std::collections::{BTreeMap, HashMap};
+use std::rc::Rc;
+use std::sync::atomic::{AtomicU64, Ordering};
+
+use crate::errors::DecodingError;
+use crate::math::interpolation::{InterpolationError, NewtonPolynomial, MAX_SAMPLES};
+
+use super::posvel::PositionVelocityRecord;
+
+/// Number of epochs between two entries of the epoch directory of the Type 9 and Type 13 data sets.
+pub(crate) const EPOCH_DIRECTORY_SIZE: usize = 100;
+
+/// Number of interpolation windows remembered by each thread.
+const NUM_CACHED_WINDOWS: usize = 4;
+
+/// Finds the provided ephemeris time in the epoch data, with the same result as `binary_search_by` on the whole epoch data.
+///
+/// The epoch directory stores every 100th epoch, so a first binary search on the directory limits the second search to a block of at most 100 epochs.
+/// If the directory is not consistent with the epoch data, the whole epoch data is searched instead.
+pub(crate) fn search_epochs(
+    epoch_data: &[f64],
+    epoch_registry: &[f64],
+    et_s: f64,
+) -> Result<usize, usize> {
+    let search = |data: &[f64]| {
+        data.binary_search_by(|epoch_et| {
+            epoch_et
+                .partial_cmp(&et_s)
+                .expect("epochs in the data set are now NaN or infinite but were not before")
+        })
+    };
+
+    if !epoch_registry.is_empty() && epoch_registry.len() <= epoch_data.len() / EPOCH_DIRECTORY_SIZE
+    {
+        let block = epoch_registry.partition_point(|epoch_et| *epoch_et < et_s);
+        let start = block * EPOCH_DIRECTORY_SIZE;
+        let end = epoch_data.len().min(start + EPOCH_DIRECTORY_SIZE);
+        // Only trust the directory if the requested epoch is indeed within this block.
+        let after_start = start == 0 || epoch_data[start - 1] < et_s;
+        let before_end = end == epoch_data.len() || epoch_data[end - 1] >= et_s;
+        if after_start && before_end {
+            return match search(&epoch_data[start..end]) {
+                Ok(idx) => Ok(start + idx),
+                Err(idx) => Err(start + idx),
+            };
+        }
+    }
+
+    search(epoch_data)
+}
+
+/// The samples used to build an interpolation, copied out of the data set.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub(crate) struct SampleWindow {
+    pub epochs: [f64; MAX_SAMPLES],
+    pub xs: [f64; MAX_SAMPLES],
+    pub ys: [f64; MAX_SAMPLES],
+    pub zs: [f64; MAX_SAMPLES],
+    pub vxs: [f64; MAX_SAMPLES],
+    pub vys: [f64; MAX_SAMPLES],
+    pub vzs: [f64; MAX_SAMPLES],
+}
+
+impl SampleWindow {
+    /// Gathers the records from `first_idx` (included) to `last_idx` (excluded).
+    pub fn gather<F>(
+        epoch_data: &[f64],
+        first_idx: usize,
+        last_idx: usize,
+        nth_record: F,
+    ) -> Result<Self, DecodingError>
+    where
+        F: Fn(usize) -> Result<PositionVelocityRecord, DecodingError>,
+    {
+        let mut window = Self {
+            epochs: [0.0; MAX_SAMPLES],
+            xs: [0.0; MAX_SAMPLES],
+            ys: [0.0; MAX_SAMPLES],
+            zs: [0.0; MAX_SAMPLES],
+            vxs: [0.0; MAX_SAMPLES],
+            vys: [0.0; MAX_SAMPLES],
+            vzs: [0.0; MAX_SAMPLES],
+        };
+
+        for (cno, idx) in (first_idx..last_idx).enumerate() {
+            let record = nth_record(idx)?;
+            window.xs[cno] = record.x_km;
+            window.ys[cno] = record.y_km;
+            window.zs[cno] = record.z_km;
+            window.vxs[cno] = record.vx_km_s;
+            window.vys[cno] = record.vy_km_s;
+            window.vzs[cno] = record.vz_km_s;
+            window.epochs[cno] = epoch_data[idx];
+        }
+
+        Ok(window)
+    }
+}
+
+/// The Newton form of the interpolation of each component of the state over a window.
+#[derive(Clone, Debug, PartialEq)]
+pub(crate) struct NewtonWindow {
+    pub polynomials: Vec<NewtonPolynomial>,
+}
+
+/// What is needed to interpolate the state in a window.
+#[derive(Clone, Debug, PartialEq)]
+pub(crate) enum Interpolant {
+    /// The samples themselves, interpolated from scratch on every evaluation
+    Samples(SampleWindow),
+    /// The precomputed Newton coefficients of the interpolation
+    Newton(Rc<NewtonWindow>),
+}
+
+/// Generation of the DAF data of this process, incremented whenever DAF data is created or modified.
+static DATA_GENERATION: AtomicU64 = AtomicU64::new(0);
+
+/// Invalidates all of the interpolation windows cached by all threads.
+///
+/// This must be called whenever the bytes of a DAF are created or modified: the memory of a dropped data set may be reused
+/// by new data at the same address, or a file may be edited while memory mapped, and neither can be detected from the data itself.
+pub(crate) fn invalidate_windows() {
+    DATA_GENERATION.fetch_add(1, Ordering::AcqRel);
+}
+
+/// Identifies a data set by the location of its data in memory, and by the generation of the DAF data when it was used.
+pub(crate) type WindowKey = (usize, usize, usize, u64);
+
+/// Returns the key of the data set using this state and epoch data.
+pub(crate) fn window_key(state_data: &[f64], epoch_data: &[f64]) -> WindowKey {
+    (
+        state_data.as_ptr() as usize,
+        epoch_data.as_ptr() as usize,
+        epoch_data.len(),
+        DATA_GENERATION.load(Ordering::Acquire),
+    )
+}
+
+#[derive(Clone, Debug)]
+struct CachedWindow {
+    key: WindowKey,
+    /// Insertion index of the requested epochs in the epoch data: all epochs strictly between the epochs at `idx - 1` and `idx` use this window.
+    idx: usize,
+    start_et_s: f64,
+    end_et_s: f64,
+    interpolant: Interpolant,
+}
+
+const NO_WINDOW: Option<CachedWindow> = None;
+
+struct WindowCache {
+    enabled: bool,
+    next: usize,
+    slots: [Option<CachedWindow>; NUM_CACHED_WINDOWS],
+}
+
+struct NewtonEntry {
+    tick: u64,
+    /// Epochs of the records around the window, checked in addition to the generation of the key
+    bounds: (f64, f64),
+    window: Rc<NewtonWindow>,
+}
+
+/// Least recently used cache of the Newton coefficients of interpolation windows.
+#[derive(Default)]
+struct NewtonCache {
+    /// Maximum number of windows kept, i.e. the capacity of the last Almanac which inserted a window
+    capacity: usize,
+    tick: u64,
+    entries: HashMap<(WindowKey, usize), NewtonEntry>,
+    recency: BTreeMap<u64, (WindowKey, usize)>,
+}
+
+impl NewtonCache {
+    fn get(&mut self, id: (WindowKey, usize), bounds: (f64, f64)) -> Option<Rc<NewtonWindow>> {
+        let entry = self.entries.get_mut(&id)?;
+        if entry.bounds != bounds {
+            return None;
+        }
+        self.recency.remove(&entry.tick);
+        self.tick += 1;
+        entry.tick = self.tick;
+        self.recency.insert(self.tick, id);
+        Some(entry.window.clone())
+    }
+
+    fn insert(&mut self, id: (WindowKey, usize), bounds: (f64, f64), window: Rc<NewtonWindow>) {
+        if let Some(old) = self.entries.remove(&id) {
+            self.recency.remove(&old.tick);
+        }
+        while self.entries.len() >= self.capacity {
+            match self.recency.pop_first() {
+                Some((_, oldest)) => {
+                    self.entries.remove(&oldest);
+                }
+                None => break,
+            }
+        }
+        self.tick += 1;
+        self.recency.insert(self.tick, id);
+        self.entries.insert(
+            id,
+            NewtonEntry {
+                tick: self.tick,
+                bounds,
+                window,
+            },
+        );
+    }
+
+    #[cfg(test)]
+    fn len(&self) -> usize {
+        self.entries.len()
+    }
+}
+
+thread_local! {
+    static LAST_WINDOWS: RefCell<WindowCache> = const {
+        RefCell::new(WindowCache {
+            enabled: true,
+            next: 0,
+            slots: [NO_WINDOW; NUM_CACHED_WINDOWS],
+        })
+    };
+
+    static NEWTON_WINDOWS: RefCell<NewtonCache> = RefCell::new(NewtonCache::default());
+
+    /// Newton window capacity of the Almanac whose data is being evaluated by this thread
+    static NEWTON_CAPACITY: Cell<usize> = const { Cell::new(0) };
+}
+
+/// Enables or disables the interpolation window cache of the Hermite Type 13 and Lagrange Type 9 data sets for the current thread, and clears it.
+///
+/// When enabled (the default), the last few interpolation windows used by this thread are remembered, such that
+/// sequential queries between the same two records skip both the search in the epoch data and the copy of the samples.
+pub fn set_interpolation_window_cache(enabled: bool) {
+    LAST_WINDOWS.with(|cache| {
+        let mut cache = cache.borrow_mut();
+        cache.enabled = enabled;
+        cache.slots = [NO_WINDOW; NUM_CACHED_WINDOWS];
+    });
+    NEWTON_WINDOWS.with(|cache| *cache.borrow_mut() = NewtonCache::default());
+}
+
+/// Restores the previous Newton window capacity of this thread when dropped, including if the evaluation panics.
+struct CapacityGuard(usize);
+
+impl Drop for CapacityGuard {
+    fn drop(&mut self) {
+        NEWTON_CAPACITY.with(|capacity| capacity.set(self.0));
+    }
+}
+
+/// Calls `f` with at most `capacity` interpolation windows whose Newton coefficients are kept by the current thread.
+///
+/// The capacity is a setting of the Almanac, and this is called around each evaluation of its data, such that it applies to every thread evaluating it.
+pub(crate) fn with_newton_window_capacity<T>(capacity: usize, f: impl FnOnce() -> T) -> T {
+    let _guard = CapacityGuard(NEWTON_CAPACITY.with(|prev| prev.replace(capacity)));
+    f()
+}
+
+/// Returns the interpolant of the data set with this key previously used for the provided epoch, if any.
+pub(crate) fn cached_window(key: WindowKey, epoch_data: &[f64], et_s: f64) -> Option<Interpolant> {
+    LAST_WINDOWS.with(|cache| {
+        let cache = cache.borrow();
+        if !cache.enabled {
+            return None;
+        }
+        // Windows used with another Newton window capacity are interpolated differently.
+        let newton = NEWTON_CAPACITY.with(Cell::get) > 0;
+        cache.slots.iter().flatten().find_map(|slot| {
+            let hit = slot.key == key
+                && slot.start_et_s < et_s
+                && et_s < slot.end_et_s
+                // Also guard against a data set which was not loaded as a DAF.
+                && epoch_data.get(slot.idx - 1) == Some(&slot.start_et_s)
+                && epoch_data.get(slot.idx) == Some(&slot.end_et_s)
+                && matches!(slot.interpolant, Interpolant::Newton(_)) == newton;
+            hit.then(|| slot.interpolant.clone())
+        })
+    })
+}
+
+/// Remembers the interpolant used for the epochs which are inserted at `idx` in the epoch data.
+pub(crate) fn store_window(
+    key: WindowKey,
+    epoch_data: &[f64],
+    idx: usize,
+    interpolant: &Interpolant,
+) {
+    if idx == 0 || idx >= epoch_data.len() {
+        // Queries outside of the epoch data (within the tolerance) are not cached.
+        return;
+    }
+    LAST_WINDOWS.with(|cache| {
+        let mut cache = cache.borrow_mut();
+        if !cache.enabled {
+            return;
+        }
+        let next = cache.next;
+        cache.slots[next] = Some(CachedWindow {
+            key,
+            idx,
+            start_et_s: epoch_data[idx - 1],
+            end_et_s: epoch_data[idx],
+            interpolant: interpolant.clone(),
+        });
+        cache.next = (next + 1) % NUM_CACHED_WINDOWS;
+    });
+}
+
+/// Returns the interpolant for the epochs which are inserted at `idx` in the epoch data, and remembers it for the next queries.
+///
+/// The samples are only gathered if needed: if the Newton coefficients of this window are already known, they are reused.
+pub(crate) fn interpolant<G, N>(
+    key: WindowKey,
+    epoch_data: &[f64],
+    idx: usize,
+    gather: G,
+    newton: N,
+) -> Result<Interpolant, InterpolationError>
+where
+    G: FnOnce() -> Result<SampleWindow, InterpolationError>,
+    N: FnOnce(&SampleWindow) -> Result<NewtonWindow, InterpolationError>,
+{
+    let capacity = NEWTON_CAPACITY.with(Cell::get);
+    let interpolant = if capacity == 0 || idx == 0 || idx >= epoch_data.len() {
+        Interpolant::Samples(gather()?)
+    } else {
+        let bounds = (epoch_data[idx - 1], epoch_data[idx]);
+        let cached = NEWTON_WINDOWS.with(|cache| cache.borrow_mut().get((key, idx), bounds));
+        match cached {
+            Some(window) => Interpolant::Newton(window),
+            None => {
+                let window = Rc::new(newton(&gather()?)?);
+                NEWTON_WINDOWS.with(|cache| {
+                    let mut cache = cache.borrow_mut();
+                    cache.capacity = capacity;
+                    cache.insert((key, idx), bounds, window.clone())
+                });
+                Interpolant::Newton(window)
+            }
+        }
+    };
+
+    store_window(key, epoch_data, idx, &interpolant);
+
+    Ok(interpolant)
+}
+
+#[cfg(test)]
+mod ut_window {
+    use super::*;
+
+    #[test]
+    fn directory_search() {
+        let epoch_data: Vec<f64> = (0..1050).map(|i| i as f64 * 10.0).collect();
+        // Every 100th epoch
+        let epoch_registry: Vec<f64> = (1..=10).map(|i| epoch_data[i * 100 - 1]).collect();
+        let bogus_registry = vec![5.0; 10];
+
+        for et_s in [
+            -1.0, 0.0, 5.0, 990.0, 995.0, 1000.0, 5555.0, 10480.0, 10490.0, 1e6,
+        ] {
+            let expected = search_epochs(&epoch_data, &[], et_s);
+            assert_eq!(search_epochs(&epoch_data, &epoch_registry, et_s), expected);
+            assert_eq!(search_epochs(&epoch_data, &bogus_registry, et_s), expected);
+        }
+        assert_eq!(
+            search_epochs(&epoch_data, &epoch_registry, 5555.0),
+            Err(556)
+        );
+        assert_eq!(search_epochs(&epoch_data, &epoch_registry, 990.0), Ok(99));
+    }
+
+    #[test]
+    fn window_cache() {
+        let state_data = [0.0; 6];
+        let epoch_data = [0.0, 10.0, 20.0];
+        let key = window_key(&state_data, &epoch_data);
+        let mut window = SampleWindow::gather(&epoch_data, 0, 0, |_| unreachable!()).unwrap();
+        window.xs[0] = 1.0;
+
+        let window = Interpolant::Samples(window);
+
+        set_interpolation_window_cache(true);
+        assert_eq!(cached_window(key, &epoch_data, 15.0), None);
+        store_window(key, &epoch_data, 2, &window);
+        assert_eq!(cached_window(key, &epoch_data, 15.0), Some(window.clone()));
+        // Only strictly between the two records
+        assert_eq!(cached_window(key, &epoch_data, 10.0), None);
+        assert_eq!(cached_window(key, &epoch_data, 20.0), None);
+        assert_eq!(cached_window(key, &epoch_data, 5.0), None);
+        // Not for other data
+        assert_eq!(cached_window((0, 0, 3, key.3), &epoch_data, 15.0), None);
+        assert_eq!(cached_window(key, &[0.0, 10.0, 30.0], 15.0), None);
+        // Nor once DAF data was created or modified, even at the same address
+        invalidate_windows();
+        let new_key = window_key(&state_data, &epoch_data);
+        assert_ne!(new_key, key);
+        assert_eq!(cached_window(new_key, &epoch_data, 15.0), None);
+
+        set_interpolation_window_cache(false);
+        assert_eq!(cached_window(key, &epoch_data, 15.0), None);
+        store_window(key, &epoch_data, 2, &window);
+        assert_eq!(cached_window(key, &epoch_data, 15.0), None);
+        set_interpolation_window_cache(true);
+    }
+
+    #[test]
+    fn newton_lru() {
+        let window = |x: f64| {
+            Rc::new(NewtonWindow {
+                polynomials: vec![NewtonPolynomial::lagrange(&[0.0, 1.0], &[x, x]).unwrap()],
+            })
+        };
+        let key = (1, 2, 3, 0);
+        let mut cache = NewtonCache {
+            capacity: 2,
+            ..Default::default()
+        };
+
+        cache.insert((key, 1), (0.0, 1.0), window(1.0));
+        cache.insert((key, 2), (1.0, 2.0), window(2.0));
+        assert_eq!(cache.len(), 2);
+        // Wrong bounds means that the data changed
+        assert_eq!(cache.get((key, 1), (0.0, 1.5)), None);
+        // Use the first window so that the second is the least recently used
+        assert_eq!(cache.get((key, 1), (0.0, 1.0)), Some(window(1.0)));
+
+        cache.insert((key, 3), (2.0, 3.0), window(3.0));
+        assert_eq!(cache.len(), 2);
+        assert_eq!(cache.get((key, 2), (1.0, 2.0)), None);
+        assert_eq!(cache.get((key, 1), (0.0, 1.0)), Some(window(1.0)));
+        assert_eq!(cache.get((key, 3), (2.0, 3.0)), Some(window(3.0)));
+
+        // Reducing the capacity evicts on the next insertion
+        cache.capacity = 1;
+        cache.insert((key, 4), (3.0, 4.0), window(4.0));
+        assert_eq!(cache.len(), 1);
+        assert_eq!(cache.get((key, 4), (3.0, 4.0)), Some(window(4.0)));
+    }
+}
@@ -0,0 +1,315 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use std::collections::HashMap;
+use std::sync::Arc;
+
+use hifitime::Epoch;
+
+use super::daf::{GenericDAF, MutKind};
+use super::{DAFError, NAIFSummaryRecord};
+use crate::NaifId;
+
+/// Location and validity of a summary in a set of loaded DAF files.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct IndexedSummary {
+    pub start_epoch: Epoch,
+    pub end_epoch: Epoch,
+    /// Index of the DAF file where this summary is defined, e.g. the SPK number in the Almanac
+    pub daf_no: usize,
+    /// Index of the summary in that DAF file
+    pub idx: usize,
+    /// Priority of this summary, the highest rank is used when several summaries are valid at the same epoch.
+    rank: u32,
+}
+
+impl IndexedSummary {
+    fn contains(&self, epoch: Epoch) -> bool {
+        epoch >= self.start_epoch && epoch <= self.end_epoch
+    }
+}
+
+/// An index of the summaries of several DAF files, grouped by NAIF ID and sorted by epoch.
+///
+/// The index stores, for each ID, a table of intervals whose interiors do not overlap and which is sorted by start epoch.
+/// The priority between overlapping summaries is resolved when the DAF is inserted, following the SPICE rule:
+/// the last loaded file wins, and within a file the first matching summary wins (as in `summary_from_id_at_epoch`).
+/// Finding the summary valid at a given epoch is then a binary search instead of a scan of every summary of every file.
+///
+/// DAF files must be inserted in their loading order.
+///
+/// The names of the summaries are decoded once, when the DAF is inserted, such that summaries can also be found by name
+/// without decoding and comparing every name of every file.
+///
+/// Clones of an index share their tables: cloning is a reference count increment, and inserting a DAF in a clone
+/// only copies the tables of the IDs and names of that DAF, so its cost does not depend on the size of the other DAF files.
+#[derive(Clone, Debug, Default, PartialEq)]
+pub struct SummaryIndex {
+    by_id: Arc<HashMap<NaifId, Arc<Vec<IndexedSummary>>>>,
+    /// For each summary name, the first summary with that name in each DAF file, in loading order.
+    by_name: Arc<HashMap<Arc<str>, Arc<Vec<IndexedSummary>>>>,
+    num_indexed: usize,
+    next_rank: u32,
+}
+
+impl SummaryIndex {
+    /// Returns the number of DAF files in this index.
+    pub fn num_indexed(&self) -> usize {
+        self.num_indexed
+    }
+
+    /// Returns true if nothing is indexed.
+    pub fn is_empty(&self) -> bool {
+        self.by_id.is_empty()
+    }
+
+    /// Adds all of the summaries of the provided DAF to the index, with a higher priority than everything already indexed.
+    ///
+    /// The DAF is counted as indexed even if its summaries cannot be read, since it would have no valid summary anyway.
+    pub fn insert<R: NAIFSummaryRecord, W: MutKind>(
+        &mut self,
+        daf_no: usize,
+        daf: &GenericDAF<R, W>,
+    ) -> Result<(), DAFError> {
+        self.num_indexed += 1;
+        let summaries = daf.data_summaries()?;
+        self.insert_names(daf_no, daf, summaries);
+        // Within a file, the first summary has the highest priority, so insert them in reverse.
+        for (idx, summary) in summaries.iter().enumerate().rev() {
+            if summary.is_empty() {
+                continue;
+            }
+            self.insert_interval(
+                summary.id(),
+                IndexedSummary {
+                    start_epoch: summary.start_epoch(),
+                    end_epoch: summary.end_epoch(),
+                    daf_no,
+                    idx,
+                    rank: self.next_rank,
+                },
+            );
+            self.next_rank += 1;
+        }
+        Ok(())
+    }
+
+    /// Indexes the first summary of each name in this DAF, as `summary_from_name` would find it.
+    fn insert_names<R: NAIFSummaryRecord, W: MutKind>(
+        &mut self,
+        daf_no: usize,
+        daf: &GenericDAF<R, W>,
+        summaries: &[R],
+    ) {
+        let (Ok(name_rcrd), Ok(file_rcrd)) = (daf.name_record(), daf.file_record()) else {
+            return;
+        };
+        let summary_size = file_rcrd.summary_size();
+        let num_entries = name_rcrd.num_entries(summary_size).min(summaries.len());
+        for (idx, summary) in summaries.iter().enumerate().take(num_entries) {
+            let name = name_rcrd.nth_name(idx, summary_size);
+            let by_name = Arc::make_mut(&mut self.by_name);
+            // Names are interned: each name is only allocated once, regardless of how many files define it.
+            if !by_name.contains_key(name) {
+                by_name.insert(Arc::from(name), Arc::default());
+            }
+            let Some(table) = by_name.get_mut(name) else {
+                continue;
+            };
+            if table.last().map_or(false, |item| item.daf_no == daf_no) {
+                // Only the first summary with that name is used.
+                continue;
+            }
+            Arc::make_mut(table).push(IndexedSummary {
+                start_epoch: summary.start_epoch(),
+                end_epoch: summary.end_epoch(),
+                daf_no,
+                idx,
+                rank: self.next_rank,
+            });
+        }
+    }
+
+    /// Inserts this summary such that it overwrites any part of the existing intervals that it overlaps.
+    fn insert_interval(&mut self, id: NaifId, new: IndexedSummary) {
+        let table = Arc::make_mut(Arc::make_mut(&mut self.by_id).entry(id).or_default());
+        // Both the start and end epochs of the table are sorted because the interiors of the intervals do not overlap.
+        let lo = table.partition_point(|item| item.end_epoch <= new.start_epoch);
+        let hi = table
+            .partition_point(|item| item.start_epoch < new.end_epoch)
+            .max(lo);
+
+        let mut replacement = Vec::with_capacity(3);
+        if lo < hi {
+            let first = table[lo];
+            if first.start_epoch < new.start_epoch {
+                replacement.push(IndexedSummary {
+                    end_epoch: new.start_epoch,
+                    ..first
+                });
+            }
+            replacement.push(new);
+            let last = table[hi - 1];
+            if last.end_epoch > new.end_epoch {
+                replacement.push(IndexedSummary {
+                    start_epoch: new.end_epoch,
+                    ..last
+                });
+            }
+        } else {
+            replacement.push(new);
+        }
+
+        table.splice(lo..hi, replacement);
+    }
+
+    /// Returns the DAF number and the index in that DAF of the highest priority summary of this ID valid at the provided epoch.
+    pub fn lookup(&self, id: NaifId, epoch: Epoch) -> Option<(usize, usize)> {
+        self.lookup_summary(id, epoch)
+            .map(|item| (item.daf_no, item.idx))
+    }
+
+    /// Returns the highest priority summary of this ID valid at the provided epoch.
+    /// Its epochs are those of the resolved interval, i.e. where this summary has the highest priority, not those of the original summary.
+    pub fn lookup_summary(&self, id: NaifId, epoch: Epoch) -> Option<&IndexedSummary> {
+        self.lookup_summary_scanned(id, epoch).0
+    }
+
+    /// Same as `lookup_summary`, but also returns the number of intervals which were examined.
+    pub fn lookup_summary_scanned(
+        &self,
+        id: NaifId,
+        epoch: Epoch,
+    ) -> (Option<&IndexedSummary>, usize) {
+        let Some(table) = self.by_id.get(&id) else {
+            return (None, 0);
+        };
+        let mut pos = table.partition_point(|item| item.start_epoch <= epoch);
+        // Adjacent intervals share their boundaries, so up to two (or more for instantaneous summaries) may contain this epoch.
+        let mut best: Option<&IndexedSummary> = None;
+        let mut scanned = 0;
+        while pos > 0 {
+            pos -= 1;
+            scanned += 1;
+            let item = &table[pos];
+            if !item.contains(epoch) {
+                break;
+            }
+            if best.map_or(true, |best| item.rank > best.rank) {
+                best = Some(item);
+            }
+        }
+        (best, scanned)
+    }
+
+    /// Returns the first summary with this name in the last loaded DAF file which defines that name.
+    pub fn lookup_name(&self, name: &str) -> Option<&IndexedSummary> {
+        self.by_name.get(name)?.last()
+    }
+
+    /// Returns the first summary with this name in the last loaded DAF file which defines that name, if it is valid at the
+    /// provided epoch, or else that of the previously loaded file, and so on.
+    pub fn lookup_name_at_epoch(&self, name: &str, epoch: Epoch) -> Option<&IndexedSummary> {
+        self.by_name
+            .get(name)?
+            .iter()
+            .rev()
+            .find(|item| item.contains(epoch))
+    }
+
+    /// Returns the intervals of validity of the provided ID, sorted by epoch, after the priority between summaries has been resolved.
+    pub fn intervals(&self, id: NaifId) -> &[IndexedSummary] {
+        self.by_id.get(&id).map_or(&[], |table| table.as_slice())
+    }
+}
+
+#[cfg(test)]
+mod ut_summary_index {
+    use super::*;
+
+    fn indexed(index: &mut SummaryIndex, start: f64, end: f64, daf_no: usize, idx: usize) {
+        let rank = index.next_rank;
+        index.next_rank += 1;
+        index.insert_interval(
+            1,
+            IndexedSummary {
+                start_epoch: Epoch::from_et_seconds(start),
+                end_epoch: Epoch::from_et_seconds(end),
+                daf_no,
+                idx,
+                rank,
+            },
+        );
+    }
+
+    fn at(index: &SummaryIndex, et_s: f64) -> Option<(usize, usize)> {
+        index.lookup(1, Epoch::from_et_seconds(et_s))
+    }
+
+    #[test]
+    fn overlapping_priority() {
+        let mut index = SummaryIndex::default();
+        assert_eq!(index.lookup(1, Epoch::from_et_seconds(0.0)), None);
+
+        indexed(&mut index, 0.0, 100.0, 0, 0);
+        indexed(&mut index, 20.0, 40.0, 1, 0);
+        indexed(&mut index, 30.0, 60.0, 2, 0);
+        indexed(&mut index, 150.0, 200.0, 2, 1);
+
+        assert_eq!(at(&index, -1.0), None);
+        assert_eq!(at(&index, 0.0), Some((0, 0)));
+        assert_eq!(at(&index, 19.9), Some((0, 0)));
+        // Boundaries are inclusive and the highest priority wins
+        assert_eq!(at(&index, 20.0), Some((1, 0)));
+        assert_eq!(at(&index, 30.0), Some((2, 0)));
+        assert_eq!(at(&index, 60.0), Some((2, 0)));
+        assert_eq!(at(&index, 60.1), Some((0, 0)));
+        assert_eq!(at(&index, 100.0), Some((0, 0)));
+        assert_eq!(at(&index, 120.0), None);
+        assert_eq!(at(&index, 150.0), Some((2, 1)));
+        assert_eq!(at(&index, 200.0), Some((2, 1)));
+        assert_eq!(at(&index, 200.001), None);
+
+        // A new interval covering everything hides all of the others
+        indexed(&mut index, -10.0, 300.0, 3, 0);
+        assert_eq!(index.intervals(1).len(), 1);
+        assert_eq!(at(&index, 30.0), Some((3, 0)));
+    }
+
+    #[test]
+    fn shared_tables() {
+        let mut index = SummaryIndex::default();
+        indexed(&mut index, 0.0, 100.0, 0, 0);
+
+        // Updating a clone leaves the original unchanged.
+        let mut clone = index.clone();
+        assert!(Arc::ptr_eq(&index.by_id, &clone.by_id));
+        indexed(&mut clone, 20.0, 40.0, 1, 0);
+        assert_eq!(at(&clone, 30.0), Some((1, 0)));
+        assert_eq!(at(&index, 30.0), Some((0, 0)));
+        assert_eq!(index.intervals(1).len(), 1);
+    }
+
+    #[test]
+    fn instantaneous_summary() {
+        let mut index = SummaryIndex::default();
+        indexed(&mut index, 0.0, 100.0, 0, 0);
+        indexed(&mut index, 50.0, 50.0, 1, 0);
+
+        assert_eq!(at(&index, 49.0), Some((0, 0)));
+        assert_eq!(at(&index, 50.0), Some((1, 0)));
+        assert_eq!(at(&index, 51.0), Some((0, 0)));
+
+        // Overwriting it again restores the original priority
+        indexed(&mut index, 0.0, 100.0, 2, 0);
+        assert_eq!(at(&index, 50.0), Some((2, 0)));
+        assert_eq!(index.intervals(1).len(), 1);
+    }
+}
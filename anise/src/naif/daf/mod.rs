@@ -18,10 +18,13 @@ use snafu::prelude::*;
 use zerocopy::{AsBytes, FromBytes};
 
 pub(crate) const RCRD_LEN: usize = 1024;
+pub mod checksum;
 #[allow(clippy::module_inception)]
 pub mod daf;
 mod data_types;
+pub mod index;
 pub mod mut_daf;
+pub mod writer;
 pub use data_types::DataType as DafDataType;
 pub mod file_record;
 pub mod name_record;
@@ -29,7 +32,10 @@ pub mod summary_record;
 // Defines the supported data types
 pub mod datatypes;
 
+pub use checksum::{BlockChecksums, LazyIntegrity};
 pub use daf::DAF;
+pub use index::SummaryIndex;
+pub use writer::DAFWriter;
 
 use crate::errors::DecodingError;
 use core::fmt::Debug;
@@ -225,6 +231,13 @@ pub enum DAFError {
     InvalidIndex { kind: &'static str, idx: usize },
     #[snafu(display("could not build data vector of type DAF/{kind}"))]
     DataBuildError { kind: &'static str },
+    #[snafu(display("DAF/{kind}: summary record is full ({max} summaries)"))]
+    SummaryRecordFull { kind: &'static str, max: usize },
+    #[snafu(display("DAF/{kind}: unsupported file layout: {reason}"))]
+    UnsupportedLayout {
+        kind: &'static str,
+        reason: &'static str,
+    },
 }
 
 // Manual implementation of PartialEq because IOError does not derive it, sadly.
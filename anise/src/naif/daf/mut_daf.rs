@@ -11,13 +11,15 @@
 use core::{marker::PhantomData, ops::Deref};
 
 use super::{
-    daf::MutDAF, DAFError, DecodingNameSnafu, IOSnafu, NAIFDataSet, NAIFSummaryRecord, NameRecord,
-    RCRD_LEN,
+    checksum, daf::MutDAF, DAFError, DecodingNameSnafu, IOSnafu, NAIFDataSet, NAIFSummaryRecord,
+    NameRecord, RCRD_LEN,
 };
 use crate::{
     errors::{DecodingError, InputOutputError},
     file2heap,
-    naif::daf::{file_record::FileRecordError, NAIFRecord, SummaryRecord},
+    naif::daf::{
+        datatypes::invalidate_windows, file_record::FileRecordError, NAIFRecord, SummaryRecord,
+    },
     DBL_SIZE,
 };
 use bytes::BytesMut;
@@ -29,12 +31,14 @@ use zerocopy::AsBytes;
 impl<R: NAIFSummaryRecord> MutDAF<R> {
     /// Parse the provided bytes as a SPICE Double Array File
     pub fn parse<B: Deref<Target = [u8]>>(bytes: B) -> Result<Self, DAFError> {
-        let crc32_checksum = crc32fast::hash(&bytes);
+        let crc32_checksum = checksum::crc32(&bytes);
         let mut buf = BytesMut::with_capacity(0);
         buf.extend(bytes.iter());
+        invalidate_windows();
         let me = Self {
             bytes: buf,
             crc32_checksum,
+            lazy_integrity: None,
             _daf_type: PhantomData,
         };
         // Check that these calls will succeed.
@@ -142,6 +146,8 @@ impl<R: NAIFSummaryRecord> MutDAF<R> {
         orig_summary_bytes.copy_from_slice(&summary_bytes);
 
         self.bytes = BytesMut::from_iter(new_bytes);
+        // The data sets of this DAF moved, and the memory of the previous ones may be reused.
+        invalidate_windows();
 
         Ok(())
     }
@@ -210,6 +216,8 @@ impl<R: NAIFSummaryRecord> MutDAF<R> {
         orig_summary_bytes.copy_from_slice(&summary_bytes);
 
         self.bytes = BytesMut::from_iter(new_bytes);
+        // The data sets of this DAF moved, and the memory of the previous ones may be reused.
+        invalidate_windows();
 
         Ok(())
     }
@@ -38,4 +38,9 @@ impl SummaryRecord {
     pub fn is_final_record(&self) -> bool {
         self.next_record() == 0
     }
+
+    /// Sets the number of summaries in this record (used when modifying a DAF).
+    pub fn set_num_summaries(&mut self, num_summaries: usize) {
+        self.num_summaries = num_summaries as f64;
+    }
 }
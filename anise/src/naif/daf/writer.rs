@@ -0,0 +1,370 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::marker::PhantomData;
+use hifitime::Epoch;
+use log::debug;
+use snafu::ResultExt;
+use std::fs::{File, OpenOptions};
+use std::io::{Read, Seek, SeekFrom, Write};
+use zerocopy::{AsBytes, FromBytes};
+
+use super::{
+    datatypes::invalidate_windows, file_record::FileRecordError, DAFError, FileRecord,
+    FileRecordSnafu, NAIFDataSet, NAIFRecord, NAIFSummaryRecord, NameRecord, SummaryRecord,
+    RCRD_LEN,
+};
+use crate::{errors::InputOutputError, DBL_SIZE};
+
+/// Edits a DAF file in place, only writing the affected data and the file, summary, and name records.
+///
+/// Contrary to a [crate::naif::daf::daf::MutDAF], the file is never loaded nor rewritten in full, so appending a segment to a large
+/// file only costs the size of that segment. The data of a new segment is written after the last data of the file; the summary, name,
+/// and file records are written once the data is written, such that an interrupted write leaves the previous segments intact.
+///
+/// Like the rest of ANISE, only DAF files with a single summary record are supported.
+///
+/// # Warning
+/// Replacing a segment in place modifies data which may be used by other readers. A file loaded with the unsafe `DAF::load_mmap` must not be edited
+/// while it is mapped, as required by that function.
+pub struct DAFWriter<R: NAIFSummaryRecord> {
+    file: File,
+    path: String,
+    file_record: FileRecord,
+    summary_record: SummaryRecord,
+    /// All of the summary slots of the summary record, used or not
+    summaries: Vec<R>,
+    name_record: NameRecord,
+    _daf_type: PhantomData<R>,
+}
+
+impl<R: NAIFSummaryRecord> DAFWriter<R> {
+    /// Opens the provided DAF file for edition, reading only its file, summary, and name records.
+    pub fn open(path: &str) -> Result<Self, DAFError> {
+        let io_err = |action: &str, e: std::io::Error| DAFError::IO {
+            action: format!("{action} {path:?}"),
+            source: InputOutputError::IOError { kind: e.kind() },
+        };
+
+        let mut file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .open(path)
+            .map_err(|e| io_err("opening", e))?;
+
+        let mut rcrd = [0_u8; RCRD_LEN];
+        file.read_exact(&mut rcrd)
+            .map_err(|e| io_err("reading file record of", e))?;
+        let file_record = FileRecord::read_from(&rcrd[..FileRecord::SIZE]).unwrap();
+        if file_record.is_empty() {
+            return Err(DAFError::FileRecord {
+                kind: R::NAME,
+                source: FileRecordError::EmptyRecord,
+            });
+        }
+        file_record
+            .endianness()
+            .context(FileRecordSnafu { kind: R::NAME })?;
+
+        let summary_offset = (file_record.fwrd_idx() - 1) * RCRD_LEN;
+        file.seek(SeekFrom::Start(summary_offset as u64))
+            .and_then(|_| file.read_exact(&mut rcrd))
+            .map_err(|e| io_err("reading summary record of", e))?;
+
+        let summary_record = SummaryRecord::read_from(&rcrd[..SummaryRecord::SIZE]).unwrap();
+        if !summary_record.is_final_record() {
+            return Err(DAFError::UnsupportedLayout {
+                kind: R::NAME,
+                reason: "more than one summary record",
+            });
+        }
+        let summaries = rcrd[SummaryRecord::SIZE..]
+            .chunks_exact(R::SIZE)
+            .map(|bytes| R::read_from(bytes).unwrap())
+            .collect();
+
+        file.read_exact(&mut rcrd)
+            .map_err(|e| io_err("reading name record of", e))?;
+        let name_record = NameRecord::read_from(&rcrd[..]).unwrap();
+
+        Ok(Self {
+            file,
+            path: path.to_string(),
+            file_record,
+            summary_record,
+            summaries,
+            name_record,
+            _daf_type: PhantomData,
+        })
+    }
+
+    /// Returns the summaries of the segments of this file.
+    pub fn summaries(&self) -> &[R] {
+        &self.summaries[..self.num_summaries()]
+    }
+
+    /// Returns the name of the n-th segment of this file.
+    pub fn name(&self, idx: usize) -> &str {
+        self.name_record
+            .nth_name(idx, self.file_record.summary_size())
+    }
+
+    /// Appends a new segment to this file and returns its index.
+    ///
+    /// The start and end indexes of the provided summary are set to the location of the new data.
+    pub fn append_segment<'a, S: NAIFDataSet<'a>>(
+        &mut self,
+        name: &str,
+        mut summary: R,
+        data: &S,
+    ) -> Result<usize, DAFError> {
+        let idx = self.num_summaries();
+        if idx == self.summaries.len() {
+            return Err(DAFError::SummaryRecordFull {
+                kind: R::NAME,
+                max: self.summaries.len(),
+            });
+        }
+
+        let data = data
+            .to_f64_daf_vec()
+            .or(Err(DAFError::DataBuildError { kind: R::NAME }))?;
+
+        let start = self.free_address();
+        self.write_data(start, &data)?;
+        summary.update_indexes(start, start + data.len() - 1);
+
+        self.summaries[idx] = summary;
+        self.name_record
+            .set_nth_name(idx, self.file_record.summary_size(), name);
+        self.write_records()?;
+
+        Ok(idx)
+    }
+
+    /// Replaces the data of the n-th segment of this file, and updates the epochs of its summary.
+    ///
+    /// If the new data is not longer than the previous one, it is written in place of the previous data. Otherwise, it is
+    /// appended after the last data of the file and the previous data is left unused.
+    pub fn replace_segment<'a, S: NAIFDataSet<'a>>(
+        &mut self,
+        idx: usize,
+        data: &S,
+        start_epoch: Epoch,
+        end_epoch: Epoch,
+    ) -> Result<(), DAFError> {
+        let summary = *self
+            .summaries()
+            .get(idx)
+            .ok_or(DAFError::InvalidIndex { idx, kind: R::NAME })?;
+
+        let data = data
+            .to_f64_daf_vec()
+            .or(Err(DAFError::DataBuildError { kind: R::NAME }))?;
+
+        let orig_len = summary.end_index() + 1 - summary.start_index();
+        let start = if data.len() <= orig_len {
+            summary.start_index()
+        } else {
+            self.free_address()
+        };
+        self.write_data(start, &data)?;
+
+        let summary = &mut self.summaries[idx];
+        summary.update_indexes(start, start + data.len() - 1);
+        summary.update_epochs(start_epoch, end_epoch);
+        self.write_records()
+    }
+
+    /// Removes the n-th segment of this file from its summary and name records.
+    ///
+    /// The data of that segment is left unused in the file.
+    pub fn remove_segment(&mut self, idx: usize) -> Result<(), DAFError> {
+        let num_summaries = self.num_summaries();
+        if idx >= num_summaries {
+            return Err(DAFError::InvalidIndex { idx, kind: R::NAME });
+        }
+
+        let summary_size = self.file_record.summary_size();
+        for sno in idx..num_summaries - 1 {
+            self.summaries[sno] = self.summaries[sno + 1];
+            let next_name = self.name(sno + 1).to_string();
+            self.name_record.set_nth_name(sno, summary_size, &next_name);
+        }
+        self.summaries[num_summaries - 1] = R::default();
+        self.name_record
+            .set_nth_name(num_summaries - 1, summary_size, "");
+
+        self.write_records()
+    }
+
+    /// Number of segments in this file.
+    ///
+    /// Trailing empty summaries are not counted, since files edited by a MutDAF do not update the number of summaries.
+    fn num_summaries(&self) -> usize {
+        let mut num = self
+            .summary_record
+            .num_summaries()
+            .min(self.summaries.len());
+        while num > 0 && self.summaries[num - 1].is_empty() {
+            num -= 1;
+        }
+        num
+    }
+
+    /// First free address of this file (in doubles, starting at one), after all of the data of its segments.
+    fn free_address(&self) -> usize {
+        self.summaries()
+            .iter()
+            .map(|summary| summary.end_index() + 1)
+            .fold(self.file_record.free_addr as usize, usize::max)
+    }
+
+    /// Writes the provided data at the provided address (in doubles, starting at one), keeping the file a whole number of records.
+    fn write_data(&mut self, address: usize, data: &[f64]) -> Result<(), DAFError> {
+        let data_end = ((address - 1 + data.len()) * DBL_SIZE) as u64;
+        self.file
+            .seek(SeekFrom::Start(((address - 1) * DBL_SIZE) as u64))
+            .and_then(|_| self.file.write_all(data.as_bytes()))
+            .and_then(|_| self.file.metadata())
+            .and_then(|metadata| {
+                let rcrd_len = RCRD_LEN as u64;
+                let padded_len = metadata.len().max(data_end).div_ceil(rcrd_len) * rcrd_len;
+                if padded_len > metadata.len() {
+                    self.file.set_len(padded_len)?;
+                }
+                self.file.sync_data()
+            })
+            .map_err(|e| self.io_err("writing data to", e))?;
+
+        // The file may be memory mapped by data sets of this process, whose cached windows would now be stale.
+        invalidate_windows();
+
+        let free_addr = address + data.len();
+        if free_addr > self.file_record.free_addr as usize {
+            self.file_record.free_addr = free_addr as u32;
+        }
+        debug!(
+            "wrote {} doubles at address {address} of {}",
+            data.len(),
+            self.path
+        );
+        Ok(())
+    }
+
+    /// Writes the summary, name, and file records of this file.
+    fn write_records(&mut self) -> Result<(), DAFError> {
+        let num_summaries = self.num_summaries();
+        self.summary_record.set_num_summaries(num_summaries);
+
+        let mut summary_rcrd = Vec::with_capacity(RCRD_LEN);
+        summary_rcrd.extend_from_slice(self.summary_record.as_bytes());
+        for summary in &self.summaries {
+            summary_rcrd.extend_from_slice(summary.as_bytes());
+        }
+        summary_rcrd.resize(RCRD_LEN, 0x0);
+
+        let mut file_rcrd = Vec::from(self.file_record.as_bytes());
+        file_rcrd.resize(RCRD_LEN, 0x0);
+
+        let summary_offset = ((self.file_record.fwrd_idx() - 1) * RCRD_LEN) as u64;
+        self.file
+            .seek(SeekFrom::Start(summary_offset))
+            .and_then(|_| self.file.write_all(&summary_rcrd))
+            .and_then(|_| self.file.write_all(self.name_record.as_bytes()))
+            .and_then(|_| self.file.seek(SeekFrom::Start(0)))
+            .and_then(|_| self.file.write_all(&file_rcrd[..FileRecord::SIZE]))
+            .and_then(|_| self.file.sync_data())
+            .map_err(|e| self.io_err("writing records of", e))
+    }
+
+    fn io_err(&self, action: &str, e: std::io::Error) -> DAFError {
+        DAFError::IO {
+            action: format!("{action} {:?}", self.path),
+            source: InputOutputError::IOError { kind: e.kind() },
+        }
+    }
+}
+
+#[cfg(test)]
+mod ut_writer {
+    use super::DAFWriter;
+    use crate::naif::daf::{datatypes::HermiteSetType13, NAIFDataSet, NAIFSummaryRecord};
+    use crate::naif::spk::summary::SPKSummaryRecord;
+    use crate::naif::SPK;
+    use hifitime::Unit;
+
+    #[test]
+    fn append_replace_remove() {
+        let path = "../target/ut-writer-gmat-hermite.bsp";
+        std::fs::copy("../data/gmat-hermite.bsp", path).unwrap();
+
+        let orig = SPK::load("../data/gmat-hermite.bsp").unwrap();
+        let orig_summary = orig.data_summaries().unwrap()[0];
+        let orig_data = orig.nth_data::<HermiteSetType13>(0).unwrap();
+        let orig_len = std::fs::metadata(path).unwrap().len();
+
+        // Append a copy of the first segment under another ID.
+        let mut writer = DAFWriter::<SPKSummaryRecord>::open(path).unwrap();
+        assert_eq!(writer.summaries().len(), 1);
+        let mut summary = orig_summary;
+        summary.target_id = -10000002;
+        assert_eq!(
+            writer
+                .append_segment("APPENDED", summary, &orig_data)
+                .unwrap(),
+            1
+        );
+        drop(writer);
+
+        let appended = SPK::load(path).unwrap();
+        assert!(appended.bytes.len() as u64 > orig_len);
+        assert_eq!(appended.bytes.len() % super::RCRD_LEN, 0);
+        let (new_summary, idx) = appended.summary_from_id(-10000002).unwrap();
+        assert_eq!(idx, 1);
+        assert!(new_summary.start_index() > orig_summary.end_index());
+        assert_eq!(appended.name_record().unwrap().nth_name(1, 5), "APPENDED");
+        if appended.nth_data::<HermiteSetType13>(1).unwrap() != orig_data {
+            panic!("appended data differs from original data");
+        }
+        if appended.nth_data::<HermiteSetType13>(0).unwrap() != orig_data {
+            panic!("original data modified by append");
+        }
+
+        // Rewrite the first segment in place with new epochs.
+        let mut writer = DAFWriter::<SPKSummaryRecord>::open(path).unwrap();
+        let new_end = orig_summary.end_epoch() - Unit::Second * 1;
+        writer
+            .replace_segment(0, &orig_data, orig_summary.start_epoch(), new_end)
+            .unwrap();
+        assert_eq!(
+            writer.summaries()[0].start_index(),
+            orig_summary.start_index()
+        );
+
+        // And remove it, such that the appended segment is the first one.
+        writer.remove_segment(0).unwrap();
+        assert_eq!(writer.summaries().len(), 1);
+        assert_eq!(writer.name(0), "APPENDED");
+        drop(writer);
+
+        let edited = SPK::load(path).unwrap();
+        assert_eq!(edited.bytes.len(), appended.bytes.len());
+        assert!(edited.summary_from_id(orig_summary.target_id).is_err());
+        assert_eq!(edited.summary_from_id(-10000002).unwrap().1, 0);
+        if edited.nth_data::<HermiteSetType13>(0).unwrap() != orig_data {
+            panic!("appended data modified by removal");
+        }
+        assert_eq!(
+            orig_data.to_f64_daf_vec().unwrap().len(),
+            orig_summary.end_index() + 1 - orig_summary.start_index()
+        );
+    }
+}
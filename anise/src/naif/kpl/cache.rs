@@ -0,0 +1,262 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::fmt;
+use std::collections::VecDeque;
+use std::path::Path;
+use std::sync::Mutex;
+
+use crate::structure::dataset::DataSetError;
+use crate::structure::{EulerParameterDataSet, PlanetaryDataSet};
+
+use super::parser::{convert_fk_str, convert_tpc_str, read_kpl};
+
+/// Default number of conversions kept by a [KPLCache] for each kind of data set.
+pub const DEFAULT_KPL_CACHE_ENTRIES: usize = 16;
+
+/// A converted data set, with the contents of the KPL files it was converted from.
+#[derive(Debug)]
+struct CacheEntry<T> {
+    digest: u64,
+    contents: Vec<Box<str>>,
+    dataset: T,
+}
+
+/// Conversions of a single kind of data set, from the least to the most recently inserted.
+#[derive(Debug)]
+struct CacheEntries<T> {
+    entries: VecDeque<CacheEntry<T>>,
+}
+
+impl<T> Default for CacheEntries<T> {
+    fn default() -> Self {
+        Self {
+            entries: VecDeque::new(),
+        }
+    }
+}
+
+impl<T: Clone> CacheEntries<T> {
+    fn get(&self, digest: u64, contents: &[&str]) -> Option<T> {
+        self.entries
+            .iter()
+            .find(|entry| {
+                entry.digest == digest
+                    && entry.contents.len() == contents.len()
+                    && entry
+                        .contents
+                        .iter()
+                        .zip(contents)
+                        .all(|(cached, content)| cached.as_ref() == *content)
+            })
+            .map(|entry| entry.dataset.clone())
+    }
+
+    fn insert(&mut self, digest: u64, contents: &[&str], dataset: T, max_entries: usize) {
+        if max_entries == 0 {
+            return;
+        }
+        while self.entries.len() >= max_entries {
+            self.entries.pop_front();
+        }
+        self.entries.push_back(CacheEntry {
+            digest,
+            contents: contents.iter().map(|content| Box::from(*content)).collect(),
+            dataset,
+        });
+    }
+}
+
+/// Digest of the contents of the KPL files of a conversion: their CRC32, and their total length.
+fn digest(contents: &[&str]) -> u64 {
+    let mut hasher = crc32fast::Hasher::new();
+    let mut len = 0_u64;
+    for content in contents {
+        hasher.update(&(content.len() as u64).to_le_bytes());
+        hasher.update(content.as_bytes());
+        len = len.wrapping_add(content.len() as u64);
+    }
+    (u64::from(hasher.finalize()) << 32) | (len & 0xFFFF_FFFF)
+}
+
+/// Caches the data sets converted from KPL files, keyed by the contents of these files, such that an unchanged text kernel is
+/// only parsed once, regardless of its path.
+///
+/// Entries are looked up by a digest of the contents, and then compared with the full contents, which each entry keeps a copy of:
+/// different kernels therefore never share a data set, even if their digests collide, which matters when the kernels are supplied
+/// by users. When full, the oldest entry is removed first.
+///
+/// The cache may be shared between threads: the conversions themselves are done outside of its lock.
+#[derive(Debug)]
+pub struct KPLCache {
+    max_entries: usize,
+    planetary: Mutex<CacheEntries<PlanetaryDataSet>>,
+    euler_parameters: Mutex<CacheEntries<EulerParameterDataSet>>,
+}
+
+impl Default for KPLCache {
+    fn default() -> Self {
+        Self::new(DEFAULT_KPL_CACHE_ENTRIES)
+    }
+}
+
+impl KPLCache {
+    /// Creates a cache which keeps up to `max_entries` conversions of each kind of data set.
+    pub fn new(max_entries: usize) -> Self {
+        Self {
+            max_entries,
+            planetary: Mutex::new(CacheEntries::default()),
+            euler_parameters: Mutex::new(CacheEntries::default()),
+        }
+    }
+
+    /// Returns the planetary data set converted from these KPL/TPC files, converting them if they are not cached, cf. [super::parser::convert_tpc].
+    pub fn convert_tpc<P: AsRef<Path> + fmt::Debug>(
+        &self,
+        pck: P,
+        gm: P,
+    ) -> Result<PlanetaryDataSet, DataSetError> {
+        self.convert_tpc_str(&read_kpl(pck)?, &read_kpl(gm)?)
+    }
+
+    /// Returns the planetary data set converted from the contents of these KPL/TPC files, converting them if they are not cached.
+    pub fn convert_tpc_str(&self, pck: &str, gm: &str) -> Result<PlanetaryDataSet, DataSetError> {
+        Self::get_or_convert(&self.planetary, self.max_entries, &[pck, gm], || {
+            convert_tpc_str(pck, gm)
+        })
+    }
+
+    /// Returns the Euler parameter data set converted from this KPL/FK file, converting it if it is not cached, cf. [super::parser::convert_fk].
+    pub fn convert_fk<P: AsRef<Path> + fmt::Debug>(
+        &self,
+        fk_file_path: P,
+    ) -> Result<EulerParameterDataSet, DataSetError> {
+        self.convert_fk_str(&read_kpl(fk_file_path)?)
+    }
+
+    /// Returns the Euler parameter data set converted from the contents of this KPL/FK file, converting it if it is not cached.
+    pub fn convert_fk_str(&self, fk: &str) -> Result<EulerParameterDataSet, DataSetError> {
+        Self::get_or_convert(&self.euler_parameters, self.max_entries, &[fk], || {
+            convert_fk_str(fk, false)
+        })
+    }
+
+    /// Returns the number of cached conversions.
+    pub fn len(&self) -> usize {
+        let planetary = self.planetary.lock().map_or(0, |e| e.entries.len());
+        let euler_parameters = self.euler_parameters.lock().map_or(0, |e| e.entries.len());
+        planetary + euler_parameters
+    }
+
+    /// Returns true if no conversion is cached.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Removes all of the cached conversions.
+    pub fn clear(&self) {
+        if let Ok(mut planetary) = self.planetary.lock() {
+            planetary.entries.clear();
+        }
+        if let Ok(mut euler_parameters) = self.euler_parameters.lock() {
+            euler_parameters.entries.clear();
+        }
+    }
+
+    fn get_or_convert<T: Clone, F>(
+        entries: &Mutex<CacheEntries<T>>,
+        max_entries: usize,
+        contents: &[&str],
+        convert: F,
+    ) -> Result<T, DataSetError>
+    where
+        F: FnOnce() -> Result<T, DataSetError>,
+    {
+        let digest = digest(contents);
+        if let Some(dataset) = entries
+            .lock()
+            .ok()
+            .and_then(|entries| entries.get(digest, contents))
+        {
+            return Ok(dataset);
+        }
+
+        let dataset = convert()?;
+        if let Ok(mut entries) = entries.lock() {
+            // Another thread may have converted the same files in the meantime.
+            if entries.get(digest, contents).is_none() {
+                entries.insert(digest, contents, dataset.clone(), max_entries);
+            }
+        }
+        Ok(dataset)
+    }
+}
+
+#[cfg(test)]
+mod ut_kpl_cache {
+    use super::*;
+    use crate::naif::kpl::parser::{convert_fk, convert_tpc};
+
+    #[test]
+    fn cached_conversions() {
+        let cache = KPLCache::new(2);
+
+        let pck08 = cache
+            .convert_tpc("../data/pck00008.tpc", "../data/gm_de431.tpc")
+            .unwrap();
+        let uncached = convert_tpc("../data/pck00008.tpc", "../data/gm_de431.tpc").unwrap();
+        assert_eq!(pck08.len(), uncached.len());
+        assert_eq!(pck08.get_by_id(399), uncached.get_by_id(399));
+        assert_eq!(cache.len(), 1);
+
+        // Same contents, so the very same conversion is returned.
+        let pck = std::fs::read_to_string("../data/pck00008.tpc").unwrap();
+        let gm = std::fs::read_to_string("../data/gm_de431.tpc").unwrap();
+        assert_eq!(cache.convert_tpc_str(&pck, &gm).unwrap(), pck08);
+        assert_eq!(cache.len(), 1);
+
+        // The order of the files matters.
+        assert!(cache.convert_tpc_str(&gm, &pck).is_ok());
+        assert_eq!(cache.len(), 2);
+
+        // Changing a value converts the files again.
+        let edited = pck.replace(
+            "BODY399_RADII     = ( 6378.14",
+            "BODY399_RADII     = ( 6378.15",
+        );
+        assert_ne!(edited, pck);
+        let edited = cache.convert_tpc_str(&edited, &gm).unwrap();
+        assert_eq!(
+            edited
+                .get_by_id(399)
+                .unwrap()
+                .shape
+                .unwrap()
+                .semi_major_equatorial_radius_km,
+            6378.15
+        );
+        // The oldest conversion was removed.
+        assert_eq!(cache.len(), 2);
+
+        let fk = cache.convert_fk("../data/moon_080317.txt").unwrap();
+        let uncached = convert_fk("../data/moon_080317.txt", false).unwrap();
+        assert_eq!(fk.len(), uncached.len());
+        assert_eq!(
+            fk.get_by_name("MOON_ME_DE421"),
+            uncached.get_by_name("MOON_ME_DE421")
+        );
+        assert_eq!(cache.len(), 3);
+
+        cache.clear();
+        assert!(cache.is_empty());
+
+        assert!(cache.convert_fk("../data/not_a_kernel.tf").is_err());
+    }
+}
@@ -59,12 +59,12 @@ impl KPLItem for FKItem {
                 }
                 Some(body_id) => {
                     // The parameter starts with the ID of the frame.
-                    let param = data
-                        .keyword
-                        .replace("TKFRAME_", "_")
-                        .replace("FRAME_", "_")
-                        .replace(&format!("_{body_id}_"), "");
-                    if let Ok(param) = Parameter::from_str(&param) {
+                    let onward = &data.keyword[data.keyword.find('_').unwrap() + 1..];
+                    let param = match onward.split_once('_') {
+                        Some((frame_id, param)) if frame_id.parse::<i32>() == Ok(body_id) => param,
+                        _ => onward,
+                    };
+                    if let Ok(param) = Parameter::from_str(param) {
                         self.data.insert(param, data.to_value());
                     } else {
                         warn!("Unknown parameter `{param}` -- ignoring");
@@ -16,11 +16,14 @@ use snafu::{whatever, Whatever};
 
 use self::parser::Assignment;
 
+pub mod cache;
 pub mod fk;
 
 pub mod parser;
 pub mod tpc;
 
+pub use cache::KPLCache;
+
 pub trait KPLItem: Debug + Default {
     type Parameter: Eq + Hash;
     /// The key used for fetching
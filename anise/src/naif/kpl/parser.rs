@@ -12,8 +12,7 @@
 
 use core::fmt;
 use std::collections::HashMap;
-use std::fs::File;
-use std::io::{BufRead, BufReader};
+use std::fs;
 use std::path::Path;
 
 use log::{error, info, warn};
@@ -39,103 +38,142 @@ enum BlockType {
     Data,
 }
 
+/// A keyword and its value, borrowed from the contents of a KPL file.
+///
+/// The value of an assignment which spans several lines includes all of these lines, new line characters included.
 #[derive(Debug, Clone, PartialEq, Eq)]
-pub struct Assignment {
-    pub keyword: String,
-    pub value: String,
+pub struct Assignment<'a> {
+    pub keyword: &'a str,
+    pub value: &'a str,
 }
 
-impl Assignment {
+/// Returns true for the characters which separate the items of a value: parentheses and commas delimit vectors, and single quotes delimit strings.
+fn is_value_separator(c: char) -> bool {
+    c.is_whitespace() || matches!(c, '(' | ')' | ',' | '\'')
+}
+
+impl Assignment<'_> {
     pub fn to_value(&self) -> KPLValue {
-        let value = &self.value;
-        // Sanitize the input
-        let value = value.
-            // Remove parentheses
-            // Convert remove the extra single quotes
-            // there usually aren't commas, only sometimes
-            replace(['(', ')', ',', '\''], "");
-
-        let vec: Vec<&str> = value.split_whitespace().filter(|s| !s.is_empty()).collect();
-        // If there are multiple items, we assume this is a vector
-        if vec.len() > 1 {
-            KPLValue::Matrix(
-                vec.iter()
-                    .map(|s| s.parse::<f64>().unwrap_or(0.0))
+        let mut items = self
+            .value
+            .split(is_value_separator)
+            .filter(|s| !s.is_empty());
+
+        match (items.next(), items.next()) {
+            // If there are multiple items, we assume this is a vector
+            (Some(first), Some(second)) => KPLValue::Matrix(
+                [first, second]
+                    .into_iter()
+                    .chain(items)
+                    .map(|s| lexical_core::parse::<f64>(s.as_bytes()).unwrap_or(0.0))
                     .collect(),
-            )
-        } else if vec.is_empty() {
-            // Return the original value as a string
-            KPLValue::String(self.value.clone())
-        } else {
+            ),
             // We have exactly one item, let's try to convert it as an integer first
-            if let Ok(as_int) = vec[0].parse::<i32>() {
-                KPLValue::Integer(as_int)
-            } else if let Ok(as_f64) = vec[0].parse::<f64>() {
-                KPLValue::Float(as_f64)
-            } else {
-                // Darn, let's default to string
-                KPLValue::String(value.clone())
+            (Some(item), None) => {
+                if let Ok(as_int) = lexical_core::parse::<i32>(item.as_bytes()) {
+                    KPLValue::Integer(as_int)
+                } else if let Ok(as_f64) = lexical_core::parse::<f64>(item.as_bytes()) {
+                    KPLValue::Float(as_f64)
+                } else {
+                    // Darn, let's default to string
+                    KPLValue::String(item.to_string())
+                }
             }
+            // Return the original value as a string
+            _ => KPLValue::String(self.value.to_string()),
         }
     }
 }
 
+/// Reads the KPL file at the provided path, and parses it with [parse_str].
 pub fn parse_file<P: AsRef<Path> + fmt::Debug, I: KPLItem>(
     file_path: P,
     show_comments: bool,
 ) -> Result<HashMap<i32, I>, DataSetError> {
-    let file =
-        File::open(&file_path).unwrap_or_else(|_| panic!("Failed to open file {file_path:?}"));
-    let reader = BufReader::new(file);
+    let contents = read_kpl(file_path)?;
+    Ok(parse_str(&contents, show_comments))
+}
+
+/// Parses the data blocks of a KPL file in a single pass over its contents, grouping the assignments by the key of the item they define.
+///
+/// Keywords and values are borrowed from the contents, and only the values are converted, as they are parsed by each item.
+pub fn parse_str<I: KPLItem>(contents: &str, show_comments: bool) -> HashMap<i32, I> {
+    let mut map = HashMap::new();
+    let mut add = |assignment: Assignment| {
+        let key = I::extract_key(&assignment);
+        if key != -1 {
+            // Otherwise, this is metadata
+            map.entry(key)
+                .or_insert_with(|| I::default())
+                .parse(assignment);
+        }
+    };
 
     let mut block_type = BlockType::Comment;
-    let mut assignments = vec![];
+    // The assignment being read: its keyword, and the range of its value in the contents
+    let mut pending: Option<(&str, usize, usize)> = None;
+    let mut offset = 0;
 
-    for line in reader.lines() {
-        let line = line.expect("Failed to read line");
+    for line in contents.split_inclusive('\n') {
+        offset += line.len();
         let tline = line.trim();
 
-        if tline.starts_with("\\begintext") {
-            block_type = BlockType::Comment;
-            continue;
-        } else if tline.starts_with("\\begindata") {
-            block_type = BlockType::Data;
+        if tline.starts_with("\\begintext") || tline.starts_with("\\begindata") {
+            // Values never span several blocks.
+            if let Some((keyword, value_start, value_end)) = pending.take() {
+                add(Assignment {
+                    keyword,
+                    value: contents[value_start..value_end].trim(),
+                });
+            }
+            block_type = if tline.starts_with("\\begintext") {
+                BlockType::Comment
+            } else {
+                BlockType::Data
+            };
             continue;
         }
 
         if block_type == BlockType::Comment && show_comments {
-            println!("{line}");
+            println!("{}", line.trim_end_matches(['\r', '\n']));
         } else if block_type == BlockType::Data {
-            let parts: Vec<&str> = line.split('=').map(|s| s.trim()).collect();
-            if parts.len() == 2 {
-                let keyword = parts[0];
-                let value = parts[1];
-                let assignment = Assignment {
-                    keyword: keyword.to_string(),
-                    value: value.to_string(),
-                };
-                assignments.push(assignment);
-            } else if let Some(mut assignment) = assignments.pop() {
-                // This is a continuation of the previous line, so let's grab the data and append the value we're reding now.
-                // We're adding the full line with all of the extra spaces because the parsing needs those delimiters to not bunch together all of the floats.
-                assignment.value += &line;
-                assignments.push(assignment);
+            match line.split_once('=') {
+                Some((keyword, value)) if !value.contains('=') => {
+                    if let Some((keyword, value_start, value_end)) = pending.take() {
+                        add(Assignment {
+                            keyword,
+                            value: contents[value_start..value_end].trim(),
+                        });
+                    }
+                    pending = Some((keyword.trim(), offset - value.len(), offset));
+                }
+                _ => {
+                    // This is a continuation of the previous line: its value now extends to the end of this line, such that
+                    // the line breaks keep delimiting the items.
+                    if let Some((_, _, value_end)) = pending.as_mut() {
+                        *value_end = offset;
+                    }
+                }
             }
         }
     }
-    // Now let's parse all of the assignments and put it into a pretty hash map.
-    let mut map = HashMap::new();
-    for item in assignments {
-        let key = I::extract_key(&item);
-        if key == -1 {
-            // This is metadata
-            continue;
-        }
-        map.entry(key).or_insert_with(|| I::default());
-        let body_map = map.get_mut(&key).unwrap();
-        body_map.parse(item);
+
+    if let Some((keyword, value_start, value_end)) = pending {
+        add(Assignment {
+            keyword,
+            value: contents[value_start..value_end].trim(),
+        });
     }
-    Ok(map)
+
+    map
+}
+
+/// Reads the contents of a KPL file.
+pub(crate) fn read_kpl<P: AsRef<Path> + fmt::Debug>(file_path: P) -> Result<String, DataSetError> {
+    fs::read_to_string(&file_path).map_err(|source| DataSetError::IO {
+        action: "reading KPL file",
+        source,
+    })
 }
 
 /// Converts two KPL/TPC files, one defining the planetary constants as text, and the other defining the gravity parameters, into the PlanetaryDataSet equivalent ANISE file.
@@ -144,10 +182,16 @@ pub fn convert_tpc<P: AsRef<Path> + fmt::Debug>(
     pck: P,
     gm: P,
 ) -> Result<PlanetaryDataSet, DataSetError> {
+    convert_tpc_str(&read_kpl(pck)?, &read_kpl(gm)?)
+}
+
+/// Converts the contents of two KPL/TPC files, one defining the planetary constants, and the other defining the gravity parameters,
+/// into the PlanetaryDataSet equivalent ANISE file. Refer to [convert_tpc] for details.
+pub fn convert_tpc_str(pck: &str, gm: &str) -> Result<PlanetaryDataSet, DataSetError> {
     let mut dataset = PlanetaryDataSet::default();
 
-    let gravity_data = parse_file::<_, TPCItem>(gm, false)?;
-    let mut planetary_data = parse_file::<_, TPCItem>(pck, false)?;
+    let gravity_data = parse_str::<TPCItem>(gm, false);
+    let mut planetary_data = parse_str::<TPCItem>(pck, false);
 
     for (key, value) in gravity_data {
         if let Some(planet_data) = planetary_data.get_mut(&key) {
@@ -315,10 +359,18 @@ pub fn convert_tpc<P: AsRef<Path> + fmt::Debug>(
 pub fn convert_fk<P: AsRef<Path> + fmt::Debug>(
     fk_file_path: P,
     show_comments: bool,
+) -> Result<EulerParameterDataSet, DataSetError> {
+    convert_fk_str(&read_kpl(fk_file_path)?, show_comments)
+}
+
+/// Converts the contents of a KPL/FK file into the EulerParameterDataSet equivalent ANISE file. Refer to [convert_fk] for details.
+pub fn convert_fk_str(
+    fk: &str,
+    show_comments: bool,
 ) -> Result<EulerParameterDataSet, DataSetError> {
     let mut dataset = EulerParameterDataSet::default();
 
-    let assignments = parse_file::<_, FKItem>(fk_file_path, show_comments)?;
+    let assignments = parse_str::<FKItem>(fk, show_comments);
 
     // Add all of the data into the data set
     for (id, item) in assignments {
@@ -25,8 +25,11 @@ impl KPLItem for TPCItem {
 
     fn extract_key(data: &Assignment) -> i32 {
         if data.keyword.starts_with("BODY") {
-            let parts: Vec<&str> = data.keyword.split('_').collect();
-            parts[0][4..].parse::<i32>().unwrap()
+            let body_info = match data.keyword.split_once('_') {
+                Some((body_info, _)) => body_info,
+                None => data.keyword,
+            };
+            body_info[4..].parse::<i32>().unwrap()
         } else {
             -1
         }
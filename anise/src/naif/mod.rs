@@ -17,7 +17,7 @@ pub mod spk;
 pub mod pretty_print;
 
 use self::{
-    daf::{daf::MutDAF, DAF},
+    daf::{daf::MutDAF, DAFWriter, DAF},
     pck::BPCSummaryRecord,
     spk::summary::SPKSummaryRecord,
 };
@@ -26,10 +26,14 @@ use self::{
 pub type SPK = DAF<SPKSummaryRecord>;
 /// Spacecraft Planetary Kernel, mutable, for editing DAF/SPK files
 pub type MutSPK = MutDAF<SPKSummaryRecord>;
+/// Spacecraft Planetary Kernel writer, for appending or replacing segments of a DAF/SPK file in place
+pub type SPKWriter = DAFWriter<SPKSummaryRecord>;
 /// Binary Planetary Constant
 pub type BPC = DAF<BPCSummaryRecord>;
 /// Binary Planetary Constant, mutable, for editing DAF/PCK files
 pub type MutBPC = MutDAF<BPCSummaryRecord>;
+/// Binary Planetary Constant writer, for appending or replacing segments of a DAF/PCK file in place
+pub type BPCWriter = DAFWriter<BPCSummaryRecord>;
 
 #[macro_export]
 macro_rules! parse_bytes_as {
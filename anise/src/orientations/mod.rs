@@ -17,6 +17,7 @@ use crate::{
 };
 
 mod paths;
+pub(crate) mod plan;
 mod rotate_to_parent;
 mod rotations;
 
@@ -25,10 +26,6 @@ mod rotations;
 pub enum OrientationError {
     /// Somehow you've entered code that should not be reachable, please file a bug.
     Unreachable,
-    #[snafu(display(
-         "could not load BPC because all {max_slots} are used (modify `MAX_LOADED_BPCS` at build time)"
-     ))]
-    StructureIsFull { max_slots: usize },
     #[snafu(display(
         "Could not rotate from {from} to {to}: no common origin found at epoch {epoch}"
     ))]
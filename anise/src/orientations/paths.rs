@@ -12,6 +12,8 @@ use hifitime::Epoch;
 use snafu::{ensure, ResultExt};
 
 use super::{BPCSnafu, NoOrientationsLoadedSnafu, OrientationDataSetSnafu, OrientationError};
+use crate::almanac::cache::{intersect_windows, CacheKey};
+use crate::almanac::metrics::DataKind;
 use crate::almanac::Almanac;
 use crate::constants::orientations::{ECLIPJ2000, J2000};
 use crate::frames::Frame;
@@ -22,24 +24,54 @@ use crate::NaifId;
 pub const MAX_TREE_DEPTH: usize = 8;
 
 impl Almanac {
+    /// Returns the key describing the loaded BPC and planetary data for the path cache, if the summary index is up to date.
+    fn orientation_cache_key(&self) -> Option<CacheKey> {
+        let num_loaded = self.num_loaded_bpc();
+        if self.bpc_index.num_indexed() == num_loaded {
+            Some((
+                num_loaded,
+                self.planetary_data.len(),
+                self.planetary_data.data_checksum,
+            ))
+        } else {
+            None
+        }
+    }
+
     /// Returns the root of all of the loaded orientations (BPC or planetary), typically this should be J2000.
     ///
     /// # Algorithm
     ///
     /// 1. For each loaded BPC, iterated in reverse order (to mimic SPICE behavior)
     /// 2. For each summary record in each BPC, follow the orientation branch all the way up until the end of this BPC or until the J2000.
+    ///
+    /// The root is cached until new BPC or planetary data is loaded.
     pub fn try_find_orientation_root(&self) -> Result<NaifId, OrientationError> {
         ensure!(
             self.num_loaded_bpc() > 0 || !self.planetary_data.is_empty(),
             NoOrientationsLoadedSnafu
         );
 
+        let cache_key = self.orientation_cache_key();
+        if let Some(root) = cache_key.and_then(|key| self.orientation_paths.root(key)) {
+            return Ok(root);
+        }
+
+        let root = self.find_orientation_root()?;
+
+        if let Some(key) = cache_key {
+            self.orientation_paths.set_root(key, root);
+        }
+
+        Ok(root)
+    }
+
+    /// Finds the orientation root without using the cache, cf. [Self::try_find_orientation_root].
+    fn find_orientation_root(&self) -> Result<NaifId, OrientationError> {
         // The common center is the absolute minimum of all centers due to the NAIF numbering.
         let mut common_center = i32::MAX;
 
-        for maybe_bpc in self.bpc_data.iter().take(self.num_loaded_bpc()).rev() {
-            let bpc = maybe_bpc.as_ref().unwrap();
-
+        for bpc in self.bpc_data.iter().rev() {
             for summary in bpc.data_summaries().context(BPCSnafu {
                 action: "finding orientation root",
             })? {
@@ -57,7 +89,7 @@ impl Almanac {
         // If we reached this point, it means that we didn't find J2000 in the loaded BPCs, so let's iterate through the planetary data
         if !self.planetary_data.is_empty() {
             for id in self.planetary_data.lut.by_id.keys() {
-                if let Ok(pc) = self.planetary_data.get_by_id(*id) {
+                if let Ok(pc) = self.planetary_data.get_ref_by_id(*id) {
                     if pc.parent_id < common_center {
                         common_center = pc.parent_id;
                         if common_center == J2000 {
@@ -78,6 +110,8 @@ impl Almanac {
     }
 
     /// Try to construct the path from the source frame all the way to the root orientation of this context.
+    ///
+    /// Paths are cached with the time window where the summaries of each hop are valid, until new BPC or planetary data is loaded.
     pub fn orientation_path_to_root(
         &self,
         source: Frame,
@@ -93,20 +127,56 @@ impl Almanac {
             return Ok((of_path_len, of_path));
         }
 
-        // Grab the summary data, which we use to find the paths
-        // Let's see if this orientation is defined in the loaded BPC files
-        let mut inertial_frame_id = match self.bpc_summary_at_epoch(source.orientation_id, epoch) {
-            Ok((summary, _, _)) => summary.inertial_frame_id,
-            Err(_) => {
-                // Not available as a BPC, so let's see if there's planetary data for it.
-                let planetary_data = self
-                    .planetary_data
-                    .get_by_id(source.orientation_id)
-                    .context(OrientationDataSetSnafu)?;
-                planetary_data.parent_id
+        let cache_key = self.orientation_cache_key();
+        if let Some(path) = cache_key.and_then(|key| {
+            self.orientation_paths
+                .path(key, source.orientation_id, epoch)
+        }) {
+            self.metrics.path_cache(DataKind::Orientation, true);
+            return Ok(path);
+        }
+        self.metrics.path_cache(DataKind::Orientation, false);
+
+        // The path is valid for as long as the summary of each hop is the one in use, and at all times if it only uses planetary data.
+        let mut window = None;
+        let mut cacheable = cache_key.is_some();
+
+        let mut parent_at_epoch = |id: NaifId| -> Result<NaifId, OrientationError> {
+            // Let's see if this orientation is defined in the loaded BPC files
+            match self.bpc_summary_at_epoch(id, epoch) {
+                Ok((summary, _, _)) => {
+                    if cacheable {
+                        match self.bpc_index.lookup_summary(id, epoch) {
+                            Some(indexed) => {
+                                window = intersect_windows(
+                                    window,
+                                    indexed.start_epoch,
+                                    indexed.end_epoch,
+                                )
+                            }
+                            None => cacheable = false,
+                        }
+                    }
+                    Ok(summary.inertial_frame_id)
+                }
+                Err(_) => {
+                    // Not available as a BPC, so let's see if there's planetary data for it.
+                    // If a BPC defines this orientation at other epochs, we don't know when this path stops being valid.
+                    if !self.bpc_index.intervals(id).is_empty() {
+                        cacheable = false;
+                    }
+                    let planetary_data = self
+                        .planetary_data
+                        .get_ref_by_id(id)
+                        .context(OrientationDataSetSnafu)?;
+                    Ok(planetary_data.parent_id)
+                }
             }
         };
 
+        // Grab the summary data, which we use to find the paths
+        let mut inertial_frame_id = parent_at_epoch(source.orientation_id)?;
+
         of_path[of_path_len] = Some(inertial_frame_id);
         of_path_len += 1;
 
@@ -117,38 +187,39 @@ impl Almanac {
             of_path_len += 1;
         }
 
-        if inertial_frame_id == common_center {
-            // Well that was quick!
-            return Ok((of_path_len, of_path));
-        }
+        let mut found = inertial_frame_id == common_center;
 
-        for _ in 0..MAX_TREE_DEPTH - 1 {
-            inertial_frame_id = match self.bpc_summary_at_epoch(inertial_frame_id, epoch) {
-                Ok((summary, _, _)) => summary.inertial_frame_id,
-                Err(_) => {
-                    // Not available as a BPC, so let's see if there's planetary data for it.
-                    let planetary_data = self
-                        .planetary_data
-                        .get_by_id(inertial_frame_id)
-                        .context(OrientationDataSetSnafu)?;
-                    planetary_data.parent_id
-                }
-            };
+        if !found {
+            for _ in 0..MAX_TREE_DEPTH - 1 {
+                inertial_frame_id = parent_at_epoch(inertial_frame_id)?;
 
-            // let summary = self.bpc_summary_at_epoch(inertial_frame_id, epoch)?.0;
-            // inertial_frame_id = summary.inertial_frame_id;
-            of_path[of_path_len] = Some(inertial_frame_id);
-            of_path_len += 1;
-            if inertial_frame_id == common_center {
-                // We're found the path!
-                return Ok((of_path_len, of_path));
+                of_path[of_path_len] = Some(inertial_frame_id);
+                of_path_len += 1;
+                if inertial_frame_id == common_center {
+                    // We're found the path!
+                    found = true;
+                    break;
+                }
             }
         }
 
-        Err(OrientationError::BPC {
-            action: "computing path to common node",
-            source: DAFError::MaxRecursionDepth,
-        })
+        if !found {
+            return Err(OrientationError::BPC {
+                action: "computing path to common node",
+                source: DAFError::MaxRecursionDepth,
+            });
+        }
+
+        if let (true, Some(key)) = (cacheable, cache_key) {
+            self.orientation_paths.insert_path(
+                key,
+                source.orientation_id,
+                window,
+                (of_path_len, of_path),
+            );
+        }
+
+        Ok((of_path_len, of_path))
     }
 
     /// Returns the orientation path between two frames and the common node. This may return a `DisjointRoots` error if the frames do not share a common root, which is considered a file integrity error.
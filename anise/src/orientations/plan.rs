@@ -0,0 +1,234 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use hifitime::Epoch;
+
+use super::rotate_to_parent::bpc_segment_rotation;
+use super::rotations::compose_path_rotation;
+use super::OrientationError;
+use crate::almanac::metrics::DataKind;
+use crate::almanac::Almanac;
+use crate::constants::orientations::{ECLIPJ2000, J2000};
+use crate::ephemerides::paths::MAX_TREE_DEPTH;
+use crate::math::rotation::DCM;
+use crate::naif::daf::datatypes::Type2ChebyshevSet;
+use crate::naif::pck::BPCSummaryRecord;
+use crate::prelude::Frame;
+use crate::structure::planetocentric::rotation_model::PlanetaryRotationModel;
+use crate::NaifId;
+
+/// How a [RotationPlan] computes the rotation of a frame to its parent, as `rotation_to_parent` would.
+enum ParentRotation<'a> {
+    /// Rotation between the inertial frames, which does not depend on the epoch
+    Fixed(DCM),
+    /// BPC segment, used in the interior of its window in the summary index, if known
+    Bpc {
+        source: Frame,
+        summary: &'a BPCSummaryRecord,
+        data: Type2ChebyshevSet<'a>,
+        window: Option<(Epoch, Epoch)>,
+    },
+    /// Rotation model from the planetary data, used at all epochs if no loaded BPC defines this frame
+    Planetary {
+        model: PlanetaryRotationModel,
+        always_valid: bool,
+    },
+}
+
+impl<'a> ParentRotation<'a> {
+    fn is_valid_at(&self, epoch: Epoch) -> bool {
+        match self {
+            Self::Fixed(_) => true,
+            // Boundaries may be shared with another segment, so they are resolved again.
+            Self::Bpc { window, .. } => {
+                window.map_or(false, |(start, end)| start < epoch && epoch < end)
+            }
+            Self::Planetary { always_valid, .. } => *always_valid,
+        }
+    }
+
+    fn evaluate(&self, epoch: Epoch) -> Result<DCM, OrientationError> {
+        match self {
+            Self::Fixed(dcm) => Ok(*dcm),
+            Self::Bpc {
+                source,
+                summary,
+                data,
+                ..
+            } => bpc_segment_rotation(*source, summary, data, epoch),
+            Self::Planetary { model, .. } => Ok(model.rotation_to_parent(epoch)),
+        }
+    }
+}
+
+/// A rotation between two frames, whose path, BPC segments, and rotation models are resolved once and reused for as long as they remain valid.
+///
+/// The rotations to their parents are composed exactly as `rotate_from_to` does, so both return the same DCM.
+pub(crate) struct RotationPlan<'a> {
+    from_frame: Frame,
+    to_frame: Frame,
+    /// Set if both frames have the same orientation
+    identity: bool,
+    common_node: NaifId,
+    node_count: usize,
+    path: [Option<NaifId>; MAX_TREE_DEPTH],
+    /// Rotation to its parent of each frame along the path, by orientation ID
+    parents: Vec<(NaifId, ParentRotation<'a>)>,
+}
+
+impl<'a> RotationPlan<'a> {
+    /// Returns true if this plan can be evaluated at the provided epoch and give the same result as `rotate_from_to`.
+    pub fn is_valid_at(&self, epoch: Epoch) -> bool {
+        self.parents
+            .iter()
+            .all(|(_, rotation)| rotation.is_valid_at(epoch))
+    }
+
+    /// Returns the DCM to rotate from the `from_frame` to the `to_frame` of this plan.
+    pub fn evaluate(&self, epoch: Epoch) -> Result<DCM, OrientationError> {
+        if self.identity {
+            return Ok(DCM::identity(
+                self.from_frame.orientation_id,
+                self.to_frame.orientation_id,
+            ));
+        }
+
+        compose_path_rotation(
+            self.from_frame,
+            self.to_frame,
+            &self.path[..self.node_count],
+            self.common_node,
+            |frame| {
+                self.parents
+                    .iter()
+                    .find(|(id, _)| *id == frame.orientation_id)
+                    .ok_or(OrientationError::Unreachable)?
+                    .1
+                    .evaluate(epoch)
+            },
+        )
+    }
+}
+
+impl Almanac {
+    /// Resolves the rotation between these frames at the provided epoch.
+    pub(crate) fn rotation_plan(
+        &self,
+        from_frame: Frame,
+        to_frame: Frame,
+        epoch: Epoch,
+    ) -> Result<RotationPlan<'_>, OrientationError> {
+        let to_frame = self.loaded_frame_info(to_frame);
+        let mut plan = RotationPlan {
+            from_frame,
+            to_frame,
+            identity: from_frame.orient_origin_match(to_frame),
+            common_node: to_frame.orientation_id,
+            node_count: 0,
+            path: [None; MAX_TREE_DEPTH],
+            parents: Vec::new(),
+        };
+        if plan.identity {
+            return Ok(plan);
+        }
+
+        let (node_count, path, common_node) =
+            self.common_orientation_path(from_frame, to_frame, epoch)?;
+        self.metrics.path_depth(DataKind::Orientation, node_count);
+        plan.node_count = node_count;
+        plan.path = path;
+        plan.common_node = common_node;
+
+        // These are the frames whose rotation to their parent is used by `compose_path_rotation`.
+        let mut ids = Vec::with_capacity(node_count + 2);
+        if !from_frame.orient_origin_id_match(common_node) {
+            ids.push(from_frame.orientation_id);
+        }
+        if !to_frame.orient_origin_id_match(common_node) {
+            ids.push(to_frame.orientation_id);
+        }
+        for id in path.iter().take(node_count).flatten() {
+            if *id != J2000 {
+                ids.push(*id);
+            }
+            if *id == common_node {
+                break;
+            }
+        }
+
+        for id in ids {
+            if !plan.parents.iter().any(|(known, _)| *known == id) {
+                let rotation = self.parent_rotation(Frame::from_orient_ssb(id), epoch)?;
+                plan.parents.push((id, rotation));
+            }
+        }
+
+        Ok(plan)
+    }
+
+    /// Resolves how the rotation of the `source` to its parent is computed at the provided epoch, as `rotation_to_parent` does.
+    fn parent_rotation(
+        &self,
+        source: Frame,
+        epoch: Epoch,
+    ) -> Result<ParentRotation<'_>, OrientationError> {
+        if source.orient_origin_id_match(J2000) || source.orient_origin_id_match(ECLIPJ2000) {
+            return Ok(ParentRotation::Fixed(
+                self.rotation_to_parent(source, epoch)?,
+            ));
+        }
+
+        // The time window is only known if the index is up to date.
+        let indexed = self.bpc_index.num_indexed() == self.num_loaded_bpc();
+        match self.bpc_summary_at_epoch(source.orientation_id, epoch) {
+            Ok((summary, bpc_no, idx_in_bpc)) => Ok(ParentRotation::Bpc {
+                source,
+                summary,
+                data: self.bpc_segment(summary, bpc_no, idx_in_bpc)?,
+                window: if indexed {
+                    self.bpc_index
+                        .lookup_summary(source.orientation_id, epoch)
+                        .map(|window| (window.start_epoch, window.end_epoch))
+                } else {
+                    None
+                },
+            }),
+            Err(_) => Ok(ParentRotation::Planetary {
+                model: self.planetary_rotation_model(source)?,
+                always_valid: indexed && self.bpc_index.intervals(source.orientation_id).is_empty(),
+            }),
+        }
+    }
+
+    /// Returns the direction cosine matrices to rotate from the `from_frame` to the `to_frame` at each of the provided epochs.
+    ///
+    /// This returns the same DCMs as calling `rotate_from_to` at each epoch, but the orientation path, the BPC segments, and the
+    /// rotation models from the planetary data are only resolved again when an epoch is outside of the segments used for the previous epoch.
+    /// Providing the epochs in chronological order, e.g. from a `TimeSeries`, maximizes this reuse.
+    pub fn rotate_many<I: IntoIterator<Item = Epoch>>(
+        &self,
+        from_frame: Frame,
+        to_frame: Frame,
+        epochs: I,
+    ) -> Result<Vec<DCM>, OrientationError> {
+        let epochs = epochs.into_iter();
+        let mut dcms = Vec::with_capacity(epochs.size_hint().0);
+
+        let mut plan: Option<RotationPlan> = None;
+        for epoch in epochs {
+            if !plan.as_ref().map_or(false, |plan| plan.is_valid_at(epoch)) {
+                plan = Some(self.rotation_plan(from_frame, to_frame, epoch)?);
+            }
+            dcms.push(plan.as_ref().unwrap().evaluate(epoch)?);
+        }
+
+        Ok(dcms)
+    }
+}
@@ -12,14 +12,18 @@ use log::trace;
 use snafu::ResultExt;
 
 use super::{OrientationError, OrientationPhysicsSnafu};
+use crate::almanac::metrics::{Interpolation, Stage};
 use crate::almanac::Almanac;
 use crate::constants::orientations::{ECLIPJ2000, J2000, J2000_TO_ECLIPJ2000_ANGLE_RAD};
 use crate::hifitime::Epoch;
-use crate::math::rotation::{r1, r1_dot, r3, r3_dot, DCM};
+use crate::math::rotation::{r1, r3r1r3_with_dot, DCM};
 use crate::naif::daf::datatypes::Type2ChebyshevSet;
 use crate::naif::daf::{DAFError, DafDataType, NAIFDataSet};
+use crate::naif::pck::BPCSummaryRecord;
 use crate::orientations::{BPCSnafu, OrientationDataSetSnafu, OrientationInterpolationSnafu};
 use crate::prelude::Frame;
+use crate::structure::planetocentric::rotation_model::PlanetaryRotationModel;
+use crate::structure::planetocentric::PlanetaryData;
 
 impl Almanac {
     /// Returns the direct cosine matrix (DCM) to rotate from the `source` to its parent in the orientation hierarchy at the provided epoch,
@@ -52,74 +56,170 @@ impl Almanac {
 
                 trace!("rotate {source} wrt to {new_frame} @ {epoch:E}");
 
-                // This should not fail because we've fetched the spk_no from above with the spk_summary_at_epoch call.
-                let bpc_data = self.bpc_data[bpc_no]
-                    .as_ref()
-                    .ok_or(OrientationError::Unreachable)?;
-
-                // Compute the angles and their rates
-                let (ra_dec_w, d_ra_dec_w) = match summary.data_type()? {
-                    DafDataType::Type2ChebyshevTriplet => {
-                        let data = bpc_data.nth_data::<Type2ChebyshevSet>(idx_in_bpc).context(
-                            BPCSnafu {
-                                action: "fetching data for interpolation",
-                            },
-                        )?;
-                        data.evaluate(epoch, summary)
-                            .context(OrientationInterpolationSnafu)?
-                    }
-                    dtype => {
-                        return Err(OrientationError::BPC {
-                            action: "rotation to parent",
-                            source: DAFError::UnsupportedDatatype {
-                                dtype,
-                                kind: "BPC computations",
-                            },
-                        })
-                    }
-                };
-
-                // And build the DCM
-                let twist_rad = ra_dec_w[2];
-                let dec_rad = ra_dec_w[1];
-                let ra_rad = ra_dec_w[0];
-
-                let twist_dot_rad = d_ra_dec_w[2];
-                let dec_dot_rad = d_ra_dec_w[1];
-                let ra_dot_rad = d_ra_dec_w[0];
-
-                let rot_mat = r3(twist_rad) * r1(dec_rad) * r3(ra_rad);
-                let rot_mat_dt = Some(
-                    twist_dot_rad * r3_dot(twist_rad) * r1(dec_rad) * r3(ra_rad)
-                        + dec_dot_rad * r3(twist_rad) * r1_dot(dec_rad) * r3(ra_rad)
-                        + ra_dot_rad * r3(twist_rad) * r1(dec_rad) * r3_dot(ra_rad),
-                );
-
-                Ok(DCM {
-                    rot_mat,
-                    rot_mat_dt,
-                    from: summary.inertial_frame_id,
-                    to: source.orientation_id,
+                let data = self.metrics.time(Stage::Decode, || {
+                    self.bpc_segment(summary, bpc_no, idx_in_bpc)
+                })?;
+                self.metrics.interpolation(Interpolation::Chebyshev);
+                self.metrics.time(Stage::Eval, || {
+                    bpc_segment_rotation(source, summary, &data, epoch)
                 })
             }
             Err(_) => {
                 trace!("query {source} wrt to its parent @ {epoch:E} using planetary data");
                 // Not available as a BPC, so let's see if there's planetary data for it.
-                let planetary_data = self
-                    .planetary_data
-                    .get_by_id(source.orientation_id)
-                    .context(OrientationDataSetSnafu)?;
-
-                // Fetch the parent info
-                let system_data = match self.planetary_data.get_by_id(planetary_data.parent_id) {
-                    Ok(parent) => parent,
-                    Err(_) => planetary_data,
-                };
-
-                planetary_data
-                    .rotation_to_parent(epoch, &system_data)
+                let (planetary_data, system_data) = self.planetary_rotation_data(source)?;
+
+                self.metrics
+                    .interpolation(Interpolation::PlanetaryConstants);
+                self.metrics
+                    .time(Stage::Eval, || {
+                        planetary_data.rotation_to_parent(epoch, system_data)
+                    })
                     .context(OrientationPhysicsSnafu)
             }
         }
     }
+
+    /// Compiles the rotation model of the `source` to its parent from the planetary data, to evaluate it many times.
+    ///
+    /// The model computes the same rotation as `rotation_to_parent` when the source is not defined in any loaded BPC.
+    pub fn planetary_rotation_model(
+        &self,
+        source: Frame,
+    ) -> Result<PlanetaryRotationModel, OrientationError> {
+        let (planetary_data, system_data) = self.planetary_rotation_data(source)?;
+        Ok(PlanetaryRotationModel::new(planetary_data, system_data))
+    }
+
+    /// Returns the planetary data of this source and of its system, i.e. its parent or itself if the parent has no data.
+    fn planetary_rotation_data(
+        &self,
+        source: Frame,
+    ) -> Result<(&PlanetaryData, &PlanetaryData), OrientationError> {
+        let planetary_data = self
+            .planetary_data
+            .get_ref_by_id(source.orientation_id)
+            .context(OrientationDataSetSnafu)?;
+
+        // Fetch the parent info
+        let system_data = match self.planetary_data.get_ref_by_id(planetary_data.parent_id) {
+            Ok(parent) => parent,
+            Err(_) => planetary_data,
+        };
+
+        Ok((planetary_data, system_data))
+    }
+
+    /// Returns the direction cosine matrices to rotate from the `source` to its parent in the orientation hierarchy at each of the provided epochs.
+    ///
+    /// This returns the same DCMs as calling `rotation_to_parent` at each epoch, but the BPC segment is only searched for again when an epoch
+    /// is outside of the segment used for the previous epoch. Providing the epochs in chronological order, e.g. from a `TimeSeries`, maximizes this reuse.
+    /// If the source is not in the loaded BPCs, its rotation model from the planetary data is only compiled once.
+    pub fn rotations_to_parent<I: IntoIterator<Item = Epoch>>(
+        &self,
+        source: Frame,
+        epochs: I,
+    ) -> Result<Vec<DCM>, OrientationError> {
+        let epochs = epochs.into_iter();
+        let mut dcms = Vec::with_capacity(epochs.size_hint().0);
+
+        // The time window is only known if the index is up to date.
+        let indexed = self.bpc_index.num_indexed() == self.num_loaded_bpc();
+        let mut segment: Option<(&BPCSummaryRecord, Type2ChebyshevSet, Epoch, Epoch)> = None;
+        // Compiled on the first epoch which is not in any BPC.
+        let mut model: Option<PlanetaryRotationModel> = None;
+
+        for epoch in epochs {
+            if let Some((summary, data, start_epoch, end_epoch)) = &segment {
+                // Boundaries may be shared with another segment, so they are resolved again.
+                if *start_epoch < epoch && epoch < *end_epoch {
+                    dcms.push(bpc_segment_rotation(source, summary, data, epoch)?);
+                    continue;
+                }
+            }
+
+            segment = None;
+            if !indexed
+                || source.orient_origin_id_match(J2000)
+                || source.orient_origin_id_match(ECLIPJ2000)
+            {
+                dcms.push(self.rotation_to_parent(source, epoch)?);
+                continue;
+            }
+
+            if let Some(window) = self.bpc_index.lookup_summary(source.orientation_id, epoch) {
+                let (start_epoch, end_epoch) = (window.start_epoch, window.end_epoch);
+                let (summary, bpc_no, idx_in_bpc) =
+                    self.bpc_summary_at_epoch(source.orientation_id, epoch)?;
+                let data = self.bpc_segment(summary, bpc_no, idx_in_bpc)?;
+                dcms.push(bpc_segment_rotation(source, summary, &data, epoch)?);
+                segment = Some((summary, data, start_epoch, end_epoch));
+            } else {
+                // Not available as a BPC, so this uses the planetary data, like `rotation_to_parent`.
+                if model.is_none() {
+                    model = Some(self.planetary_rotation_model(source)?);
+                }
+                if let Some(model) = &model {
+                    dcms.push(model.rotation_to_parent(epoch));
+                }
+            }
+        }
+
+        Ok(dcms)
+    }
+
+    /// Returns the data of this BPC segment, if its data type is supported.
+    pub(super) fn bpc_segment(
+        &self,
+        summary: &BPCSummaryRecord,
+        bpc_no: usize,
+        idx_in_bpc: usize,
+    ) -> Result<Type2ChebyshevSet, OrientationError> {
+        // This should not fail because we've fetched the bpc_no from above with the bpc_summary_at_epoch call.
+        let bpc_data = self
+            .bpc_data
+            .get(bpc_no)
+            .ok_or(OrientationError::Unreachable)?;
+
+        match summary.data_type()? {
+            DafDataType::Type2ChebyshevTriplet => bpc_data
+                .nth_data::<Type2ChebyshevSet>(idx_in_bpc)
+                .context(BPCSnafu {
+                    action: "fetching data for interpolation",
+                }),
+            dtype => Err(OrientationError::BPC {
+                action: "rotation to parent",
+                source: DAFError::UnsupportedDatatype {
+                    dtype,
+                    kind: "BPC computations",
+                },
+            }),
+        }
+    }
+}
+
+/// Evaluates the angles and their rates in this BPC segment, and builds the DCM and its time derivative from these 3-1-3 Euler angles.
+pub(super) fn bpc_segment_rotation(
+    source: Frame,
+    summary: &BPCSummaryRecord,
+    data: &Type2ChebyshevSet,
+    epoch: Epoch,
+) -> Result<DCM, OrientationError> {
+    // Compute the angles and their rates
+    let (ra_dec_w, d_ra_dec_w) = data
+        .evaluate(epoch, summary)
+        .context(OrientationInterpolationSnafu)?;
+
+    // And build the DCM: the right ascension, the declination, and then the twist.
+    let (rot_mat, rot_mat_dt) = r3r1r3_with_dot(
+        [ra_dec_w[0], ra_dec_w[1], ra_dec_w[2]],
+        [d_ra_dec_w[0], d_ra_dec_w[1], d_ra_dec_w[2]],
+    );
+
+    Ok(DCM {
+        rot_mat,
+        rot_mat_dt: Some(rot_mat_dt),
+        from: summary.inertial_frame_id,
+        to: source.orientation_id,
+    })
 }
@@ -12,6 +12,7 @@ use snafu::ResultExt;
 
 use super::OrientationError;
 use super::OrientationPhysicsSnafu;
+use crate::almanac::metrics::DataKind;
 use crate::almanac::Almanac;
 use crate::constants::orientations::J2000;
 use crate::hifitime::Epoch;
@@ -20,6 +21,7 @@ use crate::math::rotation::DCM;
 use crate::math::units::*;
 use crate::math::Vector3;
 use crate::prelude::Frame;
+use crate::NaifId;
 
 impl Almanac {
     /// Returns the 6x6 DCM needed to rotation the `from_frame` to the `to_frame`.
@@ -38,10 +40,7 @@ impl Almanac {
         let mut to_frame: Frame = to_frame;
 
         // If there is no frame info, the user hasn't loaded this frame, but might still want to compute a translation.
-        if let Ok(to_frame_info) = self.frame_from_uid(to_frame) {
-            // User has loaded the planetary data for this frame, so let's use that as the to_frame.
-            to_frame = to_frame_info;
-        }
+        to_frame = self.loaded_frame_info(to_frame);
 
         if from_frame.orient_origin_match(to_frame) {
             // Both frames match, return this frame's hash (i.e. no need to go higher up).
@@ -53,62 +52,15 @@ impl Almanac {
 
         let (node_count, path, common_node) =
             self.common_orientation_path(from_frame, to_frame, epoch)?;
-
-        // The fwrd variables are the states from the `from frame` to the common node
-        let mut dcm_fwrd = if from_frame.orient_origin_id_match(common_node) {
-            DCM::identity(common_node, common_node)
-        } else {
-            self.rotation_to_parent(from_frame, epoch)?
-        };
-
-        // The bwrd variables are the states from the `to frame` back to the common node
-        let mut dcm_bwrd = if to_frame.orient_origin_id_match(common_node) {
-            DCM::identity(common_node, common_node)
-        } else {
-            self.rotation_to_parent(to_frame, epoch)?.transpose()
-        };
-
-        for cur_node_id in path.iter().take(node_count) {
-            let next_parent = cur_node_id.unwrap();
-            if next_parent == J2000 {
-                // The parent rotation of J2000 is itself, so we can skip this.
-                continue;
-            }
-
-            let cur_dcm = self.rotation_to_parent(Frame::from_orient_ssb(next_parent), epoch)?;
-
-            if dcm_fwrd.from == cur_dcm.from {
-                dcm_fwrd = (cur_dcm * dcm_fwrd.transpose()).context(OrientationPhysicsSnafu)?;
-            } else if dcm_fwrd.from == cur_dcm.to {
-                dcm_fwrd = (dcm_fwrd * cur_dcm)
-                    .context(OrientationPhysicsSnafu)?
-                    .transpose();
-            } else if dcm_bwrd.to == cur_dcm.from {
-                dcm_bwrd = (cur_dcm * dcm_bwrd).context(OrientationPhysicsSnafu)?;
-            } else if dcm_bwrd.to == cur_dcm.to {
-                dcm_bwrd = (dcm_bwrd.transpose() * cur_dcm).context(OrientationPhysicsSnafu)?;
-            } else {
-                return Err(OrientationError::Unreachable);
-            }
-
-            if next_parent == common_node {
-                break;
-            }
-        }
-
-        if dcm_fwrd.from == dcm_bwrd.from {
-            (dcm_bwrd * dcm_fwrd.transpose()).context(OrientationPhysicsSnafu)
-        } else if dcm_fwrd.from == dcm_bwrd.to {
-            Ok((dcm_fwrd * dcm_bwrd)
-                .context(OrientationPhysicsSnafu)?
-                .transpose())
-        } else if dcm_fwrd.to == dcm_bwrd.to {
-            Ok((dcm_fwrd.transpose() * dcm_bwrd)
-                .context(OrientationPhysicsSnafu)?
-                .transpose())
-        } else {
-            (dcm_bwrd * dcm_fwrd).context(OrientationPhysicsSnafu)
-        }
+        self.metrics.path_depth(DataKind::Orientation, node_count);
+
+        compose_path_rotation(
+            from_frame,
+            to_frame,
+            &path[..node_count],
+            common_node,
+            |frame| self.rotation_to_parent(frame, epoch),
+        )
     }
 
     /// Translates a state with its origin (`to_frame`) and given its units (distance_unit, time_unit), returns that state with respect to the requested frame
@@ -141,3 +93,74 @@ impl Almanac {
         (dcm * input_state).context(OrientationPhysicsSnafu {})
     }
 }
+
+/// Composes the rotations to their parents of the frames along the path between these two frames, as found by `common_orientation_path`.
+///
+/// The rotation of each frame to its parent is provided by `rotation_to_parent`, such that it may come from the loaded data or from
+/// a [super::plan::RotationPlan].
+pub(crate) fn compose_path_rotation<F>(
+    from_frame: Frame,
+    to_frame: Frame,
+    path: &[Option<NaifId>],
+    common_node: NaifId,
+    mut rotation_to_parent: F,
+) -> Result<DCM, OrientationError>
+where
+    F: FnMut(Frame) -> Result<DCM, OrientationError>,
+{
+    // The fwrd variables are the states from the `from frame` to the common node
+    let mut dcm_fwrd = if from_frame.orient_origin_id_match(common_node) {
+        DCM::identity(common_node, common_node)
+    } else {
+        rotation_to_parent(from_frame)?
+    };
+
+    // The bwrd variables are the states from the `to frame` back to the common node
+    let mut dcm_bwrd = if to_frame.orient_origin_id_match(common_node) {
+        DCM::identity(common_node, common_node)
+    } else {
+        rotation_to_parent(to_frame)?.transpose()
+    };
+
+    for cur_node_id in path {
+        let next_parent = cur_node_id.unwrap();
+        if next_parent == J2000 {
+            // The parent rotation of J2000 is itself, so we can skip this.
+            continue;
+        }
+
+        let cur_dcm = rotation_to_parent(Frame::from_orient_ssb(next_parent))?;
+
+        if dcm_fwrd.from == cur_dcm.from {
+            dcm_fwrd = (cur_dcm * dcm_fwrd.transpose()).context(OrientationPhysicsSnafu)?;
+        } else if dcm_fwrd.from == cur_dcm.to {
+            dcm_fwrd = (dcm_fwrd * cur_dcm)
+                .context(OrientationPhysicsSnafu)?
+                .transpose();
+        } else if dcm_bwrd.to == cur_dcm.from {
+            dcm_bwrd = (cur_dcm * dcm_bwrd).context(OrientationPhysicsSnafu)?;
+        } else if dcm_bwrd.to == cur_dcm.to {
+            dcm_bwrd = (dcm_bwrd.transpose() * cur_dcm).context(OrientationPhysicsSnafu)?;
+        } else {
+            return Err(OrientationError::Unreachable);
+        }
+
+        if next_parent == common_node {
+            break;
+        }
+    }
+
+    if dcm_fwrd.from == dcm_bwrd.from {
+        (dcm_bwrd * dcm_fwrd.transpose()).context(OrientationPhysicsSnafu)
+    } else if dcm_fwrd.from == dcm_bwrd.to {
+        Ok((dcm_fwrd * dcm_bwrd)
+            .context(OrientationPhysicsSnafu)?
+            .transpose())
+    } else if dcm_fwrd.to == dcm_bwrd.to {
+        Ok((dcm_fwrd.transpose() * dcm_bwrd)
+            .context(OrientationPhysicsSnafu)?
+            .transpose())
+    } else {
+        (dcm_bwrd * dcm_fwrd).context(OrientationPhysicsSnafu)
+    }
+}
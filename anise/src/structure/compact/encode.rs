@@ -0,0 +1,384 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use hifitime::Epoch;
+use log::info;
+use snafu::prelude::*;
+
+use super::{
+    compact_kind_of, decode_chebyshev, zigzag, BitWriter, CompactDAFSnafu, CompactDecodingSnafu,
+    CompactEncoding, CompactEphemeris, CompactError, CompactInterpolationSnafu, CompactKind,
+    CompactSegment, UnsupportedSegmentSnafu, MAX_COMPACT_ORDER,
+};
+use crate::naif::daf::datatypes::{HermiteSetType13, Type2ChebyshevRecord, Type2ChebyshevSet};
+use crate::naif::daf::{DafDataType, NAIFDataSet, NAIFSummaryRecord};
+use crate::naif::spk::summary::SPKSummaryRecord;
+use crate::naif::SPK;
+use crate::DBL_SIZE;
+
+/// Largest quantized coefficient, in multiples of the quantization step, such that it is exactly represented by a 64-bit float
+const MAX_QUANTIZED: f64 = (1_u64 << 52) as f64;
+
+/// Options of the conversion of an SPK into a compact ephemeris.
+#[derive(Copy, Clone, Debug, Default, PartialEq)]
+pub struct CompactOptions {
+    /// Maximum position error of each segment with respect to the SPK, in kilometers. Zero only allows the f64 encoding, which stores the SPK data exactly.
+    pub tolerance_km: f64,
+    /// Encoding of all of the segments, or `None` to use the smallest encoding within the tolerance for each segment
+    pub encoding: Option<CompactEncoding>,
+}
+
+impl CompactEphemeris {
+    /// Builds a compact ephemeris from the Chebyshev Type 2 and Hermite Type 13 segments of this SPK, in the same order.
+    ///
+    /// The error bound of a Chebyshev segment is computed from the error of each of its coefficients, since Chebyshev polynomials are bounded by one.
+    /// The error of a Hermite segment is measured at each of its states and halfway between them, against the default Type 13 interpolation.
+    /// The f64 encoding is always accepted since it stores the data of the SPK exactly: its measured error only comes from rounding in the interpolation.
+    ///
+    /// # Errors
+    /// + The SPK contains another type of segment.
+    /// + The requested encoding cannot meet the tolerance for one of the segments.
+    pub fn from_spk(spk: &SPK, options: CompactOptions) -> Result<Self, CompactError> {
+        let mut segments = Vec::new();
+        for (idx, summary) in spk
+            .data_summaries()
+            .context(CompactDAFSnafu {
+                action: "reading SPK summaries",
+            })?
+            .iter()
+            .enumerate()
+        {
+            if summary.is_empty() {
+                continue;
+            }
+            let dtype = DafDataType::try_from(summary.data_type_i).context(CompactDAFSnafu {
+                action: "reading SPK data type",
+            })?;
+
+            let (segment, data) = match compact_kind_of(dtype) {
+                Some(CompactKind::Chebyshev) => {
+                    let set = spk
+                        .nth_data::<Type2ChebyshevSet>(idx)
+                        .context(CompactDAFSnafu {
+                            action: "reading Chebyshev segment",
+                        })?;
+                    best_encoding(summary, options, CompactKind::Chebyshev, |encoding| {
+                        compact_chebyshev(summary, &set, encoding, options.tolerance_km)
+                    })?
+                }
+                Some(CompactKind::Hermite) => {
+                    let set = spk
+                        .nth_data::<HermiteSetType13>(idx)
+                        .context(CompactDAFSnafu {
+                            action: "reading Hermite segment",
+                        })?;
+                    best_encoding(summary, options, CompactKind::Hermite, |encoding| {
+                        compact_hermite(summary, &set, encoding)
+                    })?
+                }
+                None => {
+                    return UnsupportedSegmentSnafu {
+                        target_id: summary.target_id,
+                        reason: format!("{dtype:?} is not supported"),
+                    }
+                    .fail()
+                }
+            };
+
+            info!(
+                "{} wrt {}: {} encoding in {} bytes, error below {:e} km",
+                segment.target_id,
+                segment.center_id,
+                segment.encoding,
+                data.len(),
+                segment.max_error_km
+            );
+            segments.push((segment, data));
+        }
+
+        Ok(Self::from_segments(segments))
+    }
+}
+
+/// Returns the smallest of the encodings allowed by these options whose error is within the tolerance.
+fn best_encoding<F>(
+    summary: &SPKSummaryRecord,
+    options: CompactOptions,
+    kind: CompactKind,
+    mut compact: F,
+) -> Result<(CompactSegment, Vec<u8>), CompactError>
+where
+    F: FnMut(CompactEncoding) -> Result<(CompactSegment, Vec<u8>), CompactError>,
+{
+    let candidates = match (options.encoding, kind) {
+        (Some(encoding), _) => vec![encoding],
+        (None, CompactKind::Chebyshev) => vec![
+            CompactEncoding::F64,
+            CompactEncoding::F32,
+            CompactEncoding::Quantized,
+        ],
+        (None, CompactKind::Hermite) => vec![CompactEncoding::F64, CompactEncoding::F32],
+    };
+
+    let mut best: Option<(CompactSegment, Vec<u8>)> = None;
+    let mut last_err = None;
+    for encoding in candidates {
+        match compact(encoding) {
+            Ok((segment, data))
+                if segment.max_error_km <= options.tolerance_km
+                    || encoding == CompactEncoding::F64 =>
+            {
+                if best
+                    .as_ref()
+                    .map_or(true, |(_, best)| data.len() < best.len())
+                {
+                    best = Some((segment, data));
+                }
+            }
+            Ok((segment, _)) => {
+                last_err = Some(CompactError::ToleranceExceeded {
+                    target_id: summary.target_id,
+                    encoding,
+                    error_km: segment.max_error_km,
+                    tolerance_km: options.tolerance_km,
+                })
+            }
+            Err(e) => last_err = Some(e),
+        }
+    }
+
+    best.ok_or_else(|| last_err.unwrap())
+}
+
+fn new_segment(
+    summary: &SPKSummaryRecord,
+    kind: CompactKind,
+    encoding: CompactEncoding,
+    order: usize,
+    num_records: usize,
+) -> Result<CompactSegment, CompactError> {
+    ensure!(
+        (1..=MAX_COMPACT_ORDER).contains(&order) && num_records > 0,
+        UnsupportedSegmentSnafu {
+            target_id: summary.target_id,
+            reason: format!(
+                "{num_records} records of order {order}, but at most {MAX_COMPACT_ORDER} is supported"
+            )
+        }
+    );
+    Ok(CompactSegment {
+        target_id: summary.target_id,
+        center_id: summary.center_id,
+        frame_id: summary.frame_id,
+        kind,
+        encoding,
+        order,
+        start_et_s: summary.start_epoch_et_s,
+        end_et_s: summary.end_epoch_et_s,
+        interval_s: 0.0,
+        num_records,
+        record_size: 0,
+        step_km: 0.0,
+        max_error_km: 0.0,
+        max_error_km_s: 0.0,
+        data_offset: 0,
+    })
+}
+
+fn compact_chebyshev(
+    summary: &SPKSummaryRecord,
+    set: &Type2ChebyshevSet,
+    encoding: CompactEncoding,
+    tolerance_km: f64,
+) -> Result<(CompactSegment, Vec<u8>), CompactError> {
+    let order = (set.rsize.max(2) - 2) / 3;
+    let mut segment = new_segment(
+        summary,
+        CompactKind::Chebyshev,
+        encoding,
+        order,
+        set.num_records,
+    )?;
+    segment.interval_s = set.interval_length.to_seconds();
+
+    let records = (0..set.num_records)
+        .map(|n| set.nth_record(n))
+        .collect::<Result<Vec<_>, _>>()
+        .context(CompactDecodingSnafu {
+            action: "reading Chebyshev records",
+        })?;
+    let coeffs_of = |record: &Type2ChebyshevRecord<'_>| {
+        let mut coeffs = [0.0; 3 * MAX_COMPACT_ORDER];
+        for (i, coeff) in record
+            .x_coeffs
+            .iter()
+            .chain(record.y_coeffs)
+            .chain(record.z_coeffs)
+            .take(3 * order)
+            .enumerate()
+        {
+            coeffs[i] = *coeff;
+        }
+        coeffs
+    };
+
+    // Each coefficient index is packed with the number of bits of its largest multiple of the quantization step.
+    let mut widths = Vec::new();
+    if encoding == CompactEncoding::Quantized {
+        ensure!(
+            tolerance_km > 0.0,
+            UnsupportedSegmentSnafu {
+                target_id: summary.target_id,
+                reason: "quantization requires a strictly positive tolerance"
+            }
+        );
+        // Each component is off by at most half a step per coefficient, so the position is off by at most the tolerance.
+        segment.step_km = 2.0 * tolerance_km / (3.0_f64.sqrt() * order as f64);
+        widths = vec![0_u8; 3 * order];
+        for record in &records {
+            for (width, coeff) in widths.iter_mut().zip(coeffs_of(record)) {
+                let multiple = (coeff / segment.step_km).round();
+                ensure!(
+                    multiple.abs() < MAX_QUANTIZED,
+                    UnsupportedSegmentSnafu {
+                        target_id: summary.target_id,
+                        reason: format!("tolerance of {tolerance_km} km is too small to quantize")
+                    }
+                );
+                *width = (*width).max((64 - zigzag(multiple as i64).leading_zeros()) as u8);
+            }
+        }
+    }
+
+    let mut data = widths.clone();
+    let radius_s = segment.interval_s / 2.0;
+    let mut decoded = [0.0; 3 * MAX_COMPACT_ORDER];
+    for record in &records {
+        let start = data.len();
+        let coeffs = coeffs_of(record);
+        data.extend_from_slice(&record.midpoint_et_s.to_le_bytes());
+        match encoding {
+            CompactEncoding::F64 => {
+                for coeff in &coeffs[..3 * order] {
+                    data.extend_from_slice(&coeff.to_le_bytes());
+                }
+            }
+            CompactEncoding::F32 => {
+                for coeff in &coeffs[..3 * order] {
+                    data.extend_from_slice(&(*coeff as f32).to_le_bytes());
+                }
+            }
+            CompactEncoding::Quantized => {
+                let mut bits = BitWriter::default();
+                for (coeff, width) in coeffs.iter().zip(&widths) {
+                    bits.write(zigzag((coeff / segment.step_km).round() as i64), *width);
+                }
+                data.extend_from_slice(&bits.finish());
+            }
+        }
+        segment.record_size = data.len() - start;
+
+        // The error bound is computed from the decoded coefficients, exactly as they are evaluated.
+        decode_chebyshev(
+            encoding,
+            order,
+            segment.step_km,
+            &widths,
+            &data[start..],
+            &mut decoded,
+        )
+        .context(CompactDecodingSnafu {
+            action: "verifying Chebyshev record",
+        })?;
+        let mut pos_err_km = [0.0; 3];
+        let mut vel_err_km_s = [0.0; 3];
+        for (i, coeff) in coeffs[..3 * order].iter().enumerate() {
+            let err = (decoded[i] - coeff).abs();
+            let degree = (i % order) as f64;
+            pos_err_km[i / order] += err;
+            // The derivative of the Chebyshev polynomial of degree n is bounded by n^2.
+            vel_err_km_s[i / order] += degree * degree * err / radius_s;
+        }
+        segment.max_error_km = segment.max_error_km.max(norm(pos_err_km));
+        segment.max_error_km_s = segment.max_error_km_s.max(norm(vel_err_km_s));
+    }
+
+    Ok((segment, data))
+}
+
+fn compact_hermite(
+    summary: &SPKSummaryRecord,
+    set: &HermiteSetType13,
+    encoding: CompactEncoding,
+) -> Result<(CompactSegment, Vec<u8>), CompactError> {
+    ensure!(
+        encoding != CompactEncoding::Quantized,
+        UnsupportedSegmentSnafu {
+            target_id: summary.target_id,
+            reason: "quantization only applies to Chebyshev segments"
+        }
+    );
+    let mut segment = new_segment(
+        summary,
+        CompactKind::Hermite,
+        encoding,
+        set.samples,
+        set.num_records,
+    )?;
+    segment.record_size = match encoding {
+        CompactEncoding::F32 => 6 * 4,
+        _ => 6 * DBL_SIZE,
+    };
+
+    let mut data = Vec::with_capacity(segment.data_size());
+    for et_s in set.epoch_data {
+        data.extend_from_slice(&et_s.to_le_bytes());
+    }
+    for n in 0..set.num_records {
+        let record = set.nth_record(n).context(CompactDecodingSnafu {
+            action: "reading Hermite states",
+        })?;
+        for value in [
+            record.x_km,
+            record.y_km,
+            record.z_km,
+            record.vx_km_s,
+            record.vy_km_s,
+            record.vz_km_s,
+        ] {
+            match encoding {
+                CompactEncoding::F32 => data.extend_from_slice(&(value as f32).to_le_bytes()),
+                _ => data.extend_from_slice(&value.to_le_bytes()),
+            }
+        }
+    }
+
+    // Measure the error at each state and halfway to the next one, including for the f64 encoding since it is not interpolated exactly as the SPK.
+    let epochs = set.epoch_data.iter().zip(set.epoch_data.iter().skip(1));
+    for (et_s, next_et_s) in epochs {
+        for et_s in [*et_s, 0.5 * (et_s + next_et_s)] {
+            let epoch = Epoch::from_et_seconds(et_s);
+            let (pos_km, vel_km_s) = segment.evaluate(&data, epoch)?;
+            let (exp_pos_km, exp_vel_km_s) =
+                set.evaluate(epoch, summary)
+                    .context(CompactInterpolationSnafu {
+                        action: "verifying Hermite segment",
+                    })?;
+            segment.max_error_km = segment.max_error_km.max((pos_km - exp_pos_km).norm());
+            segment.max_error_km_s = segment.max_error_km_s.max((vel_km_s - exp_vel_km_s).norm());
+        }
+    }
+
+    Ok((segment, data))
+}
+
+fn norm(components: [f64; 3]) -> f64 {
+    components.iter().map(|c| c * c).sum::<f64>().sqrt()
+}
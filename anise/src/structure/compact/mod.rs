@@ -0,0 +1,1036 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+//! Compact ANISE ephemeris format, meant for deployments where memory and storage are scarce.
+//!
+//! A compact ephemeris is built from the Chebyshev Type 2 and Hermite Type 13 segments of an SPK. Each segment stores its
+//! coefficients or states either as 64-bit floats (stored exactly), 32-bit floats, or quantized integers packed with the minimum
+//! number of bits. The segment index declares the error of each segment: a bound for Chebyshev segments, and a measured error for
+//! Hermite segments. Queries only decode the records they need.
+//!
+//! # Layout
+//! All values are little endian.
+//! + Header of 32 bytes: magic `ANISECEP`, version (u16), reserved (u16), number of segments (u32), CRC32 of the whole file computed with this field set to zero (u32), reserved.
+//! + Segment index: one entry of 88 bytes per segment, with its coverage, encoding, error bound, and the offset of its data.
+//! + Data of each segment: the bit widths of the quantized coefficients or the epochs of the Hermite states, followed by records of a fixed size.
+//!   A Chebyshev record is its midpoint in ET seconds (f64) followed by the X, Y, and Z coefficients, and a Hermite record is a position and velocity.
+
+use bytes::Bytes;
+use core::fmt;
+use core::str::FromStr;
+use hifitime::Epoch;
+use snafu::prelude::*;
+use std::fs::File;
+use std::io::{Error as IOError, ErrorKind as IOErrorKind, Write};
+use std::path::Path;
+
+use crate::errors::DecodingError;
+use crate::math::interpolation::{chebyshev_eval_xyz, hermite_eval, InterpolationError};
+use crate::math::Vector3;
+use crate::naif::daf::{DAFError, DafDataType};
+use crate::{NaifId, DBL_SIZE};
+
+mod encode;
+
+pub use encode::CompactOptions;
+
+/// Magic bytes at the start of every compact ephemeris
+pub const COMPACT_MAGIC: [u8; 8] = *b"ANISECEP";
+/// Version of the compact ephemeris layout
+pub const COMPACT_VERSION: u16 = 1;
+/// Maximum number of Chebyshev coefficients per component, or of Hermite samples, in a compact segment
+pub const MAX_COMPACT_ORDER: usize = 32;
+
+const HEADER_SIZE: usize = 32;
+const ENTRY_SIZE: usize = 88;
+
+#[derive(Debug, Snafu)]
+#[snafu(visibility(pub(crate)))]
+pub enum CompactError {
+    #[snafu(display("when {action}, {source}"))]
+    CompactDecoding {
+        action: &'static str,
+        source: DecodingError,
+    },
+    #[snafu(display("when {action}, {source}"))]
+    CompactInterpolation {
+        action: &'static str,
+        source: InterpolationError,
+    },
+    #[snafu(display("when {action}, {source}"))]
+    CompactDAF {
+        action: &'static str,
+        source: DAFError,
+    },
+    #[snafu(display("not a compact ANISE ephemeris: {reason}"))]
+    NotCompact { reason: String },
+    #[snafu(display("segment of {target_id} cannot be compacted: {reason}"))]
+    UnsupportedSegment { target_id: NaifId, reason: String },
+    #[snafu(display(
+        "{encoding} encoding of the segment of {target_id} reaches {error_km} km, beyond the tolerance of {tolerance_km} km"
+    ))]
+    ToleranceExceeded {
+        target_id: NaifId,
+        encoding: CompactEncoding,
+        error_km: f64,
+        tolerance_km: f64,
+    },
+    #[snafu(display("no compact segment of {id} at {epoch}"))]
+    NoCompactSegment { id: NaifId, epoch: Epoch },
+    #[snafu(display("input/output error while {action}: {source}"))]
+    CompactIO {
+        action: &'static str,
+        source: IOError,
+    },
+}
+
+/// Interpolation of a compact segment.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum CompactKind {
+    /// Chebyshev polynomials of the position over records of equal length, as in SPK Type 2
+    Chebyshev = 0,
+    /// Hermite interpolation of states at unequal steps, as in SPK Type 13
+    Hermite = 1,
+}
+
+impl TryFrom<u8> for CompactKind {
+    type Error = CompactError;
+
+    fn try_from(value: u8) -> Result<Self, Self::Error> {
+        match value {
+            0 => Ok(Self::Chebyshev),
+            1 => Ok(Self::Hermite),
+            _ => Err(CompactError::NotCompact {
+                reason: format!("unknown segment kind {value}"),
+            }),
+        }
+    }
+}
+
+/// Encoding of the coefficients or states of a compact segment.
+#[derive(Copy, Clone, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum CompactEncoding {
+    /// 64-bit floats, i.e. the data of the SPK itself
+    F64 = 0,
+    /// 32-bit floats
+    F32 = 1,
+    /// Multiples of a quantization step, each coefficient index packed with the number of bits its largest multiple needs (Chebyshev only)
+    Quantized = 2,
+}
+
+impl TryFrom<u8> for CompactEncoding {
+    type Error = CompactError;
+
+    fn try_from(value: u8) -> Result<Self, Self::Error> {
+        match value {
+            0 => Ok(Self::F64),
+            1 => Ok(Self::F32),
+            2 => Ok(Self::Quantized),
+            _ => Err(CompactError::NotCompact {
+                reason: format!("unknown encoding {value}"),
+            }),
+        }
+    }
+}
+
+impl FromStr for CompactEncoding {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        match s.to_lowercase().as_str() {
+            "f64" => Ok(Self::F64),
+            "f32" => Ok(Self::F32),
+            "quantized" => Ok(Self::Quantized),
+            _ => Err(format!(
+                "unknown encoding `{s}`, expected f64, f32, or quantized"
+            )),
+        }
+    }
+}
+
+impl fmt::Display for CompactEncoding {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            Self::F64 => write!(f, "f64"),
+            Self::F32 => write!(f, "f32"),
+            Self::Quantized => write!(f, "quantized"),
+        }
+    }
+}
+
+/// Entry of the segment index of a compact ephemeris.
+#[derive(Copy, Clone, Debug, PartialEq)]
+pub struct CompactSegment {
+    pub target_id: NaifId,
+    pub center_id: NaifId,
+    pub frame_id: NaifId,
+    pub kind: CompactKind,
+    pub encoding: CompactEncoding,
+    /// Number of coefficients per component of the Chebyshev records, or number of samples of the Hermite interpolation
+    pub order: usize,
+    pub start_et_s: f64,
+    pub end_et_s: f64,
+    /// Length of each Chebyshev record in seconds (unused for Hermite)
+    pub interval_s: f64,
+    pub num_records: usize,
+    /// Size in bytes of each record
+    pub record_size: usize,
+    /// Quantization step of the coefficients in kilometers, if quantized
+    pub step_km: f64,
+    /// Position error with respect to the original SPK in kilometers: a bound for Chebyshev segments, and measured at each state and halfway between them for Hermite segments
+    pub max_error_km: f64,
+    /// Velocity error with respect to the original SPK in kilometers per second, a bound or measured like the position error
+    pub max_error_km_s: f64,
+    /// Offset of the data of this segment from the start of the compact ephemeris
+    data_offset: usize,
+}
+
+impl CompactSegment {
+    pub fn start_epoch(&self) -> Epoch {
+        Epoch::from_et_seconds(self.start_et_s)
+    }
+
+    pub fn end_epoch(&self) -> Epoch {
+        Epoch::from_et_seconds(self.end_et_s)
+    }
+
+    /// Returns true if this segment covers the provided epoch, boundaries included.
+    pub fn contains(&self, epoch: Epoch) -> bool {
+        epoch >= self.start_epoch() && epoch <= self.end_epoch()
+    }
+
+    /// Size of the data stored before the records: bit widths of the quantized coefficients or epochs of the Hermite states.
+    fn prefix_size(&self) -> usize {
+        match (self.kind, self.encoding) {
+            (CompactKind::Chebyshev, CompactEncoding::Quantized) => 3 * self.order,
+            (CompactKind::Chebyshev, _) => 0,
+            (CompactKind::Hermite, _) => DBL_SIZE * self.num_records,
+        }
+    }
+
+    /// Total size of the data of this segment in bytes.
+    pub fn data_size(&self) -> usize {
+        self.prefix_size() + self.num_records * self.record_size
+    }
+
+    /// Offset of the end of the data of this segment, or None if it overflows.
+    fn checked_data_end(&self) -> Option<usize> {
+        let prefix_size = match self.kind {
+            CompactKind::Hermite => DBL_SIZE.checked_mul(self.num_records)?,
+            CompactKind::Chebyshev => self.prefix_size(),
+        };
+        self.num_records
+            .checked_mul(self.record_size)?
+            .checked_add(prefix_size)?
+            .checked_add(self.data_offset)
+    }
+
+    /// Returns the size of each record implied by the kind, encoding, and order of this segment, provided the bit widths of its quantized coefficients.
+    fn expected_record_size(&self, widths: &[u8]) -> Option<usize> {
+        match (self.kind, self.encoding) {
+            (CompactKind::Chebyshev, CompactEncoding::F64) => Some(DBL_SIZE * (1 + 3 * self.order)),
+            (CompactKind::Chebyshev, CompactEncoding::F32) => Some(DBL_SIZE + 4 * 3 * self.order),
+            (CompactKind::Chebyshev, CompactEncoding::Quantized) => {
+                let num_bits: usize = widths.iter().map(|width| *width as usize).sum();
+                Some(DBL_SIZE + (num_bits + 7) / 8)
+            }
+            (CompactKind::Hermite, CompactEncoding::F64) => Some(6 * DBL_SIZE),
+            (CompactKind::Hermite, CompactEncoding::F32) => Some(6 * 4),
+            // Quantization only applies to Chebyshev segments.
+            (CompactKind::Hermite, CompactEncoding::Quantized) => None,
+        }
+    }
+
+    fn to_le_bytes(self) -> [u8; ENTRY_SIZE] {
+        let mut entry = [0_u8; ENTRY_SIZE];
+        entry[0..4].copy_from_slice(&self.target_id.to_le_bytes());
+        entry[4..8].copy_from_slice(&self.center_id.to_le_bytes());
+        entry[8..12].copy_from_slice(&self.frame_id.to_le_bytes());
+        entry[12] = self.kind as u8;
+        entry[13] = self.encoding as u8;
+        entry[14..16].copy_from_slice(&(self.order as u16).to_le_bytes());
+        entry[16..24].copy_from_slice(&self.start_et_s.to_le_bytes());
+        entry[24..32].copy_from_slice(&self.end_et_s.to_le_bytes());
+        entry[32..40].copy_from_slice(&self.interval_s.to_le_bytes());
+        entry[40..44].copy_from_slice(&(self.num_records as u32).to_le_bytes());
+        entry[44..48].copy_from_slice(&(self.record_size as u32).to_le_bytes());
+        entry[48..56].copy_from_slice(&(self.data_offset as u64).to_le_bytes());
+        entry[56..64].copy_from_slice(&self.step_km.to_le_bytes());
+        entry[64..72].copy_from_slice(&self.max_error_km.to_le_bytes());
+        entry[72..80].copy_from_slice(&self.max_error_km_s.to_le_bytes());
+        entry
+    }
+
+    fn from_le_bytes(entry: &[u8]) -> Result<Self, CompactError> {
+        let order = read_u16(entry, 14)? as usize;
+        let segment = Self {
+            target_id: read_i32(entry, 0)?,
+            center_id: read_i32(entry, 4)?,
+            frame_id: read_i32(entry, 8)?,
+            kind: CompactKind::try_from(read_u8(entry, 12)?)?,
+            encoding: CompactEncoding::try_from(read_u8(entry, 13)?)?,
+            order,
+            start_et_s: read_f64(entry, 16)?,
+            end_et_s: read_f64(entry, 24)?,
+            interval_s: read_f64(entry, 32)?,
+            num_records: read_u32(entry, 40)? as usize,
+            record_size: read_u32(entry, 44)? as usize,
+            data_offset: read_u64(entry, 48)? as usize,
+            step_km: read_f64(entry, 56)?,
+            max_error_km: read_f64(entry, 64)?,
+            max_error_km_s: read_f64(entry, 72)?,
+        };
+        ensure!(
+            (1..=MAX_COMPACT_ORDER).contains(&order) && segment.num_records > 0,
+            NotCompactSnafu {
+                reason: format!("segment of {} has no usable records", segment.target_id)
+            }
+        );
+        Ok(segment)
+    }
+
+    /// Returns the bytes of the n-th record of this segment in the provided data.
+    fn record<'a>(&self, data: &'a [u8], n: usize) -> Result<&'a [u8], DecodingError> {
+        let start = self.data_offset + self.prefix_size() + n * self.record_size;
+        slice(data, start, self.record_size)
+    }
+
+    /// Evaluates the position and velocity of the target of this segment with respect to its center, from the data of its compact ephemeris.
+    fn evaluate(&self, data: &[u8], epoch: Epoch) -> Result<(Vector3, Vector3), CompactError> {
+        match self.kind {
+            CompactKind::Chebyshev => self.chebyshev_state(data, epoch),
+            CompactKind::Hermite => self.hermite_state(data, epoch),
+        }
+    }
+
+    fn chebyshev_state(
+        &self,
+        data: &[u8],
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3), CompactError> {
+        let et_s = epoch.to_et_seconds();
+        // Same record as the Chebyshev Type 2 data of the SPK.
+        let idx = (((et_s - self.start_et_s) / self.interval_s) as usize).min(self.num_records - 1);
+
+        let widths = if self.encoding == CompactEncoding::Quantized {
+            slice(data, self.data_offset, 3 * self.order)
+        } else {
+            Ok(&[][..])
+        }
+        .context(CompactDecodingSnafu {
+            action: "reading coefficient widths",
+        })?;
+
+        let mut coeffs = [0.0; 3 * MAX_COMPACT_ORDER];
+        let record = self.record(data, idx).context(CompactDecodingSnafu {
+            action: "reading Chebyshev record",
+        })?;
+        let midpoint_et_s = decode_chebyshev(
+            self.encoding,
+            self.order,
+            self.step_km,
+            widths,
+            record,
+            &mut coeffs,
+        )
+        .context(CompactDecodingSnafu {
+            action: "decoding Chebyshev record",
+        })?;
+
+        let radius_s = self.interval_s / 2.0;
+        let n = self.order;
+        chebyshev_eval_xyz(
+            (et_s - midpoint_et_s) / radius_s,
+            [&coeffs[..n], &coeffs[n..2 * n], &coeffs[2 * n..3 * n]],
+            radius_s,
+            epoch,
+            n - 1,
+        )
+        .context(CompactInterpolationSnafu {
+            action: "evaluating Chebyshev record",
+        })
+    }
+
+    fn hermite_state(&self, data: &[u8], epoch: Epoch) -> Result<(Vector3, Vector3), CompactError> {
+        let et_s = epoch.to_et_seconds();
+        let epoch_at = |n: usize| {
+            read_f64(data, self.data_offset + n * DBL_SIZE).context(CompactDecodingSnafu {
+                action: "reading Hermite epochs",
+            })
+        };
+        let state_at = |n: usize| -> Result<[f64; 6], CompactError> {
+            let record = self.record(data, n).context(CompactDecodingSnafu {
+                action: "reading Hermite state",
+            })?;
+            decode_state(self.encoding, record).context(CompactDecodingSnafu {
+                action: "decoding Hermite state",
+            })
+        };
+
+        let first_et_s = epoch_at(0)?;
+        let last_et_s = epoch_at(self.num_records - 1)?;
+        if et_s + 1e-9 < first_et_s || et_s - 1e-9 > last_et_s {
+            return Err(CompactError::CompactInterpolation {
+                action: "evaluating Hermite segment",
+                source: InterpolationError::NoInterpolationData {
+                    req: epoch,
+                    start: Epoch::from_et_seconds(first_et_s),
+                    end: Epoch::from_et_seconds(last_et_s),
+                },
+            });
+        }
+
+        // Binary search of the first state at or after this epoch, reading only the epochs it visits.
+        let (mut lo, mut hi) = (0, self.num_records);
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if epoch_at(mid)? < et_s {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if lo < self.num_records && epoch_at(lo)? == et_s {
+            let state = state_at(lo)?;
+            return Ok((
+                Vector3::new(state[0], state[1], state[2]),
+                Vector3::new(state[3], state[4], state[5]),
+            ));
+        }
+
+        // Same window as the Hermite Type 13 data of the SPK.
+        let num_left = self.order / 2;
+        let mut first_idx = lo.saturating_sub(num_left);
+        let last_idx = self.num_records.min(first_idx + self.order);
+        if last_idx == self.num_records {
+            first_idx = last_idx.saturating_sub(2 * num_left);
+        }
+        let count = last_idx - first_idx;
+
+        let mut epochs = [0.0; MAX_COMPACT_ORDER];
+        let mut states = [[0.0; MAX_COMPACT_ORDER]; 6];
+        for (i, n) in (first_idx..last_idx).enumerate() {
+            epochs[i] = epoch_at(n)?;
+            for (k, value) in state_at(n)?.iter().enumerate() {
+                states[k][i] = *value;
+            }
+        }
+
+        let mut pos_km = Vector3::zeros();
+        let mut vel_km_s = Vector3::zeros();
+        for k in 0..3 {
+            let (value, deriv) = hermite_eval(
+                &epochs[..count],
+                &states[k][..count],
+                &states[k + 3][..count],
+                et_s,
+            )
+            .context(CompactInterpolationSnafu {
+                action: "evaluating Hermite window",
+            })?;
+            pos_km[k] = value;
+            vel_km_s[k] = deriv;
+        }
+
+        Ok((pos_km, vel_km_s))
+    }
+}
+
+/// Compact ANISE ephemeris: only its header and segment index are decoded on load, and each query decodes the records it uses.
+#[derive(Clone, Debug)]
+pub struct CompactEphemeris {
+    bytes: Bytes,
+    segments: Vec<CompactSegment>,
+}
+
+impl CompactEphemeris {
+    /// Parses the header and the segment index of these bytes. Use `check_integrity` to also verify the checksum of the data.
+    pub fn from_bytes(bytes: Bytes) -> Result<Self, CompactError> {
+        let header = slice(&bytes, 0, HEADER_SIZE).map_err(|_| CompactError::NotCompact {
+            reason: format!("{} bytes is too short for a header", bytes.len()),
+        })?;
+        ensure!(
+            header[..8] == COMPACT_MAGIC,
+            NotCompactSnafu {
+                reason: "magic bytes mismatch"
+            }
+        );
+        let version = read_u16(header, 8)?;
+        ensure!(
+            version == COMPACT_VERSION,
+            NotCompactSnafu {
+                reason: format!("version {version} is not supported, expected {COMPACT_VERSION}")
+            }
+        );
+
+        let num_segments = read_u32(header, 12)? as usize;
+        ensure!(
+            num_segments <= (bytes.len() - HEADER_SIZE) / ENTRY_SIZE,
+            NotCompactSnafu {
+                reason: format!(
+                    "{num_segments} segments do not fit in {} bytes",
+                    bytes.len()
+                )
+            }
+        );
+        let mut segments = Vec::with_capacity(num_segments);
+        for n in 0..num_segments {
+            let entry = slice(&bytes, HEADER_SIZE + n * ENTRY_SIZE, ENTRY_SIZE).context(
+                CompactDecodingSnafu {
+                    action: "reading segment index",
+                },
+            )?;
+            let segment = CompactSegment::from_le_bytes(entry)?;
+            ensure!(
+                segment
+                    .checked_data_end()
+                    .map_or(false, |end| end <= bytes.len()),
+                NotCompactSnafu {
+                    reason: format!("data of the segment of {} is truncated", segment.target_id)
+                }
+            );
+            let widths = match (segment.kind, segment.encoding) {
+                (CompactKind::Chebyshev, CompactEncoding::Quantized) => {
+                    &bytes[segment.data_offset..segment.data_offset + 3 * segment.order]
+                }
+                _ => &[][..],
+            };
+            ensure!(
+                widths.iter().all(|width| *width <= 64)
+                    && segment.expected_record_size(widths) == Some(segment.record_size),
+                NotCompactSnafu {
+                    reason: format!(
+                        "records of {} bytes do not match the {} {:?} segment of {}",
+                        segment.record_size, segment.encoding, segment.kind, segment.target_id
+                    )
+                }
+            );
+            segments.push(segment);
+        }
+
+        Ok(Self { bytes, segments })
+    }
+
+    /// Builds a compact ephemeris from its segments, whose data offsets are relative to the start of their own data.
+    fn from_segments(segments: Vec<(CompactSegment, Vec<u8>)>) -> Self {
+        let data_start = HEADER_SIZE + segments.len() * ENTRY_SIZE;
+        let data_size: usize = segments.iter().map(|(_, data)| data.len()).sum();
+
+        let mut index = Vec::with_capacity(segments.len());
+        let mut buf = Vec::with_capacity(data_start + data_size);
+        buf.resize(data_start, 0);
+        for (mut segment, data) in segments {
+            segment.data_offset = buf.len();
+            buf[HEADER_SIZE + index.len() * ENTRY_SIZE..][..ENTRY_SIZE]
+                .copy_from_slice(&segment.to_le_bytes());
+            buf.extend_from_slice(&data);
+            index.push(segment);
+        }
+
+        buf[..8].copy_from_slice(&COMPACT_MAGIC);
+        buf[8..10].copy_from_slice(&COMPACT_VERSION.to_le_bytes());
+        buf[12..16].copy_from_slice(&(index.len() as u32).to_le_bytes());
+        let crc32 = checksum(&buf);
+        buf[16..20].copy_from_slice(&crc32.to_le_bytes());
+
+        Self {
+            bytes: Bytes::from(buf),
+            segments: index,
+        }
+    }
+
+    /// Verifies the CRC32 checksum of the header, segment index, and data.
+    pub fn check_integrity(&self) -> Result<(), CompactError> {
+        let expected = read_u32(&self.bytes, 16)?;
+        let computed = checksum(&self.bytes);
+        ensure!(
+            expected == computed,
+            NotCompactSnafu {
+                reason: format!("checksum 0x{computed:X} differs from expected 0x{expected:X}")
+            }
+        );
+        Ok(())
+    }
+
+    /// Returns the bytes of this compact ephemeris, as saved to a file.
+    pub fn as_bytes(&self) -> &[u8] {
+        &self.bytes
+    }
+
+    /// Returns the index of the segments, in their order of priority.
+    pub fn segments(&self) -> &[CompactSegment] {
+        &self.segments
+    }
+
+    /// Returns the first segment of this ID covering the provided epoch, as an SPK would prioritize them.
+    pub fn segment_at_epoch(
+        &self,
+        id: NaifId,
+        epoch: Epoch,
+    ) -> Result<&CompactSegment, CompactError> {
+        self.segments
+            .iter()
+            .find(|segment| segment.target_id == id && segment.contains(epoch))
+            .ok_or(CompactError::NoCompactSegment { id, epoch })
+    }
+
+    /// Returns the position and velocity of this ID with respect to its center at the provided epoch, and the ID of that center.
+    ///
+    /// Units are those of the original SPK, typically kilometers and kilometers per second.
+    pub fn evaluate(
+        &self,
+        id: NaifId,
+        epoch: Epoch,
+    ) -> Result<(Vector3, Vector3, NaifId), CompactError> {
+        let segment = self.segment_at_epoch(id, epoch)?;
+        let (pos_km, vel_km_s) = segment.evaluate(&self.bytes, epoch)?;
+        Ok((pos_km, vel_km_s, segment.center_id))
+    }
+
+    /// Saves this compact ephemeris to the provided file.
+    pub fn save_as(&self, filename: &Path, overwrite: bool) -> Result<(), CompactError> {
+        use log::{info, warn};
+
+        if filename.exists() {
+            if !overwrite {
+                return Err(CompactError::CompactIO {
+                    source: IOError::new(
+                        IOErrorKind::AlreadyExists,
+                        "file exists and overwrite flag set to false",
+                    ),
+                    action: "creating compact ephemeris file",
+                });
+            } else {
+                warn!("[save_as] overwriting {}", filename.display());
+            }
+        }
+
+        let mut file = File::create(filename).context(CompactIOSnafu {
+            action: "creating compact ephemeris file",
+        })?;
+        file.write_all(&self.bytes).context(CompactIOSnafu {
+            action: "writing compact ephemeris to file",
+        })?;
+        info!("[OK] compact ephemeris saved to {}", filename.display());
+        Ok(())
+    }
+}
+
+impl fmt::Display for CompactEphemeris {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        writeln!(
+            f,
+            "Compact ephemeris: {} segments in {} bytes",
+            self.segments.len(),
+            self.bytes.len()
+        )?;
+        for segment in &self.segments {
+            writeln!(
+                f,
+                "{} wrt {} (frame {}) from {:E} to {:E}: {:?} {} with {} records of {} bytes, error below {:e} km and {:e} km/s",
+                segment.target_id,
+                segment.center_id,
+                segment.frame_id,
+                segment.start_epoch(),
+                segment.end_epoch(),
+                segment.kind,
+                segment.encoding,
+                segment.num_records,
+                segment.record_size,
+                segment.max_error_km,
+                segment.max_error_km_s
+            )?;
+        }
+        Ok(())
+    }
+}
+
+/// Returns the data type of the SPK segments which can be compacted into this kind.
+pub(crate) fn compact_kind_of(dtype: DafDataType) -> Option<CompactKind> {
+    match dtype {
+        DafDataType::Type2ChebyshevTriplet => Some(CompactKind::Chebyshev),
+        DafDataType::Type13HermiteUnequalStep => Some(CompactKind::Hermite),
+        _ => None,
+    }
+}
+
+/// Decodes a Chebyshev record into the X, Y, and Z coefficients, one after the other, and returns its midpoint in ET seconds.
+pub(crate) fn decode_chebyshev(
+    encoding: CompactEncoding,
+    order: usize,
+    step_km: f64,
+    widths: &[u8],
+    record: &[u8],
+    coeffs: &mut [f64],
+) -> Result<f64, DecodingError> {
+    let midpoint_et_s = read_f64(record, 0)?;
+    let coeffs = coeffs.get_mut(..3 * order).ok_or(DecodingError::Casting)?;
+    match encoding {
+        CompactEncoding::F64 => {
+            for (i, coeff) in coeffs.iter_mut().enumerate() {
+                *coeff = read_f64(record, DBL_SIZE * (1 + i))?;
+            }
+        }
+        CompactEncoding::F32 => {
+            for (i, coeff) in coeffs.iter_mut().enumerate() {
+                *coeff = read_f32(record, DBL_SIZE + 4 * i)? as f64;
+            }
+        }
+        CompactEncoding::Quantized => {
+            let mut bits = BitReader::new(record.get(DBL_SIZE..).unwrap_or_default());
+            for (coeff, width) in coeffs.iter_mut().zip(widths) {
+                *coeff = unzigzag(bits.read(*width)?) as f64 * step_km;
+            }
+        }
+    }
+    Ok(midpoint_et_s)
+}
+
+/// Decodes a Hermite state into its position and velocity components.
+pub(crate) fn decode_state(
+    encoding: CompactEncoding,
+    record: &[u8],
+) -> Result<[f64; 6], DecodingError> {
+    let mut state = [0.0; 6];
+    for (i, value) in state.iter_mut().enumerate() {
+        *value = match encoding {
+            CompactEncoding::F32 => read_f32(record, 4 * i)? as f64,
+            _ => read_f64(record, DBL_SIZE * i)?,
+        };
+    }
+    Ok(state)
+}
+
+/// Maps signed integers to unsigned ones such that small magnitudes need few bits.
+pub(crate) fn zigzag(value: i64) -> u64 {
+    ((value << 1) ^ (value >> 63)) as u64
+}
+
+pub(crate) fn unzigzag(value: u64) -> i64 {
+    ((value >> 1) as i64) ^ -((value & 1) as i64)
+}
+
+/// Writes values with the provided number of bits each, least significant bit first.
+#[derive(Default)]
+pub(crate) struct BitWriter {
+    pub bytes: Vec<u8>,
+    acc: u128,
+    num_bits: u32,
+}
+
+impl BitWriter {
+    pub fn write(&mut self, value: u64, width: u8) {
+        self.acc |= (value as u128) << self.num_bits;
+        self.num_bits += width as u32;
+        while self.num_bits >= 8 {
+            self.bytes.push(self.acc as u8);
+            self.acc >>= 8;
+            self.num_bits -= 8;
+        }
+    }
+
+    pub fn finish(mut self) -> Vec<u8> {
+        if self.num_bits > 0 {
+            self.bytes.push(self.acc as u8);
+        }
+        self.bytes
+    }
+}
+
+struct BitReader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+    acc: u128,
+    num_bits: u32,
+}
+
+impl<'a> BitReader<'a> {
+    fn new(bytes: &'a [u8]) -> Self {
+        Self {
+            bytes,
+            pos: 0,
+            acc: 0,
+            num_bits: 0,
+        }
+    }
+
+    fn read(&mut self, width: u8) -> Result<u64, DecodingError> {
+        let width = width as u32;
+        if width == 0 {
+            return Ok(0);
+        } else if width > 64 {
+            return Err(DecodingError::Casting);
+        }
+        while self.num_bits < width {
+            let byte = *self
+                .bytes
+                .get(self.pos)
+                .ok_or(DecodingError::InaccessibleBytes {
+                    start: self.pos,
+                    end: self.pos + 1,
+                    size: self.bytes.len(),
+                })?;
+            self.acc |= (byte as u128) << self.num_bits;
+            self.pos += 1;
+            self.num_bits += 8;
+        }
+        let value = (self.acc & (u128::MAX >> (128 - width))) as u64;
+        self.acc >>= width;
+        self.num_bits -= width;
+        Ok(value)
+    }
+}
+
+/// Returns the CRC32 of a compact ephemeris of at least a header, computed with the checksum field of its header set to zero.
+fn checksum(bytes: &[u8]) -> u32 {
+    let mut hasher = crc32fast::Hasher::new();
+    hasher.update(&bytes[..16]);
+    hasher.update(&[0; 4]);
+    hasher.update(&bytes[20..]);
+    hasher.finalize()
+}
+
+fn slice(bytes: &[u8], start: usize, len: usize) -> Result<&[u8], DecodingError> {
+    let end = start.checked_add(len);
+    end.and_then(|end| bytes.get(start..end))
+        .ok_or(DecodingError::InaccessibleBytes {
+            start,
+            end: end.unwrap_or(usize::MAX),
+            size: bytes.len(),
+        })
+}
+
+fn read_u8(bytes: &[u8], start: usize) -> Result<u8, DecodingError> {
+    Ok(slice(bytes, start, 1)?[0])
+}
+
+fn read_u16(bytes: &[u8], start: usize) -> Result<u16, DecodingError> {
+    Ok(u16::from_le_bytes(
+        slice(bytes, start, 2)?.try_into().unwrap(),
+    ))
+}
+
+fn read_u32(bytes: &[u8], start: usize) -> Result<u32, DecodingError> {
+    Ok(u32::from_le_bytes(
+        slice(bytes, start, 4)?.try_into().unwrap(),
+    ))
+}
+
+fn read_i32(bytes: &[u8], start: usize) -> Result<i32, DecodingError> {
+    Ok(i32::from_le_bytes(
+        slice(bytes, start, 4)?.try_into().unwrap(),
+    ))
+}
+
+fn read_u64(bytes: &[u8], start: usize) -> Result<u64, DecodingError> {
+    Ok(u64::from_le_bytes(
+        slice(bytes, start, 8)?.try_into().unwrap(),
+    ))
+}
+
+fn read_f32(bytes: &[u8], start: usize) -> Result<f32, DecodingError> {
+    Ok(f32::from_le_bytes(
+        slice(bytes, start, 4)?.try_into().unwrap(),
+    ))
+}
+
+fn read_f64(bytes: &[u8], start: usize) -> Result<f64, DecodingError> {
+    Ok(f64::from_le_bytes(
+        slice(bytes, start, 8)?.try_into().unwrap(),
+    ))
+}
+
+impl From<DecodingError> for CompactError {
+    fn from(source: DecodingError) -> Self {
+        Self::CompactDecoding {
+            action: "reading compact ephemeris",
+            source,
+        }
+    }
+}
+
+#[cfg(test)]
+mod ut_compact {
+    use super::*;
+    use crate::naif::daf::datatypes::{HermiteSetType13, Type2ChebyshevSet};
+    use crate::naif::daf::NAIFDataSet;
+    use crate::naif::SPK;
+
+    /// Returns a few epochs spread over this segment, boundaries included.
+    fn epochs_of(segment: &CompactSegment) -> Vec<Epoch> {
+        (0..=7)
+            .map(|k| {
+                Epoch::from_et_seconds(
+                    segment.start_et_s + (segment.end_et_s - segment.start_et_s) * k as f64 / 7.0,
+                )
+            })
+            .collect()
+    }
+
+    #[test]
+    fn compact_chebyshev() {
+        let spk = SPK::load("../data/de440s.bsp").unwrap();
+
+        let lossless = CompactEphemeris::from_spk(&spk, CompactOptions::default()).unwrap();
+        lossless.check_integrity().unwrap();
+        let reloaded =
+            CompactEphemeris::from_bytes(Bytes::copy_from_slice(lossless.as_bytes())).unwrap();
+        assert_eq!(reloaded.segments(), lossless.segments());
+
+        let options = CompactOptions {
+            tolerance_km: 1e-3,
+            encoding: None,
+        };
+        let compact = CompactEphemeris::from_spk(&spk, options).unwrap();
+        compact.check_integrity().unwrap();
+        assert!(
+            2 * compact.as_bytes().len() < lossless.as_bytes().len(),
+            "{} bytes is not much smaller than {} bytes",
+            compact.as_bytes().len(),
+            lossless.as_bytes().len()
+        );
+
+        for (segment, lossless_segment) in compact.segments().iter().zip(lossless.segments()) {
+            assert_eq!(lossless_segment.encoding, CompactEncoding::F64);
+            assert!(segment.max_error_km <= options.tolerance_km);
+            for epoch in epochs_of(segment) {
+                let (summary, idx) = spk
+                    .summary_from_id_at_epoch(segment.target_id, epoch)
+                    .unwrap();
+                let (exp_pos_km, exp_vel_km_s) = spk
+                    .nth_data::<Type2ChebyshevSet>(idx)
+                    .unwrap()
+                    .evaluate(epoch, summary)
+                    .unwrap();
+
+                // The lossless encoding is evaluated exactly as the SPK.
+                let (pos_km, vel_km_s, center_id) =
+                    lossless.evaluate(segment.target_id, epoch).unwrap();
+                assert_eq!((pos_km, vel_km_s), (exp_pos_km, exp_vel_km_s));
+                assert_eq!(center_id, summary.center_id);
+
+                let (pos_km, vel_km_s, _) = compact.evaluate(segment.target_id, epoch).unwrap();
+                assert!((pos_km - exp_pos_km).norm() <= segment.max_error_km + 1e-9);
+                assert!((vel_km_s - exp_vel_km_s).norm() <= segment.max_error_km_s + 1e-12);
+            }
+        }
+
+        // An encoding which cannot meet the tolerance is rejected.
+        assert!(CompactEphemeris::from_spk(
+            &spk,
+            CompactOptions {
+                tolerance_km: 1e-9,
+                encoding: Some(CompactEncoding::F32),
+            },
+        )
+        .is_err());
+    }
+
+    #[test]
+    fn compact_hermite() {
+        let spk = SPK::load("../data/gmat-hermite.bsp").unwrap();
+        let options = CompactOptions {
+            tolerance_km: 1e-2,
+            encoding: Some(CompactEncoding::F32),
+        };
+        let compact = CompactEphemeris::from_spk(&spk, options).unwrap();
+        let lossless = CompactEphemeris::from_spk(&spk, CompactOptions::default()).unwrap();
+        assert!(compact.as_bytes().len() < lossless.as_bytes().len());
+        assert!(CompactEphemeris::from_spk(
+            &spk,
+            CompactOptions {
+                tolerance_km: 1.0,
+                encoding: Some(CompactEncoding::Quantized),
+            },
+        )
+        .is_err());
+
+        for segment in compact.segments() {
+            assert_eq!(segment.kind, CompactKind::Hermite);
+            for epoch in epochs_of(segment) {
+                let (summary, idx) = spk
+                    .summary_from_id_at_epoch(segment.target_id, epoch)
+                    .unwrap();
+                let (exp_pos_km, exp_vel_km_s) = spk
+                    .nth_data::<HermiteSetType13>(idx)
+                    .unwrap()
+                    .evaluate(epoch, summary)
+                    .unwrap();
+
+                let (pos_km, vel_km_s, _) = compact.evaluate(segment.target_id, epoch).unwrap();
+                assert!((pos_km - exp_pos_km).norm() < options.tolerance_km);
+                assert!((vel_km_s - exp_vel_km_s).norm() < 1e-5);
+
+                let (pos_km, _, _) = lossless.evaluate(segment.target_id, epoch).unwrap();
+                assert!((pos_km - exp_pos_km).norm() < 1e-6);
+            }
+        }
+
+        // The error of the f64 encoding is measured too, and only comes from rounding.
+        for segment in lossless.segments() {
+            assert_eq!(segment.encoding, CompactEncoding::F64);
+            assert!(segment.max_error_km < 1e-6, "{:e} km", segment.max_error_km);
+        }
+
+        assert!(compact
+            .evaluate(-1, compact.segments()[0].start_epoch())
+            .is_err());
+    }
+
+    #[test]
+    fn bit_packing() {
+        let values = [0_i64, -1, 1, 1 << 40, -(1 << 52), 12345];
+        let widths: Vec<u8> = values
+            .iter()
+            .map(|v| (64 - zigzag(*v).leading_zeros()) as u8)
+            .collect();
+        assert_eq!(&widths[..3], &[0, 1, 2]);
+
+        let mut writer = BitWriter::default();
+        for (value, width) in values.iter().zip(&widths) {
+            writer.write(zigzag(*value), *width);
+        }
+        let bytes = writer.finish();
+        let total_bits: usize = widths.iter().map(|w| *w as usize).sum();
+        assert_eq!(bytes.len(), (total_bits + 7) / 8);
+
+        let mut reader = BitReader::new(&bytes);
+        for (value, width) in values.iter().zip(&widths) {
+            assert_eq!(unzigzag(reader.read(*width).unwrap()), *value);
+        }
+        assert!(reader.read(64).is_err());
+    }
+
+    #[test]
+    fn not_compact() {
+        assert!(CompactEphemeris::from_bytes(Bytes::from_static(b"ANISECEP")).is_err());
+        assert!(CompactEphemeris::from_bytes(Bytes::from(vec![0_u8; HEADER_SIZE])).is_err());
+
+        let spk = SPK::load("../data/gmat-hermite.bsp").unwrap();
+        let compact = CompactEphemeris::from_spk(&spk, CompactOptions::default()).unwrap();
+        let corrupted = |offset: usize, value: &[u8]| {
+            let mut bytes = compact.as_bytes().to_vec();
+            bytes[offset..offset + value.len()].copy_from_slice(value);
+            CompactEphemeris::from_bytes(Bytes::from(bytes))
+        };
+        assert!(corrupted(0, &[]).is_ok());
+        // Number of segments, record size, and data offset of the first segment
+        assert!(corrupted(12, &u32::MAX.to_le_bytes()).is_err());
+        assert!(corrupted(HEADER_SIZE + 44, &1_u32.to_le_bytes()).is_err());
+        assert!(corrupted(HEADER_SIZE + 48, &u64::MAX.to_le_bytes()).is_err());
+        // The header is covered by the checksum too.
+        let reserved = corrupted(10, &[1]).unwrap();
+        assert!(reserved.check_integrity().is_err());
+
+        assert_eq!("F32".parse(), Ok(CompactEncoding::F32));
+        assert!("f16".parse::<CompactEncoding>().is_err());
+    }
+}
@@ -0,0 +1,341 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::fmt;
+use core::ops::Range;
+use std::sync::OnceLock;
+
+use bytes::Bytes;
+use der::{
+    asn1::{OctetStringRef, SequenceOf},
+    Decode, Reader, SliceReader, Tag,
+};
+use log::error;
+use snafu::prelude::*;
+
+use super::{decoding_error, DataSet, DataSetError, DataSetT};
+use crate::{
+    errors::{DecodingError, IntegrityError},
+    naif::daf::checksum,
+    structure::{
+        dataset::error::DataSetLutSnafu,
+        lookuptable::{LookUpTable, LutError},
+        metadata::Metadata,
+    },
+    NaifId,
+};
+
+/// A DataSet whose entries are only decoded when they are first accessed.
+///
+/// Loading one only decodes the metadata and the look up table, and checks that the encoded entries are within the bytes: the bytes
+/// themselves are kept as is, so a memory mapped file is only read where the accessed entries are. Each entry is then decoded once,
+/// on its first access, and references to that decoded entry are returned.
+///
+/// Hence, the integrity of the data is not checked on load. Use `check_integrity` to compute the checksum of all of the entries
+/// without decoding them. An entry which cannot be decoded returns an error on each access.
+#[derive(Clone)]
+pub struct LazyDataSet<T: DataSetT, const ENTRIES: usize> {
+    pub metadata: Metadata,
+    /// All datasets have LookUpTable (LUT) that stores the mapping between a key and its index in the ephemeris list.
+    pub lut: LookUpTable<ENTRIES>,
+    pub data_checksum: u32,
+    bytes: Bytes,
+    /// Location of all of the encoded entries in the bytes
+    data_span: Range<usize>,
+    /// Location of each encoded entry in the bytes
+    spans: Vec<Range<usize>>,
+    entries: Vec<OnceLock<T>>,
+}
+
+impl<T: DataSetT, const ENTRIES: usize> LazyDataSet<T, ENTRIES> {
+    /// Try to load an Anise file from these bytes, e.g. from `file2mmap!`, only decoding its metadata and look up table.
+    pub fn try_from_bytes(bytes: Bytes) -> Result<Self, DataSetError> {
+        let (metadata, lut, data_checksum, data_span, lengths) =
+            Self::decode_header(&bytes).map_err(|_| decoding_error(&bytes, T::NAME))?;
+
+        let mut spans = Vec::with_capacity(lengths.len());
+        let mut start = data_span.start;
+        for len in lengths.iter() {
+            let end = start + *len as usize;
+            if end > data_span.end {
+                error!("[lazy] entry #{} exceeds the encoded data", spans.len());
+                return Err(DataSetError::DataDecoding {
+                    action: "loading lazy data set",
+                    source: DecodingError::InaccessibleBytes {
+                        start,
+                        end,
+                        size: data_span.end,
+                    },
+                });
+            }
+            spans.push(start..end);
+            start = end;
+        }
+
+        let entries = (0..spans.len()).map(|_| OnceLock::new()).collect();
+
+        Ok(Self {
+            metadata,
+            lut,
+            data_checksum,
+            bytes,
+            data_span,
+            spans,
+            entries,
+        })
+    }
+
+    /// Decodes the metadata, look up table, checksum, location of the encoded entries, and length of each entry.
+    #[allow(clippy::type_complexity)]
+    fn decode_header(
+        bytes: &[u8],
+    ) -> der::Result<(
+        Metadata,
+        LookUpTable<ENTRIES>,
+        u32,
+        Range<usize>,
+        SequenceOf<u32, ENTRIES>,
+    )> {
+        let mut reader = SliceReader::new(bytes)?;
+        let metadata = reader.decode()?;
+        let lut = reader.decode()?;
+        let data_checksum = reader.decode()?;
+        // The first integer contains the number of usable items in the data, the others are the encoded length of each of them.
+        let bytes_meta: SequenceOf<u32, ENTRIES> = reader.decode()?;
+        let octets: OctetStringRef = reader.decode()?;
+
+        let start = octets.as_bytes().as_ptr() as usize - bytes.as_ptr() as usize;
+        let data_span = start..start + octets.as_bytes().len();
+
+        let mut lengths = SequenceOf::new();
+        let num_entries = bytes_meta.get(0).copied().unwrap_or(0) as usize;
+        for meta_idx in 0..num_entries {
+            let len = bytes_meta
+                .get(meta_idx + 1)
+                .ok_or_else(|| Tag::Sequence.value_error())?;
+            lengths.add(*len)?;
+        }
+
+        reader.finish((metadata, lut, data_checksum, data_span, lengths))
+    }
+
+    /// Computes the CRC32 of the encoded entries, without decoding them.
+    pub fn crc32(&self) -> u32 {
+        checksum::crc32(&self.bytes[self.data_span.clone()])
+    }
+
+    /// Checks that the CRC32 of the encoded entries matches the checksum of this data set, without decoding them.
+    pub fn check_integrity(&self) -> Result<(), IntegrityError> {
+        let computed_chksum = self.crc32();
+        if computed_chksum == self.data_checksum {
+            Ok(())
+        } else {
+            error!(
+                "[integrity] expected hash {} but computed {}",
+                self.data_checksum, computed_chksum
+            );
+            Err(IntegrityError::ChecksumInvalid {
+                expected: self.data_checksum,
+                computed: computed_chksum,
+            })
+        }
+    }
+
+    /// Returns a reference to the entry at that index, decoding it on its first access.
+    fn get_ref_by_index(&self, index: u32) -> Result<&T, DataSetError> {
+        let cell = self
+            .entries
+            .get(index as usize)
+            .ok_or(LutError::InvalidIndex { index })
+            .context(DataSetLutSnafu {
+                action: "fetching lazy entry",
+            })?;
+
+        if let Some(entry) = cell.get() {
+            return Ok(entry);
+        }
+
+        let entry =
+            T::from_der(&self.bytes[self.spans[index as usize].clone()]).map_err(|err| {
+                DataSetError::DataDecoding {
+                    action: "decoding lazy entry",
+                    source: DecodingError::DecodingDer { err },
+                }
+            })?;
+        // If another thread decoded this entry in the meantime, its entry is kept.
+        Ok(cell.get_or_init(|| entry))
+    }
+
+    /// Get a copy of the data with that ID, if that ID is in the lookup table
+    pub fn get_by_id(&self, id: NaifId) -> Result<T, DataSetError> {
+        self.get_ref_by_id(id).cloned()
+    }
+
+    /// Get a reference to the data with that ID, if that ID is in the lookup table, decoding it on its first access
+    pub fn get_ref_by_id(&self, id: NaifId) -> Result<&T, DataSetError> {
+        match self.lut.by_id.get(&id) {
+            Some(index) => self.get_ref_by_index(*index),
+            None => Err(DataSetError::DataSetLut {
+                action: "fetching by ID",
+                source: LutError::UnknownId { id },
+            }),
+        }
+    }
+
+    /// Get a copy of the data with that name, if that name is in the lookup table
+    pub fn get_by_name(&self, name: &str) -> Result<T, DataSetError> {
+        self.get_ref_by_name(name).cloned()
+    }
+
+    /// Get a reference to the data with that name, if that name is in the lookup table, decoding it on its first access
+    pub fn get_ref_by_name(&self, name: &str) -> Result<&T, DataSetError> {
+        match self.lut.by_name.get(&name.try_into().unwrap()) {
+            Some(index) => self.get_ref_by_index(*index),
+            None => Err(DataSetError::DataSetLut {
+                action: "fetching by name",
+                source: LutError::UnknownName {
+                    name: name.try_into().unwrap(),
+                },
+            }),
+        }
+    }
+
+    /// Returns the number of entries which have been decoded so far.
+    pub fn num_decoded(&self) -> usize {
+        self.entries
+            .iter()
+            .filter(|entry| entry.get().is_some())
+            .count()
+    }
+
+    /// Returns the length of the LONGEST of the two look up tables
+    pub fn len(&self) -> usize {
+        self.lut.len()
+    }
+
+    /// Returns whether this dataset is empty
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Decodes all of the entries into a DataSet, e.g. to modify it.
+    pub fn to_dataset(&self) -> Result<DataSet<T, ENTRIES>, DataSetError> {
+        let data = (0..self.entries.len() as u32)
+            .map(|index| self.get_ref_by_index(index).cloned())
+            .collect::<Result<Vec<T>, DataSetError>>()?;
+
+        Ok(DataSet {
+            metadata: self.metadata.clone(),
+            lut: self.lut.clone(),
+            data_checksum: self.data_checksum,
+            data,
+        })
+    }
+}
+
+impl<T: DataSetT, const ENTRIES: usize> fmt::Debug for LazyDataSet<T, ENTRIES> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("LazyDataSet")
+            .field("metadata", &self.metadata)
+            .field("lut", &self.lut)
+            .field("data_checksum", &self.data_checksum)
+            .field("num_entries", &self.entries.len())
+            .field("num_decoded", &self.num_decoded())
+            .finish()
+    }
+}
+
+impl<T: DataSetT, const ENTRIES: usize> fmt::Display for LazyDataSet<T, ENTRIES> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "{:?} with {} ID mappings and {} name mappings ({} of {} entries decoded)",
+            self.metadata.dataset_type,
+            self.lut.by_id.len(),
+            self.lut.by_name.len(),
+            self.num_decoded(),
+            self.entries.len()
+        )
+    }
+}
+
+#[cfg(test)]
+mod ut_lazy_dataset {
+    use der::Encode;
+
+    use super::*;
+    use crate::structure::spacecraft::{Mass, SRPData, SpacecraftData};
+
+    #[test]
+    fn lazy_spacecraft_lookup() {
+        let mut dataset = DataSet::<SpacecraftData, 64>::default();
+        for i in 0..40 {
+            let sc = SpacecraftData {
+                name: format!("sc {i}").as_str().try_into().unwrap(),
+                mass_kg: Some(Mass::from_dry_and_fuel_masses(100.0 + i as f64, 10.0)),
+                srp_data: (i % 2 == 0).then(SRPData::default),
+                ..Default::default()
+            };
+            dataset
+                .push(sc, Some(-100 - i), Some(&format!("spacecraft {i}")))
+                .unwrap();
+        }
+        dataset.set_crc32();
+
+        let mut buf = vec![];
+        dataset.encode_to_vec(&mut buf).unwrap();
+        let bytes = Bytes::from(buf);
+
+        let lazy = LazyDataSet::<SpacecraftData, 64>::try_from_bytes(bytes.clone()).unwrap();
+        assert_eq!(lazy.len(), 40);
+        assert_eq!(lazy.num_decoded(), 0);
+        assert!(lazy.check_integrity().is_ok());
+        assert_eq!(lazy.crc32(), dataset.crc32());
+
+        // Only the accessed entries are decoded, once.
+        let sc = lazy.get_ref_by_id(-117).unwrap();
+        assert_eq!(sc, dataset.get_ref_by_id(-117).unwrap());
+        assert!(core::ptr::eq(sc, lazy.get_ref_by_id(-117).unwrap()));
+        assert_eq!(
+            lazy.get_ref_by_name("spacecraft 17").unwrap(),
+            dataset.get_ref_by_id(-117).unwrap()
+        );
+        assert_eq!(
+            lazy.get_by_name("spacecraft 4").unwrap(),
+            dataset.get_by_name("spacecraft 4").unwrap()
+        );
+        assert_eq!(lazy.num_decoded(), 2);
+
+        assert!(lazy.get_ref_by_id(0).is_err());
+        assert!(lazy.get_ref_by_name("unknown").is_err());
+
+        assert_eq!(lazy.to_dataset().unwrap(), dataset);
+        assert_eq!(lazy.num_decoded(), 40);
+
+        // Corrupting an entry is only detected on access of that entry, or by checking the integrity.
+        let mut corrupted = bytes.to_vec();
+        let entry = lazy.spans[lazy.lut.by_id[&-130] as usize].clone();
+        corrupted[entry.start] = 0xFF;
+        let corrupted =
+            LazyDataSet::<SpacecraftData, 64>::try_from_bytes(Bytes::from(corrupted)).unwrap();
+        assert!(corrupted.check_integrity().is_err());
+        assert!(corrupted.get_ref_by_id(-130).is_err());
+        assert_eq!(
+            corrupted.get_ref_by_id(-117).unwrap(),
+            dataset.get_ref_by_id(-117).unwrap()
+        );
+
+        // Truncated bytes are rejected on load.
+        assert!(
+            LazyDataSet::<SpacecraftData, 64>::try_from_bytes(bytes.slice(..bytes.len() - 10))
+                .is_err()
+        );
+    }
+}
@@ -7,7 +7,7 @@
  *
  * Documentation: https://nyxspace.com/
  */
-use self::error::{DataDecodingSnafu, DataSetLutSnafu};
+use self::error::DataSetLutSnafu;
 use super::{
     lookuptable::{LookUpTable, LutError},
     metadata::Metadata,
@@ -16,6 +16,7 @@ use super::{
 };
 use crate::{
     errors::{DecodingError, IntegrityError},
+    naif::daf::checksum,
     structure::dataset::error::DataSetIntegritySnafu,
     NaifId,
 };
@@ -41,9 +42,11 @@ io_imports!();
 
 mod datatype;
 mod error;
+mod lazy;
 
 pub use datatype::DataSetType;
 pub use error::DataSetError;
+pub use lazy::LazyDataSet;
 
 /// The kind of data that can be encoded in a dataset
 pub trait DataSetT: Clone + Default + Encode + for<'a> Decode<'a> {
@@ -73,44 +76,7 @@ impl<T: DataSetT, const ENTRIES: usize> DataSet<T, ENTRIES> {
                 })?;
                 Ok(ctx)
             }
-            Err(_) => {
-                // If we can't load the file, let's try to load the version only to be helpful
-                let semver_bytes = bytes
-                    .get(0..5)
-                    .ok_or(DecodingError::InaccessibleBytes {
-                        start: 0,
-                        end: 5,
-                        size: bytes.len(),
-                    })
-                    .context(DataDecodingSnafu {
-                        action: "checking data set version",
-                    })?;
-                match Semver::from_der(semver_bytes) {
-                    Ok(file_version) => {
-                        if file_version == ANISE_VERSION {
-                            Err(DataSetError::DataDecoding {
-                                action: "loading from bytes",
-                                source: DecodingError::Obscure { kind: T::NAME },
-                            })
-                        } else {
-                            Err(DataSetError::DataDecoding {
-                                action: "checking data set version",
-                                source: DecodingError::AniseVersion {
-                                    got: file_version,
-                                    exp: ANISE_VERSION,
-                                },
-                            })
-                        }
-                    }
-                    Err(err) => {
-                        error!("context bytes not in ANISE format");
-                        Err(DataSetError::DataDecoding {
-                            action: "loading SemVer",
-                            source: DecodingError::DecodingDer { err },
-                        })
-                    }
-                }
-            }
+            Err(_) => Err(decoding_error(&bytes, T::NAME)),
         }
     }
 
@@ -123,7 +89,7 @@ impl<T: DataSetT, const ENTRIES: usize> DataSet<T, ENTRIES> {
     /// Compute the CRC32 of the underlying bytes
     pub fn crc32(&self) -> u32 {
         let bytes = self.build_data_seq().1;
-        crc32fast::hash(bytes.as_bytes())
+        checksum::crc32(bytes.as_bytes())
     }
 
     /// Sets the checksum of this data.
@@ -227,11 +193,15 @@ impl<T: DataSetT, const ENTRIES: usize> DataSet<T, ENTRIES> {
 
     /// Get a copy of the data with that ID, if that ID is in the lookup table
     pub fn get_by_id(&self, id: NaifId) -> Result<T, DataSetError> {
+        self.get_ref_by_id(id).cloned()
+    }
+
+    /// Get a reference to the data with that ID, if that ID is in the lookup table, avoiding the copy of `get_by_id`
+    pub fn get_ref_by_id(&self, id: NaifId) -> Result<&T, DataSetError> {
         if let Some(index) = self.lut.by_id.get(&id) {
             // Found the ID
             self.data
                 .get(*index as usize)
-                .cloned()
                 .ok_or_else(|| LutError::InvalidIndex { index: *index })
                 .context(DataSetLutSnafu {
                     action: "fetching by ID",
@@ -300,10 +270,14 @@ impl<T: DataSetT, const ENTRIES: usize> DataSet<T, ENTRIES> {
 
     /// Get a copy of the data with that name, if that name is in the lookup table
     pub fn get_by_name(&self, name: &str) -> Result<T, DataSetError> {
+        self.get_ref_by_name(name).cloned()
+    }
+
+    /// Get a reference to the data with that name, if that name is in the lookup table, avoiding the copy of `get_by_name`
+    pub fn get_ref_by_name(&self, name: &str) -> Result<&T, DataSetError> {
         if let Some(index) = self.lut.by_name.get(&name.try_into().unwrap()) {
             self.data
                 .get(*index as usize)
-                .cloned()
                 .ok_or_else(|| LutError::InvalidIndex { index: *index })
                 .context(DataSetLutSnafu {
                     action: "fetching by name",
@@ -448,6 +422,47 @@ impl<T: DataSetT, const ENTRIES: usize> DataSet<T, ENTRIES> {
     }
 }
 
+/// Returns the most helpful error when the provided bytes cannot be decoded as a data set of that kind: whether the ANISE version
+/// of these bytes differs from this version, or whether these bytes are not ANISE data at all.
+pub(crate) fn decoding_error(bytes: &[u8], kind: &'static str) -> DataSetError {
+    // If we can't load the file, let's try to load the version only to be helpful
+    let Some(semver_bytes) = bytes.get(0..5) else {
+        return DataSetError::DataDecoding {
+            action: "checking data set version",
+            source: DecodingError::InaccessibleBytes {
+                start: 0,
+                end: 5,
+                size: bytes.len(),
+            },
+        };
+    };
+    match Semver::from_der(semver_bytes) {
+        Ok(file_version) => {
+            if file_version == ANISE_VERSION {
+                DataSetError::DataDecoding {
+                    action: "loading from bytes",
+                    source: DecodingError::Obscure { kind },
+                }
+            } else {
+                DataSetError::DataDecoding {
+                    action: "checking data set version",
+                    source: DecodingError::AniseVersion {
+                        got: file_version,
+                        exp: ANISE_VERSION,
+                    },
+                }
+            }
+        }
+        Err(err) => {
+            error!("context bytes not in ANISE format");
+            DataSetError::DataDecoding {
+                action: "loading SemVer",
+                source: DecodingError::DecodingDer { err },
+            }
+        }
+    }
+}
+
 impl<T: DataSetT, const ENTRIES: usize> Encode for DataSet<T, ENTRIES> {
     fn encoded_len(&self) -> der::Result<der::Length> {
         let (bytes_meta, bytes) = self.build_data_seq();
@@ -625,8 +640,13 @@ mod dataset_ut {
         let srp_repr = repr_dec.get_by_id(-20).unwrap();
         assert_eq!(srp_repr, srp_sc);
 
+        // References point to the same entries
+        assert_eq!(repr_dec.get_ref_by_id(-50).unwrap(), &full_sc);
+        assert_eq!(repr_dec.get_ref_by_name("SRP spacecraft").unwrap(), &srp_sc);
+
         // And check that we get an error if the data is wrong.
         assert!(repr_dec.get_by_id(0).is_err());
+        assert!(repr_dec.get_ref_by_id(0).is_err());
 
         // Check that we can modify it.
         let orig_dataset = dataset.clone();
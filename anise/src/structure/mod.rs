@@ -12,6 +12,7 @@
  * This module only contains the serialization and deserialization components of ANISE.
  * All other computations are at a higher level module.
  */
+pub mod compact;
 pub mod dataset;
 pub mod lookuptable;
 pub mod metadata;
@@ -12,7 +12,7 @@ use crate::{
     astro::PhysicsResult,
     constants::orientations::orientation_name_from_id,
     math::{
-        rotation::{r1, r3, DCM},
+        rotation::{r3r1r3, DCM},
         Matrix3,
     },
     prelude::{Frame, FrameUid},
@@ -22,6 +22,7 @@ use core::f64::consts::FRAC_PI_2;
 use core::fmt;
 pub mod ellipsoid;
 pub mod phaseangle;
+pub mod rotation_model;
 use der::{Decode, Encode, Reader, Writer};
 use ellipsoid::Ellipsoid;
 use hifitime::{Epoch, TimeUnits, Unit};
@@ -224,11 +225,8 @@ impl PlanetaryData {
                 None => 0.0,
             };
 
-            let ra_dcm = r3(right_asc_rad);
-            let dec_dcm = r1(dec_rad);
-            let w_dcm = r3(twist_rad);
-            // Perform a multiplication of the DCMs, regardless of frames.
-            Ok(w_dcm * dec_dcm * ra_dcm)
+            // Perform the 3-1-3 rotation, regardless of frames.
+            Ok(r3r1r3(right_asc_rad, dec_rad, twist_rad))
         }
     }
 
@@ -0,0 +1,186 @@
+/*
+ * ANISE Toolkit
+ * Copyright (C) 2021-onward Christopher Rabotin <christopher.rabotin@gmail.com> et al. (cf. AUTHORS.md)
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Documentation: https://nyxspace.com/
+ */
+
+use core::f64::consts::FRAC_PI_2;
+
+use hifitime::{Epoch, TimeUnits, Unit};
+
+use super::{phaseangle::PhaseAngle, PlanetaryData, MAX_NUT_PREC_ANGLES};
+use crate::{
+    math::{
+        rotation::{r3r1r3, DCM},
+        Matrix3,
+    },
+    NaifId,
+};
+
+/// A pole or prime meridian angle, where only the non-zero nutation and precession terms are kept.
+#[derive(Clone, Debug, PartialEq)]
+struct CompiledAngle {
+    offset_deg: f64,
+    rate_deg: f64,
+    accel_deg: f64,
+    /// Index of the nutation and precession angle and coefficient of each term
+    terms: Vec<(usize, f64)>,
+}
+
+impl CompiledAngle {
+    fn new(angle: &PhaseAngle<MAX_NUT_PREC_ANGLES>) -> Self {
+        Self {
+            offset_deg: angle.offset_deg,
+            rate_deg: angle.rate_deg,
+            accel_deg: angle.accel_deg,
+            terms: angle
+                .coeffs
+                .iter()
+                .copied()
+                .enumerate()
+                .take(angle.coeffs_count as usize)
+                .filter(|(_, coeff)| *coeff != 0.0)
+                .collect(),
+        }
+    }
+
+    fn max_term(&self) -> usize {
+        self.terms.last().map_or(0, |(ii, _)| ii + 1)
+    }
+
+    /// Evaluates this angle in degrees, given the time since J2000 TDB and the trigonometric function of each nutation and precession angle.
+    fn evaluate_deg(&self, factor: f64, trig: &[f64]) -> f64 {
+        let mut angle_deg =
+            self.offset_deg + self.rate_deg * factor + self.accel_deg * factor.powi(2);
+        for (ii, coeff) in &self.terms {
+            angle_deg += coeff * trig[*ii];
+        }
+        angle_deg
+    }
+}
+
+/// The rotation of a body to its parent frame from planetary constants, compiled once such that it can be evaluated many times.
+///
+/// The planetary data of the body and the nutation and precession angles of its system are copied once, and only the terms
+/// with a non-zero coefficient are evaluated, along with one sine and cosine per nutation and precession angle.
+/// This computes exactly the same rotation as [PlanetaryData::rotation_to_parent].
+#[derive(Clone, Debug, PartialEq)]
+pub struct PlanetaryRotationModel {
+    /// The NAIF ID of this object
+    pub object_id: NaifId,
+    /// The NAIF ID of the parent orientation
+    pub parent_id: NaifId,
+    right_ascension: Option<CompiledAngle>,
+    declination: Option<CompiledAngle>,
+    prime_meridian: Option<CompiledAngle>,
+    /// Nutation and precession angles of the system, only up to the last one used
+    nut_prec_angles: Vec<PhaseAngle<0>>,
+}
+
+impl PlanetaryRotationModel {
+    /// Compiles the rotation model of this body given the planetary data of its system, i.e. the body itself if it has no parent data.
+    pub fn new(body: &PlanetaryData, system: &PlanetaryData) -> Self {
+        let right_ascension = body.pole_right_ascension.as_ref().map(CompiledAngle::new);
+        let declination = body.pole_declination.as_ref().map(CompiledAngle::new);
+        let prime_meridian = body.prime_meridian.as_ref().map(CompiledAngle::new);
+
+        let num_used = [&right_ascension, &declination, &prime_meridian]
+            .iter()
+            .filter_map(|angle| angle.as_ref().map(|angle| angle.max_term()))
+            .max()
+            .unwrap_or(0);
+
+        // Angles which the system does not define are zero, as in PlanetaryData::dcm_to_parent.
+        let zero = PhaseAngle::<0> {
+            offset_deg: 0.0,
+            rate_deg: 0.0,
+            accel_deg: 0.0,
+            coeffs_count: 0,
+            coeffs: [],
+        };
+        let nut_prec_angles = (0..num_used)
+            .map(|ii| {
+                if ii < system.num_nut_prec_angles as usize {
+                    system.nut_prec_angles[ii]
+                } else {
+                    zero
+                }
+            })
+            .collect();
+
+        Self {
+            object_id: body.object_id,
+            parent_id: body.parent_id,
+            right_ascension,
+            declination,
+            prime_meridian,
+            nut_prec_angles,
+        }
+    }
+
+    /// Returns true if this model has no rotation at all.
+    pub fn is_identity(&self) -> bool {
+        self.right_ascension.is_none()
+            && self.declination.is_none()
+            && self.prime_meridian.is_none()
+    }
+
+    /// Computes the rotation matrix to the parent frame.
+    pub fn dcm_to_parent(&self, epoch: Epoch) -> Matrix3 {
+        if self.is_identity() {
+            return Matrix3::identity();
+        }
+
+        let mut sines = [0.0_f64; MAX_NUT_PREC_ANGLES];
+        let mut cosines = [0.0_f64; MAX_NUT_PREC_ANGLES];
+        for (ii, nut_prec_angle) in self.nut_prec_angles.iter().enumerate() {
+            let angle_rad = nut_prec_angle
+                .evaluate_deg(epoch, Unit::Century)
+                .to_radians();
+            (sines[ii], cosines[ii]) = angle_rad.sin_cos();
+        }
+
+        let tdb = epoch.to_tdb_duration();
+        let centuries = tdb.to_unit(Unit::Century);
+        let days = tdb.to_unit(Unit::Day);
+
+        let right_asc_rad = match &self.right_ascension {
+            Some(angle) => angle.evaluate_deg(centuries, &sines).to_radians() + FRAC_PI_2,
+            None => 0.0,
+        };
+
+        let dec_rad = match &self.declination {
+            Some(angle) => FRAC_PI_2 - angle.evaluate_deg(centuries, &cosines).to_radians(),
+            None => 0.0,
+        };
+
+        let twist_rad = match &self.prime_meridian {
+            Some(angle) => angle.evaluate_deg(days, &sines).to_radians(),
+            None => 0.0,
+        };
+
+        r3r1r3(right_asc_rad, dec_rad, twist_rad)
+    }
+
+    /// Computes the rotation to the parent frame, including its time derivative, like [PlanetaryData::rotation_to_parent].
+    pub fn rotation_to_parent(&self, epoch: Epoch) -> DCM {
+        if self.is_identity() {
+            DCM::identity(self.object_id, self.parent_id)
+        } else {
+            // For planetary constants data, we perform a finite differencing to compute the time derivative.
+            let pre_rot_dcm = self.dcm_to_parent(epoch - 1.seconds());
+            let post_rot_dcm = self.dcm_to_parent(epoch + 1.seconds());
+
+            DCM {
+                rot_mat: self.dcm_to_parent(epoch),
+                rot_mat_dt: Some((post_rot_dcm - pre_rot_dcm) / 2.0),
+                from: self.parent_id,
+                to: self.object_id,
+            }
+        }
+    }
+}
@@ -1,6 +1,6 @@
 // Start by creating the ANISE planetary data
 use anise::{
-    constants::frames::{EARTH_ITRF93, EARTH_J2000},
+    constants::frames::{EARTH_ITRF93, EARTH_J2000, MOON_J2000},
     naif::kpl::parser::convert_tpc,
     prelude::{Aberration, Almanac, Orbit, BPC, SPK},
 };
@@ -77,3 +77,281 @@ fn test_state_transformation() {
 
     assert_eq!(orig_state, from_state_itrf93_to_eme2k);
 }
+
+#[test]
+fn test_load_mmap() {
+    let heap = Almanac::default()
+        .load("../data/de440s.bsp")
+        .unwrap()
+        .load("../data/earth_latest_high_prec.bpc")
+        .unwrap();
+
+    // SAFETY: the test data is not modified while the tests run.
+    let mapped = unsafe {
+        Almanac::default()
+            .load_mmap("../data/de440s.bsp")
+            .unwrap()
+            .load_mmap("../data/earth_latest_high_prec.bpc")
+            .unwrap()
+    };
+
+    assert_eq!(mapped.num_loaded_spk(), 1);
+    assert_eq!(mapped.num_loaded_bpc(), 1);
+
+    let epoch = Epoch::from_str("2021-10-29 12:34:56 TDB").unwrap();
+
+    assert_eq!(
+        heap.transform(EARTH_ITRF93, MOON_J2000, epoch, None)
+            .unwrap(),
+        mapped
+            .transform(EARTH_ITRF93, MOON_J2000, epoch, None)
+            .unwrap()
+    );
+}
+
+#[test]
+fn test_many_loaded_spks() {
+    let planets = Almanac::new("../data/de440s.bsp").unwrap();
+    let spacecraft = SPK::load("../data/gmat-hermite.bsp").unwrap();
+    let sc_frame = anise::prelude::Frame::from_ephem_j2000(-10000001);
+    let epoch = Epoch::from_str("2000-01-01T14:00:00 UTC").unwrap();
+
+    // Far more SPKs than the former fixed limit of 32
+    let mut almanac = planets.clone();
+    for _ in 0..300 {
+        almanac = almanac.with_spk(spacecraft.clone()).unwrap();
+    }
+    assert_eq!(almanac.num_loaded_spk(), 301);
+    assert_eq!(almanac.spk_index.num_indexed(), 301);
+    // The original Almanac is unchanged
+    assert_eq!(planets.num_loaded_spk(), 1);
+
+    let once = planets.with_spk(spacecraft).unwrap();
+    for (target, observer) in [(sc_frame, MOON_J2000), (MOON_J2000, EARTH_J2000)] {
+        let expected = once.translate_geometric(target, observer, epoch).unwrap();
+        let state = almanac
+            .translate_geometric(target, observer, epoch)
+            .unwrap();
+        assert_eq!(state.radius_km, expected.radius_km);
+        assert_eq!(state.velocity_km_s, expected.velocity_km_s);
+    }
+
+    // The most recently loaded SPK is the one used
+    let (_, spk_no, _) = almanac.spk_summary_at_epoch(-10000001, epoch).unwrap();
+    assert_eq!(spk_no, 300);
+    assert_eq!(almanac.try_find_ephemeris_root().unwrap(), 0);
+}
+
+#[cfg(feature = "parallel")]
+#[test]
+fn test_transform_batch() {
+    use anise::almanac::batch::BatchJob;
+    use anise::constants::frames::VENUS_J2000;
+    use hifitime::Unit;
+
+    let almanac = Almanac::default()
+        .load("../data/de440s.bsp")
+        .unwrap()
+        .load("../data/earth_latest_high_prec.bpc")
+        .unwrap()
+        .load("../data/pck08.pca")
+        .unwrap();
+
+    let start = Epoch::from_str("2021-10-29 12:34:56 TDB").unwrap();
+
+    let jobs = [
+        BatchJob::new(
+            MOON_J2000,
+            EARTH_ITRF93,
+            start,
+            start + Unit::Day * 3,
+            Unit::Minute * 7,
+            None,
+        ),
+        // Long enough to span several segments of DE440s
+        BatchJob::new(
+            VENUS_J2000,
+            EARTH_J2000,
+            start,
+            start + Unit::Day * 90,
+            Unit::Hour * 1,
+            Aberration::LT,
+        ),
+        // Empty job
+        BatchJob::new(
+            MOON_J2000,
+            EARTH_J2000,
+            start,
+            start,
+            Unit::Second * 0,
+            None,
+        ),
+    ];
+
+    let results = almanac.transform_batch(&jobs);
+    assert_eq!(results.len(), jobs.len());
+
+    for (job, result) in jobs.iter().zip(results) {
+        let states = result.unwrap();
+        assert_eq!(states.len(), job.len());
+        for (n, state) in states.iter().enumerate() {
+            let expected = almanac
+                .transform(
+                    job.target_frame,
+                    job.observer_frame,
+                    job.epoch(n),
+                    job.ab_corr,
+                )
+                .unwrap();
+            assert_eq!(state, &expected);
+        }
+    }
+
+    // Data outside of the loaded ephemeris only fails that job, and buffers are reused.
+    let bad_job = BatchJob::new(
+        MOON_J2000,
+        EARTH_J2000,
+        Epoch::from_str("1000-01-01 00:00:00 TDB").unwrap(),
+        Epoch::from_str("1000-01-02 00:00:00 TDB").unwrap(),
+        Unit::Hour * 1,
+        None,
+    );
+    let mut outputs = Vec::new();
+    let statuses = almanac.transform_batch_into(&[jobs[0], bad_job], &mut outputs);
+    assert!(statuses[0].is_ok());
+    assert!(statuses[1].is_err());
+    assert_eq!(outputs[0].len(), jobs[0].len());
+}
+
+#[test]
+fn test_transform_many() {
+    use anise::constants::frames::IAU_MOON_FRAME;
+    use hifitime::{TimeSeries, Unit};
+
+    let almanac = Almanac::default()
+        .load("../data/de440s.bsp")
+        .unwrap()
+        .load("../data/earth_latest_high_prec.bpc")
+        .unwrap()
+        .load("../data/pck08.pca")
+        .unwrap();
+
+    let start = Epoch::from_str("2021-10-29 12:34:56 TDB").unwrap();
+    let epochs: Vec<Epoch> =
+        TimeSeries::inclusive(start, start + Unit::Day * 3, Unit::Minute * 17).collect();
+
+    for (target, observer, ab_corr) in [
+        (IAU_MOON_FRAME, EARTH_ITRF93, None),
+        (EARTH_ITRF93, IAU_MOON_FRAME, Aberration::LT),
+        (MOON_J2000, EARTH_J2000, Aberration::CN_S),
+    ] {
+        let states = almanac
+            .transform_many(target, observer, epochs.iter().copied(), ab_corr)
+            .unwrap();
+        assert_eq!(states.len(), epochs.len());
+        for (state, epoch) in states.iter().zip(epochs.iter()) {
+            let expected = almanac
+                .transform(target, observer, *epoch, ab_corr)
+                .unwrap();
+            assert_eq!(state, &expected, "{target} -> {observer} @ {epoch}");
+        }
+
+        // Writing into a longer buffer only fills the first states.
+        let mut buffer = vec![Orbit::zero(observer); epochs.len() + 1];
+        let written = almanac
+            .transform_many_into(
+                target,
+                observer,
+                epochs.iter().copied(),
+                ab_corr,
+                &mut buffer,
+            )
+            .unwrap();
+        assert_eq!(written, epochs.len());
+        assert_eq!(&buffer[..written], states.as_slice());
+        assert_eq!(buffer[written], Orbit::zero(observer));
+    }
+}
+
+#[test]
+fn visibility_passes_match_aer() {
+    use anise::almanac::visibility::VisibilitySettings;
+    use anise::constants::frames::IAU_EARTH_FRAME;
+    use anise::constants::usual_planetary_constants::MEAN_EARTH_ANGULAR_VELOCITY_DEG_S;
+    use anise::prelude::{Frame, Unit};
+
+    let almanac = Almanac::default()
+        .load("../data/de440s.bsp")
+        .unwrap()
+        .load("../data/gmat-hermite.bsp")
+        .unwrap()
+        .load("../data/pck08.pca")
+        .unwrap();
+
+    let iau_earth = almanac.frame_from_uid(IAU_EARTH_FRAME).unwrap();
+    let sc = Frame::from_ephem_j2000(-10000001);
+    let (start, end) = almanac.spk_domain(-10000001).unwrap();
+
+    // A grid of stations, such that the spacecraft passes over several of them.
+    let sites: Vec<(f64, f64)> = (-2..=2)
+        .flat_map(|lat| (0..8).map(move |long| (lat as f64 * 30.0, long as f64 * 45.0)))
+        .collect();
+    let station_at = |(latitude_deg, longitude_deg): (f64, f64), epoch: Epoch| {
+        Orbit::try_latlongalt(
+            latitude_deg,
+            longitude_deg,
+            0.5,
+            MEAN_EARTH_ANGULAR_VELOCITY_DEG_S,
+            epoch,
+            iau_earth,
+        )
+        .unwrap()
+    };
+    let stations: Vec<Orbit> = sites.iter().map(|site| station_at(*site, start)).collect();
+
+    let settings = VisibilitySettings {
+        min_elevation_deg: 10.0,
+        ..Default::default()
+    };
+    let passes = almanac
+        .visibility_passes(&stations, &[sc], start, end, settings)
+        .unwrap();
+    assert!(!passes.is_empty());
+
+    let elevation_deg = |station: usize, epoch: Epoch| {
+        let rx = almanac.transform(sc, EARTH_J2000, epoch, None).unwrap();
+        almanac
+            .azimuth_elevation_range_sez(rx, station_at(sites[station], epoch))
+            .unwrap()
+            .elevation_deg
+    };
+
+    for pass in passes {
+        assert!(pass.max_elevation_deg >= settings.min_elevation_deg);
+        // The crossings match the elevation of the AER computation, to the precision of the search.
+        if pass.rise_epoch > start {
+            let el_deg = elevation_deg(pass.station, pass.rise_epoch);
+            assert!(
+                (el_deg - settings.min_elevation_deg).abs() < 1e-2,
+                "rise of {pass:?} at {el_deg} deg"
+            );
+            assert!(
+                elevation_deg(pass.station, pass.rise_epoch - Unit::Second * 1)
+                    < settings.min_elevation_deg
+            );
+        }
+        if pass.set_epoch < end {
+            let el_deg = elevation_deg(pass.station, pass.set_epoch);
+            assert!(
+                (el_deg - settings.min_elevation_deg).abs() < 1e-2,
+                "set of {pass:?} at {el_deg} deg"
+            );
+            assert!(
+                elevation_deg(pass.station, pass.set_epoch + Unit::Second * 1)
+                    < settings.min_elevation_deg
+            );
+        }
+        let mid_epoch = pass.rise_epoch + 0.5 * pass.duration();
+        assert!(elevation_deg(pass.station, mid_epoch) >= settings.min_elevation_deg);
+    }
+}
@@ -377,6 +377,86 @@ fn multithread_query() {
     println!("Took {delta_t}");
 }
 
+#[test]
+fn translate_many_matches_translate() {
+    let ctx = Almanac::default()
+        .load("../data/de440s.bsp")
+        .and_then(|ctx| ctx.load("../data/gmat-hermite.bsp"))
+        .unwrap();
+
+    let my_sc_j2k = Frame::from_ephem_j2000(-10000001);
+    let (start, end) = ctx.spk_domain(-10000001).unwrap();
+
+    for (target, observer) in [
+        (my_sc_j2k, EARTH_J2000),
+        (my_sc_j2k, MOON_J2000),
+        (MOON_J2000, VENUS_J2000),
+    ] {
+        let epochs: Vec<Epoch> = TimeSeries::inclusive(start, end, 1.minutes()).collect();
+
+        let states = ctx
+            .translate_many(target, observer, epochs.iter().copied(), None)
+            .unwrap();
+
+        assert_eq!(states.len(), epochs.len());
+
+        for (state, epoch) in states.iter().zip(epochs) {
+            let expected = ctx.translate_geometric(target, observer, epoch).unwrap();
+            assert_eq!(state.epoch, epoch);
+            assert_eq!(state.frame, expected.frame);
+            assert_eq!(
+                state.radius_km, expected.radius_km,
+                "{target} -> {observer} @ {epoch}"
+            );
+            assert_eq!(state.velocity_km_s, expected.velocity_km_s);
+        }
+    }
+}
+
+#[test]
+fn aberration_corrected_reuse_matches_translate() {
+    let ctx = Almanac::default()
+        .load("../data/de440s.bsp")
+        .and_then(|ctx| ctx.load("../data/gmat-hermite.bsp"))
+        .unwrap();
+
+    let my_sc_j2k = Frame::from_ephem_j2000(-10000001);
+    let (start, end) = ctx.spk_domain(-10000001).unwrap();
+    let epochs: Vec<Epoch> = TimeSeries::inclusive(start, end, 7.minutes()).collect();
+    let targets = [MOON_J2000, VENUS_J2000, EARTH_J2000, my_sc_j2k];
+
+    for ab_corr in [
+        Aberration::LT,
+        Aberration::LT_S,
+        Aberration::CN_S,
+        Aberration::XCN,
+    ] {
+        let states = ctx
+            .translate_many(my_sc_j2k, MOON_J2000, epochs.iter().copied(), ab_corr)
+            .unwrap();
+
+        for (state, epoch) in states.iter().zip(epochs.iter()) {
+            let expected = ctx
+                .translate(my_sc_j2k, MOON_J2000, *epoch, ab_corr)
+                .unwrap();
+            assert_eq!(state.radius_km, expected.radius_km, "{ab_corr:?} @ {epoch}");
+            assert_eq!(state.velocity_km_s, expected.velocity_km_s);
+        }
+
+        let epoch = epochs[epochs.len() / 2];
+        let states = ctx
+            .translate_targets(&targets, EARTH_J2000, epoch, ab_corr)
+            .unwrap();
+
+        for (state, target) in states.iter().zip(targets) {
+            let expected = ctx.translate(target, EARTH_J2000, epoch, ab_corr).unwrap();
+            assert_eq!(state.radius_km, expected.radius_km, "{ab_corr:?} {target}");
+            assert_eq!(state.velocity_km_s, expected.velocity_km_s);
+            assert_eq!(state.frame, expected.frame);
+        }
+    }
+}
+
 #[test]
 fn hermite_query() {
     use anise::naif::kpl::parser::convert_tpc;
@@ -435,6 +515,139 @@ fn hermite_query() {
         .is_ok());
 }
 
+#[test]
+fn hermite_window_cache() {
+    use anise::naif::daf::datatypes::set_interpolation_window_cache;
+
+    let traj = SPK::load("../data/gmat-hermite.bsp").unwrap();
+    let summary = traj.data_summaries().unwrap()[0];
+    let ctx = Almanac::from_spk(traj).unwrap();
+
+    // Step through the data at one second intervals, such that most queries land in the same window as the previous one.
+    let end = summary
+        .end_epoch()
+        .min(summary.start_epoch() + Unit::Hour * 1);
+    let epochs: Vec<Epoch> =
+        TimeSeries::inclusive(summary.start_epoch(), end, Unit::Second * 1).collect();
+
+    let mut states = Vec::with_capacity(epochs.len());
+    for epoch in &epochs {
+        states.push(
+            ctx.translate(
+                summary.target_frame(),
+                summary.center_frame(),
+                *epoch,
+                Aberration::NONE,
+            )
+            .unwrap(),
+        );
+    }
+
+    set_interpolation_window_cache(false);
+    for (epoch, cached) in epochs.iter().zip(states.iter()) {
+        let state = ctx
+            .translate(
+                summary.target_frame(),
+                summary.center_frame(),
+                *epoch,
+                Aberration::NONE,
+            )
+            .unwrap();
+        assert_eq!(state.radius_km, cached.radius_km, "{epoch}");
+        assert_eq!(state.velocity_km_s, cached.velocity_km_s, "{epoch}");
+    }
+    set_interpolation_window_cache(true);
+}
+
+#[test]
+fn hermite_newton_windows() {
+    let traj = SPK::load("../data/gmat-hermite.bsp").unwrap();
+    let summary = traj.data_summaries().unwrap()[0];
+    let ctx = Almanac::from_spk(traj).unwrap();
+
+    let end = summary
+        .end_epoch()
+        .min(summary.start_epoch() + Unit::Hour * 1);
+    let epochs: Vec<Epoch> =
+        TimeSeries::inclusive(summary.start_epoch(), end, Unit::Second * 7).collect();
+
+    let expected: Vec<Orbit> = epochs
+        .iter()
+        .map(|epoch| {
+            ctx.translate(
+                summary.target_frame(),
+                summary.center_frame(),
+                *epoch,
+                Aberration::NONE,
+            )
+            .unwrap()
+        })
+        .collect();
+
+    // Keep so few windows that some are evicted while stepping through the data.
+    let newton = ctx.with_newton_window_capacity(2);
+    let mut states = Vec::with_capacity(epochs.len());
+    for (epoch, expected) in epochs.iter().zip(expected.iter()) {
+        let state = newton
+            .translate(
+                summary.target_frame(),
+                summary.center_frame(),
+                *epoch,
+                Aberration::NONE,
+            )
+            .unwrap();
+        assert!(
+            relative_eq!(
+                state.radius_km,
+                expected.radius_km,
+                epsilon = POSITION_EPSILON_KM
+            ),
+            "{epoch}: {:e} km",
+            (state.radius_km - expected.radius_km).norm()
+        );
+        assert!(
+            relative_eq!(
+                state.velocity_km_s,
+                expected.velocity_km_s,
+                epsilon = VELOCITY_EPSILON_KM_S
+            ),
+            "{epoch}: {:e} km/s",
+            (state.velocity_km_s - expected.velocity_km_s).norm()
+        );
+        states.push(state);
+    }
+
+    // The capacity is a setting of the Almanac, so other threads use it too, while the original Almanac is unchanged.
+    std::thread::scope(|scope| {
+        scope.spawn(|| {
+            for (epoch, state) in epochs.iter().zip(states.iter()) {
+                let from_thread = newton
+                    .translate(
+                        summary.target_frame(),
+                        summary.center_frame(),
+                        *epoch,
+                        Aberration::NONE,
+                    )
+                    .unwrap();
+                assert_eq!(from_thread.radius_km, state.radius_km, "{epoch}");
+                assert_eq!(from_thread.velocity_km_s, state.velocity_km_s, "{epoch}");
+            }
+        });
+    });
+    for (epoch, expected) in epochs.iter().zip(expected.iter()) {
+        let state = ctx
+            .translate(
+                summary.target_frame(),
+                summary.center_frame(),
+                *epoch,
+                Aberration::NONE,
+            )
+            .unwrap();
+        assert_eq!(state.radius_km, expected.radius_km, "{epoch}");
+        assert_eq!(state.velocity_km_s, expected.velocity_km_s, "{epoch}");
+    }
+}
+
 /// This tests that the rotation from Moon to Earth matches SPICE with different aberration corrections.
 /// We test Moon->Earth Moon Barycenter (instead of Venus->SSB as above) because there is no stellar correction possible
 /// when the parent is the solar system barycenter.
@@ -321,3 +321,95 @@ fn regression_test_issue_112_test_iau_jupiter() {
         dcm.rot_mat - spice_dcm.rot_mat
     );
 }
+
+#[test]
+fn test_rotations_to_parent() {
+    let almanac = Almanac::default()
+        .load("../data/earth_latest_high_prec.bpc")
+        .unwrap()
+        .load("../data/pck08.pca")
+        .unwrap();
+
+    // Hourly over a few days, which spans several segments of the high precision Earth BPC.
+    let start = Epoch::from_gregorian_utc_at_midnight(2023, 1, 1);
+    let epochs: Vec<Epoch> =
+        TimeSeries::inclusive(start, start + Unit::Day * 5, Unit::Hour * 1).collect();
+
+    for frame in [EARTH_ITRF93, IAU_MOON_FRAME, EME2000] {
+        let dcms = almanac.rotations_to_parent(frame, epochs.clone()).unwrap();
+        assert_eq!(dcms.len(), epochs.len());
+        for (dcm, epoch) in dcms.iter().zip(epochs.iter()) {
+            let expected = almanac.rotation_to_parent(frame, *epoch).unwrap();
+            assert_eq!(dcm.rot_mat, expected.rot_mat, "{frame} @ {epoch}");
+            assert_eq!(dcm.rot_mat_dt, expected.rot_mat_dt, "{frame} @ {epoch}");
+            assert_eq!((dcm.from, dcm.to), (expected.from, expected.to));
+        }
+    }
+}
+
+#[test]
+fn test_planetary_rotation_model() {
+    for path in ["../data/pck08.pca", "../data/pck11.pca"] {
+        let almanac = Almanac::new(path).unwrap();
+        let ids: Vec<i32> = almanac.planetary_data.lut.by_id.keys().copied().collect();
+        assert!(!ids.is_empty());
+
+        // Skip the IDs which are also the inertial frames, whose rotations are embedded.
+        for id in ids
+            .into_iter()
+            .filter(|id| ![J2000, ECLIPJ2000].contains(id))
+        {
+            let frame = Frame::from_orient_ssb(id);
+            let model = almanac.planetary_rotation_model(frame).unwrap();
+            for epoch in TimeSeries::inclusive(
+                Epoch::from_gregorian_utc_at_midnight(1990, 1, 1),
+                Epoch::from_gregorian_utc_at_midnight(2050, 1, 1),
+                Unit::Day * 1001,
+            ) {
+                let expected = almanac.rotation_to_parent(frame, epoch).unwrap();
+                let dcm = model.rotation_to_parent(epoch);
+                // The compiled model skips the copies and zero terms, but computes exactly the same rotation.
+                assert_eq!(dcm.rot_mat, expected.rot_mat, "{path}: {id} @ {epoch}");
+                assert_eq!(
+                    dcm.rot_mat_dt, expected.rot_mat_dt,
+                    "{path}: {id} @ {epoch}"
+                );
+                assert_eq!((dcm.from, dcm.to), (expected.from, expected.to));
+            }
+        }
+    }
+}
+
+#[test]
+fn test_rotate_many() {
+    let almanac = Almanac::default()
+        .load("../data/earth_latest_high_prec.bpc")
+        .unwrap()
+        .load("../data/pck08.pca")
+        .unwrap();
+
+    // Every 20 minutes over a few days, which spans several segments of the high precision Earth BPC.
+    let start = Epoch::from_gregorian_utc_at_midnight(2023, 1, 1);
+    let epochs: Vec<Epoch> =
+        TimeSeries::inclusive(start, start + Unit::Day * 5, Unit::Minute * 20).collect();
+
+    for (from, to) in [
+        (EARTH_ITRF93, IAU_MOON_FRAME),
+        (IAU_MOON_FRAME, EARTH_ITRF93),
+        (EARTH_ITRF93, EME2000),
+        (IAU_JUPITER_FRAME, IAU_MOON_FRAME),
+        (EME2000, EME2000),
+    ] {
+        let dcms = almanac.rotate_many(from, to, epochs.clone()).unwrap();
+        assert_eq!(dcms.len(), epochs.len());
+        for (dcm, epoch) in dcms.iter().zip(epochs.iter()) {
+            let expected = almanac.rotate_from_to(from, to, *epoch).unwrap();
+            assert_eq!(dcm.rot_mat, expected.rot_mat, "{from} -> {to} @ {epoch}");
+            assert_eq!(
+                dcm.rot_mat_dt, expected.rot_mat_dt,
+                "{from} -> {to} @ {epoch}"
+            );
+            assert_eq!((dcm.from, dcm.to), (expected.from, expected.to));
+        }
+    }
+}